@@ -107,6 +107,7 @@ target_sources (xrpl_core PRIVATE
   src/ripple/protocol/impl/TxMeta.cpp
   src/ripple/protocol/impl/UintTypes.cpp
   src/ripple/protocol/impl/digest.cpp
+  src/ripple/protocol/impl/digest_batch.cpp
   src/ripple/protocol/impl/tokens.cpp
   #[===============================[
     main sources:
@@ -448,6 +449,15 @@ target_sources (rippled PRIVATE
   src/ripple/app/tx/impl/Transactor.cpp
   src/ripple/app/tx/impl/apply.cpp
   src/ripple/app/tx/impl/applySteps.cpp
+  src/ripple/app/hook/impl/EmittedTxnIndex.cpp
+  src/ripple/app/hook/impl/HookArena.cpp
+  src/ripple/app/hook/impl/HookChainCache.cpp
+  src/ripple/app/hook/impl/HookStats.cpp
+  src/ripple/app/hook/impl/HookTrace.cpp
+  src/ripple/app/hook/impl/HookValidationCache.cpp
+  src/ripple/app/hook/impl/MemorySnapshot.cpp
+  src/ripple/app/hook/impl/ModuleCache.cpp
+  src/ripple/app/hook/impl/WeakChainScheduler.cpp
   src/ripple/app/hook/impl/applyHook.cpp
   src/ripple/app/tx/impl/details/NFTokenUtils.cpp
   #[===============================[
@@ -555,6 +565,7 @@ target_sources (rippled PRIVATE
   src/ripple/overlay/impl/ProtocolVersion.cpp
   src/ripple/overlay/impl/TrafficCount.cpp
   src/ripple/overlay/impl/TxMetrics.cpp
+  src/ripple/overlay/impl/TxVerifyQueue.cpp
   #[===============================[
      main sources:
        subdir: peerfinder
@@ -598,6 +609,8 @@ target_sources (rippled PRIVATE
   src/ripple/rpc/handlers/FetchInfo.cpp
   src/ripple/rpc/handlers/GatewayBalances.cpp
   src/ripple/rpc/handlers/GetCounts.cpp
+  src/ripple/rpc/handlers/HookStats.cpp
+  src/ripple/rpc/handlers/HookTrace.cpp
   src/ripple/rpc/handlers/LedgerAccept.cpp
   src/ripple/rpc/handlers/LedgerCleanerHandler.cpp
   src/ripple/rpc/handlers/LedgerClosed.cpp
@@ -695,16 +708,30 @@ if (tests)
     src/test/app/DepositAuth_test.cpp
     src/test/app/Discrepancy_test.cpp
     src/test/app/DNS_test.cpp
+    src/test/app/EmittedTxnIndex_test.cpp
     src/test/app/Escrow_test.cpp
     src/test/app/FeeVote_test.cpp
     src/test/app/Flow_test.cpp
     src/test/app/Freeze_test.cpp
+    src/test/app/Guard_test.cpp
     src/test/app/HashRouter_test.cpp
+    src/test/app/HookArena_test.cpp
+    src/test/app/HookBench_test.cpp
+    src/test/app/HookChainCache_test.cpp
+    src/test/app/HookFuel_test.cpp
+    src/test/app/HookNative_test.cpp
+    src/test/app/HookStateMap_test.cpp
+    src/test/app/HookStats_test.cpp
+    src/test/app/HookTrace_test.cpp
+    src/test/app/HookValidationCache_test.cpp
+    src/test/app/LRUMap_test.cpp
     src/test/app/LedgerHistory_test.cpp
     src/test/app/LedgerLoad_test.cpp
     src/test/app/LedgerReplay_test.cpp
     src/test/app/LoadFeeTrack_test.cpp
     src/test/app/Manifest_test.cpp
+    src/test/app/MemorySnapshot_test.cpp
+    src/test/app/ModuleCache_test.cpp
     src/test/app/MultiSign_test.cpp
     src/test/app/NetworkID_test.cpp
     src/test/app/NFToken_test.cpp
@@ -721,6 +748,7 @@ if (tests)
     src/test/app/RCLValidations_test.cpp
     src/test/app/Regression_test.cpp
     src/test/app/SHAMapStore_test.cpp
+    src/test/app/STOIndex_test.cpp
     src/test/app/SetAuth_test.cpp
     src/test/app/SetRegularKey_test.cpp
     src/test/app/SetTrust_test.cpp
@@ -733,6 +761,8 @@ if (tests)
     src/test/app/ValidatorKeys_test.cpp
     src/test/app/ValidatorList_test.cpp
     src/test/app/ValidatorSite_test.cpp
+    src/test/app/WeakChainScheduler_test.cpp
+    src/test/app/XFL_test.cpp
     src/test/app/SetHook_test.cpp
     src/test/app/tx/apply_test.cpp
     #[===============================[
@@ -930,6 +960,7 @@ if (tests)
     src/test/protocol/Seed_test.cpp
     src/test/protocol/SeqProxy_test.cpp
     src/test/protocol/TER_test.cpp
+    src/test/protocol/digest_test.cpp
     src/test/protocol/types_test.cpp
     #[===============================[
        test sources:
@@ -955,6 +986,7 @@ if (tests)
     src/test/rpc/Fee_test.cpp
     src/test/rpc/GatewayBalances_test.cpp
     src/test/rpc/GetCounts_test.cpp
+    src/test/rpc/InfoSubMessage_test.cpp
     src/test/rpc/JSONRPC_test.cpp
     src/test/rpc/KeyGeneration_test.cpp
     src/test/rpc/LedgerClosed_test.cpp
@@ -995,6 +1027,7 @@ if (tests)
          subdir: shamap
     #]===============================]
     src/test/shamap/FetchPack_test.cpp
+    src/test/shamap/SHAMapFlush_test.cpp
     src/test/shamap/SHAMapSync_test.cpp
     src/test/shamap/SHAMap_test.cpp
     #[===============================[
@@ -0,0 +1,79 @@
+#ifndef HOOK_EMITTED_TXN_INDEX_INCLUDED
+#define HOOK_EMITTED_TXN_INDEX_INCLUDED 1
+#include <ripple/basics/UnorderedContainers.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/beast/utility/Journal.h>
+#include <ripple/ledger/ReadView.h>
+#include <ripple/protocol/STTx.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace hook
+{
+    /**
+     * The emitted transactions waiting in the emitted directory, each parsed once and ordered by the
+     * ledgers they become ready in and expire after, for TxQ::accept to inject.
+     *
+     * The directory stays the authority. The open ledger can be built on a ledger this server did
+     * not apply itself, so every update walks the key lists of the directory's pages and reconciles
+     * the index with them. That walk only reads the pages, an entry itself is read and parsed only
+     * the first time its key is seen, or not at all when finalizeHookResult emitted it on this
+     * server and handed over the parsed transaction. Only the transactions due in the ledger are
+     * returned.
+     */
+    class EmittedTxnIndex
+    {
+        public:
+            struct Due
+            {
+                std::vector<ripple::uint256> pending;   // ids of every well formed emitted txn in the directory
+                std::vector<std::shared_ptr<ripple::STTx const>> ready;     // FirstLedgerSequence is this ledger
+                std::vector<std::shared_ptr<ripple::STTx const>> expired;   // LastLedgerSequence has passed
+            };
+
+        private:
+            struct Entry
+            {
+                std::shared_ptr<ripple::STTx const> tx;     // nullptr if the entry is not a usable emitted txn
+                uint32_t firstSeq = 0;
+                uint32_t lastSeq = 0;
+                uint64_t seen = 0;      // the last update which found the entry in the directory, 0 for none
+            };
+
+            using Order = std::set<std::pair<uint32_t, ripple::uint256>>;
+
+            std::mutex mutex_;
+            ripple::hash_map<ripple::uint256, Entry> entries_;     // by emitted txn ledger key
+            Order byFirst_;
+            Order byLast_;
+            uint64_t generation_ = 0;
+
+            Entry&
+            add(ripple::uint256 const& key, std::shared_ptr<ripple::STTx const> tx);
+
+            void
+            remove(ripple::uint256 const& key);
+
+        public:
+            // the parsed form of a transaction just added to the emitted directory by this server
+            void
+            emitted(std::shared_ptr<ripple::STTx const> const& tx);
+
+            // the emitted txn with this id has left the emitted directory
+            void
+            removed(ripple::uint256 const& txnID);
+
+            // reconcile with the emitted directory of view and return what is due in its ledger
+            Due
+            update(ripple::ReadView const& view, beast::Journal const& j);
+
+            std::size_t
+            size();
+    };
+}
+
+#endif
@@ -1,5 +1,7 @@
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 #ifndef HOOKENUM_INCLUDED
 #define HOOKENUM_INCLUDED 1
 namespace ripple
@@ -323,5 +325,61 @@ namespace hook_api
         {"otxn_param",{0x7EU,0x7FU,0x7FU,0x7FU,0x7FU}},
         {"meta_slot",{0x7EU,0x7FU}}        
     };
+
+    // imports added by amendments: hooks may only import these when the matching bit is set in the
+    // rules version the guard checker is given
+    // 0x01: featureHookStatePrefetch
+    // (0x02: featureHookFuel adds no imports, it has the guard checker price hooks in fuel)
+    static const std::map<std::string, std::vector<uint8_t>> import_whitelist_1
+    {
+        {"state_prefetch",{0x7EU,0x7FU,0x7FU,0x7FU,0x7FU}},
+    };
+
+    // the signature of an api function hooks may import under rulesVersion, nullptr if they may not
+    inline std::vector<uint8_t> const*
+    import_signature(std::string const& api_name, uint64_t rulesVersion)
+    {
+        if (auto const it = import_whitelist.find(api_name); it != import_whitelist.end())
+            return &it->second;
+
+        if (rulesVersion & 0x01U)
+            if (auto const it = import_whitelist_1.find(api_name); it != import_whitelist_1.end())
+                return &it->second;
+
+        return nullptr;
+    }
+
+    // the fuel a wasm instruction burns once featureHookFuel is enabled, by its first byte, so a
+    // prefixed (0xFC, 0xFD) instruction burns what its prefix does. the guard checker prices hooks
+    // with it and the executor meters them with it, an instruction burns at least 1
+    inline uint64_t
+    instruction_fuel(uint8_t opcode)
+    {
+        switch (opcode)
+        {
+            case 0x10U:     // call, the only functions a hook may call are host functions
+                return 5;
+
+            case 0x6DU: case 0x6EU: case 0x6FU: case 0x70U:     // i32.div_s/u, i32.rem_s/u
+            case 0x7FU: case 0x80U: case 0x81U: case 0x82U:     // i64.div_s/u, i64.rem_s/u
+            case 0x91U: case 0x95U:                             // f32.sqrt, f32.div
+            case 0x9FU: case 0xA3U:                             // f64.sqrt, f64.div
+                return 4;
+
+            case 0xFCU:     // bulk memory and saturating truncation
+                return 8;
+
+            case 0xFDU:     // vector instructions
+                return 2;
+
+            default:
+                break;
+        }
+
+        if (opcode >= 0x28U && opcode <= 0x3EU)     // loads and stores
+            return 2;
+
+        return 1;
+    }
 };
 #endif
@@ -1,13 +1,17 @@
+#ifndef GUARD_INCLUDED
+#define GUARD_INCLUDED 1
 #include <map>
 #include <vector>
 #include <string_view>
 #include <utility>
 #include <iostream>
 #include <ostream>
-#include <stack>
+#include <optional>
 #include <string>
 #include <functional>
-#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <ripple/basics/Slice.h>
 #include "Enum.h"
 
 using GuardLog = std::optional<std::reference_wrapper<std::basic_ostream<char>>>;
@@ -23,79 +27,105 @@ using GuardLog = std::optional<std::reference_wrapper<std::basic_ostream<char>>>
         else\
             (*guardLog).get() << "HookSet(" << logCode << ")[" << guardLogAccStr << "]: "
 
+/**
+ * The guard checker walks the hook's byte code once, without copying it and without throwing.
+ *
+ * Its verdicts are consensus relevant, so it deliberately keeps every quirk of the checker it
+ * replaced: offsets are ints, LEB128 values are truncated to the type they are stored in, section
+ * lengths and code sizes may point backwards, and a value starting past the end decodes as 0. The
+ * only differences are on input which made the old checker read out of bounds or never return,
+ * both are rejected here. src/test/app/Guard_test.cpp compares the two.
+ */
+
 // web assembly contains a lot of run length encoding in LEB128 format
-inline uint64_t
+// decodes the value at offset into val and moves offset past it. returns false if the value is
+// truncated or overflows. a value starting outside of buf decodes as 0 and leaves offset as it is,
+// callers find that with their bounds checks
+inline bool
 parseLeb128(
-    std::vector<unsigned char> const& buf,
-    int start_offset,
-    int* end_offset)
+    ripple::Slice const& buf,
+    int& offset,
+    uint64_t& val)
 {
-    uint64_t val = 0, shift = 0, i = start_offset;
-    while (i < buf.size())
+    val = 0;
+    if (offset < 0)
+        return true;
+
+    uint8_t const* const data = buf.data();
+    std::size_t const size = buf.size();
+    uint64_t shift = 0;
+    for (std::size_t i = offset; i < size; )
     {
-        uint64_t b = (uint64_t)(buf[i]);
-        uint64_t last = val;
-        val += (b & 0x7FU) << shift;
+        uint64_t const b = data[i];
+        uint64_t const last = val;
+        // shifts past 63 wrap around as they always have on x86-64
+        val += (b & 0x7FU) << (shift & 63U);
         if (val < last)
-        {
-            // overflow
-            throw std::overflow_error { "leb128 overflow" };
-        }
+            return false;   // overflow
         ++i;
         if (b & 0x80U)
         {
             shift += 7;
-            if (!(i < buf.size()))
-                throw std::length_error { "leb128 short or invalid" };
             continue;
         }
-        *end_offset = i;
-
-        return val;
+        offset = static_cast<int>(i);
+        return true;
     }
-    return 0;
+
+    // either there was nothing to decode or the last byte announced another
+    return static_cast<std::size_t>(offset) >= size;
 }
 
-inline int64_t
-parseSignedLeb128(
-    std::vector<unsigned char> const& buf,
-    int start_offset,
-    int* end_offset)
+// as parseLeb128, for the immediates the guard checker never needs the value of
+inline bool
+skipLeb128(
+    ripple::Slice const& buf,
+    int& offset)
 {
+    uint64_t val;
+    return parseLeb128(buf, offset, val);
+}
+
+// as parseLeb128 for a signed value, the guard checker never needs the value itself
+inline bool
+skipSignedLeb128(
+    ripple::Slice const& buf,
+    int& offset)
+{
+    if (offset < 0)
+        return true;
+
+    uint8_t const* const data = buf.data();
+    std::size_t const size = buf.size();
     int64_t val = 0;
-    uint64_t shift = 0, i = start_offset;
-    while (i < buf.size())
+    uint64_t shift = 0;
+    for (std::size_t i = offset; i < size; )
     {
-        uint64_t b = (uint64_t)(buf[i]);
-        int64_t last = val;
-        val += (b & 0x7FU) << shift;
+        uint64_t const b = data[i];
+        int64_t const last = val;
+        val = static_cast<int64_t>(static_cast<uint64_t>(val) + ((b & 0x7FU) << (shift & 63U)));
         if (val < last)
-        {
-            // overflow
-            throw std::overflow_error { "leb128 overflow" };
-        }
+            return false;   // overflow
         ++i;
         if (b & 0x80U)
         {
             shift += 7;
-            if (!(i < buf.size()))
-                throw std::length_error { "leb128 short or invalid" };
             continue;
         }
-        *end_offset = i;
-        if (shift < 64 && (b&0x40U))
-            val |= (~0 << shift);
-
-        return val;
+        offset = static_cast<int>(i);
+        return true;
     }
-    return 0;
+
+    return static_cast<std::size_t>(offset) >= size;
 }
 
 
-// this macro will return temMALFORMED if i ever exceeds the end of the hook
+// the macros below are used where the byte code is `hook` and the offset being read is `i`
+
+// this macro will return temMALFORMED if i is not inside the hook
 #define CHECK_SHORT_HOOK()\
 {\
-    if (i >= hook.size())\
+    if (i < 0 || static_cast<std::size_t>(i) >= hook.size())\
     {\
         \
         GUARDLOG(hook::log::SHORT_HOOK) \
@@ -108,7 +138,8 @@ parseSignedLeb128(
 
 #define REQUIRE(x)\
 {\
-    if (i + (x) > hook.size())\
+    if (static_cast<int64_t>(i) + (x) < 0 ||\
+        static_cast<std::size_t>(static_cast<int64_t>(i) + (x)) > hook.size())\
     {\
         \
         GUARDLOG(hook::log::SHORT_HOOK) \
@@ -123,11 +154,41 @@ parseSignedLeb128(
     i += (x);\
 }
 
-#define LEB()\
-    parseLeb128(hook, i, &i)
+// read the LEB128 at i into x, converting it as an assignment would
+#define LEB(x)\
+{\
+    uint64_t leb;\
+    if (!parseLeb128(hook, i, leb))\
+    {\
+        GUARDLOG(hook::log::SHORT_HOOK) \
+            << "Malformed transaction: Hook contained a truncated or overflowing leb128. "\
+            << "SetHook.cpp:" << __LINE__ << "\n";\
+        return {};\
+    }\
+    x = leb;\
+}
 
-#define SIGNED_LEB()\
-    parseSignedLeb128(hook, i, &i)
+#define SKIP_LEB()\
+{\
+    if (!skipLeb128(hook, i))\
+    {\
+        GUARDLOG(hook::log::SHORT_HOOK) \
+            << "Malformed transaction: Hook contained a truncated or overflowing leb128. "\
+            << "SetHook.cpp:" << __LINE__ << "\n";\
+        return {};\
+    }\
+}
+
+#define SKIP_SIGNED_LEB()\
+{\
+    if (!skipSignedLeb128(hook, i))\
+    {\
+        GUARDLOG(hook::log::SHORT_HOOK) \
+            << "Malformed transaction: Hook contained a truncated or overflowing leb128. "\
+            << "SetHook.cpp:" << __LINE__ << "\n";\
+        return {};\
+    }\
+}
 
 #define GUARD_ERROR(msg)\
 {\
@@ -142,147 +203,69 @@ parseSignedLeb128(
 }
 
 
+// a block which has not ended yet
 struct WasmBlkInf
 {
-    uint32_t sanity_check;
     uint32_t iteration_bound;
     uint32_t instruction_count;
-    WasmBlkInf* parent;
-    std::vector<WasmBlkInf*> children;
-    uint32_t start_byte;
-    bool is_root;
-
-    WasmBlkInf(
-            uint32_t iteration_bound_,
-            uint32_t instruction_count_,
-            WasmBlkInf* parent_,
-            uint32_t start_byte_,
-            bool is_root_ = false)
-        :
-            sanity_check(0x1234ABCDU),
-            iteration_bound(iteration_bound_),
-            instruction_count(instruction_count_),
-            children({}),
-            parent(parent_),
-            start_byte(start_byte_),
-            is_root(is_root_)
-    {
-        // all done by the above
-    }
-
-    WasmBlkInf* add_child(uint32_t iteration_bound, uint32_t start_byte)
-    {
-        WasmBlkInf* child = new WasmBlkInf(iteration_bound, 0, this, start_byte, false);
-        children.push_back(child);
-        return child;
-    }
-
-    void free_children(WasmBlkInf* blk)
-    {
-        for (WasmBlkInf* child : blk->children)
-            free_children(child);
-        delete blk;
-    }
-
-
-    ~WasmBlkInf()
-    {
-        // only the root is responsible for freeing
-        if (is_root)
-            for (WasmBlkInf* child : children)
-                free_children(child);
-    }
-
+    uint64_t children_wce;      // worst case execution of the blocks which ended inside this one
+    int level;                  // 0 for the function body
 };
 
-#define PRINT_WCE(x)\
-{\
-    if (DEBUG_GUARD)\
-         printf("%llx:: [%u]%.*swce=%ld | start=%x instcount=%u guard=%u, "\
-                 "parent_guard=%d, multiplier=%g parentptr=%llx\n",\
-             &blk,\
-             x,\
-             level, "                                                                                  ",\
-             worst_case_execution,\
-             blk->start_byte,\
-             blk->instruction_count,\
-             blk->iteration_bound,\
-             (blk->parent != 0 ? blk->parent->iteration_bound : -1),\
-             multiplier, &(blk->parent));\    
-}
-// compute worst case execution time
+// compute worst case execution time of a block which has ended, its parent is nullptr for the
+// function body
 inline
-uint64_t compute_wce (const WasmBlkInf* blk, int level, bool* recursion_limit_reached)
+uint64_t compute_wce(WasmBlkInf const& blk, WasmBlkInf const* parent)
 {
-        if (level > 16)
-        {
-            *recursion_limit_reached = true;
-            return 0;
-        }
-
-        if (blk->sanity_check != 0x1234ABCDU)
-        {
-            printf("!!! sanity check failed\n");
-            *recursion_limit_reached = true;
-            return (uint64_t)-1;
-        }
-
-        WasmBlkInf const* parent = blk->parent;
-
-        if (parent && parent->sanity_check != 0x1234ABCDU)
-        {
-            printf("!!! parent sanity check failed\n");
-            *recursion_limit_reached = true;
-            return (uint64_t)-1;
-        }
-
-        uint64_t worst_case_execution = blk->instruction_count;
-        double multiplier = 1.0;
-
-        if (blk->children.size() > 0)
-            for (auto const& child : blk->children)
-                worst_case_execution += compute_wce(child, level + 1, recursion_limit_reached);
+    uint64_t worst_case_execution = blk.instruction_count;
+    worst_case_execution += blk.children_wce;
 
-        if (parent == 0 ||
-            parent->iteration_bound == 0)  // this condtion should never occur [defensively programmed]
-        {
-            PRINT_WCE(1);
-            return worst_case_execution;
-        }
+    if (parent == 0 ||
+        parent->iteration_bound == 0)  // this condtion should never occur [defensively programmed]
+        return worst_case_execution;
 
-        // if the block has a parent then the quotient of its guard and its parent's guard
-        // gives us the loop iterations and thus the multiplier for the instruction count
-        multiplier =
-            ((double)(blk->iteration_bound)) /
-            ((double)(parent->iteration_bound));
+    // if the block has a parent then the quotient of its guard and its parent's guard
+    // gives us the loop iterations and thus the multiplier for the instruction count
+    double multiplier =
+        ((double)(blk.iteration_bound)) /
+        ((double)(parent->iteration_bound));
 
-        worst_case_execution *= multiplier;
-        if (worst_case_execution < 1.0)
-            worst_case_execution = 1.0;
+    worst_case_execution *= multiplier;
+    if (worst_case_execution < 1.0)
+        worst_case_execution = 1.0;
 
-        PRINT_WCE(3);
-        return worst_case_execution;
-    };
+    return worst_case_execution;
+}
 
 
 // checks the WASM binary for the appropriate required _g guard calls and rejects it if they are not found
 // start_offset is where the codesection or expr under analysis begins and end_offset is where it ends
 // returns {worst case instruction count} if valid or {} if invalid
-// may throw overflow_error, length_error
+//
+// blocks are kept on a stack rather than in a tree: when a block ends its worst case execution is
+// folded into the block it is in, so nothing is left to walk once the expr has been read
+//
+// the worst case instruction count leaves out the guard call at each loop start, so it is not a bound
+// on what the vm executes. if fuel_bound is given it is set to a bound on the fuel (see
+// hook_api::instruction_fuel) the vm meters: every instruction's fuel counted as many times as its
+// innermost loop's guard allows, and each loop's opcode and guard call counted once more than that,
+// the last call being the one which rolls the hook back
 inline
 std::optional<uint64_t>
 check_guard(
-    std::vector<uint8_t> const& hook,
+    ripple::Slice const& hook,
     int codesec,
     int start_offset,
     int end_offset,
     int guard_func_idx,
     int last_import_idx,
     GuardLog guardLog,
-    std::string guardLogAccStr)
+    std::string const& guardLogAccStr,
+    uint64_t* fuel_bound = nullptr)
 {
 
     #define MAX_GUARD_CALLS 1024
+    #define MAX_BLOCK_LEVEL 16
     uint32_t guard_count = 0;
 
     if (DEBUG_GUARD)
@@ -291,35 +274,30 @@ check_guard(
                codesec, start_offset, end_offset, guard_func_idx, last_import_idx);
 
     if (end_offset <= 0) end_offset = hook.size();
-    int block_depth = 0;
 
-    // the root node is constructed in a unique ptr, which will cause its destructor to be called
-    // when the function exits. The destructor of the root node will recursively free all heap allocated children.
-    //WasmBlkInf(uint32_t iteration_bound_, uint32_t instruction_count_,
-    //        WasmBlkInf* parent_, uint32_t start_byte_, bool is_root_ = false) : 
-    std::unique_ptr<WasmBlkInf> root = std::make_unique<WasmBlkInf>(1, 0, (WasmBlkInf*)0, start_offset, true); 
-     
-    WasmBlkInf* current = &(*root);    
+    uint64_t fuel = 0;
 
-    if (DEBUG_GUARD)
-        printf("\n\n\nstart of guard analysis for codesec %d\n", codesec);
+    // the open blocks, innermost last, the first is the function body
+    std::vector<WasmBlkInf> blocks;
+    blocks.reserve(MAX_BLOCK_LEVEL + 1);
+    blocks.push_back({1, 0, 0, 0});
 
-    for (int i = start_offset; i < end_offset; )
+    auto const end_block = [&blocks]()
     {
+        uint64_t const wce = compute_wce(blocks.back(), &blocks[blocks.size() - 2]);
+        blocks.pop_back();
+        blocks.back().children_wce += wce;
+    };
 
-        if (DEBUG_GUARD_VERY_VERBOSE)
-        {
-            printf("->");
-            for (int z = i; z < 16 + i && z < end_offset; ++z)
-                printf("%02X", hook[z]);
-            printf("\n");
-        }
-
+    for (int i = start_offset; i < end_offset; )
+    {
         REQUIRE(1);
         uint8_t instr = hook[i];
         ADVANCE(1);
 
-        current->instruction_count++;
+        WasmBlkInf& current = blocks.back();
+        current.instruction_count++;
+        fuel += hook_api::instruction_fuel(instr) * current.iteration_bound;
 
         // unreachable and nop instructions
         if (instr == 0x00U ||   // unreachable
@@ -331,10 +309,6 @@ check_guard(
             instr == 0x03U ||   // loop
             instr == 0x04U)     // if
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("%s instruction at %d [%x]\n",
-                    (instr == 0x02U ? "Block" : (instr == 0x03U ? "Loop" : "If")), i, i);
-
             // there must be at least a one byte block return type here
             REQUIRE(1);
 
@@ -342,16 +316,16 @@ check_guard(
             uint8_t block_type = hook[i];
             if ((block_type >= 0x7CU && block_type <= 0x7FU) ||
                  block_type == 0x7BU || block_type == 0x70U  ||
-                 block_type == 0x7BU || block_type == 0x40U)
+                 block_type == 0x40U)
             {
                 ADVANCE(1);
             }
             else
             {
-                SIGNED_LEB();
+                SKIP_SIGNED_LEB();
             }
 
-            uint32_t iteration_bound = (current->parent == 0 ? 1 : current->iteration_bound);
+            uint32_t iteration_bound = (blocks.size() == 1 ? 1 : current.iteration_bound);
             if (instr == 0x03U)
             {
                 // now look for the guard call
@@ -365,21 +339,22 @@ check_guard(
                 if (hook[i] != 0x41U)
                     GUARD_ERROR("Missing first i32.const after loop instruction");
                 ADVANCE(1);
-                SIGNED_LEB();          // this is the ID, we don't need it here
+                SKIP_SIGNED_LEB();     // this is the ID, we don't need it here
 
                 // second i32
                 REQUIRE(1);
                 if (hook[i] != 0x41U)
                     GUARD_ERROR("Missing second i32.const after loop instruction");
                 ADVANCE(1);
-                iteration_bound = LEB();   // second param is the iteration bound, which is important here
+                LEB(iteration_bound);   // second param is the iteration bound, which is important here
 
                 // guard call
                 REQUIRE(1);
                 if (hook[i] != 0x10U)
                     GUARD_ERROR("Missing call to _g after first and second i32.const at loop start");
                 ADVANCE(1);
-                uint64_t call_func_idx = LEB();     // the function being called *must* be the _g function
+                uint64_t call_func_idx;
+                LEB(call_func_idx);     // the function being called *must* be the _g function
 
                 if (iteration_bound == 0)
                     GUARD_ERROR("Guard call cannot specify 0 maxiter.");
@@ -389,78 +364,69 @@ check_guard(
 
                 if (guard_count++ > MAX_GUARD_CALLS)
                     GUARD_ERROR("Too many guard calls! Limit is 1024");
+
+                // loop, i32.const, i32.const, call _g
+                fuel +=
+                    (hook_api::instruction_fuel(0x03U) + 2 * hook_api::instruction_fuel(0x41U) +
+                     hook_api::instruction_fuel(0x10U)) * ((uint64_t)iteration_bound + 1);
             }
 
-            current = current->add_child(iteration_bound, i);
-            block_depth++;
+            int const level = current.level + 1;
+            if (level > MAX_BLOCK_LEVEL)
+            {
+                GUARDLOG(hook::log::NESTING_LIMIT) << "GuardCheck "
+                    << "Maximum allowable depth of blocks reached (16 levels). Flatten your loops and conditions!.\n";
+                return {};
+            }
+
+            blocks.push_back({iteration_bound, 0, 0, level});
             continue;
         }
 
         if (instr == 0x0BU)     // block end
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - block end instruction at %d [%x]\n", i, i);
-
-            block_depth--;
-            current = current->parent;
-            if (current == 0 && block_depth == -1 && (i >= end_offset))
-                break;          // codesec end
-            else if (current == 0)
-            {
-                GUARD_ERROR("Illegal block end (current==0)");
-            }
-            else if (block_depth < 0)
+            if (blocks.size() > 1)
             {
-                GUARD_ERROR("Illegal block end (block_depth<0)");
+                end_block();
+                continue;
             }
 
+            if (i >= end_offset)
+                break;          // codesec end
 
-            if (current->sanity_check != 0x1234ABCDU)
-            {
-                GUARD_ERROR("Sanity check failed (bad pointer)");
-            }            
-            continue;
+            GUARD_ERROR("Illegal block end (current==0)");
         }
 
         if (instr == 0x0CU ||   // br
             instr == 0x0DU)     // br_if
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - %s instruction at %d [%x]\n",
-                    (instr == 0x0CU ? "br" : "br_if"), i, i);
-
             REQUIRE(1);
-            LEB();
+            SKIP_LEB();
             continue;
         }
 
         if (instr == 0x0EU)     // br_table
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - br_table instruction at %d [%x]\n", i, i);
-
-            int vec_count = LEB();
+            int vec_count;
+            LEB(vec_count);
             for (int v = 0; v < vec_count; ++v)
             {
                 REQUIRE(1);
-                LEB();
+                SKIP_LEB();
             }
             REQUIRE(1);
-            LEB();
+            SKIP_LEB();
             continue;
         }
 
         if (instr == 0x0FU)     // return
-        {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - return instruction at %d [%x]\n", i, i);
             continue;
-        }
 
         if (instr == 0x10U)     // call
         {
             REQUIRE(1);
-            uint64_t callee_idx = LEB();
+            uint64_t callee_idx;
+            LEB(callee_idx);
             // disallow calling of user defined functions inside a hook
             if (callee_idx > last_import_idx)
             {
@@ -494,9 +460,6 @@ check_guard(
         // reference instructions
         if (instr >= 0xD0U && instr <= 0xD2)
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - reference instruction at %d [%x]\n", i, i);
-
             if (instr == 0x0D0U)
             {
                 REQUIRE(1);
@@ -509,7 +472,7 @@ check_guard(
             if (instr == 0x0D2U)
             {
                 REQUIRE(1);
-                LEB();
+                SKIP_LEB();
             }
 
             continue;
@@ -520,13 +483,11 @@ check_guard(
             instr == 0x1BU ||   // select
             instr == 0x1CU)     // select t*
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - parametric instruction at %d [%x]\n", i, i);
-
             if (instr == 0x1CU)     // select t*
             {
                 REQUIRE(1);
-                uint64_t vec_count = LEB();
+                uint64_t vec_count;
+                LEB(vec_count);
                 for (uint64_t n = 0; n < vec_count; ++n)
                 {
                     REQUIRE(1);
@@ -546,11 +507,8 @@ check_guard(
         // variable instructions
         if (instr >= 0x20U && instr <= 0x24U)
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - variable instruction at %d [%x]\n", i, i);
-
             REQUIRE(1);
-            LEB();
+            SKIP_LEB();
             continue;
         }
 
@@ -563,37 +521,33 @@ check_guard(
             REQUIRE(1);
             if (instr != 0xFCU)
             {
-                if (DEBUG_GUARD_VERBOSE)
-                    printf("Guard checker - table instruction at %d [%x]\n", i, i);
-                LEB();
+                SKIP_LEB();
                 continue;
             }
 
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - 0xFC instruction at %d [%x]\n", i, i);
-
-            uint64_t fc_type = LEB();
+            uint64_t fc_type;
+            LEB(fc_type);
             REQUIRE(1);
 
             if (fc_type >= 12 && fc_type <= 17)     // table instructions
             {
-                LEB();
+                SKIP_LEB();
                 if (fc_type == 12 ||    // table.init
                     fc_type == 14)      // table.copy
                 {
                     REQUIRE(1);
-                    LEB();
+                    SKIP_LEB();
                 }
             }
             else if (fc_type == 8)      // memory.init
             {
-                LEB();
+                SKIP_LEB();
                 REQUIRE(1);
                 ADVANCE(1);
             }
             else if (fc_type == 9)      // data.drop
             {
-                LEB();
+                SKIP_LEB();
             }
             else if (fc_type == 10)     // memory.copy
             {
@@ -617,22 +571,16 @@ check_guard(
         // memory instructions
         if (instr >= 0x28U && instr <= 0x3EU)   // various loads and stores
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - memory instruction at %d [%x]\n", i, i);
-
             REQUIRE(1);
-            LEB();
+            SKIP_LEB();
             REQUIRE(1);
-            LEB();
+            SKIP_LEB();
             continue;
         }
 
         // more memory instructions
         if (instr == 0x3FU || instr == 0x40U)
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - memory instruction 2 at %d [%x]\n", i, i);
-
             REQUIRE(1);
 
             if (instr == 0x40U) // disallow memory.grow
@@ -651,19 +599,14 @@ check_guard(
         // numeric instructions (i32, i64)
         if (instr == 0x41U || instr == 0x42U)   // i32/64.const
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - i.const at %d [%x]\n", i, i);
             REQUIRE(1);
-            LEB();
+            SKIP_LEB();
             continue;
         }
 
         // more numeric instructions
         if (instr == 0x43U)     // f32.const
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - f32.const at %d [%x]\n", i, i);
-
             REQUIRE(4);
             ADVANCE(4);
             continue;
@@ -671,9 +614,6 @@ check_guard(
 
         if (instr == 0x44U)     // f64.const
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - f64.const at %d [%x]\n", i, i);
-
             REQUIRE(8);
             ADVANCE(8);
             continue;
@@ -682,9 +622,6 @@ check_guard(
         // even more numeric instructions
         if (instr >= 0x45U && instr <= 0xC4U)
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - numeric instruction at %d [%x]\n", i, i);
-
             // these have no arguments
             continue;
         }
@@ -692,21 +629,19 @@ check_guard(
         // vector instructions
         if (instr == 0xFDU)
         {
-            if (DEBUG_GUARD_VERBOSE)
-                printf("Guard checker - vector instruction at %d [%x]\n", i, i);
-
             REQUIRE(1);
-            uint64_t v = LEB();
+            uint64_t v;
+            LEB(v);
 
             if (v <= 11)  // memargs only
             {
-                REQUIRE(1); LEB();
-                REQUIRE(1); LEB();
+                REQUIRE(1); SKIP_LEB();
+                REQUIRE(1); SKIP_LEB();
             }
             else if (v >= 84U && v <= 91U)  // memargs + laneidx (1b)
             {
-                REQUIRE(1); LEB();
-                REQUIRE(1); LEB();
+                REQUIRE(1); SKIP_LEB();
+                REQUIRE(1); SKIP_LEB();
                 REQUIRE(1); ADVANCE(1);
             }
             else if (v >= 21U && v <= 34U)  // laneidx (1b)
@@ -735,14 +670,11 @@ check_guard(
         }
     }
 
-    bool recursion_limit_reached = false;
-    uint64_t wce = compute_wce(&(*root), 0, &recursion_limit_reached);
-    if (recursion_limit_reached)
-    {
-        GUARDLOG(hook::log::NESTING_LIMIT) << "GuardCheck "
-            << "Maximum allowable depth of blocks reached (16 levels). Flatten your loops and conditions!.\n";
-        return {};
-    }
+    // blocks still open when the expr ran out end with it
+    while (blocks.size() > 1)
+        end_block();
+
+    uint64_t wce = compute_wce(blocks.front(), nullptr);
 
     GUARDLOG(hook::log::INSTRUCTION_COUNT) << "GuardCheck "
         << "Total worse-case execution count: " << wce << "\n";
@@ -754,21 +686,224 @@ check_guard(
             << "or check your guards!" << "\n";
         return {};
     }
+
+    if (fuel_bound)
+        *fuel_bound = fuel;
+
     return wce;
 }
 
-// RH TODO: reprogram this function to use REQUIRE/ADVANCE
-// may throw overflow_error
+// checks the function types declared by the type section starting at i (after its length)
+// hook_type_idx is the type of hook() and cbak(), import_type_map the types of the imports
+inline
+bool
+check_types(
+    ripple::Slice const& hook,
+    int i,
+    int hook_type_idx,
+    std::map<int, std::map<int, std::string>> const& import_type_map,
+    uint64_t rulesVersion,
+    GuardLog guardLog,
+    std::string const& guardLogAccStr)
+{
+    int const section_type = 1;
+
+    int type_count;
+    LEB(type_count); CHECK_SHORT_HOOK();
+    for (int j = 0; j < type_count; ++j)
+    {
+        if (hook[i++] != 0x60)
+        {
+            GUARDLOG(hook::log::FUNC_TYPE_INVALID)
+                << "Invalid function type. "
+                << "Codesec: " << section_type << " "
+                << "Local: " << j << " "
+                << "Offset: " << i << "\n";
+            return {};
+        }
+        CHECK_SHORT_HOOK();
+
+        // check the consistency of the type
+        std::optional<std::string> first_name;
+        std::optional<std::reference_wrapper<std::vector<uint8_t> const>> first_signature;
+        if (auto const& usage = import_type_map.find(j); usage != import_type_map.end())
+        {
+            for (auto const& [import_idx, api_name] : usage->second)
+            {
+                auto const& api_signature =
+                    *hook_api::import_signature(api_name, rulesVersion);
+
+                if (!first_signature)
+                {
+                    first_name = api_name;
+                    first_signature = api_signature;
+                    continue;
+                }
+
+                if (api_signature != (*first_signature).get())
+                {
+                    GUARDLOG(hook::log::FUNC_TYPE_INVALID)
+                        << "Function type is inconsitent across referenced apis. "
+                        << "This probably means one of your apis has the wrong signature. "
+                        << "(Either: " << *first_name << ", or: " << api_name << ".) "
+                        << "Codesec: " << section_type << " "
+                        << "Local: " << j << " "
+                        << "Offset: " << i << "\n";
+                    return {};
+                }
+            }
+        }
+        else if (j == hook_type_idx)
+        {
+            // pass
+        }
+        else
+        {
+            // fail
+            GUARDLOG(hook::log::FUNC_TYPE_INVALID)
+                << "Invalid function type. Not used by any import or hook/cbak func. "
+                << "Codesec: " << section_type << " "
+                << "Local: " << j << " "
+                << "Offset: " << i << "\n";
+            return {};
+        }
+
+        int param_count;
+        LEB(param_count); CHECK_SHORT_HOOK();
+        if (j == hook_type_idx)
+        {
+           if (param_count != 1)
+            {
+                GUARDLOG(hook::log::PARAM_HOOK_CBAK)
+                    << "Malformed transaction. "
+                    << "hook and cbak function definition must have exactly one parameter (uint32_t)." << "\n";
+                return {};
+            }
+        }
+        else
+        if (param_count != (*first_signature).get().size() - 1)
+        {
+            GUARDLOG(hook::log::FUNC_TYPE_INVALID)
+                << "Malformed transaction. "
+                << "Hook API: " << *first_name << " has the wrong number of parameters.\n";
+            return {};
+        }
+
+        for (int k = 0; k < param_count; ++k)
+        {
+            int param_type;
+            LEB(param_type); CHECK_SHORT_HOOK();
+            if (param_type == 0x7FU || param_type == 0x7EU ||
+                param_type == 0x7DU || param_type == 0x7CU)
+            {
+                // pass, this is fine
+            }
+            else
+            {
+                GUARDLOG(hook::log::FUNC_PARAM_INVALID)
+                    << "Invalid parameter type in function type. "
+                    << "Codesec: " << section_type << " "
+                    << "Local: " << j << " "
+                    << "Offset: " << i << "\n";
+                return {};
+            }
+
+            // hook and cbak parameter check here
+            if (j == hook_type_idx)
+            {
+               if (param_type != 0x7FU /* i32 */)
+               {
+                    GUARDLOG(hook::log::PARAM_HOOK_CBAK)
+                        << "Malformed transaction. "
+                        << "hook and cbak function definition must have exactly one uint32_t parameter." << "\n";
+                    return {};
+               }
+            }
+            else
+            if ((*first_signature).get()[k + 1] != param_type)
+            {
+                GUARDLOG(hook::log::FUNC_PARAM_INVALID)
+                    << "Malformed transaction. "
+                    << "Hook API: " << *first_name << " definition parameters incorrect." << "\n";
+                return {};
+            }
+        }
+
+        int result_count;
+        LEB(result_count); CHECK_SHORT_HOOK();
+
+        // RH TODO: enable this for production
+        // this needs a reliable hook cleaner otherwise it will catch most compilers out
+        if (result_count != 1)
+        {
+            GUARDLOG(hook::log::FUNC_RETURN_COUNT)
+                << "Malformed transaction. "
+                << "Hook declares a function type that returns fewer or more than one value. " << "\n";
+            return {};
+        }
+
+        // this can only ever be 1 in production, but in testing it may also be 0 or >1
+        // so for completeness this loop is here but can be taken out in prod
+        for (int k = 0; k < result_count; ++k)
+        {
+            int result_type;
+            LEB(result_type); CHECK_SHORT_HOOK();
+            if (result_type == 0x7F || result_type == 0x7E ||
+                result_type == 0x7D || result_type == 0x7C)
+            {
+                // pass, this is fine
+            }
+            else
+            {
+                GUARDLOG(hook::log::FUNC_RETURN_INVALID)
+                    << "Invalid return type in function type. "
+                    << "Codesec: " << section_type << " "
+                    << "Local: " << j << " "
+                    << "Offset: " << i << "\n";
+                return {};
+            }
+
+            // hook and cbak return type check here
+            if (j == hook_type_idx)
+            {
+                if (result_count != 1 || result_type != 0x7E /* i64 */)
+                {
+                    GUARDLOG(hook::log::RETURN_HOOK_CBAK)
+                        << "Malformed transaction. "
+                        << (j == hook_type_idx ? "hook" : "cbak") << " j=" << j << " "
+                        << " function definition must have exactly one int64_t return type. "
+                        << "resultcount=" << result_count << ", resulttype=" << result_type << ", "
+                        << "paramcount=" << param_count << "\n";
+                    return {};
+                }
+            }
+            else
+            if ((*first_signature).get()[0] != result_type)
+            {
+                GUARDLOG(hook::log::FUNC_RETURN_INVALID)
+                    << "Malformed transaction. "
+                    << "Hook API: " << *first_name << " definition return type incorrect." << "\n";
+                return {};
+            }
+        }
+    }
+
+    return true;
+}
+
+// with featureHookFuel (rules version bit 0x02) hook() and cbak() are priced by the fuel their guards
+// bound them to rather than by their worst case instruction count
 inline
 std::optional<  // unpopulated means invalid
 std::pair<
-    uint64_t,   // max instruction count for hook()
-    uint64_t    // max instruction count for cbak()
+    uint64_t,   // max instruction count (or fuel) for hook()
+    uint64_t    // max instruction count (or fuel) for cbak()
 >>
 validateGuards(
-    std::vector<uint8_t> const& hook,
+    ripple::Slice const& hook,
     GuardLog guardLog,
-    std::string guardLogAccStr)
+    std::string const& guardLogAccStr,
+    uint64_t rulesVersion = 0)      // amendment gated imports allowed, see hook_api::import_signature
 {
     uint64_t byteCount = hook.size();
 
@@ -800,27 +935,33 @@ validateGuards(
 
     // this maps function ids to type ids, used for looking up the type of cbak and hook
     // as established inside the wasm binary.
-    std::map<int, int> func_type_map;
+    std::vector<int> func_type_map;
     std::map<int /* type idx */, std::map<int /* import index */, std::string /* api name */>> import_type_map;
 
+    // the type section can only be checked once the import, function and export sections have been
+    // read and code sections only once the imports are known. sections may come in any order, so
+    // both are remembered by their offset (past the section length) and checked after the others
+    std::vector<std::pair<int /* section type */, int /* offset */>> deferred;
+
+    // the offsets sections started at, a section starting where an earlier one did means the
+    // section lengths go round in circles
+    std::vector<bool> section_starts(hook.size());
+
     // now we check for guards... first check if _g is imported
     int guard_import_number = -1;
     int last_import_number = -1;
     int import_count = 0;
-    int last_section_type = 0;
-    for (int i = 8, j = 0; i < hook.size();)
+    for (int i = 8; i >= 0 && static_cast<std::size_t>(i) < hook.size();)
     {
 
-        if (j == i)
+        if (section_starts[i])
         {
-            // if the loop iterates twice with the same value for i then
-            // it's an infinite loop edge case
             GUARDLOG(hook::log::WASM_PARSE_LOOP)
                 << "Malformed transaction: Hook is invalid WASM binary." << "\n";
             return {};
         }
 
-        j = i;
+        section_starts[i] = true;
 
         // each web assembly section begins with a single byte section type followed by an leb128 length
         int section_type = hook[i++];
@@ -833,29 +974,25 @@ validateGuards(
             return {};
         }
 
-        if (section_type <= last_section_type)
-        {
-            GUARDLOG(hook::log::SECTIONS_OUT_OF_SEQUENCE)
-                << "Malformed transcation. "
-                << "Hook contained wasm sections that were either repeated or were out of sequence.\n";
-            return {};
-        }
-
-
-
-        int section_length = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-        //int section_start = i;
+        int section_length;
+        LEB(section_length); CHECK_SHORT_HOOK();
 
         if (DEBUG_GUARD_VERBOSE)
             printf("WASM binary analysis -- upto %d: section %d with length %d\n",
                     i, section_type, section_length);
 
-        int next_section = i + section_length;
+        int next_section =
+            static_cast<int>(static_cast<uint32_t>(i) + static_cast<uint32_t>(section_length));
 
+        if (section_type == 1 || section_type == 10) // type section, code section
+        {
+            deferred.emplace_back(section_type, i);
+        }
+        else
         if (section_type == 2) // import section
         {
             // we are interested in the import section... we need to know if _g is imported and which import# it is
-            import_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+            LEB(import_count); CHECK_SHORT_HOOK();
             if (import_count <= 0)
             {
                 GUARDLOG(hook::log::IMPORTS_MISSING)
@@ -870,7 +1007,8 @@ validateGuards(
             for (int j = 0; j < import_count; ++j)
             {
                 // first check module name
-                int mod_length = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                int mod_length;
+                LEB(mod_length); CHECK_SHORT_HOOK();
                 if (mod_length < 1 || mod_length > (hook.size() - i))
                 {
                     GUARDLOG(hook::log::IMPORT_MODULE_BAD)
@@ -890,7 +1028,8 @@ validateGuards(
                 i += mod_length; CHECK_SHORT_HOOK();
 
                 // next get import name
-                int name_length = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                int name_length;
+                LEB(name_length); CHECK_SHORT_HOOK();
                 if (name_length < 1 || name_length > (hook.size() - i))
                 {
                     GUARDLOG(hook::log::IMPORT_NAME_BAD)
@@ -915,15 +1054,15 @@ validateGuards(
 
                 // execution to here means it's a function import
                 i++; CHECK_SHORT_HOOK();
-                int type_idx = 
-                    parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                int type_idx;
+                LEB(type_idx); CHECK_SHORT_HOOK();
 
                 // RH TODO: validate that the parameters of the imported functions are correct
                 if (import_name == "_g")
                 {
                     guard_import_number = func_upto;
                 }
-                else if (hook_api::import_whitelist.find(import_name) == hook_api::import_whitelist.end())
+                else if (!hook_api::import_signature(import_name, rulesVersion))
                 {
                     GUARDLOG(hook::log::IMPORT_ILLEGAL)
                         << "Malformed transaction. "
@@ -953,13 +1092,12 @@ validateGuards(
 
             // we have an imported guard function, so now we need to enforce the guard rule:
             // all loops must start with a guard call before any branching
-            // to enforce these rules we must do a second pass of the wasm in case the function
-            // section was placed in this wasm binary before the import section
 
         } else
         if (section_type == 7) // export section
         {
-            int export_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+            int export_count;
+            LEB(export_count); CHECK_SHORT_HOOK();
             if (export_count <= 0)
             {
                 GUARDLOG(hook::log::EXPORTS_MISSING)
@@ -971,8 +1109,9 @@ validateGuards(
 
             for (int j = 0; j < export_count; ++j)
             {
-                int name_len = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                if (name_len == 4)
+                int name_len;
+                LEB(name_len); CHECK_SHORT_HOOK();
+                if (name_len == 4 && static_cast<std::size_t>(i) + 4 <= hook.size())
                 {
 
                     if (hook[i] == 'h' && hook[i+1] == 'o' && hook[i+2] == 'o' && hook[i+3] == 'k')
@@ -987,7 +1126,7 @@ validateGuards(
                         }
 
                         i++; CHECK_SHORT_HOOK();
-                        hook_func_idx = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                        LEB(hook_func_idx); CHECK_SHORT_HOOK();
                         continue;
                     }
 
@@ -1002,13 +1141,13 @@ validateGuards(
                             return {};
                         }
                         i++; CHECK_SHORT_HOOK();
-                        cbak_func_idx = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                        LEB(cbak_func_idx); CHECK_SHORT_HOOK();
                         continue;
                     }
                 }
 
                 i += name_len + 1;
-                parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                SKIP_LEB(); CHECK_SHORT_HOOK();
             }
 
             // execution to here means export section was parsed
@@ -1023,7 +1162,8 @@ validateGuards(
         }
         else if (section_type == 3) // function section
         {
-            int function_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+            int function_count;
+            LEB(function_count); CHECK_SHORT_HOOK();
             if (function_count <= 0)
             {
                 GUARDLOG(hook::log::FUNCS_MISSING)
@@ -1035,10 +1175,14 @@ validateGuards(
 
             for (int j = 0; j < function_count; ++j)
             {
-                int type_idx = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
+                int type_idx;
+                LEB(type_idx); CHECK_SHORT_HOOK();
                 if (DEBUG_GUARD)
                     printf("Function map: func %d -> type %d\n", j, type_idx);
-                func_type_map[j] = type_idx;
+                if (static_cast<std::size_t>(j) < func_type_map.size())
+                    func_type_map[j] = type_idx;
+                else
+                    func_type_map.push_back(type_idx);
             }
         }
 
@@ -1046,16 +1190,27 @@ validateGuards(
         continue;
     }
 
+    if (!hook_func_idx)
+    {
+        GUARDLOG(hook::log::EXPORT_MISSING)
+            << "Malformed transaction. "
+            << "Hook did not export: int64_t hook(uint32_t); " << "\n";
+        return {};
+    }
+
     // we must subtract import_count from the hook and cbak function in order to be able to
     // look them up in the functions section. this is a rule of the webassembly spec
-    // note that at this point in execution we are guarenteed these are populated
     *hook_func_idx -= import_count;
 
     if (cbak_func_idx)
         *cbak_func_idx -= import_count;
 
-    if (func_type_map.find(*hook_func_idx) == func_type_map.end() ||
-        (cbak_func_idx && func_type_map.find(*cbak_func_idx) == func_type_map.end()))
+    auto const has_type = [&func_type_map](int func_idx)
+    {
+        return func_idx >= 0 && static_cast<std::size_t>(func_idx) < func_type_map.size();
+    };
+
+    if (!has_type(*hook_func_idx) || (cbak_func_idx && !has_type(*cbak_func_idx)))
     {
         GUARDLOG(hook::log::FUNC_TYPELESS)
             << "Malformed transaction. "
@@ -1076,290 +1231,98 @@ validateGuards(
 
     int64_t maxInstrCountHook = 0;
     int64_t maxInstrCountCbak = 0;
+    uint64_t maxFuelHook = 0;
+    uint64_t maxFuelCbak = 0;
 
-    // second pass... where we check all the guard function calls follow the guard rules
-    // minimal other validation in this pass because first pass caught most of it
-    for (int i = 8; i < hook.size();)
+    // where we check all the guard function calls follow the guard rules
+    for (auto const& [section_type, start] : deferred)
     {
-
-        int section_type = hook[i++];
-        int section_length = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-        //int section_start = i;
-        int next_section = i + section_length;
+        int i = start;
 
         if (section_type == 1) // type section
         {
-            int type_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-            for (int j = 0; j < type_count; ++j)
-            {
-                if (hook[i++] != 0x60)
-                {
-                    GUARDLOG(hook::log::FUNC_TYPE_INVALID)
-                        << "Invalid function type. "
-                        << "Codesec: " << section_type << " "
-                        << "Local: " << j << " "
-                        << "Offset: " << i << "\n";
-                    return {};
-                }
-                CHECK_SHORT_HOOK();
+            if (!check_types(hook, i, hook_type_idx, import_type_map, rulesVersion, guardLog, guardLogAccStr))
+                return {};
+            continue;
+        }
 
-                // check the consistency of the type
-                std::optional<std::string> first_name;
-                std::optional<std::reference_wrapper<std::vector<uint8_t> const>> first_signature;
-                if (auto const& usage = import_type_map.find(j); usage != import_type_map.end())
-                {
-                    for (auto const& [import_idx, api_name] : usage->second)
-                    {
-                        auto const& api_signature =  
-                            hook_api::import_whitelist.find(api_name)->second;
+        // code section
+        // RH TODO: parse anywhere else an expr is allowed in wasm and enforce rules there too
+        // these are the functions
+        int func_count;
+        LEB(func_count); CHECK_SHORT_HOOK();
 
-                        if (!first_signature)
-                        {
-                            first_name = api_name;
-                            first_signature = api_signature;
-                            continue;
-                        }
-
-                        if (api_signature != (*first_signature).get())
-                        {
-                            GUARDLOG(hook::log::FUNC_TYPE_INVALID)
-                                << "Function type is inconsitent across referenced apis. "
-                                << "This probably means one of your apis has the wrong signature. "
-                                << "(Either: " << *first_name << ", or: " << api_name << ".) "
-                                << "Codesec: " << section_type << " "
-                                << "Local: " << j << " "
-                                << "Offset: " << i << "\n";
-                            return {};
-                        }
-                    } 
-                }
-                else if (j == hook_type_idx)
-                {
-                    // pass
-                }
-                else
+        for (int j = 0; j < func_count; ++j)
+        {
+            // parse locals
+            int code_size;
+            LEB(code_size); CHECK_SHORT_HOOK();
+            int code_end = i + code_size;
+            int local_count;
+            LEB(local_count); CHECK_SHORT_HOOK();
+            for (int k = 0; k < local_count; ++k)
+            {
+                /*int array_size = */
+                SKIP_LEB(); CHECK_SHORT_HOOK();
+                if (!(hook[i] >= 0x7C && hook[i] <= 0x7F))
                 {
-                    // fail
-                    GUARDLOG(hook::log::FUNC_TYPE_INVALID)
-                        << "Invalid function type. Not used by any import or hook/cbak func. "
-                        << "Codesec: " << section_type << " "
-                        << "Local: " << j << " "
+                    GUARDLOG(hook::log::TYPE_INVALID)
+                        << "Invalid local type. "
+                        << "Codesec: " << j << " "
+                        << "Local: " << k << " "
                         << "Offset: " << i << "\n";
                     return {};
                 }
+                i++; CHECK_SHORT_HOOK();
+            }
 
-                int param_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                if (j == hook_type_idx)
-                {
-                   if (param_count != 1)
-                    {
-                        GUARDLOG(hook::log::PARAM_HOOK_CBAK)
-                            << "Malformed transaction. "
-                            << "hook and cbak function definition must have exactly one parameter (uint32_t)." << "\n";
-                        return {};
-                    }
-                }
-                else
-                if (param_count != (*first_signature).get().size() - 1)
-                {
-                    GUARDLOG(hook::log::FUNC_TYPE_INVALID)
-                        << "Malformed transaction. "
-                        << "Hook API: " << *first_name << " has the wrong number of parameters.\n";
-                    return {};
-                }
-
-                for (int k = 0; k < param_count; ++k)
-                {
-                    int param_type = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                    if (param_type == 0x7FU || param_type == 0x7EU ||
-                        param_type == 0x7DU || param_type == 0x7CU)
-                    {
-                        // pass, this is fine
-                    }
-                    else
-                    {
-                        GUARDLOG(hook::log::FUNC_PARAM_INVALID)
-                            << "Invalid parameter type in function type. "
-                            << "Codesec: " << section_type << " "
-                            << "Local: " << j << " "
-                            << "Offset: " << i << "\n";
-                        return {};
-                    }
-
-                    if (DEBUG_GUARD)
-                        printf("Function type idx: %d, hook_func_idx: %d, cbak_func_idx: %d "
-                               "param_count: %d param_type: %x\n",
-                               j, *hook_func_idx, *cbak_func_idx, param_count, param_type);
-
-                    // hook and cbak parameter check here
-                    if (j == hook_type_idx)
-                    {
-                       if (param_type != 0x7FU /* i32 */)
-                       {
-                            GUARDLOG(hook::log::PARAM_HOOK_CBAK)
-                                << "Malformed transaction. "
-                                << "hook and cbak function definition must have exactly one uint32_t parameter." << "\n";
-                            return {};
-                       }
-                    }
-                    else
-                    if ((*first_signature).get()[k + 1] != param_type)
-                    {
-                        GUARDLOG(hook::log::FUNC_PARAM_INVALID)
-                            << "Malformed transaction. "
-                            << "Hook API: " << *first_name << " definition parameters incorrect." << "\n";
-                        return {};
-                    }
-                }
-
-                int result_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-
-                // RH TODO: enable this for production
-                // this needs a reliable hook cleaner otherwise it will catch most compilers out
-                if (result_count != 1)
-                {
-                    GUARDLOG(hook::log::FUNC_RETURN_COUNT)
-                        << "Malformed transaction. "
-                        << "Hook declares a function type that returns fewer or more than one value. " << "\n";
-                    return {};
-                }
-
-                // this can only ever be 1 in production, but in testing it may also be 0 or >1
-                // so for completeness this loop is here but can be taken out in prod
-                for (int k = 0; k < result_count; ++k)
-                {
-                    int result_type = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                    if (result_type == 0x7F || result_type == 0x7E ||
-                        result_type == 0x7D || result_type == 0x7C)
-                    {
-                        // pass, this is fine
-                    }
-                    else
-                    {
-                        GUARDLOG(hook::log::FUNC_RETURN_INVALID)
-                            << "Invalid return type in function type. "
-                            << "Codesec: " << section_type << " "
-                            << "Local: " << j << " "
-                            << "Offset: " << i << "\n";
-                        return {};
-                    }
-
-                    if (DEBUG_GUARD)
-                        printf("Function type idx: %d, hook_func_idx: %d, cbak_func_idx: %d "
-                               "result_count: %d result_type: %x\n",
-                               j, *hook_func_idx, *cbak_func_idx, result_count, result_type);
-
-                    // hook and cbak return type check here
-                    if (j == hook_type_idx)
-                    {
-                        if (result_count != 1 || result_type != 0x7E /* i64 */)
-                        {
-                            GUARDLOG(hook::log::RETURN_HOOK_CBAK)
-                                << "Malformed transaction. "
-                                << (j == hook_type_idx ? "hook" : "cbak") << " j=" << j << " "
-                                << " function definition must have exactly one int64_t return type. "
-                                << "resultcount=" << result_count << ", resulttype=" << result_type << ", "
-                                << "paramcount=" << param_count << "\n";
-                            return {};
-                        }
-                    }
-                    else
-                    if ((*first_signature).get()[0] != result_type)
-                    {
-                        GUARDLOG(hook::log::FUNC_RETURN_INVALID)
-                            << "Malformed transaction. "
-                            << "Hook API: " << *first_name << " definition return type incorrect." << "\n";
-                        return {};
-                    }
-                }
+            if (i == code_end)
+                continue; // allow empty functions
+
+            // execution to here means we are up to the actual expr for the codesec/function
+
+            uint64_t fuel = 0;
+            auto valid =
+                check_guard(
+                    hook,
+                    j,
+                    i,
+                    code_end,
+                    guard_import_number,
+                    last_import_number,
+                    guardLog,
+                    guardLogAccStr,
+                    &fuel);
+
+            if (!valid)
+                return {};
 
+            if (hook_func_idx && *hook_func_idx == j)
+            {
+                maxInstrCountHook = *valid;
+                maxFuelHook = fuel;
             }
-        }
-        else
-        if (section_type == 10) // code section
-        {
-            // RH TODO: parse anywhere else an expr is allowed in wasm and enforce rules there too
-            // these are the functions
-            int func_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-
-            for (int j = 0; j < func_count; ++j)
+            else if (cbak_func_idx && *cbak_func_idx == j)
             {
-                // parse locals
-                int code_size = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                int code_end = i + code_size;
-                int local_count = parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                for (int k = 0; k < local_count; ++k)
-                {
-                    /*int array_size = */
-                    parseLeb128(hook, i, &i); CHECK_SHORT_HOOK();
-                    if (!(hook[i] >= 0x7C && hook[i] <= 0x7F))
-                    {
-                        GUARDLOG(hook::log::TYPE_INVALID)
-                            << "Invalid local type. "
-                            << "Codesec: " << j << " "
-                            << "Local: " << k << " "
-                            << "Offset: " << i << "\n";
-                        return {};
-                    }
-                    i++; CHECK_SHORT_HOOK();
-                }
-
-                if (i == code_end)
-                    continue; // allow empty functions
-
-                // execution to here means we are up to the actual expr for the codesec/function
-
-                auto valid =
-                    check_guard(
-                        hook,
-                        j,
-                        i,
-                        code_end,
-                        guard_import_number,
-                        last_import_number,
-                        guardLog,
-                        guardLogAccStr);
-
-                if (!valid)
-                    return {};
-
-                if (hook_func_idx && *hook_func_idx == j)
-                    maxInstrCountHook = *valid;
-                else if (cbak_func_idx && *cbak_func_idx == j)
-                    maxInstrCountCbak = *valid;
-                else
-                {
-                    if (DEBUG_GUARD)
-                        printf("code section: %d not hook_func_idx: %d or cbak_func_idx: %d\n",
-                                j, *hook_func_idx, (cbak_func_idx ? *cbak_func_idx : -1));
-                    //   assert(false);
-                }
-                i = code_end;
+                maxInstrCountCbak = *valid;
+                maxFuelCbak = fuel;
             }
+            else
+            {
+                if (DEBUG_GUARD)
+                    printf("code section: %d not hook_func_idx: %d or cbak_func_idx: %d\n",
+                            j, *hook_func_idx, (cbak_func_idx ? *cbak_func_idx : -1));
+            }
+            i = code_end;
         }
-        i = next_section;
     }
 
     // execution to here means guards are installed correctly
 
-    return std::pair<uint64_t, uint64_t>{maxInstrCountHook, maxInstrCountCbak};
-
-    /*
-    GUARDLOG(hook::log::WASM_SMOKE_TEST)
-        << "Trying to wasm instantiate proposed hook "
-        << "size = " <<  hook.size() << "\n";
-
-    std::optional<std::string> result =
-        hook::HookExecutor::validateWasm(hook.data(), (size_t)hook.size());
-
-    if (result)
-    {
-        GUARDLOG(hook::log::WASM_TEST_FAILURE)
-            << "Tried to set a hook with invalid code. VM error: "
-            << *result << "\n";
-        return {};
-    }
-    */
+    if (rulesVersion & 0x02U)
+        return std::pair<uint64_t, uint64_t>{maxFuelHook, maxFuelCbak};
 
     return std::pair<uint64_t, uint64_t>{maxInstrCountHook, maxInstrCountCbak};
 }
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef HOOK_ARENA_INCLUDED
+#define HOOK_ARENA_INCLUDED 1
+#include <boost/container/pmr/memory_resource.hpp>
+#include <boost/container/pmr/polymorphic_allocator.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace hook
+{
+    // Use boost::pmr rather than std::pmr, as RawStateTable does, for the sake of clang
+    template <class T>
+    using ArenaAllocator = boost::container::pmr::polymorphic_allocator<T>;
+
+    template <class Key, class T>
+    using ArenaMap = std::map<Key, T, std::less<Key>, ArenaAllocator<std::pair<Key const, T>>>;
+
+    template <class T>
+    using ArenaQueue = std::queue<T, std::deque<T, ArenaAllocator<T>>>;
+
+    /**
+     * HookArena is a per-thread monotonic arena for the bookkeeping a hook execution allocates and
+     * throws away again (slots, nonces, guard counters). A Scope is opened for the hook phase of a
+     * transaction, everything the containers of its HookContexts allocate comes from the arena and
+     * is released at once when the outermost Scope on the thread closes. Each thread keeps its arena
+     * (and its initial buffer) between phases, so a typical phase does not touch the heap at all.
+     *
+     * Memory taken from resource() must not outlive the Scope it was taken in.
+     */
+    class HookArena
+    {
+        public:
+            struct Counts
+            {
+                uint64_t phases;            // outermost Scopes closed
+                uint64_t allocations;       // allocations served by the arenas
+                uint64_t heapBlocks;        // blocks the arenas took from the heap to serve them
+                uint64_t bytes;             // bytes allocated from the arenas
+            };
+
+            // bytes of the buffer each thread's arena starts from before it needs the heap
+            static constexpr std::size_t initialSize = 16384;
+
+            /**
+             * Open the hook phase on this thread. Scopes nest, only the outermost one releases the
+             * arena when it closes.
+             */
+            class Scope
+            {
+                public:
+                    Scope();
+                    ~Scope();
+
+                    Scope(Scope const&) = delete;
+                    Scope& operator=(Scope const&) = delete;
+            };
+
+            // the arena of the Scope open on this thread, the default (heap) resource outside one
+            static boost::container::pmr::memory_resource*
+            resource();
+
+            static Counts
+            getCounts();
+    };
+}
+
+#endif
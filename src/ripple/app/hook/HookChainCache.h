@@ -0,0 +1,163 @@
+#ifndef HOOK_CHAIN_CACHE_INCLUDED
+#define HOOK_CHAIN_CACHE_INCLUDED 1
+#include <ripple/app/hook/LRUMap.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/ledger/ReadView.h>
+#include <ripple/protocol/AccountID.h>
+#include <ripple/protocol/STLedgerEntry.h>
+#include <ripple/protocol/TxFormats.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace hook
+{
+    /**
+     * One non-blank position of an account's hook chain with the hook object's overrides applied
+     * over its definition's defaults.
+     */
+    struct ResolvedHook
+    {
+        uint8_t hookNo = 0;                 // position in sfHooks counting from 1, blanks included
+        ripple::uint256 hookHash;
+
+        // nullptr when the definition was missing from the ledger, nothing below is then set
+        std::shared_ptr<ripple::STLedgerEntry const> definition;
+
+        ripple::uint256 hookSetTxnID;
+        ripple::uint256 hookNamespace;
+        uint64_t hookOn = 0;
+        uint32_t flags = 0;
+        uint32_t feeDrops = 0;              // the definition's sfFee, as charged per execution
+        std::optional<uint64_t> fuel;       // the definition's sfHookFuel, unset if set before HookFuel
+        bool hasCallback = false;
+
+        // the definition's default parameters overridden by the hook object's, see
+        // gatherHookParameters, which fails when the definition has no sfHookParameters
+        bool parametersValid = false;
+        std::map<std::vector<uint8_t>, std::vector<uint8_t>> parameters;
+    };
+
+    /**
+     * Everything fee calculation and execution need from an account's hook chain, resolved once
+     * per version of its hook SLE. Immutable once built, so it is shared between threads freely.
+     */
+    class ResolvedHookChain
+    {
+        public:
+            // fees are summed per transaction type for the types a hookOn mask can address
+            static constexpr std::size_t feeTypes = 64;
+
+        private:
+            std::shared_ptr<ripple::STLedgerEntry const> hookSLE_;
+            std::vector<ResolvedHook> hooks_;
+            std::array<uint64_t, feeTypes> fee_ {};
+            std::array<uint64_t, feeTypes> collectFee_ {};
+
+        public:
+            ResolvedHookChain(
+                ripple::ReadView const& view,
+                std::shared_ptr<ripple::STLedgerEntry const> const& hookSLE);
+
+            // the hook SLE this chain was resolved from
+            std::shared_ptr<ripple::STLedgerEntry const> const&
+            hookSLE() const
+            {
+                return hookSLE_;
+            }
+
+            std::vector<ResolvedHook> const&
+            hooks() const
+            {
+                return hooks_;
+            }
+
+            // the execution fee of every hook which fires on txType, or only those with hsfCOLLECT
+            uint64_t
+            fee(ripple::TxType txType, bool collectCallsOnly) const;
+    };
+
+    /**
+     * HookChainCache keeps the resolved hook chains of recently active accounts, so the fee
+     * calculation run for the originating account and every rollback capable stake holder on each
+     * relay, TxQ check and apply does not re-read and re-resolve the hook and definition SLEs.
+     *
+     * A cached chain is only handed out for the very hook SLE object it was resolved from. Ledgers
+     * read through a CachedView (the open ledger and everything validated against it) return one
+     * shared SLE object per key and content, so a chain is reused for as long as the account's hooks
+     * are unchanged, across ledgers too. A view which hands out fresh objects, like the ledger built
+     * during consensus, simply misses. Definitions do not have to be checked: a definition cannot
+     * be removed or replaced while a hook SLE still references it, and apart from its reference
+     * count it never changes. A few versions are kept per account so views of different ledgers do
+     * not evict each other's entries. The one transaction which changes a hook SLE, SetHook,
+     * changes the copy it peeked in place, so it drops the account's entries once it is done.
+     */
+    class HookChainCache
+    {
+        public:
+            using Chain = std::shared_ptr<ResolvedHookChain const>;
+
+            struct Counts
+            {
+                uint64_t hits;
+                uint64_t misses;
+                uint64_t evictions;
+                uint64_t invalidations;
+                uint64_t size;
+            };
+
+            // versions of the same account's chain kept at once
+            static constexpr std::size_t versionsPerAccount = 2;
+
+        private:
+            using Versions = std::vector<Chain>;    // most recently used first
+
+            mutable std::mutex mutex_;
+            LRUMap<ripple::uint256, Versions> chains_;     // by hook SLE key
+
+            std::atomic<uint64_t> invalidations_ {0};
+
+        public:
+            explicit HookChainCache(std::size_t capacity);
+
+            HookChainCache(HookChainCache const&) = delete;
+            HookChainCache& operator=(HookChainCache const&) = delete;
+
+            // the cache used by all transactors in this process
+            static HookChainCache&
+            instance();
+
+            /**
+             * The resolved chain of hookSLE (read from view), resolving it against view on a miss.
+             * Returns nullptr if hookSLE is.
+             */
+            Chain
+            resolve(
+                ripple::ReadView const& view,
+                std::shared_ptr<ripple::STLedgerEntry const> const& hookSLE);
+
+            // read the hook SLE from view and resolve it, nullptr if the account has none
+            Chain
+            resolve(ripple::ReadView const& view, ripple::Keylet const& hookKeylet);
+
+            // drop every cached version of the account's chain, its hooks are being changed
+            void
+            invalidate(ripple::AccountID const& account);
+
+            std::size_t
+            size() const;
+
+            Counts
+            getCounts() const;
+    };
+
+    // maximum number of accounts whose chains are kept by HookChainCache::instance()
+    uint32_t maxHookChainCacheSize(void);
+}
+
+#endif
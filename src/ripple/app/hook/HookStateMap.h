@@ -0,0 +1,426 @@
+#ifndef HOOK_STATE_MAP_INCLUDED
+#define HOOK_STATE_MAP_INCLUDED 1
+#include <ripple/basics/Slice.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/basics/hardened_hash.h>
+#include <ripple/beast/hash/hash_append.h>
+#include <ripple/protocol/AccountID.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace hook
+{
+    namespace detail
+    {
+        /**
+         * Append-only storage which allocates in blocks of N elements and never moves an element,
+         * so indices and references stay valid until the arena itself is destroyed.
+         */
+        template <class T, std::size_t N = 64>
+        class Arena
+        {
+            private:
+                std::vector<std::unique_ptr<std::array<T, N>>> blocks_;
+                std::size_t size_ = 0;
+
+            public:
+                template <class... Args>
+                T&
+                emplace_back(Args&&... args)
+                {
+                    if (size_ % N == 0)
+                        blocks_.push_back(std::make_unique<std::array<T, N>>());
+                    T& slot = (*blocks_.back())[size_ % N];
+                    slot = T { std::forward<Args>(args)... };
+                    ++size_;
+                    return slot;
+                }
+
+                T&
+                operator[](std::size_t i)
+                {
+                    return (*blocks_[i / N])[i % N];
+                }
+
+                T const&
+                operator[](std::size_t i) const
+                {
+                    return (*blocks_[i / N])[i % N];
+                }
+
+                std::size_t
+                size() const
+                {
+                    return size_;
+                }
+        };
+
+        /**
+         * Insert-only open addressing (linear probing) index over an Arena. Elements are never
+         * erased, a state delete is just a set to an empty value, which keeps probing trivial.
+         * Keys are hashed with a per-map random seed since hooks choose them.
+         */
+        template <class Key, class T>
+        class FlatMap
+        {
+            private:
+                struct Slot
+                {
+                    Key key;
+                    T value;
+                };
+
+                Arena<Slot> slots_;
+                std::vector<uint32_t> index_;    // 0 = empty, otherwise position in slots_ + 1
+                ripple::hardened_hash<> hasher_;
+
+                std::size_t
+                probe(Key const& key) const
+                {
+                    std::size_t const mask = index_.size() - 1;
+                    std::size_t i = hasher_(key) & mask;
+                    while (index_[i] != 0 && !(slots_[index_[i] - 1].key == key))
+                        i = (i + 1) & mask;
+                    return i;
+                }
+
+                void
+                grow()
+                {
+                    std::vector<uint32_t> old;
+                    old.swap(index_);
+                    index_.assign(old.empty() ? 16 : old.size() * 2, 0);
+                    for (uint32_t pos : old)
+                        if (pos != 0)
+                            index_[probe(slots_[pos - 1].key)] = pos;
+                }
+
+            public:
+                T*
+                find(Key const& key)
+                {
+                    if (index_.empty())
+                        return nullptr;
+                    uint32_t const pos = index_[probe(key)];
+                    return pos == 0 ? nullptr : &slots_[pos - 1].value;
+                }
+
+                // precondition: key is not present
+                T&
+                emplace(Key const& key, T&& value)
+                {
+                    // keep the load factor at or below one half
+                    if ((slots_.size() + 1) * 2 > index_.size())
+                        grow();
+
+                    std::size_t const i = probe(key);
+                    assert(index_[i] == 0);
+                    Slot& slot = slots_.emplace_back(key, std::move(value));
+                    index_[i] = static_cast<uint32_t>(slots_.size());
+                    return slot.value;
+                }
+
+                std::size_t
+                size() const
+                {
+                    return slots_.size();
+                }
+
+                // insertion order access, used to build ordered views
+                Key const&
+                keyAt(std::size_t i) const
+                {
+                    return slots_[i].key;
+                }
+
+                T const&
+                valueAt(std::size_t i) const
+                {
+                    return slots_[i].value;
+                }
+        };
+    }
+
+    // This map type acts as both a read and write cache for hook execution
+    // and is preserved across the execution of the set of hook chains
+    // being executed in the current transaction. It is committed to lgr
+    // only upon tesSuccess for the otxn.
+    //
+    // Storage is flat: one open addressing table keyed by (account, namespace, key) whose entries,
+    // including their values, live in an arena owned by the map and therefore by the originating
+    // transaction. Values up to inlineDataSize bytes (the maximum hook state size) are stored
+    // in the entry itself. Iteration in (account, namespace, key) order, the order the state must be
+    // written to the ledger in, is only provided by the ordered() view used by finalizeHookState.
+    //
+    // Alongside the entries the map holds ledger values read ahead of use (see state_prefetch).
+    // These are kept apart from the entries, a prefetched value only becomes an entry when a hook
+    // actually reads it, so prefetching never changes reserve or modification accounting.
+    //
+    // Weak hook chains run in parallel each fill a map of their own, which are merged into the
+    // transaction's map in chain order when they touched disjoint accounts (see merge).
+    class HookStateMap
+    {
+        public:
+            static constexpr std::size_t inlineDataSize = 256;
+
+            struct Entry
+            {
+                bool modified = false;      // is modified from ledger value
+
+                ripple::Slice
+                data() const
+                {
+                    return overflow_.empty()
+                        ? ripple::Slice { inline_.data(), size_ }
+                        : ripple::Slice { overflow_.data(), overflow_.size() };
+                }
+
+                void
+                assign(ripple::Slice const& value)
+                {
+                    if (value.size() <= inlineDataSize)
+                    {
+                        overflow_.clear();
+                        if (!value.empty())
+                            std::memcpy(inline_.data(), value.data(), value.size());
+                        size_ = static_cast<uint16_t>(value.size());
+                    }
+                    else
+                        overflow_.assign(value.begin(), value.end());
+                }
+
+            private:
+                uint16_t size_ = 0;
+                std::array<uint8_t, inlineDataSize> inline_;
+                std::vector<uint8_t> overflow_;     // only if the state size limit is ever raised
+            };
+
+            struct EntryKey
+            {
+                ripple::AccountID account;
+                ripple::uint256 ns;
+                ripple::uint256 key;
+
+                bool
+                operator==(EntryKey const& o) const
+                {
+                    return key == o.key && ns == o.ns && account == o.account;
+                }
+
+                template <class Hasher>
+                friend void
+                hash_append(Hasher& h, EntryKey const& k)
+                {
+                    using beast::hash_append;
+                    hash_append(h, k.account, k.ns, k.key);
+                }
+            };
+
+        private:
+            struct NamespaceKey
+            {
+                ripple::AccountID account;
+                ripple::uint256 ns;
+
+                bool
+                operator==(NamespaceKey const& o) const
+                {
+                    return ns == o.ns && account == o.account;
+                }
+
+                template <class Hasher>
+                friend void
+                hash_append(Hasher& h, NamespaceKey const& k)
+                {
+                    using beast::hash_append;
+                    hash_append(h, k.account, k.ns);
+                }
+            };
+
+            detail::FlatMap<ripple::AccountID, int64_t> accounts_;  // remaining available ownercount
+            detail::FlatMap<NamespaceKey, bool> namespaces_;
+            detail::FlatMap<EntryKey, Entry> entries_;
+
+        public:
+            struct PrefetchStatus
+            {
+                bool attempted = false;     // the namespace directory has been walked (or skipped)
+                bool complete = false;      // every entry of the namespace is in the prefetch table
+                uint32_t misses = 0;        // reads which had to go to the ledger
+            };
+
+        private:
+            detail::FlatMap<NamespaceKey, PrefetchStatus> prefetchStatus_;
+            detail::FlatMap<EntryKey, Entry> prefetched_;
+
+        public:
+            uint32_t modified_entry_count = 0;      // track the number of total modified
+
+            // remaining available reserve count for the account, nullptr if not seen yet
+            int64_t*
+            findAccount(ripple::AccountID const& account)
+            {
+                return accounts_.find(account);
+            }
+
+            int64_t&
+            insertAccount(ripple::AccountID const& account, int64_t availableForReserves)
+            {
+                return accounts_.emplace(account, std::move(availableForReserves));
+            }
+
+            bool
+            hasNamespace(ripple::AccountID const& account, ripple::uint256 const& ns)
+            {
+                return namespaces_.find(NamespaceKey { account, ns }) != nullptr;
+            }
+
+            void
+            insertNamespace(ripple::AccountID const& account, ripple::uint256 const& ns)
+            {
+                namespaces_.emplace(NamespaceKey { account, ns }, true);
+            }
+
+            Entry*
+            find(
+                ripple::AccountID const& account,
+                ripple::uint256 const& ns,
+                ripple::uint256 const& key)
+            {
+                return entries_.find(EntryKey { account, ns, key });
+            }
+
+            // precondition: the entry is not present
+            Entry&
+            insert(
+                ripple::AccountID const& account,
+                ripple::uint256 const& ns,
+                ripple::uint256 const& key,
+                bool modified,
+                ripple::Slice const& data)
+            {
+                Entry& entry = entries_.emplace(EntryKey { account, ns, key }, Entry {});
+                entry.modified = modified;
+                entry.assign(data);
+                return entry;
+            }
+
+            std::size_t
+            size() const
+            {
+                return entries_.size();
+            }
+
+            PrefetchStatus&
+            prefetchStatus(ripple::AccountID const& account, ripple::uint256 const& ns)
+            {
+                NamespaceKey const k { account, ns };
+                if (auto* status = prefetchStatus_.find(k))
+                    return *status;
+                return prefetchStatus_.emplace(k, PrefetchStatus {});
+            }
+
+            // the ledger value read ahead for this key, nullptr if it was not prefetched
+            Entry const*
+            findPrefetched(
+                ripple::AccountID const& account,
+                ripple::uint256 const& ns,
+                ripple::uint256 const& key)
+            {
+                return prefetched_.find(EntryKey { account, ns, key });
+            }
+
+            void
+            insertPrefetched(
+                ripple::AccountID const& account,
+                ripple::uint256 const& ns,
+                ripple::uint256 const& key,
+                ripple::Slice const& data)
+            {
+                EntryKey const k { account, ns, key };
+                if (prefetched_.find(k))
+                    return;
+                prefetched_.emplace(k, Entry {}).assign(data);
+            }
+
+            std::size_t
+            prefetchedSize() const
+            {
+                return prefetched_.size();
+            }
+
+            /**
+             * Every account whose state or reserve this map has looked at, including state reads
+             * which missed. Two maps with disjoint sets were built by executions which could not
+             * have observed each other's state.
+             */
+            std::vector<ripple::AccountID>
+            touchedAccounts() const
+            {
+                std::vector<ripple::AccountID> accounts;
+                for (std::size_t i = 0; i < accounts_.size(); ++i)
+                    accounts.push_back(accounts_.keyAt(i));
+                for (std::size_t i = 0; i < namespaces_.size(); ++i)
+                    accounts.push_back(namespaces_.keyAt(i).account);
+                for (std::size_t i = 0; i < entries_.size(); ++i)
+                    accounts.push_back(entries_.keyAt(i).account);
+                for (std::size_t i = 0; i < prefetchStatus_.size(); ++i)
+                    accounts.push_back(prefetchStatus_.keyAt(i).account);
+
+                std::sort(accounts.begin(), accounts.end());
+                accounts.erase(std::unique(accounts.begin(), accounts.end()), accounts.end());
+                return accounts;
+            }
+
+            /**
+             * Take over the entries, reserves and modification count of a map whose touched accounts
+             * are disjoint from this one's. Values read ahead are a cache and are not carried over.
+             */
+            void
+            merge(HookStateMap const& other)
+            {
+                for (std::size_t i = 0; i < other.accounts_.size(); ++i)
+                    insertAccount(other.accounts_.keyAt(i), other.accounts_.valueAt(i));
+                for (std::size_t i = 0; i < other.namespaces_.size(); ++i)
+                    insertNamespace(other.namespaces_.keyAt(i).account, other.namespaces_.keyAt(i).ns);
+                for (std::size_t i = 0; i < other.entries_.size(); ++i)
+                {
+                    EntryKey const& k = other.entries_.keyAt(i);
+                    Entry const& e = other.entries_.valueAt(i);
+                    insert(k.account, k.ns, k.key, e.modified, e.data());
+                }
+                modified_entry_count += other.modified_entry_count;
+            }
+
+            /**
+             * All entries sorted by account, then namespace, then key. Built on demand, only
+             * finalizeHookState needs the entries in this order.
+             */
+            std::vector<std::pair<EntryKey const*, Entry const*>>
+            ordered() const
+            {
+                std::vector<std::pair<EntryKey const*, Entry const*>> view;
+                view.reserve(entries_.size());
+                for (std::size_t i = 0; i < entries_.size(); ++i)
+                    view.emplace_back(&entries_.keyAt(i), &entries_.valueAt(i));
+
+                std::sort(view.begin(), view.end(),
+                    [](auto const& a, auto const& b)
+                    {
+                        return
+                            std::tie(a.first->account, a.first->ns, a.first->key) <
+                            std::tie(b.first->account, b.first->ns, b.first->key);
+                    });
+
+                return view;
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef HOOK_STATS_INCLUDED
+#define HOOK_STATS_INCLUDED 1
+#include <ripple/basics/base_uint.h>
+#include <ripple/basics/hardened_hash.h>
+#include <ripple/json/json_value.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hook
+{
+    struct HookResult;
+
+    // upper bound on the number of hook api functions, each has a slot in HookResult::hostCalls
+    constexpr std::size_t maxHostFunctions = 128;
+
+    /**
+     * Give a hook api function its slot in HookResult::hostCalls. Called once per function by
+     * DEFINE_HOOK_FUNCTION while the host functions are statically initialised.
+     */
+    uint16_t
+    registerHostFunction(char const* name);
+
+    // the names of the registered hook api functions, indexed by their slot
+    std::vector<std::string> const&
+    hostFunctionNames();
+
+    /**
+     * HookStats profiles hook executions per HookHash so operators can find the hooks which
+     * consume the node's CPU. hook::apply records every execution once it has finished.
+     *
+     * Each thread records into its own shard, whose lock is only ever contended by a reader taking
+     * a snapshot, so executions on different threads never wait for each other. A snapshot merges
+     * the shards. Execution times are kept in a power of two histogram of microseconds, the
+     * percentiles reported are the upper bound of the bucket they fall in.
+     * A shard holds at most capacity hooks. When a hook it does not hold executes on a full shard
+     * the hook least recently executed there is forgotten (LRU eviction), so the hooks executing
+     * now are always profiled however many others executed on the node before them.
+     */
+    class HookStats
+    {
+        public:
+            // power of two buckets of execution time in microseconds, the last is open ended
+            static constexpr std::size_t timeBuckets = 32;
+
+            struct Summary
+            {
+                ripple::uint256 hookHash;
+                uint64_t executions = 0;
+                uint64_t wasmErrors = 0;            // executions ending in ExitType::WASM_ERROR
+                uint64_t totalMicros = 0;
+                uint64_t maxMicros = 0;
+                uint64_t p50Micros = 0;
+                uint64_t p99Micros = 0;
+                uint64_t instructions = 0;
+                uint64_t stateReads = 0;            // state and state_foreign calls
+                uint64_t stateWrites = 0;           // state_set and state_foreign_set calls
+                uint64_t emits = 0;                 // transactions emitted, accepted or not
+                std::vector<std::pair<std::string, uint64_t>> hostCalls;    // most called first
+            };
+
+        private:
+            using LRU = std::list<ripple::uint256>;
+
+            struct Counters
+            {
+                uint64_t executions = 0;
+                uint64_t wasmErrors = 0;
+                uint64_t totalMicros = 0;
+                uint64_t maxMicros = 0;
+                uint64_t instructions = 0;
+                uint64_t emits = 0;
+                std::array<uint64_t, timeBuckets> micros {};
+                std::vector<uint64_t> hostCalls;    // indexed by host function slot
+            };
+
+            struct Entry
+            {
+                Counters counters;
+                LRU::iterator position;
+            };
+
+            struct Shard
+            {
+                std::mutex mutex;
+                LRU lru;    // front = most recently executed
+                std::unordered_map<ripple::uint256, Entry, ripple::hardened_hash<>> hooks;
+            };
+
+            uint64_t const id_;                     // tells this instance's shards apart per thread
+            std::size_t const capacity_;
+
+            mutable std::mutex shardsMutex_;
+            std::vector<std::shared_ptr<Shard>> shards_;
+
+            std::atomic<uint64_t> evicted_ {0};
+
+            Shard&
+            shard();
+
+        public:
+            explicit HookStats(std::size_t capacity);
+
+            HookStats(HookStats const&) = delete;
+            HookStats& operator=(HookStats const&) = delete;
+
+            // the profile kept by hook::apply in this process
+            static HookStats&
+            instance();
+
+            // account one finished execution
+            void
+            record(HookResult const& result, std::chrono::microseconds elapsed);
+
+            // the profiled hooks which used the most execution time, most first
+            std::vector<Summary>
+            top(std::size_t limit) const;
+
+            // top(limit) as reported by the hook_stats command and the perf log
+            Json::Value
+            getJson(std::size_t limit) const;
+
+            // hooks a shard forgot to make room for another, with the executions it had profiled
+            uint64_t
+            evicted() const
+            {
+                return evicted_.load();
+            }
+    };
+
+    // maximum number of distinct hooks profiled per thread by HookStats::instance()
+    uint32_t maxHookStatsSize(void);
+}
+
+#endif
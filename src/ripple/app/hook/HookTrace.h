@@ -0,0 +1,199 @@
+#ifndef HOOK_TRACE_INCLUDED
+#define HOOK_TRACE_INCLUDED 1
+#include <ripple/app/hook/LRUMap.h>
+#include <ripple/basics/Slice.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/json/json_value.h>
+#include <ripple/protocol/AccountID.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ripple
+{
+    class Section;
+}
+
+namespace beast
+{
+    class Journal;
+}
+
+namespace hook
+{
+
+    /**
+     * HookTraceLog keeps the output of the trace, trace_num and trace_float hook api functions in
+     * a bounded ring of fixed size entries per HookHash, so operators can follow what hooks trace
+     * without running the node at trace log level. Appending copies the raw bytes the hook passed
+     * into the next slot of its hook's ring, the text is only formatted when the entries are read
+     * (hook_trace command).
+     *
+     * Once a hook's ring is full its oldest entries are overwritten, a hook tracing in a loop never
+     * pushes out what other hooks traced. The rings of the least recently tracing hooks are dropped
+     * to keep at most about the configured number of hooks. Rings are spread over shards by
+     * HookHash, each behind its own lock, so hooks tracing on different threads (weak chains run in
+     * parallel) rarely wait for each other. Every entry gets a sequence number across all hooks so
+     * readers can poll for the entries they have not seen yet and tell how many they missed.
+     */
+    class HookTraceLog
+    {
+        public:
+            // the same bounds the trace functions apply to what they write to the log
+            static constexpr std::size_t maxMessage = 128;
+            static constexpr std::size_t maxData = 1023;
+
+            // most entries setup() lets all rings hold together, entries are a little over 1KiB each
+            static constexpr std::size_t maxEntries = 65536;
+
+            // hooks keeping a ring unless configured otherwise
+            static constexpr std::size_t defaultHooks = 256;
+
+            static constexpr std::size_t shardCount = 16;
+
+            enum class Kind : uint8_t
+            {
+                text,           // trace: data as is
+                hex,            // trace with as_hex: data shown as hex
+                utf16,          // trace: data is UTF-16LE, shown as every other byte
+                number,         // trace_num
+                floating        // trace_float: number is an XFL
+            };
+
+            struct Entry
+            {
+                uint64_t seq = 0;
+                std::chrono::system_clock::time_point time;
+                ripple::uint256 hookHash;
+                ripple::uint256 otxnId;
+                ripple::AccountID account;      // the account the hook is installed on
+                Kind kind = Kind::text;
+                uint8_t messageLen = 0;
+                uint16_t dataLen = 0;
+                int64_t number = 0;
+                uint8_t payload[maxMessage + maxData];  // message followed by data
+
+                ripple::Slice
+                message() const
+                {
+                    return {payload, messageLen};
+                }
+
+                ripple::Slice
+                data() const
+                {
+                    return {payload + messageLen, dataLen};
+                }
+            };
+
+            struct Page
+            {
+                std::vector<Entry> entries;
+                uint64_t marker = 0;            // where the next read should continue
+                uint64_t missed = 0;            // entries of any hook past the marker lost before this read
+            };
+
+        private:
+            // one hook's entries, in the order appended until full, then overwritten oldest first
+            struct Ring
+            {
+                std::vector<Entry> entries;
+                uint64_t appended = 0;
+            };
+
+            struct Shard
+            {
+                std::mutex mutex;
+                std::optional<LRUMap<ripple::uint256, Ring>> rings;  // unset while disabled
+            };
+
+            // taken one at a time by writers, all at once (in order) by resize() and read()
+            mutable std::array<Shard, shardCount> shards_;
+
+            std::size_t capacity_ = 0;          // entries per ring, written with all shards locked
+            uint64_t first_ = 1;                // sequence number of the first entry since resize()
+
+            // sequence number of the next entry appended, taken under the lock of its shard
+            std::atomic<uint64_t> next_ {1};
+
+            std::atomic<bool> enabled_ {false};
+
+            Shard&
+            shard(ripple::uint256 const& hookHash) const;
+
+        public:
+            HookTraceLog() = default;
+
+            HookTraceLog(HookTraceLog const&) = delete;
+            HookTraceLog& operator=(HookTraceLog const&) = delete;
+
+            // the ring the hook api functions trace into in this process
+            static HookTraceLog&
+            instance();
+
+            /**
+             * Size the rings according to the [hooks] config section:
+             *   trace_buffer=<entries>     keep the last so many traces of each hook (default 0, off)
+             *   trace_hooks=<hooks>        keep them for this many hooks (default 256)
+             * The hooks are lowered if they would hold more than maxEntries together.
+             */
+            void
+            setup(ripple::Section const& section, beast::Journal const& j);
+
+            /**
+             * (Re)size the rings, dropping all entries. Each of the at least hooks most recently
+             * tracing hooks keeps its last capacity traces. A capacity of 0 disables tracing.
+             */
+            void
+            resize(std::size_t capacity, std::size_t hooks = defaultHooks);
+
+            bool
+            enabled() const
+            {
+                return enabled_.load(std::memory_order_relaxed);
+            }
+
+            // entries kept per hook
+            std::size_t
+            capacity() const;
+
+            // copy one trace into its hook's ring, message and data are truncated to their bounds
+            void
+            append(
+                ripple::uint256 const& hookHash,
+                ripple::uint256 const& otxnId,
+                ripple::AccountID const& account,
+                Kind kind,
+                ripple::Slice message,
+                ripple::Slice data,
+                int64_t number);
+
+            /**
+             * Up to limit of the retained entries with a sequence number of at least marker, oldest
+             * first, optionally only those traced by the given hook.
+             */
+            Page
+            read(
+                uint64_t marker,
+                std::size_t limit,
+                std::optional<ripple::uint256> const& hookHash) const;
+
+            // an entry's trace as it would have been written to the log
+            static std::string
+            format(Entry const& entry);
+
+            // read(marker, limit, hookHash) as reported by the hook_trace command
+            Json::Value
+            getJson(
+                uint64_t marker,
+                std::size_t limit,
+                std::optional<ripple::uint256> const& hookHash) const;
+    };
+}
+
+#endif
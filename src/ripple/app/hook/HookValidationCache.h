@@ -0,0 +1,80 @@
+#ifndef HOOK_VALIDATION_CACHE_INCLUDED
+#define HOOK_VALIDATION_CACHE_INCLUDED 1
+#include <ripple/app/hook/LRUMap.h>
+#include <ripple/basics/base_uint.h>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace hook
+{
+    /**
+     * HookValidationCache stores one Verdict per SetHook byte code: whether validateGuards and the
+     * WasmEdge smoke test accepted it, the worst case execution of hook() and cbak() the fee is
+     * computed from, or why it was rejected. A large sfCreateCode blob is then only analysed once
+     * per node rather than on every relay, resubmission and apply of the transactions carrying it.
+     *
+     * The key is the SHA512H of the code, the same value which becomes its HookHash, paired with
+     * the rules version bitmask the guards were checked under, since amendments change which
+     * imports are whitelisted (see hook_api::import_signature) and how the bound is computed.
+     * Neither check looks at anything else, so a verdict never becomes stale and the least recently
+     * looked up one is only dropped to keep the node's memory bounded.
+     */
+    class HookValidationCache
+    {
+        public:
+            struct Verdict
+            {
+                bool valid = false;
+                uint64_t maxInstrCountHook = 0;     // worst case execution of hook(), if valid
+                uint64_t maxInstrCountCbak = 0;     // worst case execution of cbak(), if valid
+                std::string reason;                 // why the code was rejected, empty if valid
+            };
+
+            struct Counts
+            {
+                uint64_t hits;
+                uint64_t misses;
+                uint64_t evictions;
+                uint64_t size;
+            };
+
+        private:
+            // code hash, rules version
+            using Key = std::pair<ripple::uint256, uint64_t>;
+
+            mutable std::mutex mutex_;
+            LRUMap<Key, Verdict> verdicts_;
+
+        public:
+            explicit HookValidationCache(std::size_t capacity);
+
+            HookValidationCache(HookValidationCache const&) = delete;
+            HookValidationCache& operator=(HookValidationCache const&) = delete;
+
+            // the cache used by SetHook in this process
+            static HookValidationCache&
+            instance();
+
+            // the verdict for the code with this hash, if it has been validated under these rules
+            std::optional<Verdict>
+            find(ripple::uint256 const& codeHash, uint64_t rulesVersion);
+
+            // record the verdict of a validation
+            void
+            insert(ripple::uint256 const& codeHash, uint64_t rulesVersion, Verdict const& verdict);
+
+            std::size_t
+            size() const;
+
+            Counts
+            getCounts() const;
+    };
+
+    // maximum number of verdicts kept by HookValidationCache::instance()
+    uint32_t maxHookValidationCacheSize(void);
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef HOOK_LRU_MAP_INCLUDED
+#define HOOK_LRU_MAP_INCLUDED 1
+#include <ripple/basics/hardened_hash.h>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace hook
+{
+    /**
+     * LRUMap is the bounded map with least recently used eviction the in-memory hook caches are
+     * built on. It keeps the keys in a list ordered by use next to a hash map holding each value
+     * with its position in that list.
+     *
+     * It does no locking of its own, each cache guards it with the mutex which also covers the rest
+     * of its state. Only the hit, miss and eviction counters are atomic, so a cache can report them
+     * without taking its lock.
+     */
+    template <class Key, class Value, class Hash = ripple::hardened_hash<>>
+    class LRUMap
+    {
+        private:
+            using LRU = std::list<Key>;
+
+            struct Entry
+            {
+                Value value;
+                typename LRU::iterator position;
+            };
+
+            std::size_t const capacity_;
+
+            LRU lru_;   // front = most recently used
+            std::unordered_map<Key, Entry, Hash> map_;
+
+            std::atomic<uint64_t> hits_ {0};
+            std::atomic<uint64_t> misses_ {0};
+            std::atomic<uint64_t> evictions_ {0};
+
+            void
+            touch(Entry& entry)
+            {
+                lru_.splice(lru_.begin(), lru_, entry.position);
+            }
+
+        public:
+            explicit LRUMap(std::size_t capacity)
+                : capacity_(capacity < 1 ? 1 : capacity)
+            {
+            }
+
+            LRUMap(LRUMap const&) = delete;
+            LRUMap& operator=(LRUMap const&) = delete;
+
+            /**
+             * The value under key if it is there and usable(value) accepts it, which counts a hit
+             * and makes it the most recently used. Anything else counts a miss and returns nullptr.
+             */
+            template <class Usable>
+            Value*
+            find(Key const& key, Usable&& usable)
+            {
+                auto const it = map_.find(key);
+                if (it == map_.end() || !usable(it->second.value))
+                {
+                    ++misses_;
+                    return nullptr;
+                }
+
+                touch(it->second);
+                ++hits_;
+                return &it->second.value;
+            }
+
+            Value*
+            find(Key const& key)
+            {
+                return find(key, [](Value const&) { return true; });
+            }
+
+            // the value under key without counting or reordering anything, nullptr if absent
+            Value*
+            peek(Key const& key)
+            {
+                auto const it = map_.find(key);
+                return it == map_.end() ? nullptr : &it->second.value;
+            }
+
+            /**
+             * Make key the most recently used, adding it with value unless it is already there (as
+             * when another thread added it meanwhile), in which case value is discarded. Adding
+             * evicts the least recently used keys beyond capacity first, onEvict(key, value) sees
+             * each of them before it goes. Returns the value under key and whether it was added.
+             */
+            template <class OnEvict>
+            std::pair<Value&, bool>
+            insert(Key const& key, Value value, OnEvict&& onEvict)
+            {
+                if (auto const it = map_.find(key); it != map_.end())
+                {
+                    touch(it->second);
+                    return { it->second.value, false };
+                }
+
+                while (map_.size() >= capacity_ && !lru_.empty())
+                {
+                    auto const last = map_.find(lru_.back());
+                    onEvict(last->first, last->second.value);
+                    map_.erase(last);
+                    lru_.pop_back();
+                    ++evictions_;
+                }
+
+                lru_.push_front(key);
+                auto const it = map_.emplace(key, Entry { std::move(value), lru_.begin() }).first;
+                return { it->second.value, true };
+            }
+
+            std::pair<Value&, bool>
+            insert(Key const& key, Value value)
+            {
+                return insert(key, std::move(value), [](Key const&, Value&) {});
+            }
+
+            // remove key, which is not counted as an eviction, returns false if it was absent
+            bool
+            erase(Key const& key)
+            {
+                auto const it = map_.find(key);
+                if (it == map_.end())
+                    return false;
+
+                lru_.erase(it->second.position);
+                map_.erase(it);
+                return true;
+            }
+
+            // call f(key, value) for every entry, in no particular order
+            template <class F>
+            void
+            forEach(F&& f)
+            {
+                for (auto& [key, entry] : map_)
+                    f(key, entry.value);
+            }
+
+            template <class F>
+            void
+            forEach(F&& f) const
+            {
+                for (auto const& [key, entry] : map_)
+                    f(key, entry.value);
+            }
+
+            std::size_t
+            size() const
+            {
+                return map_.size();
+            }
+
+            uint64_t
+            hits() const
+            {
+                return hits_.load();
+            }
+
+            uint64_t
+            misses() const
+            {
+                return misses_.load();
+            }
+
+            uint64_t
+            evictions() const
+            {
+                return evictions_.load();
+            }
+    };
+}
+
+#endif
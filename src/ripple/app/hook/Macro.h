@@ -85,7 +85,8 @@
     extern WasmEdge_ValType WasmFunctionParams##F[];\
     extern WasmEdge_ValType WasmFunctionResult##F[];\
     extern WasmEdge_FunctionTypeContext* WasmFunctionType##F;\
-    extern WasmEdge_String WasmFunctionName##F;
+    extern WasmEdge_String WasmFunctionName##F;\
+    extern uint16_t const WasmFunctionId##F;
 
 
 #define DECLARE_HOOK_FUNCNARG(R, F)\
@@ -96,7 +97,8 @@
         const WasmEdge_Value *in, WasmEdge_Value *out);\
     extern WasmEdge_ValType WasmFunctionResult##F[];\
     extern WasmEdge_FunctionTypeContext* WasmFunctionType##F;\
-    extern WasmEdge_String WasmFunctionName##F;
+    extern WasmEdge_String WasmFunctionName##F;\
+    extern uint16_t const WasmFunctionId##F;
 
 #define DEFINE_HOOK_FUNCTION(R, F, ...)\
     WasmEdge_Result hook_api::WasmFunction##F(\
@@ -106,7 +108,9 @@
     {\
         int _stack = 0;\
         FOR_VARS(VAR_ASSIGN, 2, __VA_ARGS__);\
-        hook::HookContext* hookCtx = reinterpret_cast<hook::HookContext*>(data_ptr);\
+        hook::HookContext* hookCtx = *reinterpret_cast<hook::HookContext**>(data_ptr);\
+        ++hookCtx->result.hostCallCount;\
+        ++hookCtx->result.hostCalls[WasmFunctionId##F];\
         R return_code = hook_api::F(*hookCtx,  *const_cast<WasmEdge_CallingFrameContext*>(frameCtx),\
                STRIP_TYPES(__VA_ARGS__));\
         if (return_code == RC_ROLLBACK || return_code == RC_ACCEPT)\
@@ -120,6 +124,7 @@
             WasmFunctionParams##F, VA_NARGS(NULL, __VA_ARGS__),\
             WasmFunctionResult##F, 1);\
     WasmEdge_String hook_api::WasmFunctionName##F = WasmEdge_StringCreateByCString(#F);\
+    uint16_t const hook_api::WasmFunctionId##F = hook::registerHostFunction(#F);\
     R hook_api::F(hook::HookContext& hookCtx, WasmEdge_CallingFrameContext const& frameCtx, __VA_ARGS__)
 
 #define DEFINE_HOOK_FUNCNARG(R, F)\
@@ -128,7 +133,9 @@
         const WasmEdge_CallingFrameContext* frameCtx,\
         const WasmEdge_Value *in, WasmEdge_Value *out)\
     {\
-        hook::HookContext* hookCtx = reinterpret_cast<hook::HookContext*>(data_ptr);\
+        hook::HookContext* hookCtx = *reinterpret_cast<hook::HookContext**>(data_ptr);\
+        ++hookCtx->result.hostCallCount;\
+        ++hookCtx->result.hostCalls[WasmFunctionId##F];\
         R return_code = hook_api::F(*hookCtx, *const_cast<WasmEdge_CallingFrameContext*>(frameCtx));\
         if (return_code == RC_ROLLBACK || return_code == RC_ACCEPT)\
             return WasmEdge_Result_Terminate;\
@@ -139,17 +146,25 @@
     WasmEdge_FunctionTypeContext* hook_api::WasmFunctionType##F = \
         WasmEdge_FunctionTypeCreate({}, 0, WasmFunctionResult##F, 1);\
     WasmEdge_String hook_api::WasmFunctionName##F = WasmEdge_StringCreateByCString(#F);\
+    uint16_t const hook_api::WasmFunctionId##F = hook::registerHostFunction(#F);\
     R hook_api::F(hook::HookContext& hookCtx, WasmEdge_CallingFrameContext const& frameCtx)
 
+// journal and memory are resolved once per execution and kept in the HookContext, host functions
+// called in a tight loop only pay for reading them back
 #define HOOK_SETUP()\
     [[maybe_unused]] ApplyContext& applyCtx = hookCtx.applyCtx;\
     [[maybe_unused]] auto& view = applyCtx.view();\
-    [[maybe_unused]] auto j = applyCtx.app.journal("View");\
-    [[maybe_unused]] WasmEdge_MemoryInstanceContext* memoryCtx =\
-            WasmEdge_CallingFrameGetMemoryInstance(&frameCtx, 0);\
-    [[maybe_unused]] unsigned char* memory = WasmEdge_MemoryInstanceGetPointer(memoryCtx, 0, 0);\
-    [[maybe_unused]] const uint64_t memory_length = WasmEdge_MemoryInstanceGetPageSize(memoryCtx) * \
-        WasmEdge_kPageSize;
+    [[maybe_unused]] auto const& j = hookCtx.j;\
+    if (!hookCtx.memoryCtx)\
+    {\
+        hookCtx.memoryCtx = WasmEdge_CallingFrameGetMemoryInstance(&frameCtx, 0);\
+        hookCtx.memory = WasmEdge_MemoryInstanceGetPointer(hookCtx.memoryCtx, 0, 0);\
+        hookCtx.memoryLength = WasmEdge_MemoryInstanceGetPageSize(hookCtx.memoryCtx) * \
+            WasmEdge_kPageSize;\
+    }\
+    [[maybe_unused]] WasmEdge_MemoryInstanceContext* memoryCtx = hookCtx.memoryCtx;\
+    [[maybe_unused]] unsigned char* memory = hookCtx.memory;\
+    [[maybe_unused]] const uint64_t memory_length = hookCtx.memoryLength;
 
 #define WRITE_WASM_MEMORY(bytes_written, guest_dst_ptr, guest_dst_len,\
         host_src_ptr, host_src_len, host_memory_ptr, guest_memory_length)\
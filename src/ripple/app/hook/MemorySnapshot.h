@@ -0,0 +1,197 @@
+#ifndef HOOK_MEMORY_SNAPSHOT_INCLUDED
+#define HOOK_MEMORY_SNAPSHOT_INCLUDED 1
+#include <ripple/app/hook/LRUMap.h>
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/beast/utility/Journal.h>
+#include <wasmedge/wasmedge.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ripple
+{
+    class Section;
+}
+
+namespace hook
+{
+
+    /**
+     * MemorySnapshot is the linear memory of a hook as it is straight after instantiation, that is
+     * with its data segments applied, together with the hook's module minus its data section.
+     * Instantiating that module and placing the image into its (zero filled) memory results in the
+     * same instance as instantiating the hook itself, without copying the data segments again.
+     *
+     * On Linux with the WasmEdge version this is built against (0.11.2, checked again at runtime)
+     * the image is kept in a memfd and mapped copy-on-write (MAP_PRIVATE | MAP_FIXED) over the
+     * instance's memory, so placing it costs one mmap and only the pages the hook writes to are
+     * ever copied. Otherwise, or if the memory is not page aligned, the non-zero pages are copied in.
+     */
+    class MemorySnapshot
+    {
+        private:
+            // a run of the image which is not all zero
+            struct Chunk
+            {
+                uint32_t offset;
+                std::vector<uint8_t> bytes;
+            };
+
+            ModuleCache::Module const module_;
+            std::string const memoryName_;
+            uint32_t const pages_;
+            std::vector<Chunk> const chunks_;
+            uint64_t const instructions_;
+            int fd_ = -1;                       // memfd holding the image, -1 if it is copied in
+
+        public:
+            MemorySnapshot(
+                ModuleCache::Module module,
+                std::string memoryName,
+                uint32_t pages,
+                std::vector<Chunk> chunks,
+                uint64_t instructions);
+
+            ~MemorySnapshot();
+
+            MemorySnapshot(MemorySnapshot const&) = delete;
+            MemorySnapshot& operator=(MemorySnapshot const&) = delete;
+
+            // the hook without its data section, this is what gets instantiated
+            ModuleCache::Module const&
+            module() const
+            {
+                return module_;
+            }
+
+            /**
+             * Instructions counted while instantiating the hook but not while instantiating module(),
+             * i.e. the evaluation of the data segment offsets. They are added to the instruction count
+             * of an execution from the snapshot so the hook fee does not depend on how it was started.
+             */
+            uint64_t
+            instructions() const
+            {
+                return instructions_;
+            }
+
+            /**
+             * Place the image into the memory of a fresh instance of module(). Returns false if the
+             * instance's memory does not match the snapshot or could not be written, including a
+             * failed mapping which may have left it without memory, in which case the instance must
+             * be deleted without being executed.
+             */
+            bool
+            apply(WasmEdge_ModuleInstanceContext* instance) const;
+
+            /**
+             * Instantiate the hook (and its stripped counterpart) once to take its snapshot. Returns
+             * nullptr if the hook cannot be snapshotted or either instantiation fails.
+             */
+            static std::shared_ptr<MemorySnapshot const>
+            take(
+                ModuleCache::Module const& hook,
+                const void* wasm,
+                size_t len,
+                WasmEdge_ConfigureContext* confCtx,
+                WasmEdge_StoreContext* storeCtx,
+                beast::Journal const& j);
+
+            /**
+             * The byte code with its data section removed, or nullopt if the hook has no active data
+             * segments (nothing to gain), or if it has a start function (which would run before the
+             * image is in place), passive data segments or a data count section (memory.init and
+             * data.drop would find the segments gone), or if the byte code is malformed.
+             */
+            static std::optional<std::vector<uint8_t>>
+            stripData(const void* wasm, size_t len);
+    };
+
+    /**
+     * MemorySnapshotCache maps the HookHash of recently executed hooks to their MemorySnapshot, so
+     * the strong, weak (hook_again) and callback executions of a hook all start from the same image
+     * and only the first pays for instantiating it twice. A hook which cannot be snapshotted is
+     * stored with an empty snapshot, so it is not examined again on each execution and simply runs
+     * as before. Snapshots are immutable and may be applied concurrently on several threads.
+     *
+     * Each entry holds the hook's stripped module and, on Linux, a memfd the size of its memory,
+     * so far fewer are kept than modules in the ModuleCache. An evicted snapshot stays alive for the
+     * executions still holding it.
+     */
+    class MemorySnapshotCache
+    {
+        public:
+            using Snapshot = std::shared_ptr<MemorySnapshot const>;
+
+            struct Counts
+            {
+                uint64_t hits;
+                uint64_t misses;
+                uint64_t rejected;
+                uint64_t evictions;
+                uint64_t size;
+            };
+
+        private:
+            mutable std::mutex mutex_;
+            LRUMap<ripple::uint256, Snapshot> snapshots_;     // empty if it cannot be snapshotted
+
+            std::atomic<bool> enabled_ {false};
+
+            std::atomic<uint64_t> rejected_ {0};
+
+        public:
+            explicit MemorySnapshotCache(std::size_t capacity);
+
+            MemorySnapshotCache(MemorySnapshotCache const&) = delete;
+            MemorySnapshotCache& operator=(MemorySnapshotCache const&) = delete;
+
+            // the cache used by all hook executions in this process
+            static MemorySnapshotCache&
+            instance();
+
+            /**
+             * Enable snapshots according to the [hooks] config section:
+             *   memory_snapshots=1     start interpreted hooks from a snapshot (default off)
+             */
+            void
+            setup(ripple::Section const& section, beast::Journal const& j);
+
+            bool
+            enabled() const;
+
+            void
+            enable(bool on);
+
+            /**
+             * Return the snapshot for the given hook hash, taking it on a cache miss with the thread's
+             * configuration and store (whose imports the hook links against). Returns nullptr if
+             * snapshots are disabled or the hook cannot be snapshotted.
+             */
+            Snapshot
+            fetch(
+                ripple::uint256 const& hookHash,
+                ModuleCache::Module const& hook,
+                const void* wasm,
+                size_t len,
+                WasmEdge_ConfigureContext* confCtx,
+                WasmEdge_StoreContext* storeCtx,
+                beast::Journal const& j);
+
+            std::size_t
+            size() const;
+
+            Counts
+            getCounts() const;
+    };
+
+    // maximum number of hooks whose snapshot (or lack of one) is kept by MemorySnapshotCache::instance()
+    uint32_t maxHookMemorySnapshotCacheSize(void);
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef HOOK_MODULE_CACHE_INCLUDED
+#define HOOK_MODULE_CACHE_INCLUDED 1
+#include <ripple/app/hook/LRUMap.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/beast/utility/Journal.h>
+#include <boost/filesystem.hpp>
+#include <wasmedge/wasmedge.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ripple
+{
+    class JobQueue;
+    class ReadView;
+    class Section;
+}
+
+namespace hook
+{
+
+    /**
+     * ModuleCache keeps loaded and validated wasm modules (WasmEdge AST modules) in memory so
+     * that a hook which fires on every transaction against a busy account only pays the
+     * parse + validate cost once.
+     *
+     * Entries are keyed by HookHash. The HookHash is the SHA512H of the hook's CreateCode, so an
+     * entry can never become stale: the same key always refers to the same byte code.
+     * One instance serves every execution in the process. It holds at most capacity modules and
+     * forgets the least recently fetched one to make room for another. AST modules are immutable once validated, so a module handed out by fetch() may be
+     * instantiated concurrently on several threads.
+     *
+     * Optionally (see setupNative) each entry also has an ahead-of-time compiled tier. Nothing
+     * of it happens while transactions are applied: fetch() only notes hooks without native
+     * code, and each validated ledger (compilePending) starts a background job which compiles
+     * the noted hooks whose definitions it holds, or loads the artifact an earlier run left on
+     * disk, under the HookHash. Every artifact is stored with a digest binding it to the hook
+     * and is only loaded if it matches. The interpreted module is always kept so execution can
+     * fall back to it. Native code is compiled with instruction counting enabled, so metering
+     * (and therefore the hook fee) is identical across both tiers.
+     */
+    class ModuleCache
+    {
+        public:
+            using Module = std::shared_ptr<WasmEdge_ASTModuleContext const>;
+
+            // the tiers available for a hook, native is empty until compiled (or when disabled)
+            struct Modules
+            {
+                Module interpreted;
+                Module native;
+            };
+
+            struct Counts
+            {
+                uint64_t hits;
+                uint64_t misses;
+                uint64_t evictions;
+                uint64_t failures;
+                uint64_t size;
+                uint64_t native;
+                uint64_t compileFailures;
+            };
+
+        private:
+            mutable std::mutex mutex_;
+            LRUMap<ripple::uint256, Modules> modules_;
+
+            // native tier, nativePath_ is empty when the tier is disabled
+            boost::filesystem::path nativePath_;
+            std::atomic<bool> nativeEnabled_ {false};
+            std::set<ripple::uint256> pending_;     // cached without native code, not yet tried
+            std::set<ripple::uint256> rejected_;    // demoted, never compiled again this run
+            bool jobQueued_ = false;                // at most one compile job at a time
+
+            std::atomic<uint64_t> failures_ {0};
+            std::atomic<uint64_t> native_ {0};
+            std::atomic<uint64_t> compileFailures_ {0};
+
+            /**
+             * Load and validate a previously compiled native artifact, nullptr if absent or bad.
+             * The artifact is only handed to the loader (which dlopens it) once it matches the
+             * digest stored alongside it for this hook.
+             */
+            static Module
+            loadNative(
+                boost::filesystem::path const& file,
+                ripple::uint256 const& hookHash,
+                beast::Journal const& j);
+
+            // run the WasmEdge compiler, writing the artifact and its digest, returns true on success
+            static bool
+            compile(
+                std::vector<uint8_t> const& wasm,
+                ripple::uint256 const& hookHash,
+                boost::filesystem::path const& file,
+                beast::Journal const& j);
+
+            // the digest of an artifact built from the hook, see loadNative
+            static ripple::uint256
+            nativeDigest(ripple::uint256 const& hookHash, std::vector<uint8_t> const& artifact);
+
+            boost::filesystem::path
+            nativeFile(ripple::uint256 const& hookHash) const;
+
+            // compile or load the native code of each hook, run by the job compilePending queues
+            void
+            buildNative(
+                std::shared_ptr<ripple::ReadView const> const& ledger,
+                std::set<ripple::uint256> const& hookHashes,
+                beast::Journal const& j);
+
+        public:
+            explicit ModuleCache(std::size_t capacity);
+
+            ModuleCache(ModuleCache const&) = delete;
+            ModuleCache& operator=(ModuleCache const&) = delete;
+
+            // the cache used by all hook executions in this process
+            static ModuleCache&
+            instance();
+
+            // parse and validate a wasm blob, returns nullptr if either step fails
+            static Module
+            load(const void* wasm, size_t len, beast::Journal const& j);
+
+            /**
+             * Enable or disable the native tier according to the [hooks] config section:
+             *   aot=1           turn on ahead-of-time compilation (default off)
+             *   aot_path=<dir>  where artifacts are kept (default <database_path>/hook_aot), it
+             *                   must only be writable by the server
+             * Hooks already cached are compiled from the next validated ledger on.
+             */
+            void
+            setupNative(
+                ripple::Section const& section,
+                std::string const& databasePath,
+                beast::Journal const& j);
+
+            bool
+            nativeEnabled() const;
+
+            /**
+             * Return the loaded and validated module(s) for the given hook hash, loading from the
+             * supplied byte code on a cache miss. The interpreted module is empty if the byte code
+             * could not be loaded or validated (failures are not cached). A miss never touches
+             * the native tier, the hook is left for compilePending.
+             */
+            Modules
+            fetch(
+                ripple::uint256 const& hookHash,
+                const void* wasm,
+                size_t len,
+                beast::Journal const& j);
+
+            /**
+             * Queue a background job giving native code to the hooks cached since the last call,
+             * unless the native tier is disabled or a job is still running. Called with each
+             * validated ledger, the byte code is read from the hook definitions it holds so only
+             * hooks which made it onto a validated ledger are ever compiled. Hooks it doesn't
+             * hold yet are tried again with the next ledger.
+             */
+            void
+            compilePending(
+                std::shared_ptr<ripple::ReadView const> const& ledger,
+                ripple::JobQueue& jobQueue,
+                beast::Journal const& j);
+
+            // drop a native module which failed to instantiate, execution continues interpreted
+            void
+            demoteNative(ripple::uint256 const& hookHash);
+
+            std::size_t
+            size() const;
+
+            Counts
+            getCounts() const;
+    };
+
+    // maximum number of loaded modules kept by ModuleCache::instance()
+    uint32_t maxHookModuleCacheSize(void);
+}
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef HOOK_STO_INDEX_INCLUDED
+#define HOOK_STO_INDEX_INCLUDED 1
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace hook
+{
+    // RH NOTE this is a light-weight stobject parsing function for drilling into a provided serialzied object
+    // however it could probably be replaced by an existing class or routine or set of routines in XRPLD
+    // Returns object length including header bytes (and footer bytes in the event of array or object)
+    // negative indicates error
+    // -1 = unexpected end of bytes
+    // -2 = unknown type (detected early)
+    // -3 = unknown type (end of function)
+    // -4 = excessive stobject nesting
+    // -5 = excessively large array or object
+    inline int32_t get_stobject_length (
+        unsigned char const* start,   // in - begin iterator
+        unsigned char const* maxptr,  // in - end iterator
+        int& type,              // out - populated by serialized type code
+        int& field,             // out - populated by serialized field code
+        int& payload_start,     // out - the start of actual payload data for this type
+        int& payload_length,    // out - the length of actual payload data for this type
+        int recursion_depth = 0)   // used internally
+    {
+        if (recursion_depth > 10)
+            return -4;
+
+        unsigned char const* end = maxptr;
+        unsigned char const* upto = start;
+        int high = *upto >> 4;
+        int low = *upto & 0xF;
+
+        upto++; if (upto >= end) return -1;
+        if (high > 0 && low > 0)
+        {
+            // common type common field
+            type = high;
+            field = low;
+        } else if (high > 0) {
+            // common type, uncommon field
+            type = high;
+            field = *upto++;
+        } else if (low > 0) {
+            // common field, uncommon type
+            field = low;
+            type = *upto++;
+        } else {
+            // uncommon type and field
+            type = *upto++;
+            if (upto >= end) return -1;
+            field = *upto++;
+        }
+
+        if (upto >= end) return -1;
+
+        // RH TODO: link this to rippled's internal STObject constants
+        // E.g.:
+        /*
+        int field_code = (safe_cast<int>(type) << 16) | field;
+        auto const& fieldObj = ripple::SField::getField;
+        */
+
+        if (type < 1 || type > 19 || ( type >= 9 && type <= 13))
+            return -2;
+
+        bool is_vl = (type == 8 /*ACCID*/ || type == 7 || type == 18 || type == 19);
+
+
+        int length = -1;
+        if (is_vl)
+        {
+            length = *upto++;
+            if (upto >= end)
+                return -1;
+
+            if (length < 193)
+            {
+                // do nothing
+            } else if (length > 192 && length < 241)
+            {
+                length -= 193;
+                length *= 256;
+                length += *upto++ + 193; if (upto > end) return -1;
+            } else {
+                int b2 = *upto++; if (upto >= end) return -1;
+                length -= 241;
+                length *= 65536;
+                length += 12481 + (b2 * 256) + *upto++; if (upto >= end) return -1;
+            }
+        } else if ((type >= 1 && type <= 5) || type == 16 || type == 17 )
+        {
+            length =    (type ==  1 ?  2 :
+                        (type ==  2 ?  4 :
+                        (type ==  3 ?  8 :
+                        (type ==  4 ? 16 :
+                        (type ==  5 ? 32 :
+                        (type == 16 ?  1 :
+                        (type == 17 ? 20 : -1 )))))));
+
+        } else if (type == 6) /* AMOUNT */
+        {
+            length =  (*upto >> 6 == 1) ? 8 : 48;
+            if (upto >= end) return -1;
+        }
+
+        if (length > -1)
+        {
+            payload_start = upto - start;
+            payload_length = length;
+            return length + (upto - start);
+        }
+
+        if (type == 15 || type == 14) /* Object / Array */
+        {
+           payload_start = upto - start;
+
+           for(int i = 0; i < 1024; ++i)
+           {
+                int subfield = -1, subtype = -1, payload_start_ = -1, payload_length_ = -1;
+                int32_t sublength = get_stobject_length(
+                        upto, end, subtype, subfield, payload_start_, payload_length_, recursion_depth + 1);
+                if (sublength < 0)
+                    return -1;
+                upto += sublength;
+                if (upto >= end)
+                    return -1;
+
+                if ((*upto == 0xE1U && type == 0xEU) ||
+                    (*upto == 0xF1U && type == 0xFU))
+                {
+                    payload_length = upto - start - payload_start;
+                    upto++;
+                    return (upto - start);
+                }
+           }
+           return -5;
+        }
+
+        return -3;
+
+    }
+
+    struct STOField
+    {
+        int32_t offset;         // of the field header from the start of the scanned buffer
+        int32_t length;         // including header (and footer for arrays and objects)
+        int type;
+        int field;
+        int payload_start;      // relative to offset
+        int payload_length;
+    };
+
+    /**
+     * The top level fields of a serialized object (or the elements of an unwrapped array) exactly as
+     * the sto_* scan loops see them: at most 1024 consecutive get_stobject_length calls, stopping at
+     * the end of the buffer or at the first field which does not parse.
+     */
+    struct STOScan
+    {
+        std::vector<STOField> fields;
+        bool error = false;     // the field after the last one in fields failed to parse
+        int64_t upto = 0;       // where the walk stopped, past the end for an overlong last field
+
+        static STOScan
+        make(unsigned char const* start, unsigned char const* end)
+        {
+            STOScan scan;
+            unsigned char const* upto = start;
+            for (int i = 0; i < 1024 && upto < end; ++i)
+            {
+                int type = -1, field = -1, payload_start = -1, payload_length = -1;
+                int32_t length = get_stobject_length(upto, end, type, field, payload_start, payload_length, 0);
+                if (length < 0)
+                {
+                    scan.error = true;
+                    break;
+                }
+                scan.fields.push_back(
+                    STOField { (int32_t)(upto - start), length, type, field, payload_start, payload_length });
+                upto += length;
+            }
+            scan.upto = upto - start;
+            return scan;
+        }
+    };
+
+    /**
+     * Per execution cache of STOScans over the hook's linear memory, so that a hook drilling into
+     * the same object with repeated sto_* calls (and into the objects nested in it, which lie inside
+     * the same buffer) parses each range once. A hook can write its memory between calls, so every
+     * buffer is snapshotted when first scanned and a cached scan is only used while the memory still
+     * holds the same bytes, which is a memcmp rather than a re-parse.
+     */
+    class STOIndex
+    {
+        public:
+            static constexpr std::size_t maxBuffers = 8;
+            static constexpr std::size_t maxScansPerBuffer = 32;
+            static constexpr std::size_t maxBufferSize = 16 * 1024;
+
+        private:
+            struct Buffer
+            {
+                uint32_t ptr = 0;
+                std::vector<uint8_t> bytes;
+                std::vector<std::pair<std::pair<uint32_t, uint32_t>, STOScan>> scans;
+                uint64_t used = 0;
+            };
+
+            std::vector<Buffer> buffers_;
+            uint64_t clock_ = 0;
+            STOScan uncached_;
+
+            STOScan const&
+            scanIn(Buffer& buffer, uint32_t ptr, uint32_t len)
+            {
+                buffer.used = ++clock_;
+                auto const key = std::make_pair(ptr, len);
+                for (auto const& [k, scan] : buffer.scans)
+                    if (k == key)
+                        return scan;
+
+                if (buffer.scans.size() >= maxScansPerBuffer)
+                    buffer.scans.erase(buffer.scans.begin());
+
+                unsigned char const* start = buffer.bytes.data() + (ptr - buffer.ptr);
+                buffer.scans.emplace_back(key, STOScan::make(start, start + len));
+                return buffer.scans.back().second;
+            }
+
+        public:
+            // the scan of [memory + ptr, memory + ptr + len), the caller has bounds checked the range
+            STOScan const&
+            scan(unsigned char const* memory, uint32_t ptr, uint32_t len)
+            {
+                if (len > maxBufferSize)
+                {
+                    uncached_ = STOScan::make(memory + ptr, memory + ptr + len);
+                    return uncached_;
+                }
+
+                for (std::size_t i = 0; i < buffers_.size(); )
+                {
+                    Buffer& buffer = buffers_[i];
+                    bool const contains =
+                        ptr >= buffer.ptr &&
+                        (uint64_t)ptr + len <= (uint64_t)buffer.ptr + buffer.bytes.size();
+                    if (contains)
+                    {
+                        if (std::memcmp(memory + ptr, buffer.bytes.data() + (ptr - buffer.ptr), len) == 0)
+                            return scanIn(buffer, ptr, len);
+
+                        // the hook has written over this buffer since it was scanned
+                        buffers_.erase(buffers_.begin() + i);
+                        continue;
+                    }
+                    ++i;
+                }
+
+                if (buffers_.size() >= maxBuffers)
+                    buffers_.erase(std::min_element(buffers_.begin(), buffers_.end(),
+                        [](Buffer const& a, Buffer const& b) { return a.used < b.used; }));
+
+                Buffer& buffer = buffers_.emplace_back();
+                buffer.ptr = ptr;
+                buffer.bytes.assign(memory + ptr, memory + ptr + len);
+                return scanIn(buffer, ptr, len);
+            }
+
+            std::size_t
+            size() const
+            {
+                return buffers_.size();
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef HOOK_WEAK_CHAIN_SCHEDULER_INCLUDED
+#define HOOK_WEAK_CHAIN_SCHEDULER_INCLUDED 1
+#include <ripple/beast/utility/Journal.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ripple
+{
+    class Section;
+}
+
+namespace hook
+{
+    /**
+     * Worker pool used to run the weak (collect) hook chains of a transaction's stake holders
+     * concurrently. Off unless [hooks] parallel_weak_chains names a thread count.
+     *
+     * The scheduler only runs tasks, deciding whether the chains were independent and merging
+     * their results in chain order is left to the caller (see Transactor::doTSHParallel). The
+     * calling thread takes tasks as well, so a batch always completes even when every worker is
+     * busy with another transaction's batch.
+     */
+    class WeakChainScheduler
+    {
+        private:
+            struct Batch
+            {
+                std::function<void(std::size_t)> task;
+                std::size_t size = 0;
+                std::atomic<std::size_t> next {0};
+                std::atomic<std::size_t> done {0};
+                std::atomic<bool> failed {false};
+                std::mutex mutex;
+                std::condition_variable finished;
+
+                // run the next task of the batch, false once every task has been taken
+                bool
+                work();
+            };
+
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::deque<std::shared_ptr<Batch>> queue_;
+            std::vector<std::thread> threads_;
+            bool stop_ = false;
+
+            // read by every transaction applied, set by setup and start
+            std::atomic<bool> enabled_ {false};
+
+            std::atomic<uint64_t> batches_ {0};
+            std::atomic<uint64_t> fallbacks_ {0};
+
+            void
+            worker();
+
+        public:
+            WeakChainScheduler() = default;
+            ~WeakChainScheduler();
+
+            WeakChainScheduler(WeakChainScheduler const&) = delete;
+            WeakChainScheduler& operator=(WeakChainScheduler const&) = delete;
+
+            // the scheduler used by all transactors in this process
+            static WeakChainScheduler&
+            instance();
+
+            /**
+             * Start the worker pool according to the [hooks] config section:
+             *   parallel_weak_chains=<n>   worker threads, 0 (the default) keeps execution sequential
+             *
+             * The pool outlives the Application that started it, an Application set up without the
+             * option disables it again.
+             */
+            void
+            setup(ripple::Section const& section, beast::Journal const& j);
+
+            // start n worker threads and enable the pool, for setup and tests, once started the
+            // thread count is kept
+            void
+            start(std::size_t n);
+
+            bool
+            enabled() const;
+
+            /**
+             * Run task(0) ... task(n - 1) on the pool and the calling thread, returning once all have
+             * completed. Returns false if any task threw, the exceptions themselves are dropped.
+             */
+            bool
+            run(std::size_t n, std::function<void(std::size_t)> task);
+
+            // a batch whose chains turned out not to be independent and were run again in sequence
+            void
+            noteFallback();
+
+            // reported by get_counts
+            uint64_t
+            batches() const;
+
+            uint64_t
+            fallbacks() const;
+    };
+}
+
+#endif
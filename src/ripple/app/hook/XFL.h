@@ -0,0 +1,584 @@
+#ifndef HOOK_XFL_INCLUDED
+#define HOOK_XFL_INCLUDED 1
+#include <ripple/app/hook/Enum.h>
+#include <ripple/basics/IOUAmount.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * XFL is the 64 bit floating point format of the hook API:
+ *
+ *   bit 63      always 0 (negative int64 values are error codes)
+ *   bit 62      sign, set for positive values
+ *   bits 61-54  exponent + 97
+ *   bits 53-0   mantissa, normalized into [minMantissa, maxMantissa]
+ *
+ * and 0 is the canonical zero. The kernels below are what the float_* host functions compute.
+ * They are integer only (apart from float_log and float_root which are defined by double math)
+ * and must stay bit-exact with the results hooks have always seen, including the rounding of the
+ * digit-by-digit division and the error values some edge cases produce, as these results end up
+ * in ledger state. XFL_test checks every kernel against the implementation it replaced.
+ */
+namespace hook_float
+{
+
+    // power of 10 LUT for fast integer math
+    static constexpr int64_t power_of_ten[19] =
+    {
+        1LL,
+        10LL,
+        100LL,
+        1000LL,
+        10000LL,
+        100000LL,
+        1000000LL,
+        10000000LL,
+        100000000LL,
+        1000000000LL,
+        10000000000LL,
+        100000000000LL,
+        1000000000000LL,
+        10000000000000LL,
+        100000000000000LL,
+        1000000000000000LL,  // 15
+        10000000000000000LL,
+        100000000000000000LL,
+        1000000000000000000LL,
+    };
+
+    static int64_t const minMantissa = 1000000000000000ull;
+    static int64_t const maxMantissa = 9999999999999999ull;
+    static int32_t const minExponent = -96;
+    static int32_t const maxExponent = 80;
+    inline int32_t get_exponent(int64_t float1)
+    {
+        if (float1 < 0)
+            return hook_api::INVALID_FLOAT;
+        if (float1 == 0)
+            return 0;
+        if (float1 < 0) return hook_api::INVALID_FLOAT;
+        uint64_t float_in = (uint64_t)float1;
+        float_in >>= 54U;
+        float_in &= 0xFFU;
+        return ((int32_t)float_in) - 97;
+    }
+
+    inline int64_t get_mantissa(int64_t float1)
+    {
+        if (float1 < 0)
+            return hook_api::INVALID_FLOAT;
+        if (float1 == 0)
+            return 0;
+        if (float1 < 0) return hook_api::INVALID_FLOAT;
+        float1 -= ((((uint64_t)float1) >> 54U) << 54U);
+        return float1;
+    }
+
+    inline bool is_negative(int64_t float1)
+    {
+        return ((float1 >> 62U) & 1ULL) == 0;
+    }
+
+    inline int64_t invert_sign(int64_t float1)
+    {
+        int64_t r = (int64_t)(((uint64_t)float1) ^ (1ULL<<62U));
+        return r;
+    }
+
+    inline int64_t set_sign(int64_t float1, bool set_negative)
+    {
+        bool neg = is_negative(float1);
+        if ((neg && set_negative) || (!neg && !set_negative))
+            return float1;
+
+        return invert_sign(float1);
+    }
+
+    inline int64_t set_mantissa(int64_t float1, uint64_t mantissa)
+    {
+        if (mantissa > maxMantissa)
+            return hook_api::MANTISSA_OVERSIZED;
+        if (mantissa < minMantissa)
+            return hook_api::MANTISSA_UNDERSIZED;
+        return float1 - get_mantissa(float1) + mantissa;
+    }
+
+    inline int64_t set_exponent(int64_t float1, int32_t exponent)
+    {
+        if (exponent > maxExponent)
+            return hook_api::EXPONENT_OVERSIZED;
+        if (exponent < minExponent)
+            return hook_api::EXPONENT_UNDERSIZED;
+
+        uint64_t exp = (exponent + 97);
+        exp <<= 54U;
+        float1 &= ~(0xFFLL<<54);
+        float1 += (int64_t)exp;
+        return float1;
+    }
+
+    // true if float1 is 0 or a normalized XFL, anything else is rejected with INVALID_FLOAT
+    inline bool is_valid(int64_t float1)
+    {
+        if (float1 < 0)
+            return false;
+        if (float1 == 0)
+            return true;
+        uint64_t mantissa = get_mantissa(float1);
+        int32_t exponent = get_exponent(float1);
+        return !(mantissa < minMantissa ||
+            mantissa > maxMantissa ||
+            exponent > maxExponent ||
+            exponent < minExponent);
+    }
+
+    /**
+     * Pack a signed mantissa and exponent exactly as the set_* helpers above do, this is the
+     * conversion used for IOUAmount results. Note a zero mantissa does not give canonical 0 here
+     * (set_mantissa reports it as undersized), callers which can produce zero check for it first.
+     */
+    inline int64_t make_float_signed(int64_t man_out, int32_t exponent)
+    {
+        int64_t float_out = 0;
+        bool neg = man_out < 0;
+        if (neg)
+            man_out *= -1;
+
+        float_out = set_sign(float_out, neg);
+        float_out = set_mantissa(float_out, (uint64_t)man_out);
+        float_out = set_exponent(float_out, exponent);
+        return float_out;
+    }
+
+    inline int64_t make_float(ripple::IOUAmount const& amt)
+    {
+        return make_float_signed(amt.mantissa(), amt.exponent());
+    }
+
+    inline int64_t make_float(uint64_t mantissa, int32_t exponent, bool neg)
+    {
+        if (mantissa == 0)
+            return 0;
+        if (mantissa > maxMantissa)
+            return hook_api::MANTISSA_OVERSIZED;
+        if (mantissa < minMantissa)
+            return hook_api::MANTISSA_UNDERSIZED;
+        if (exponent > maxExponent)
+            return hook_api::EXPONENT_OVERSIZED;
+        if (exponent < minExponent)
+            return hook_api::EXPONENT_UNDERSIZED;
+        int64_t out =  0;
+        out = set_mantissa(out, mantissa);
+        out = set_exponent(out, exponent);
+        out = set_sign(out, neg);
+        return out;
+    }
+
+    /**
+     * Decimal order of a mantissa exactly as normalize_xfl has always computed it, that is
+     * (int32_t)log10(man), and -1 for zero. That is the exact order except close to a power of
+     * ten, where converting man to double and the rounding of log10 can push the result over the
+     * boundary (10^18 - 4000 has order 18, but not every value above it does). Within a relative
+     * distance of 10^-12 of a power of ten the libm call is made as before, everywhere else
+     * log10 is provably truncated to the exact order so it is computed with integers.
+     */
+    inline int32_t order(uint64_t man)
+    {
+        static constexpr uint64_t pow10[20] =
+        {
+            1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+            100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+            10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+            100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+        };
+        static constexpr uint64_t window = 1000000000000ULL;
+
+        if (man == 0)
+            return -1;
+
+        int32_t const bits = 64 - __builtin_clzll(man);
+        int32_t const t = (bits * 1233) >> 12;
+        int32_t const e = t - (man < pow10[t] ? 1 : 0);
+
+        bool const nearLower = man - pow10[e] <= pow10[e] / window;
+        bool const nearUpper = e < 19 && pow10[e + 1] - man <= pow10[e + 1] / window;
+        if (nearLower || nearUpper)
+            return (int32_t)log10((double)man);
+
+        return e;
+    }
+
+    /**
+     * This function normalizes the mantissa and exponent passed, if it can.
+     * It returns the XFL and mutates the supplied manitssa and exponent.
+     * If a negative mantissa is provided then the returned XFL has the negative flag set.
+     * If there is an overflow error return XFL_OVERFLOW. On underflow returns canonical 0
+     */
+    template <typename T>
+    inline int64_t normalize_xfl(T& man, int32_t& exp, bool neg = false)
+    {
+
+        constexpr bool sman = std::is_same<T, int64_t>::value;
+        static_assert(sman || std::is_same<T, uint64_t>());
+
+        if constexpr(sman)
+        {
+            if (man < 0)
+            {
+                man *= -1LL;
+                neg = true;
+            }
+        }
+
+        // mantissa order
+        int32_t mo = order((uint64_t)man);
+        int32_t adjust = 15 - mo;
+
+        if (adjust > 0)
+        {
+            man *= power_of_ten[adjust];
+            exp -= adjust;
+        }
+        else if (adjust < 0)
+        {
+            man /= power_of_ten[-adjust];
+            exp -= adjust;
+        }
+
+        if (man == 0)
+        {
+            exp = 0;
+            return 0;
+        }
+
+        // even after adjustment the mantissa can be outside the range by one place
+        // improving the math above would probably alleviate the need for these branches
+        if (man < minMantissa)
+        {
+            if (man == minMantissa - 1LL)
+                man += 1LL;
+            else
+            {
+                man *= 10LL;
+                exp--;
+            }
+        }
+
+        if (man > maxMantissa)
+        {
+            if (man == maxMantissa + 1LL)
+                man -= 1LL;
+            else
+            {
+                man /= 10LL;
+                exp++;
+            }
+        }
+
+        if (exp < minExponent)
+        {
+            man = 0;
+            exp = 0;
+            return 0;
+        }
+
+        if (man == 0)
+        {
+            exp = 0;
+            return 0;
+        }
+
+        if (exp > maxExponent)
+            return hook_api::XFL_OVERFLOW;
+
+        int64_t ret = make_float((uint64_t)man, exp, neg);
+        if constexpr(sman)
+        {
+            if (neg)
+                man *= -1LL;
+        }
+
+        return ret;
+
+    }
+
+    static int64_t const float_one_internal = make_float(1000000000000000ull, -15, false);
+
+    // product of two non-zero XFLs given as parts, the 128 bit product is truncated to 17 digits
+    inline int64_t multiply_parts(
+            uint64_t man1,
+            int32_t exp1,
+            bool neg1,
+            uint64_t man2,
+            int32_t exp2,
+            bool neg2)
+    {
+        unsigned __int128 mult = (unsigned __int128)man1 * (unsigned __int128)man2;
+        mult /= (unsigned __int128)power_of_ten[15];
+        uint64_t man_out = static_cast<uint64_t>(mult);
+        int32_t exp_out = exp1 + exp2 + 15;
+        bool neg_out = (neg1 && !neg2) || (!neg1 && neg2);
+        int64_t ret = normalize_xfl(man_out, exp_out, neg_out);
+
+        if (ret == hook_api::EXPONENT_UNDERSIZED)
+            return 0;
+        if (ret == hook_api::EXPONENT_OVERSIZED)
+            return hook_api::XFL_OVERFLOW;
+        return ret;
+    }
+
+    // precondition: both operands are valid (see is_valid)
+    inline int64_t multiply(int64_t float1, int64_t float2)
+    {
+        if (float1 == 0 || float2 == 0)
+            return 0;
+
+        return multiply_parts(
+            get_mantissa(float1), get_exponent(float1), is_negative(float1),
+            get_mantissa(float2), get_exponent(float2), is_negative(float2));
+    }
+
+    /**
+     * Quotient of two XFLs by decimal long division. The divisor is aligned to the dividend by
+     * truncating powers of ten and loses a digit on every step, and a digit only counts the times
+     * the divisor fits with a non-zero remainder. Each digit is computed with one integer division
+     * rather than repeated subtraction, the digits themselves are unchanged.
+     */
+    inline int64_t divide(int64_t float1, int64_t float2)
+    {
+        if (!is_valid(float1) || !is_valid(float2))
+            return hook_api::INVALID_FLOAT;
+        if (float2 == 0)
+            return hook_api::DIVISION_BY_ZERO;
+        if (float1 == 0)
+            return 0;
+
+        // special case: division by 1
+        // RH TODO: add more special cases (division by power of 10)
+        if (float2 == float_one_internal)
+            return float1;
+
+        uint64_t man1 = get_mantissa(float1);
+        int32_t exp1 = get_exponent(float1);
+        bool neg1 = is_negative(float1);
+        uint64_t man2 = get_mantissa(float2);
+        int32_t exp2 = get_exponent(float2);
+        bool neg2 = is_negative(float2);
+
+        int64_t tmp1 = normalize_xfl(man1, exp1);
+        int64_t tmp2 = normalize_xfl(man2, exp2);
+
+        if (tmp1 < 0 || tmp2 < 0)
+            return hook_api::INVALID_FLOAT;
+
+        if (tmp1 == 0)
+            return 0;
+
+        while (man2 > man1)
+        {
+            man2 /= 10;
+            exp2++;
+        }
+
+        if (man2 == 0)
+            return hook_api::DIVISION_BY_ZERO;
+
+        while (man2 < man1)
+        {
+            if (man2*10 > man1)
+                break;
+            man2 *= 10;
+            exp2--;
+        }
+
+        uint64_t man3 = 0;
+        int32_t exp3 = exp1 - exp2;
+
+        while (man2 > 0)
+        {
+            // the number of times man2 can be taken from man1 leaving more than man2, man1 is never 0
+            uint64_t i = (man1 - 1) / man2;
+            man1 -= i * man2;
+
+            man3 *= 10;
+            man3 += i;
+            man2 /= 10;
+            if (man2 == 0)
+                break;
+            exp3--;
+        }
+
+        bool neg3 = !((neg1 && neg2) || (!neg1 && !neg2));
+
+        return normalize_xfl(man3, exp3, neg3);
+    }
+
+    /**
+     * Sum of two valid XFLs with the semantics of IOUAmount::operator+=: the operand with the lower
+     * exponent is truncated to the other's exponent, results within 10 of zero become zero.
+     */
+    inline int64_t sum(int64_t float1, int64_t float2)
+    {
+        if (float1 == 0) return float2;
+        if (float2 == 0) return float1;
+
+        int64_t man1 = (int64_t)(get_mantissa(float1)) * (is_negative(float1) ? -1LL : 1LL);
+        int32_t exp1 = get_exponent(float1);
+        int64_t man2 = (int64_t)(get_mantissa(float2)) * (is_negative(float2) ? -1LL : 1LL);
+        int32_t exp2 = get_exponent(float2);
+
+        // dividing by ten d times truncates exactly like dividing by 10^d, past 18 places every
+        // valid mantissa is gone
+        if (exp1 < exp2)
+        {
+            man1 = exp2 - exp1 > 18 ? 0 : man1 / power_of_ten[exp2 - exp1];
+            exp1 = exp2;
+        }
+        else if (exp2 < exp1)
+            man2 = exp1 - exp2 > 18 ? 0 : man2 / power_of_ten[exp1 - exp2];
+
+        int64_t man = man1 + man2;
+        int32_t exp = exp1;
+
+        // this is an underflow e.g. as a result of subtracting an xfl from itself
+        // and thus not an error, just return canonical 0
+        if (man >= -10 && man <= 10)
+            return 0;
+
+        bool const neg = man < 0;
+        if (neg)
+            man = -man;
+
+        while (man < minMantissa && exp > minExponent)
+        {
+            man *= 10;
+            --exp;
+        }
+
+        while (man > maxMantissa)
+        {
+            if (exp >= maxExponent)
+                return hook_api::XFL_OVERFLOW;
+            man /= 10;
+            ++exp;
+        }
+
+        if (exp < minExponent || man < minMantissa)
+            return 0;
+
+        if (exp > maxExponent)
+            return hook_api::XFL_OVERFLOW;
+
+        return make_float_signed(neg ? -man : man, exp);
+    }
+
+    // -1, 0 or 1 as float1 is less than, equal to or greater than float2, both must be valid
+    inline int compare(int64_t float1, int64_t float2)
+    {
+        // valid XFLs are canonical, equal values have equal bits
+        if (float1 == float2)
+            return 0;
+
+        // zero is treated as positive
+        bool const neg1 = float1 != 0 && is_negative(float1);
+        bool const neg2 = float2 != 0 && is_negative(float2);
+
+        if (neg1 != neg2)
+            return neg1 ? -1 : 1;
+
+        bool less;
+        if (float1 == 0)
+            less = !neg2;
+        else if (float2 == 0)
+            less = neg1;
+        else if (get_exponent(float1) != get_exponent(float2))
+            less = (get_exponent(float1) > get_exponent(float2)) == neg1;
+        else
+            less = (get_mantissa(float1) < get_mantissa(float2)) != neg1;
+
+        return less ? -1 : 1;
+    }
+
+    // the integer part of float1 * 10^decimal_places, float1 must be valid and non-zero
+    inline int64_t to_int(int64_t float1, uint32_t decimal_places, bool absolute)
+    {
+        uint64_t man1 = get_mantissa(float1);
+        int32_t exp1 = get_exponent(float1);
+        bool neg1 = is_negative(float1);
+
+        if (decimal_places > 15)
+            return hook_api::INVALID_ARGUMENT;
+
+        if (neg1)
+        {
+            if (!absolute)
+                return hook_api::CANT_RETURN_NEGATIVE;
+        }
+
+        int32_t shift = -(exp1 + decimal_places);
+
+        if (shift > 15)
+            return 0;
+
+        if (shift < 0)
+            return hook_api::TOO_BIG;
+
+        if (shift > 0)
+            man1 /= power_of_ten[shift];
+
+        return man1;
+    }
+
+    // conversion used by float_log and float_root, whose results are defined by double math
+    inline int64_t double_to_xfl(double x)
+    {
+        if ((x) == 0)
+            return 0;
+        bool neg = x < 0;
+        double absresult = neg ? -x : x;
+
+        // first compute the base 10 order of the float
+        int32_t exp_out = (int32_t) log10(absresult);
+
+        // next adjust it into the valid mantissa range (this means dividing by its order and multiplying by 10**15)
+        absresult *= pow(10, -exp_out + 15);
+
+        // after adjustment the value may still fall below the minMantissa
+        int64_t result = (int64_t)absresult;
+        if (result < minMantissa)
+        {
+            if (result == minMantissa - 1LL)
+                result += 1LL;
+            else
+            {
+                result *= 10LL;
+                exp_out--;
+            }
+        }
+
+        // likewise the value can fall above the maxMantissa
+        if (result > maxMantissa)
+        {
+            if (result == maxMantissa + 1LL)
+                result -= 1LL;
+            else
+            {
+                result /= 10LL;
+                exp_out++;
+            }
+        }
+
+        exp_out -= 15;
+        int64_t ret = make_float(result, exp_out, neg);
+
+        if (ret == hook_api::EXPONENT_UNDERSIZED)
+            return 0;
+
+        return ret;
+    }
+}
+
+#endif
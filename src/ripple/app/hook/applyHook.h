@@ -2,6 +2,7 @@
 #define APPLY_HOOK_INCLUDED 1
 #include <ripple/basics/Blob.h>
 #include <ripple/protocol/TER.h>
+#include <ripple/protocol/Feature.h>
 #include <ripple/app/tx/impl/ApplyContext.h>
 #include <ripple/beast/utility/Journal.h>
 #include <ripple/app/misc/Transaction.h>
@@ -15,6 +16,13 @@
 #include <wasmedge/wasmedge.h>
 #include <ripple/app/hook/Macro.h>
 #include <ripple/app/hook/Enum.h>
+#include <ripple/app/hook/HookArena.h>
+#include <ripple/app/hook/HookStateMap.h>
+#include <ripple/app/hook/HookStats.h>
+#include <ripple/app/hook/MemorySnapshot.h>
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/app/hook/STOIndex.h>
+#include <ripple/core/JobQueue.h>
 
 namespace hook
 {
@@ -22,24 +30,6 @@ namespace hook
     struct HookResult;
     bool isEmittedTxn(ripple::STTx const& tx);
 
-    // This map type acts as both a read and write cache for hook execution
-    // and is preserved across the execution of the set of hook chains
-    // being executed in the current transaction. It is committed to lgr
-    // only upon tesSuccess for the otxn.
-    class HookStateMap :
-            public std::map<
-                ripple::AccountID,                  // account that owns the state
-                std::pair<
-                    int64_t,                        // remaining available ownercount
-                    std::map<ripple::uint256,       // namespace
-                    std::map<ripple::uint256,       // key
-                    std::pair<
-                        bool,                       // is modified from ledger value
-                        ripple::Blob>>>>>           // the value
-    {
-        public:
-            uint32_t modified_entry_count = 0;      // track the number of total modified 
-    };            
 
 
     
@@ -192,6 +182,8 @@ namespace hook_api
                                                         uint32_t kread_ptr, uint32_t kread_len,
                                                         uint32_t nread_ptr, uint32_t nread_len,
                                                         uint32_t aread_ptr, uint32_t aread_len );
+    DECLARE_HOOK_FUNCTION(int64_t,	state_prefetch,     uint32_t nread_ptr, uint32_t nread_len,
+                                                        uint32_t aread_ptr, uint32_t aread_len );
     DECLARE_HOOK_FUNCTION(int64_t,	trace,              uint32_t mread_ptr, uint32_t mread_len,
                                                         uint32_t dread_ptr, uint32_t dread_len, uint32_t as_hex );
     DECLARE_HOOK_FUNCTION(int64_t,	trace_num,          uint32_t read_ptr, uint32_t read_len, int64_t number );
@@ -236,7 +228,7 @@ namespace hook
     HookResult
     apply(
         ripple::uint256 const& hookSetTxnID, /* this is the txid of the sethook, used for caching (one day) */
-        ripple::uint256 const& hookHash,     /* hash of the actual hook byte code, used for metadata */
+        ripple::uint256 const& hookHash,     /* hash of the actual hook byte code, used for metadata and module caching */
         ripple::uint256 const& hookNamespace,
         ripple::Blob const& wasm,
         std::map<
@@ -257,6 +249,7 @@ namespace hook
         bool isStrongTSH,
         uint32_t wasmParam,
         uint8_t hookChainPosition,
+        std::optional<uint64_t> fuel,         /* sfHookFuel (or sfHookCallbackFuel) of the hook definition */
         // result of apply() if this is weak exec
         std::shared_ptr<STObject const> const& provisionalMeta
     );
@@ -264,6 +257,7 @@ namespace hook
     struct HookContext;
 
     uint32_t maxHookStateDataSize(void);
+    uint32_t maxHookStatePrefetchCount(void);
     uint32_t maxHookWasmSize(void);
     uint32_t maxHookParameterKeySize(void);
     uint32_t maxHookParameterValueSize(void);
@@ -276,6 +270,22 @@ namespace hook
     int64_t computeExecutionFee(uint64_t instructionCount);
     int64_t computeCreationFee(uint64_t byteCount);
 
+    /**
+     * The fuel each wasm instruction burns under the given rules, indexed by WasmEdge opcode (the
+     * byte of a single byte instruction, the prefix in the high byte of a prefixed one), or nullptr
+     * when the rules do not meter hooks. With featureHookFuel it is hook_api::instruction_fuel, the
+     * schedule the guard checker priced the definition's sfHookFuel and sfFee with.
+     */
+    std::vector<uint64_t> const*
+    executionCostTable(ripple::Rules const& rules);
+
+    // a transaction emitted by a hook, kept as parsed by emit until finalizeHookResult commits it
+    struct EmittedTxn
+    {
+        ripple::uint256 id;
+        std::shared_ptr<ripple::STTx const> stx;
+    };
+
     struct HookResult
     {
         ripple::uint256     const      hookSetTxnID;
@@ -287,7 +297,7 @@ namespace hook
         ripple::AccountID   const      otxnAccount;
         ripple::uint256     const      hookNamespace;
 
-        std::queue<std::shared_ptr<ripple::Transaction>> emittedTxn {}; // etx stored here until accept/rollback
+        std::vector<EmittedTxn> emittedTxn {}; // etx stored here until accept/rollback
         HookStateMap& stateMap;
         uint16_t changedStateCount = 0;
         std::map<
@@ -306,6 +316,9 @@ namespace hook
         std::string exitReason {""};
         int64_t exitCode {-1};
         uint64_t instructionCount {0};
+        uint64_t fuelBurnt {0};         // fuel the hook itself burnt, if the execution was metered
+        uint32_t hostCallCount {0};     // hook api functions called by this execution
+        std::array<uint32_t, maxHostFunctions> hostCalls {};   // calls per hook api function slot
         bool hasCallback = false;   // true iff this hook wasm has a cbak function
         bool isCallback = false;    // true iff this hook execution is a callback in action
         bool isStrong = false;
@@ -324,30 +337,39 @@ namespace hook
     {
         std::shared_ptr<const ripple::STObject> storage;
         const ripple::STBase* entry; // raw pointer into the storage, that can be freely pointed around inside
+        std::optional<ripple::Blob> serialized; // entry serialized, filled by slot or slot_size on first use
     };
 
     struct HookContext
     {
         ripple::ApplyContext& applyCtx;
+        beast::Journal const j;     // looked up once per execution rather than on every host call
         // slots are used up by requesting objects from inside the hook
         // the map stores pairs consisting of a memory view and whatever shared or unique ptr is required to
         // keep the underlying object alive for the duration of the hook's execution
         // slot number -> { keylet or hash, { pointer to current object, storage for that object } }
-        std::map<uint32_t, SlotEntry> slot {};
-        std::queue<uint32_t> slot_free {};
+        // the containers below are allocated from the HookArena of the hook phase
+        ArenaMap<uint32_t, SlotEntry> slot { HookArena::resource() };
+        ArenaQueue<uint32_t> slot_free { ArenaAllocator<uint32_t> { HookArena::resource() } };
         uint32_t slot_counter { 0 }; // uint16 to avoid accidental overflow and to allow more slots in future
+        STOIndex stoIndex {};   // field scans of serialized objects in hook memory, used by the sto_ functions
         uint16_t emit_nonce_counter { 0 }; // incremented whenever nonce is called to ensure unique nonces
         uint16_t ledger_nonce_counter { 0 };
         int64_t expected_etxn_count { -1 }; // make this a 64bit int so the uint32 from the hookapi cant overflow it
-        std::map<ripple::uint256, bool> nonce_used {};
+        ArenaMap<ripple::uint256, bool> nonce_used { HookArena::resource() };
         uint32_t generation = 0; // used for caching, only generated when txn_generation is called
         uint64_t burden = 0;      // used for caching, only generated when txn_burden is called
-        std::map<uint32_t, uint32_t> guard_map {}; // iteration guard map <id -> upto_iteration>
+        ArenaMap<uint32_t, uint32_t> guard_map { HookArena::resource() }; // iteration guard map <id -> upto_iteration>
         HookResult result;
         std::optional<ripple::STObject> emitFailure;    // if this is a callback from a failed
                                                         // emitted txn then this optional becomes
                                                         // populated with the SLE
         const HookExecutor* module = 0;
+        // linear memory of the executing instance, resolved by the first host call (HOOK_SETUP).
+        // Guard validation rejects memory.grow so base and length can't change afterwards.
+        WasmEdge_MemoryInstanceContext* memoryCtx = nullptr;
+        unsigned char* memory = nullptr;
+        uint64_t memoryLength = 0;
     };
 
     bool
@@ -421,9 +443,195 @@ namespace hook
     // see: lib/system/allocator.cpp
     #define WasmEdge_kPageSize 65536ULL
 
+    /**
+     * HookImports is the "env" import module every hook links against: the hook api host functions
+     * plus a host table and memory, already registered into a store together with the configuration
+     * hooks run under. Building it means creating ~90 function instances, and it is the same for every
+     * execution, so each thread keeps one and reuses it.
+     * The host data of every function points at `bound`, which holds the HookContext currently
+     * executing on the thread. HookExecutor sets it on construction and clears it on destruction.
+     * The host table and memory are never linked by a hook (guard validation only allows function
+     * imports), so no per-execution state survives in here between executions.
+     * Host functions added by an amendment are only registered in the imports built for rules which
+     * enable it, matching the whitelist SetHook checks the hook's imports against.
+     */
+    struct HookImports
+    {
+        HookContext* bound = nullptr;
+        WasmEdge_ModuleInstanceContext* importObj;
+        WasmEdge_ConfigureContext* confCtx;
+        WasmEdge_StoreContext* storeCtx;
+        bool registered = false;
+
+        explicit HookImports(bool statePrefetch)
+            : importObj(WasmEdge_ModuleInstanceCreate(exportName))
+            , confCtx(WasmEdge_ConfigureCreate())
+            , storeCtx(WasmEdge_StoreCreate())
+        {
+            WasmEdge_ConfigureStatisticsSetInstructionCounting(confCtx, true);
+
+            // fuel is burnt through the cost limit, without a limit set no execution is affected
+            WasmEdge_ConfigureStatisticsSetCostMeasuring(confCtx, true);
+
+            WasmEdge_LogSetDebugLevel();
+
+            ADD_HOOK_FUNCTION(_g, bound);
+            ADD_HOOK_FUNCTION(accept, bound);
+            ADD_HOOK_FUNCTION(rollback, bound);
+            ADD_HOOK_FUNCTION(util_raddr, bound);
+            ADD_HOOK_FUNCTION(util_accid, bound);
+            ADD_HOOK_FUNCTION(util_verify, bound);
+            ADD_HOOK_FUNCTION(util_sha512h, bound);
+            ADD_HOOK_FUNCTION(sto_validate, bound);
+            ADD_HOOK_FUNCTION(sto_subfield, bound);
+            ADD_HOOK_FUNCTION(sto_subarray, bound);
+            ADD_HOOK_FUNCTION(sto_emplace, bound);
+            ADD_HOOK_FUNCTION(sto_erase, bound);
+            ADD_HOOK_FUNCTION(util_keylet, bound);
+
+            ADD_HOOK_FUNCTION(emit, bound);
+            ADD_HOOK_FUNCTION(etxn_burden, bound);
+            ADD_HOOK_FUNCTION(etxn_fee_base, bound);
+            ADD_HOOK_FUNCTION(etxn_details, bound);
+            ADD_HOOK_FUNCTION(etxn_reserve, bound);
+            ADD_HOOK_FUNCTION(etxn_generation, bound);
+            ADD_HOOK_FUNCTION(etxn_nonce, bound);
+
+            ADD_HOOK_FUNCTION(float_set, bound);
+            ADD_HOOK_FUNCTION(float_multiply, bound);
+            ADD_HOOK_FUNCTION(float_mulratio, bound);
+            ADD_HOOK_FUNCTION(float_negate, bound);
+            ADD_HOOK_FUNCTION(float_compare, bound);
+            ADD_HOOK_FUNCTION(float_sum, bound);
+            ADD_HOOK_FUNCTION(float_sto, bound);
+            ADD_HOOK_FUNCTION(float_sto_set, bound);
+            ADD_HOOK_FUNCTION(float_invert, bound);
+
+            ADD_HOOK_FUNCTION(float_divide, bound);
+            ADD_HOOK_FUNCTION(float_one, bound);
+            ADD_HOOK_FUNCTION(float_mantissa, bound);
+            ADD_HOOK_FUNCTION(float_sign, bound);
+            ADD_HOOK_FUNCTION(float_int, bound);
+            ADD_HOOK_FUNCTION(float_log, bound);
+            ADD_HOOK_FUNCTION(float_root, bound);
+
+            ADD_HOOK_FUNCTION(otxn_burden, bound);
+            ADD_HOOK_FUNCTION(otxn_generation, bound);
+            ADD_HOOK_FUNCTION(otxn_field, bound);
+            ADD_HOOK_FUNCTION(otxn_id, bound);
+            ADD_HOOK_FUNCTION(otxn_type, bound);
+            ADD_HOOK_FUNCTION(otxn_slot, bound);
+            ADD_HOOK_FUNCTION(otxn_param, bound);
+
+            ADD_HOOK_FUNCTION(hook_account, bound);
+            ADD_HOOK_FUNCTION(hook_hash, bound);
+            ADD_HOOK_FUNCTION(hook_again, bound);
+            ADD_HOOK_FUNCTION(fee_base, bound);
+            ADD_HOOK_FUNCTION(ledger_seq, bound);
+            ADD_HOOK_FUNCTION(ledger_last_hash, bound);
+            ADD_HOOK_FUNCTION(ledger_last_time, bound);
+            ADD_HOOK_FUNCTION(ledger_nonce, bound);
+            ADD_HOOK_FUNCTION(ledger_keylet, bound);
+
+            ADD_HOOK_FUNCTION(hook_param, bound);
+            ADD_HOOK_FUNCTION(hook_param_set, bound);
+            ADD_HOOK_FUNCTION(hook_skip, bound);
+            ADD_HOOK_FUNCTION(hook_pos, bound);
+
+            ADD_HOOK_FUNCTION(state, bound);
+            ADD_HOOK_FUNCTION(state_foreign, bound);
+            ADD_HOOK_FUNCTION(state_set, bound);
+            ADD_HOOK_FUNCTION(state_foreign_set, bound);
+            if (statePrefetch)
+                ADD_HOOK_FUNCTION(state_prefetch, bound);
+
+            ADD_HOOK_FUNCTION(slot, bound);
+            ADD_HOOK_FUNCTION(slot_clear, bound);
+            ADD_HOOK_FUNCTION(slot_count, bound);
+            ADD_HOOK_FUNCTION(slot_set, bound);
+            ADD_HOOK_FUNCTION(slot_size, bound);
+            ADD_HOOK_FUNCTION(slot_subarray, bound);
+            ADD_HOOK_FUNCTION(slot_subfield, bound);
+            ADD_HOOK_FUNCTION(slot_type, bound);
+            ADD_HOOK_FUNCTION(slot_float, bound);
+
+            ADD_HOOK_FUNCTION(trace, bound);
+            ADD_HOOK_FUNCTION(trace_num, bound);
+            ADD_HOOK_FUNCTION(trace_float, bound);
+
+            ADD_HOOK_FUNCTION(meta_slot, bound);
+
+            /*
+            ADD_HOOK_FUNCTION(str_find, bound);
+            ADD_HOOK_FUNCTION(str_replace, bound);
+            ADD_HOOK_FUNCTION(str_compare, bound);
+            ADD_HOOK_FUNCTION(str_concat, bound);
+            */
+
+            WasmEdge_TableInstanceContext* hostTable = WasmEdge_TableInstanceCreate(tableType);
+            WasmEdge_ModuleInstanceAddTable(importObj, tableName, hostTable);
+            WasmEdge_MemoryInstanceContext* hostMem  = WasmEdge_MemoryInstanceCreate(memType);
+            WasmEdge_ModuleInstanceAddMemory(importObj, memName, hostMem);
+
+            // registration only needs an executor for the duration of the call
+            WasmEdge_ExecutorContext* execCtx = WasmEdge_ExecutorCreate(confCtx, NULL);
+            registered = WasmEdge_ResultOK(WasmEdge_ExecutorRegisterImport(execCtx, storeCtx, importObj));
+            WasmEdge_ExecutorDelete(execCtx);
+        }
+
+        ~HookImports()
+        {
+            WasmEdge_StoreDelete(storeCtx);
+            WasmEdge_ModuleInstanceDelete(importObj);
+            WasmEdge_ConfigureDelete(confCtx);
+        }
+
+        HookImports(HookImports const&) = delete;
+        HookImports& operator=(HookImports const&) = delete;
+
+        /**
+         * Bind the calling thread's HookImports to ctx. If they are already bound (an execution is
+         * already in progress further up this thread's stack) a private set is built into `owned`.
+         */
+        static HookImports*
+        acquire(HookContext& ctx, std::unique_ptr<HookImports>& owned)
+        {
+            bool const statePrefetch =
+                ctx.applyCtx.view().rules().enabled(featureHookStatePrefetch);
+
+            HookImports& pooled = threadImports(statePrefetch);
+
+            HookImports* imports = &pooled;
+            if (pooled.bound)
+            {
+                owned = std::make_unique<HookImports>(statePrefetch);
+                imports = owned.get();
+            }
+
+            imports->bound = &ctx;
+            return imports;
+        }
+
+    private:
+        // the calling thread's imports for rules with or without featureHookStatePrefetch, each set
+        // is built the first time the thread executes a hook under such rules
+        static HookImports&
+        threadImports(bool statePrefetch)
+        {
+            if (statePrefetch)
+            {
+                thread_local HookImports imports { true };
+                return imports;
+            }
+
+            thread_local HookImports imports { false };
+            return imports;
+        }
+    };
+
     /**
      * HookExecutor is effectively a two-part function:
-     * The first part sets up the Hook Api inside the wasm import, ready for use
+     * The first part binds the thread's Hook Api import (HookImports) to the hook context, ready for use
      * (this is done during object construction.)
      * The second part is actually executing webassembly instructions
      * this is done during execteWasm function.
@@ -436,9 +644,12 @@ namespace hook
             bool spent = false; // a HookExecutor can only be used once
 
 
+            // set only when the calling thread's HookImports were already in use
+            std::unique_ptr<HookImports> owned;
+
         public:
             HookContext& hookCtx;
-            WasmEdge_ModuleInstanceContext* importObj;
+            HookImports* imports;
 
         /**
          * Validate that a web assembly blob can be loaded by wasmedge
@@ -466,8 +677,17 @@ namespace hook
          * Execute web assembly byte code against the constructed Hook Context
          * Once execution has occured the exector is spent and cannot be used again and should be destructed
          * Information about the execution is populated into hookCtx
+         * The loaded and validated module is taken from (or placed into) the process-wide ModuleCache
+         * keyed by hookHash, so the byte code is only parsed on the first execution. If the native tier
+         * is enabled the compiled module is used once available, falling back to the interpreter.
+         * Interpreted hooks start from their MemorySnapshot when memory snapshots are enabled.
+         * If fuel is set the execution is metered with the rules' executionCostTable and aborted
+         * (WASM_ERROR) as soon as it has burnt that much.
          */
-        void executeWasm(const void* wasm, size_t len, bool callback, uint32_t wasmParam, beast::Journal const& j)
+        void executeWasm(
+            ripple::uint256 const& hookHash,
+            const void* wasm, size_t len, bool callback, uint32_t wasmParam,
+            std::optional<uint64_t> fuel, beast::Journal const& j)
         {
 
             // HookExecutor can only execute once
@@ -478,45 +698,126 @@ namespace hook
             JLOG(j.trace())
                 << "HookInfo[" << HC_ACC() << "]: creating wasm instance";
 
-            WasmEdge_ConfigureContext* confCtx  = WasmEdge_ConfigureCreate();
-            WasmEdge_ConfigureStatisticsSetInstructionCounting(confCtx, true);
-            WasmEdge_VMContext* vmCtx = WasmEdge_VMCreate(confCtx, NULL);
+            ModuleCache& cache = ModuleCache::instance();
+            ModuleCache::Modules modules = cache.fetch(hookHash, wasm, len, j);
 
-            WasmEdge_Result res = WasmEdge_VMRegisterModuleFromImport(vmCtx, this->importObj);
-            if (!WasmEdge_ResultOK(res))
+            if (!modules.interpreted)
+            {
+                hookCtx.result.exitType = hook_api::ExitType::WASM_ERROR;
+                JLOG(j.warn())
+                    << "HookError[" << HC_ACC() << "]: Load/validate phase failed";
+                return;
+            }
+
+            // the import object, store and configuration come from the thread's HookImports, only the
+            // statistics (instruction count) and the executor bound to them are per execution
+            WasmEdge_StoreContext* storeCtx = imports->storeCtx;
+            WasmEdge_StatisticsContext* statsCtx = WasmEdge_StatisticsCreate();
+            WasmEdge_ExecutorContext* execCtx = WasmEdge_ExecutorCreate(imports->confCtx, statsCtx);
+            WasmEdge_ModuleInstanceContext* moduleCtx = NULL;
+
+            // instructions counted instantiating the hook which a start from a snapshot did not count
+            uint64_t instantiationCount = 0;
+
+            // a failed instantiation must not leave anything in the count, which goes into the
+            // metadata, whichever tier the node tried first
+            auto const restartCounting = [&]()
+            {
+                WasmEdge_ExecutorDelete(execCtx);
+                WasmEdge_StatisticsDelete(statsCtx);
+                statsCtx = WasmEdge_StatisticsCreate();
+                execCtx = WasmEdge_ExecutorCreate(imports->confCtx, statsCtx);
+            };
+
+            WasmEdge_Result res = WasmEdge_Result_Success;
+            if (!imports->registered)
             {
                 hookCtx.result.exitType = hook_api::ExitType::WASM_ERROR;
                 JLOG(j.trace())
-                    << "HookError[" << HC_ACC() << "]: Import phase failed "
-                    << WasmEdge_ResultGetMessage(res);
+                    << "HookError[" << HC_ACC() << "]: Import phase failed";
             }
             else
+            {
+                if (modules.native)
+                {
+                    res = WasmEdge_ExecutorInstantiate(execCtx, &moduleCtx, storeCtx, modules.native.get());
+                    if (!WasmEdge_ResultOK(res))
+                    {
+                        JLOG(j.warn())
+                            << "HookError[" << HC_ACC() << "]: Native instantiation failed, falling back "
+                            << "to interpreter " << WasmEdge_ResultGetMessage(res);
+                        moduleCtx = NULL;
+                        restartCounting();
+                    }
+                }
+                else if (auto snapshot = MemorySnapshotCache::instance().fetch(
+                            hookHash, modules.interpreted, wasm, len, imports->confCtx, storeCtx, j))
+                {
+                    // the data segments are not copied again, their image is mapped in from the snapshot
+                    res = WasmEdge_ExecutorInstantiate(execCtx, &moduleCtx, storeCtx, snapshot->module().get());
+                    if (WasmEdge_ResultOK(res) && snapshot->apply(moduleCtx))
+                        instantiationCount = snapshot->instructions();
+                    else
+                    {
+                        JLOG(j.warn())
+                            << "HookError[" << HC_ACC() << "]: Snapshot instantiation failed, "
+                            << "instantiating the hook";
+
+                        if (WasmEdge_ResultOK(res))
+                            WasmEdge_ModuleInstanceDelete(moduleCtx);
+                        moduleCtx = NULL;
+                        restartCounting();
+                    }
+                }
+
+                if (!moduleCtx)
+                {
+                    res = WasmEdge_ExecutorInstantiate(
+                            execCtx, &moduleCtx, storeCtx, modules.interpreted.get());
+                    if (WasmEdge_ResultOK(res) && modules.native)
+                        cache.demoteNative(hookHash);
+                }
+
+                if (!WasmEdge_ResultOK(res))
+                {
+                    hookCtx.result.exitType = hook_api::ExitType::WASM_ERROR;
+                    JLOG(j.warn())
+                        << "HookError[" << HC_ACC() << "]: Instantiation phase failed "
+                        << WasmEdge_ResultGetMessage(res);
+                    moduleCtx = NULL;
+                }
+            }
+
+            if (moduleCtx)
             {
 
                 WasmEdge_Value params[1] = { WasmEdge_ValueGenI32((int64_t)wasmParam) };
                 WasmEdge_Value returns[1];
 
-                /*
-                printf("executing hook wasm:\n");
-                for (int j = 0; j < len; j++)
+                WasmEdge_FunctionInstanceContext* funcCtx =
+                    WasmEdge_ModuleInstanceFindFunction(moduleCtx, callback ? cbakFunctionName : hookFunctionName);
+
+                // the fuel pays for running the hook, whatever its instantiation cost is not counted
+                uint64_t fuelStart = 0;
+                if (fuel)
                 {
-                    if (j % 16 == 0)
-                        printf("0x%08X:\t", j);
+                    if (auto const* table = executionCostTable(hookCtx.applyCtx.view().rules()))
+                        WasmEdge_StatisticsSetCostTable(
+                            statsCtx, const_cast<uint64_t*>(table->data()), table->size());
 
-                    printf("%02X%s", (reinterpret_cast<const uint8_t*>(wasm))[j],
-                        (j % 16 == 15 ? "\n" :
-                        (j % 4 == 3 ? "  " :
-                        (j % 2 == 1 ? " " : ""))));
+                    fuelStart = WasmEdge_StatisticsGetTotalCost(statsCtx);
+                    WasmEdge_StatisticsSetCostLimit(statsCtx, fuelStart + *fuel);
                 }
-                printf("\n----\n");
-                */
-
-                res =
-                    WasmEdge_VMRunWasmFromBuffer(vmCtx, reinterpret_cast<const uint8_t*>(wasm), len,
-                        callback ? cbakFunctionName : hookFunctionName,
-                        params, 1, returns, 1);
 
-                if (!WasmEdge_ResultOK(res))
+                if (!funcCtx)
+                {
+                    JLOG(j.warn())
+                        << "HookError[" << HC_ACC() << "]: WASM VM error "
+                        << (callback ? "cbak" : "hook") << " function not exported";
+                    hookCtx.result.exitType = hook_api::ExitType::WASM_ERROR;
+                }
+                else if (res = WasmEdge_ExecutorInvoke(execCtx, funcCtx, params, 1, returns, 1);
+                    !WasmEdge_ResultOK(res))
                 {
                     JLOG(j.warn())
                         << "HookError[" << HC_ACC() << "]: WASM VM error "
@@ -525,124 +826,32 @@ namespace hook
                 }
                 else
                 {
-
-                    auto* statsCtx= WasmEdge_VMGetStatisticsContext(vmCtx);
-                    hookCtx.result.instructionCount = WasmEdge_StatisticsGetInstrCount(statsCtx);
+                    // both tiers count every executed wasm instruction, so this is tier independent
+                    hookCtx.result.instructionCount =
+                        WasmEdge_StatisticsGetInstrCount(statsCtx) + instantiationCount;
                 }
+
+                if (fuel)
+                    hookCtx.result.fuelBurnt = WasmEdge_StatisticsGetTotalCost(statsCtx) - fuelStart;
             }
 
-            WasmEdge_ConfigureDelete(confCtx);
-            WasmEdge_VMDelete(vmCtx);
+            // deleting the instance also unlinks it from the pooled store
+            if (moduleCtx)
+                WasmEdge_ModuleInstanceDelete(moduleCtx);
+            WasmEdge_ExecutorDelete(execCtx);
+            WasmEdge_StatisticsDelete(statsCtx);
         }
 
         HookExecutor(HookContext& ctx)
             : hookCtx(ctx)
-            , importObj(WasmEdge_ModuleInstanceCreate(exportName))
+            , imports(HookImports::acquire(ctx, owned))
         {
             ctx.module = this;
-
-            WasmEdge_LogSetDebugLevel();
-
-            ADD_HOOK_FUNCTION(_g, ctx);
-            ADD_HOOK_FUNCTION(accept, ctx);
-            ADD_HOOK_FUNCTION(rollback, ctx);
-            ADD_HOOK_FUNCTION(util_raddr, ctx);
-            ADD_HOOK_FUNCTION(util_accid, ctx);
-            ADD_HOOK_FUNCTION(util_verify, ctx);
-            ADD_HOOK_FUNCTION(util_sha512h, ctx);
-            ADD_HOOK_FUNCTION(sto_validate, ctx);
-            ADD_HOOK_FUNCTION(sto_subfield, ctx);
-            ADD_HOOK_FUNCTION(sto_subarray, ctx);
-            ADD_HOOK_FUNCTION(sto_emplace, ctx);
-            ADD_HOOK_FUNCTION(sto_erase, ctx);
-            ADD_HOOK_FUNCTION(util_keylet, ctx);
-
-            ADD_HOOK_FUNCTION(emit, ctx);
-            ADD_HOOK_FUNCTION(etxn_burden, ctx);
-            ADD_HOOK_FUNCTION(etxn_fee_base, ctx);
-            ADD_HOOK_FUNCTION(etxn_details, ctx);
-            ADD_HOOK_FUNCTION(etxn_reserve, ctx);
-            ADD_HOOK_FUNCTION(etxn_generation, ctx);
-            ADD_HOOK_FUNCTION(etxn_nonce, ctx);
-
-            ADD_HOOK_FUNCTION(float_set, ctx);
-            ADD_HOOK_FUNCTION(float_multiply, ctx);
-            ADD_HOOK_FUNCTION(float_mulratio, ctx);
-            ADD_HOOK_FUNCTION(float_negate, ctx);
-            ADD_HOOK_FUNCTION(float_compare, ctx);
-            ADD_HOOK_FUNCTION(float_sum, ctx);
-            ADD_HOOK_FUNCTION(float_sto, ctx);
-            ADD_HOOK_FUNCTION(float_sto_set, ctx);
-            ADD_HOOK_FUNCTION(float_invert, ctx);
-
-            ADD_HOOK_FUNCTION(float_divide, ctx);
-            ADD_HOOK_FUNCTION(float_one, ctx);
-            ADD_HOOK_FUNCTION(float_mantissa, ctx);
-            ADD_HOOK_FUNCTION(float_sign, ctx);
-            ADD_HOOK_FUNCTION(float_int, ctx);
-            ADD_HOOK_FUNCTION(float_log, ctx);
-            ADD_HOOK_FUNCTION(float_root, ctx);
-
-            ADD_HOOK_FUNCTION(otxn_burden, ctx);
-            ADD_HOOK_FUNCTION(otxn_generation, ctx);
-            ADD_HOOK_FUNCTION(otxn_field, ctx);
-            ADD_HOOK_FUNCTION(otxn_id, ctx);
-            ADD_HOOK_FUNCTION(otxn_type, ctx);
-            ADD_HOOK_FUNCTION(otxn_slot, ctx);
-            ADD_HOOK_FUNCTION(otxn_param, ctx);
-
-            ADD_HOOK_FUNCTION(hook_account, ctx);
-            ADD_HOOK_FUNCTION(hook_hash, ctx);
-            ADD_HOOK_FUNCTION(hook_again, ctx);
-            ADD_HOOK_FUNCTION(fee_base, ctx);
-            ADD_HOOK_FUNCTION(ledger_seq, ctx);
-            ADD_HOOK_FUNCTION(ledger_last_hash, ctx);
-            ADD_HOOK_FUNCTION(ledger_last_time, ctx);
-            ADD_HOOK_FUNCTION(ledger_nonce, ctx);
-            ADD_HOOK_FUNCTION(ledger_keylet, ctx);
-
-            ADD_HOOK_FUNCTION(hook_param, ctx);
-            ADD_HOOK_FUNCTION(hook_param_set, ctx);
-            ADD_HOOK_FUNCTION(hook_skip, ctx);
-            ADD_HOOK_FUNCTION(hook_pos, ctx);
-
-            ADD_HOOK_FUNCTION(state, ctx);
-            ADD_HOOK_FUNCTION(state_foreign, ctx);
-            ADD_HOOK_FUNCTION(state_set, ctx);
-            ADD_HOOK_FUNCTION(state_foreign_set, ctx);
-
-            ADD_HOOK_FUNCTION(slot, ctx);
-            ADD_HOOK_FUNCTION(slot_clear, ctx);
-            ADD_HOOK_FUNCTION(slot_count, ctx);
-            ADD_HOOK_FUNCTION(slot_set, ctx);
-            ADD_HOOK_FUNCTION(slot_size, ctx);
-            ADD_HOOK_FUNCTION(slot_subarray, ctx);
-            ADD_HOOK_FUNCTION(slot_subfield, ctx);
-            ADD_HOOK_FUNCTION(slot_type, ctx);
-            ADD_HOOK_FUNCTION(slot_float, ctx);
-
-            ADD_HOOK_FUNCTION(trace, ctx);
-            ADD_HOOK_FUNCTION(trace_num, ctx);
-            ADD_HOOK_FUNCTION(trace_float, ctx);
-
-            ADD_HOOK_FUNCTION(meta_slot, ctx);
-
-            /*
-            ADD_HOOK_FUNCTION(str_find, ctx);
-            ADD_HOOK_FUNCTION(str_replace, ctx);
-            ADD_HOOK_FUNCTION(str_compare, ctx);
-            ADD_HOOK_FUNCTION(str_concat, ctx);
-            */
-
-            WasmEdge_TableInstanceContext* hostTable = WasmEdge_TableInstanceCreate(tableType);
-            WasmEdge_ModuleInstanceAddTable(importObj, tableName, hostTable);
-            WasmEdge_MemoryInstanceContext* hostMem  = WasmEdge_MemoryInstanceCreate(memType);
-            WasmEdge_ModuleInstanceAddMemory(importObj, memName, hostMem);
         }
 
         ~HookExecutor()
         {
-            WasmEdge_ModuleInstanceDelete(importObj);
+            imports->bound = nullptr;
         };
     };
 
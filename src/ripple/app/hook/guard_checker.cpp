@@ -68,15 +68,12 @@ int main(int argc, char** argv)
         upto += bytes_read;
     }
 
-    std::vector<uint8_t> hook(upto);
-    memcpy(hook.data(), hook_data, upto);
-
     printf("Read %ld bytes from `%s` successfully...\n", upto, fin);
 
     close(fd);
 
     auto result = 
-        validateGuards(hook, std::cout, "");
+        validateGuards(ripple::Slice(hook_data, upto), std::cout, "");
 
     if (!result)
     {
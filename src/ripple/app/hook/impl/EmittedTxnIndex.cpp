@@ -0,0 +1,203 @@
+#include <ripple/app/hook/EmittedTxnIndex.h>
+#include <ripple/basics/Log.h>
+#include <ripple/basics/safe_cast.h>
+#include <ripple/ledger/View.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/Serializer.h>
+
+namespace hook
+{
+
+namespace
+{
+
+bool
+usable(ripple::STTx const& tx)
+{
+    return
+        tx.isFieldPresent(ripple::sfEmitDetails) &&
+        tx.isFieldPresent(ripple::sfFirstLedgerSequence) &&
+        tx.isFieldPresent(ripple::sfLastLedgerSequence);
+}
+
+}
+
+EmittedTxnIndex::Entry&
+EmittedTxnIndex::add(ripple::uint256 const& key, std::shared_ptr<ripple::STTx const> tx)
+{
+    Entry& entry = entries_[key];
+    entry.tx = std::move(tx);
+    if (entry.tx)
+    {
+        entry.firstSeq = entry.tx->getFieldU32(ripple::sfFirstLedgerSequence);
+        entry.lastSeq = entry.tx->getFieldU32(ripple::sfLastLedgerSequence);
+        byFirst_.emplace(entry.firstSeq, key);
+        byLast_.emplace(entry.lastSeq, key);
+    }
+    return entry;
+}
+
+void
+EmittedTxnIndex::remove(ripple::uint256 const& key)
+{
+    auto const it = entries_.find(key);
+    if (it == entries_.end())
+        return;
+
+    if (it->second.tx)
+    {
+        byFirst_.erase({it->second.firstSeq, key});
+        byLast_.erase({it->second.lastSeq, key});
+    }
+    entries_.erase(it);
+}
+
+void
+EmittedTxnIndex::emitted(std::shared_ptr<ripple::STTx const> const& tx)
+{
+    if (!tx || !usable(*tx))
+        return;
+
+    auto const key = ripple::keylet::emittedTxn(tx->getTransactionID()).key;
+
+    std::lock_guard lock(mutex_);
+    if (entries_.find(key) == entries_.end())
+        add(key, tx);
+}
+
+void
+EmittedTxnIndex::removed(ripple::uint256 const& txnID)
+{
+    auto const key = ripple::keylet::emittedTxn(txnID).key;
+
+    std::lock_guard lock(mutex_);
+    remove(key);
+}
+
+EmittedTxnIndex::Due
+EmittedTxnIndex::update(ripple::ReadView const& view, beast::Journal const& j)
+{
+    using namespace ripple;
+
+    std::lock_guard lock(mutex_);
+
+    Due due;
+    uint64_t const generation = ++generation_;
+    uint32_t const seq = view.info().seq;
+    bool complete = true;
+
+    Keylet const emittedDirKeylet { keylet::emittedDir() };
+    std::shared_ptr<SLE const> sleDirNode {};
+    unsigned int uDirEntry {0};
+    uint256 dirEntry {beast::zero};
+
+    if (!dirIsEmpty(view, emittedDirKeylet) &&
+        cdirFirst(view, emittedDirKeylet.key, sleDirNode, uDirEntry, dirEntry))
+    do
+    {
+        auto const it = entries_.find(dirEntry);
+        Entry* entry = it == entries_.end() ? nullptr : &it->second;
+        if (!entry)
+        {
+            auto sleItem = view.read(Keylet { ltCHILD, dirEntry });
+            if (!sleItem)
+            {
+                // Directory node has an invalid index.  Bail out.
+                JLOG(j.fatal())
+                    << "EmittedTxn processing: directory node in ledger " << seq
+                    << " has index to object that is missing: "
+                    << to_string(dirEntry);
+                complete = false;
+                break;
+            }
+
+            if (safe_cast<LedgerEntryType>((*sleItem)[sfLedgerEntryType]) != ltEMITTED_TXN)
+            {
+                JLOG(j.fatal())
+                    << "EmittedTxn processing: emitted directory contained non ltEMITTED_TXN type";
+                complete = false;
+                break;
+            }
+
+            std::shared_ptr<STTx const> tx;
+            try
+            {
+                auto const& emitted =
+                    const_cast<ripple::STLedgerEntry&>(*sleItem).getField(sfEmittedTxn).downcast<STObject>();
+
+                Serializer s;
+                emitted.add(s);
+                SerialIter sit(s.slice());
+                tx = std::make_shared<STTx const>(std::ref(sit));
+
+                if (!usable(*tx))
+                {
+                    JLOG(j.warn())
+                        << "Hook: Emission failure: "
+                        << "sfEmitDetails or sfFirst/LastLedgerSeq missing.";
+                    tx.reset();
+                }
+            }
+            catch (std::exception& e)
+            {
+                JLOG(j.fatal()) << "EmittedTxn Processing: Failure: " << e.what() << "\n";
+            }
+
+            entry = &add(dirEntry, std::move(tx));
+        }
+
+        entry->seen = generation;
+        if (entry->tx)
+            due.pending.push_back(entry->tx->getTransactionID());
+
+    } while (cdirNext(view, emittedDirKeylet.key, sleDirNode, uDirEntry, dirEntry));
+
+    // entries which have left the directory, and entries handed over by finalizeHookResult whose
+    // ledger was never built on here, can no longer become due
+    if (complete)
+    {
+        for (auto it = entries_.begin(); it != entries_.end(); )
+        {
+            auto const& entry = it->second;
+            bool const gone = entry.seen == 0 ? entry.lastSeq < seq : entry.seen != generation;
+            if (!gone)
+            {
+                ++it;
+                continue;
+            }
+
+            if (entry.tx)
+            {
+                byFirst_.erase({entry.firstSeq, it->first});
+                byLast_.erase({entry.lastSeq, it->first});
+            }
+            it = entries_.erase(it);
+        }
+    }
+
+    for (auto it = byLast_.begin(); it != byLast_.end() && it->first < seq; ++it)
+    {
+        auto const& entry = entries_.at(it->second);
+        if (entry.seen == generation)
+            due.expired.push_back(entry.tx);
+    }
+
+    for (auto it = byFirst_.lower_bound({seq, uint256 {}});
+        it != byFirst_.end() && it->first == seq; ++it)
+    {
+        auto const& entry = entries_.at(it->second);
+        if (entry.seen == generation && entry.lastSeq >= seq)
+            due.ready.push_back(entry.tx);
+    }
+
+    return due;
+}
+
+std::size_t
+EmittedTxnIndex::size()
+{
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+}
+
+}
@@ -0,0 +1,138 @@
+#include <ripple/app/hook/HookArena.h>
+#include <boost/container/pmr/global_resource.hpp>
+#include <boost/container/pmr/monotonic_buffer_resource.hpp>
+#include <atomic>
+#include <memory>
+
+namespace hook
+{
+
+namespace
+{
+
+namespace pmr = boost::container::pmr;
+
+// takes the blocks of one thread's arena from the heap, counting them
+class Upstream : public pmr::memory_resource
+{
+    public:
+        uint64_t blocks = 0;
+
+    protected:
+        void*
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            ++blocks;
+            return pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void
+        do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+        {
+            pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool
+        do_is_equal(pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+};
+
+// one thread's arena, only ever used by that thread
+class Arena : public pmr::memory_resource
+{
+    public:
+        Upstream upstream;
+        std::unique_ptr<unsigned char[]> buffer {new unsigned char[HookArena::initialSize]};
+        pmr::monotonic_buffer_resource monotonic {buffer.get(), HookArena::initialSize, &upstream};
+
+        uint32_t depth = 0;             // Scopes open
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+    protected:
+        void*
+        do_allocate(std::size_t size, std::size_t alignment) override
+        {
+            ++allocations;
+            bytes += size;
+            return monotonic.allocate(size, alignment);
+        }
+
+        void
+        do_deallocate(void*, std::size_t, std::size_t) override
+        {
+            // monotonic, released when the outermost Scope closes
+        }
+
+        bool
+        do_is_equal(pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+};
+
+thread_local Arena* current = nullptr;
+
+std::atomic<uint64_t> phases {0};
+std::atomic<uint64_t> allocations {0};
+std::atomic<uint64_t> heapBlocks {0};
+std::atomic<uint64_t> bytes {0};
+
+Arena&
+local()
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+}
+
+HookArena::Scope::Scope()
+{
+    Arena& arena = local();
+    ++arena.depth;
+    current = &arena;
+}
+
+HookArena::Scope::~Scope()
+{
+    Arena& arena = local();
+    if (--arena.depth > 0)
+        return;
+
+    current = nullptr;
+
+    // counted per thread and published once per phase, so allocating stays free of atomics
+    ++phases;
+    allocations += arena.allocations;
+    heapBlocks += arena.upstream.blocks;
+    bytes += arena.bytes;
+    arena.allocations = 0;
+    arena.upstream.blocks = 0;
+    arena.bytes = 0;
+
+    arena.monotonic.release();
+}
+
+boost::container::pmr::memory_resource*
+HookArena::resource()
+{
+    if (current)
+        return current;
+    return pmr::get_default_resource();
+}
+
+HookArena::Counts
+HookArena::getCounts()
+{
+    return Counts {
+        .phases = phases.load(),
+        .allocations = allocations.load(),
+        .heapBlocks = heapBlocks.load(),
+        .bytes = bytes.load()
+    };
+}
+
+}
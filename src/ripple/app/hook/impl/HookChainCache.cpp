@@ -0,0 +1,215 @@
+#include <ripple/app/hook/HookChainCache.h>
+#include <ripple/app/hook/Enum.h>
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/protocol/Indexes.h>
+#include <algorithm>
+
+namespace hook
+{
+
+namespace
+{
+
+void
+mergeParameters(
+    ripple::STArray const& from,
+    std::map<std::vector<uint8_t>, std::vector<uint8_t>>& parameters)
+{
+    for (auto const& hookParameter : from)
+    {
+        auto const& hookParameterObj = dynamic_cast<ripple::STObject const*>(&hookParameter);
+        parameters[hookParameterObj->getFieldVL(ripple::sfHookParameterName)] =
+            hookParameterObj->getFieldVL(ripple::sfHookParameterValue);
+    }
+}
+
+}
+
+uint32_t
+maxHookChainCacheSize(void)
+{
+    return 4096U;
+}
+
+ResolvedHookChain::ResolvedHookChain(
+    ripple::ReadView const& view,
+    std::shared_ptr<ripple::STLedgerEntry const> const& hookSLE)
+    : hookSLE_(hookSLE)
+{
+    using namespace ripple;
+
+    auto const& hooks = hookSLE->getFieldArray(sfHooks);
+    hooks_.reserve(hooks.size());
+
+    uint8_t hookNo = 0;
+    for (auto const& hook : hooks)
+    {
+        hookNo++;
+
+        STObject const* hookObj = dynamic_cast<STObject const*>(&hook);
+
+        if (!hookObj->isFieldPresent(sfHookHash)) // skip blanks
+            continue;
+
+        ResolvedHook& resolved = hooks_.emplace_back();
+        resolved.hookNo = hookNo;
+        resolved.hookHash = hookObj->getFieldH256(sfHookHash);
+
+        auto const hookDef = view.read(keylet::hookDefinition(resolved.hookHash));
+        if (!hookDef)
+            continue;
+
+        resolved.definition = hookDef;
+        resolved.hookSetTxnID = hookDef->getFieldH256(sfHookSetTxnID);
+
+        resolved.hookNamespace =
+            hookObj->isFieldPresent(sfHookNamespace)
+                ? hookObj->getFieldH256(sfHookNamespace)
+                : hookDef->getFieldH256(sfHookNamespace);
+
+        resolved.hookOn =
+            hookObj->isFieldPresent(sfHookOn)
+                ? hookObj->getFieldU64(sfHookOn)
+                : hookDef->getFieldU64(sfHookOn);
+
+        resolved.flags =
+            hookObj->isFieldPresent(sfFlags)
+                ? hookObj->getFieldU32(sfFlags)
+                : hookDef->getFieldU32(sfFlags);
+
+        resolved.feeDrops = (uint32_t)(hookDef->getFieldAmount(sfFee).xrp().drops());
+        resolved.fuel = hookDef->at(~sfHookFuel);
+        resolved.hasCallback = hookDef->isFieldPresent(sfHookCallbackFee);
+
+        // first defaults and then custom
+        resolved.parametersValid = hookDef->isFieldPresent(sfHookParameters);
+        if (resolved.parametersValid)
+        {
+            mergeParameters(hookDef->getFieldArray(sfHookParameters), resolved.parameters);
+            if (hookObj->isFieldPresent(sfHookParameters))
+                mergeParameters(hookObj->getFieldArray(sfHookParameters), resolved.parameters);
+        }
+
+        for (std::size_t txType = 0; txType < feeTypes; ++txType)
+        {
+            if (!canHook(static_cast<TxType>(txType), resolved.hookOn))
+                continue;
+
+            fee_[txType] += resolved.feeDrops;
+            if (resolved.flags & hsfCOLLECT)
+                collectFee_[txType] += resolved.feeDrops;
+        }
+    }
+}
+
+uint64_t
+ResolvedHookChain::fee(ripple::TxType txType, bool collectCallsOnly) const
+{
+    if (txType < feeTypes)
+        return collectCallsOnly ? collectFee_[txType] : fee_[txType];
+
+    uint64_t fee = 0;
+    for (auto const& hook : hooks_)
+        if (hook.definition && canHook(txType, hook.hookOn) &&
+            (!collectCallsOnly || (hook.flags & hsfCOLLECT)))
+            fee += hook.feeDrops;
+    return fee;
+}
+
+HookChainCache::HookChainCache(std::size_t capacity)
+    : chains_(capacity)
+{
+}
+
+HookChainCache&
+HookChainCache::instance()
+{
+    static HookChainCache cache { maxHookChainCacheSize() };
+    return cache;
+}
+
+HookChainCache::Chain
+HookChainCache::resolve(
+    ripple::ReadView const& view,
+    std::shared_ptr<ripple::STLedgerEntry const> const& hookSLE)
+{
+    if (!hookSLE)
+        return {};
+
+    ripple::uint256 const& key = hookSLE->key();
+
+    // the version resolved from this very hookSLE object, if any
+    auto const resolvedFrom = [&hookSLE](Versions& versions)
+    {
+        return std::find_if(versions.begin(), versions.end(), [&hookSLE](Chain const& version)
+        {
+            return version->hookSLE() == hookSLE;
+        });
+    };
+
+    {
+        std::lock_guard lock(mutex_);
+        Versions::iterator v;
+        if (auto const versions = chains_.find(key, [&](Versions& versions)
+            {
+                v = resolvedFrom(versions);
+                return v != versions.end();
+            }))
+        {
+            Chain chain = *v;
+            std::rotate(versions->begin(), v, v + 1);
+            return chain;
+        }
+    }
+
+    // resolve outside the lock, this reads every definition of the chain from the view
+    Chain chain = std::make_shared<ResolvedHookChain const>(view, hookSLE);
+
+    std::lock_guard lock(mutex_);
+
+    // another thread may have resolved the same version meanwhile
+    auto& versions = chains_.insert(key, {}).first;
+    if (auto const v = resolvedFrom(versions); v != versions.end())
+        return *v;
+
+    versions.insert(versions.begin(), chain);
+    if (versions.size() > versionsPerAccount)
+        versions.resize(versionsPerAccount);
+
+    return chain;
+}
+
+HookChainCache::Chain
+HookChainCache::resolve(ripple::ReadView const& view, ripple::Keylet const& hookKeylet)
+{
+    return resolve(view, view.read(hookKeylet));
+}
+
+void
+HookChainCache::invalidate(ripple::AccountID const& account)
+{
+    std::lock_guard lock(mutex_);
+    if (chains_.erase(ripple::keylet::hook(account).key))
+        ++invalidations_;
+}
+
+std::size_t
+HookChainCache::size() const
+{
+    std::lock_guard lock(mutex_);
+    return chains_.size();
+}
+
+HookChainCache::Counts
+HookChainCache::getCounts() const
+{
+    return Counts {
+        .hits = chains_.hits(),
+        .misses = chains_.misses(),
+        .evictions = chains_.evictions(),
+        .invalidations = invalidations_.load(),
+        .size = size()
+    };
+}
+
+}
@@ -0,0 +1,271 @@
+#include <ripple/app/hook/HookStats.h>
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/protocol/jss.h>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace hook
+{
+
+namespace
+{
+
+std::vector<std::string>&
+registeredNames()
+{
+    static std::vector<std::string> names;
+    return names;
+}
+
+// the slot of a registered host function, maxHostFunctions if there is none by that name
+std::size_t
+slotOf(std::string const& name)
+{
+    auto const& names = hostFunctionNames();
+    return std::find(names.begin(), names.end(), name) - names.begin();
+}
+
+std::size_t
+timeBucket(uint64_t micros)
+{
+    return std::min<std::size_t>(std::bit_width(micros), HookStats::timeBuckets - 1);
+}
+
+// the upper bound of the bucket the p'th fraction of executions falls in
+uint64_t
+percentile(
+    std::array<uint64_t, HookStats::timeBuckets> const& micros,
+    uint64_t executions,
+    uint64_t maxMicros,
+    double p)
+{
+    uint64_t const rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * executions + 0.5));
+    uint64_t seen = 0;
+    for (std::size_t b = 0; b < micros.size(); ++b)
+    {
+        seen += micros[b];
+        if (seen >= rank)
+            return std::min(maxMicros, b == 0 ? 0 : (uint64_t(1) << b) - 1);
+    }
+    return maxMicros;
+}
+
+}
+
+uint32_t
+maxHookStatsSize(void)
+{
+    return 4096U;
+}
+
+uint16_t
+registerHostFunction(char const* name)
+{
+    auto& names = registeredNames();
+    assert(names.size() < maxHostFunctions);
+    if (names.size() >= maxHostFunctions)
+        return maxHostFunctions - 1;
+
+    names.emplace_back(name);
+    return static_cast<uint16_t>(names.size() - 1);
+}
+
+std::vector<std::string> const&
+hostFunctionNames()
+{
+    return registeredNames();
+}
+
+HookStats::HookStats(std::size_t capacity)
+    : id_([]() {
+        static std::atomic<uint64_t> instances {0};
+        return ++instances;
+    }())
+    , capacity_(capacity < 1 ? 1 : capacity)
+{
+}
+
+HookStats&
+HookStats::instance()
+{
+    static HookStats stats { maxHookStatsSize() };
+    return stats;
+}
+
+HookStats::Shard&
+HookStats::shard()
+{
+    // the shards this thread records into, at most one per instance
+    thread_local std::vector<std::pair<uint64_t, std::shared_ptr<Shard>>> local;
+
+    for (auto const& [id, shard] : local)
+        if (id == id_)
+            return *shard;
+
+    auto shard = std::make_shared<Shard>();
+    {
+        std::lock_guard lock(shardsMutex_);
+        shards_.push_back(shard);
+    }
+    local.emplace_back(id_, shard);
+    return *shard;
+}
+
+void
+HookStats::record(HookResult const& result, std::chrono::microseconds elapsed)
+{
+    uint64_t const micros = elapsed.count() < 0 ? 0 : elapsed.count();
+    std::size_t const functions = hostFunctionNames().size();
+
+    Shard& s = shard();
+    std::lock_guard lock(s.mutex);
+
+    auto it = s.hooks.find(result.hookHash);
+    if (it == s.hooks.end())
+    {
+        if (s.hooks.size() >= capacity_)
+        {
+            s.hooks.erase(s.lru.back());
+            s.lru.pop_back();
+            ++evicted_;
+        }
+
+        s.lru.push_front(result.hookHash);
+        it = s.hooks.emplace(result.hookHash, Entry {{}, s.lru.begin()}).first;
+    }
+    else
+        s.lru.splice(s.lru.begin(), s.lru, it->second.position);
+
+    Counters& c = it->second.counters;
+    ++c.executions;
+    if (result.exitType == hook_api::ExitType::WASM_ERROR)
+        ++c.wasmErrors;
+    c.totalMicros += micros;
+    c.maxMicros = std::max(c.maxMicros, micros);
+    ++c.micros[timeBucket(micros)];
+    c.instructions += result.instructionCount;
+    c.emits += result.emittedTxn.size();
+
+    if (c.hostCalls.size() < functions)
+        c.hostCalls.resize(functions);
+    for (std::size_t f = 0; f < functions; ++f)
+        c.hostCalls[f] += result.hostCalls[f];
+}
+
+std::vector<HookStats::Summary>
+HookStats::top(std::size_t limit) const
+{
+    std::vector<std::shared_ptr<Shard>> shards;
+    {
+        std::lock_guard lock(shardsMutex_);
+        shards = shards_;
+    }
+
+    std::unordered_map<ripple::uint256, Counters, ripple::hardened_hash<>> merged;
+    for (auto const& shard : shards)
+    {
+        std::lock_guard lock(shard->mutex);
+        for (auto const& [hookHash, entry] : shard->hooks)
+        {
+            Counters const& from = entry.counters;
+            Counters& to = merged[hookHash];
+            to.executions += from.executions;
+            to.wasmErrors += from.wasmErrors;
+            to.totalMicros += from.totalMicros;
+            to.maxMicros = std::max(to.maxMicros, from.maxMicros);
+            to.instructions += from.instructions;
+            to.emits += from.emits;
+            for (std::size_t b = 0; b < timeBuckets; ++b)
+                to.micros[b] += from.micros[b];
+            if (to.hostCalls.size() < from.hostCalls.size())
+                to.hostCalls.resize(from.hostCalls.size());
+            for (std::size_t f = 0; f < from.hostCalls.size(); ++f)
+                to.hostCalls[f] += from.hostCalls[f];
+        }
+    }
+
+    std::vector<std::pair<ripple::uint256, Counters const*>> order;
+    order.reserve(merged.size());
+    for (auto const& [hookHash, c] : merged)
+        order.emplace_back(hookHash, &c);
+
+    auto const byTime = [](auto const& a, auto const& b) {
+        return a.second->totalMicros != b.second->totalMicros
+            ? a.second->totalMicros > b.second->totalMicros
+            : a.first < b.first;
+    };
+    if (order.size() > limit)
+    {
+        std::partial_sort(order.begin(), order.begin() + limit, order.end(), byTime);
+        order.resize(limit);
+    }
+    else
+        std::sort(order.begin(), order.end(), byTime);
+
+    auto const& names = hostFunctionNames();
+    auto const calls = [&](Counters const& c, std::string const& name) -> uint64_t {
+        std::size_t const f = slotOf(name);
+        return f < c.hostCalls.size() ? c.hostCalls[f] : 0;
+    };
+
+    std::vector<Summary> summaries;
+    summaries.reserve(order.size());
+    for (auto const& [hookHash, c] : order)
+    {
+        Summary& s = summaries.emplace_back();
+        s.hookHash = hookHash;
+        s.executions = c->executions;
+        s.wasmErrors = c->wasmErrors;
+        s.totalMicros = c->totalMicros;
+        s.maxMicros = c->maxMicros;
+        s.p50Micros = percentile(c->micros, c->executions, c->maxMicros, 0.50);
+        s.p99Micros = percentile(c->micros, c->executions, c->maxMicros, 0.99);
+        s.instructions = c->instructions;
+        s.stateReads = calls(*c, "state") + calls(*c, "state_foreign");
+        s.stateWrites = calls(*c, "state_set") + calls(*c, "state_foreign_set");
+        s.emits = c->emits;
+
+        for (std::size_t f = 0; f < c->hostCalls.size() && f < names.size(); ++f)
+            if (c->hostCalls[f])
+                s.hostCalls.emplace_back(names[f], c->hostCalls[f]);
+        std::stable_sort(s.hostCalls.begin(), s.hostCalls.end(),
+            [](auto const& a, auto const& b) { return a.second > b.second; });
+    }
+
+    return summaries;
+}
+
+Json::Value
+HookStats::getJson(std::size_t limit) const
+{
+    using namespace ripple;
+
+    Json::Value ret(Json::objectValue);
+    ret[jss::evicted] = std::to_string(evicted());
+
+    Json::Value& hooks = (ret[jss::hooks] = Json::arrayValue);
+    for (auto const& s : top(limit))
+    {
+        Json::Value& jv = hooks.append(Json::objectValue);
+        jv[jss::hook_hash] = to_string(s.hookHash);
+        jv[jss::executions] = std::to_string(s.executions);
+        jv[jss::wasm_errors] = std::to_string(s.wasmErrors);
+        jv[jss::total_us] = std::to_string(s.totalMicros);
+        jv[jss::p50_us] = std::to_string(s.p50Micros);
+        jv[jss::p99_us] = std::to_string(s.p99Micros);
+        jv[jss::max_us] = std::to_string(s.maxMicros);
+        jv[jss::instructions] = std::to_string(s.instructions);
+        jv[jss::state_reads] = std::to_string(s.stateReads);
+        jv[jss::state_writes] = std::to_string(s.stateWrites);
+        jv[jss::emits] = std::to_string(s.emits);
+
+        Json::Value& calls = (jv[jss::host_calls] = Json::objectValue);
+        for (auto const& [name, count] : s.hostCalls)
+            calls[name] = std::to_string(count);
+    }
+
+    return ret;
+}
+
+}
@@ -0,0 +1,283 @@
+#include <ripple/app/hook/HookTrace.h>
+#include <ripple/app/hook/XFL.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/Log.h>
+#include <ripple/basics/chrono.h>
+#include <ripple/basics/strHex.h>
+#include <ripple/protocol/jss.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace hook
+{
+
+HookTraceLog&
+HookTraceLog::instance()
+{
+    static HookTraceLog log;
+    return log;
+}
+
+void
+HookTraceLog::setup(ripple::Section const& section, beast::Journal const& j)
+{
+    std::size_t entries = 0;
+    ripple::get_if_exists(section, "trace_buffer", entries);
+    if (entries == 0)
+        return;
+
+    std::size_t hooks = defaultHooks;
+    ripple::get_if_exists(section, "trace_hooks", hooks);
+    hooks = std::max<std::size_t>(hooks, 1);
+
+    if (entries > maxEntries)
+    {
+        JLOG(j.warn()) << "Hook trace_buffer of " << entries << " entries lowered to " << maxEntries;
+        entries = maxEntries;
+    }
+
+    if (hooks > maxEntries / entries)
+    {
+        JLOG(j.warn())
+            << "Hook trace_hooks of " << hooks << " lowered to " << maxEntries / entries
+            << " to keep at most " << maxEntries << " traces";
+        hooks = maxEntries / entries;
+    }
+
+    JLOG(j.info())
+        << "Hook traces kept in rings of " << entries << " entries for " << hooks << " hooks";
+    resize(entries, hooks);
+}
+
+HookTraceLog::Shard&
+HookTraceLog::shard(ripple::uint256 const& hookHash) const
+{
+    // hook hashes are uniformly distributed, the first byte spreads them well enough
+    return shards_[*hookHash.data() % shardCount];
+}
+
+void
+HookTraceLog::resize(std::size_t capacity, std::size_t hooks)
+{
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(shardCount);
+    for (auto& shard : shards_)
+        locks.emplace_back(shard.mutex);
+
+    // each shard keeps its share of the hooks, rounded up
+    std::size_t const hooksPerShard = (std::max<std::size_t>(hooks, 1) + shardCount - 1) / shardCount;
+    for (auto& shard : shards_)
+    {
+        shard.rings.reset();
+        if (capacity > 0)
+            shard.rings.emplace(hooksPerShard);
+    }
+
+    capacity_ = capacity;
+    first_ = next_.load();
+    enabled_ = capacity > 0;
+}
+
+std::size_t
+HookTraceLog::capacity() const
+{
+    std::lock_guard lock(shards_.front().mutex);
+    return capacity_;
+}
+
+void
+HookTraceLog::append(
+    ripple::uint256 const& hookHash,
+    ripple::uint256 const& otxnId,
+    ripple::AccountID const& account,
+    Kind kind,
+    ripple::Slice message,
+    ripple::Slice data,
+    int64_t number)
+{
+    std::size_t const messageLen = std::min(message.size(), maxMessage);
+    std::size_t const dataLen = std::min(data.size(), maxData);
+    auto const now = std::chrono::system_clock::now();
+
+    Shard& s = shard(hookHash);
+    std::lock_guard lock(s.mutex);
+    if (!s.rings)
+        return;
+
+    Ring& ring = s.rings->insert(hookHash, {}).first;
+    Entry& e = ring.entries.size() < capacity_
+        ? ring.entries.emplace_back()
+        : ring.entries[ring.appended % capacity_];
+    ++ring.appended;
+
+    // taken under the shard's lock, so every number below next_ is in its ring once read() holds
+    // all the locks
+    e.seq = next_++;
+    e.time = now;
+    e.hookHash = hookHash;
+    e.otxnId = otxnId;
+    e.account = account;
+    e.kind = kind;
+    e.messageLen = static_cast<uint8_t>(messageLen);
+    e.dataLen = static_cast<uint16_t>(dataLen);
+    e.number = number;
+    if (messageLen > 0)
+        std::memcpy(e.payload, message.data(), messageLen);
+    if (dataLen > 0)
+        std::memcpy(e.payload + messageLen, data.data(), dataLen);
+}
+
+HookTraceLog::Page
+HookTraceLog::read(
+    uint64_t marker,
+    std::size_t limit,
+    std::optional<ripple::uint256> const& hookHash) const
+{
+    Page page;
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(shardCount);
+    for (auto& shard : shards_)
+        locks.emplace_back(shard.mutex);
+
+    uint64_t const next = next_.load();
+    uint64_t const from = std::max<uint64_t>(marker, 1);
+    if (from >= next)
+    {
+        page.marker = from;
+        return page;
+    }
+
+    // the sequence numbers of every entry retained from the marker on tell the lost ones apart,
+    // whichever hook they belong to
+    std::vector<uint64_t> retained;
+    std::vector<Entry const*> matching;
+    for (auto const& shard : shards_)
+    {
+        if (!shard.rings)
+            continue;
+
+        shard.rings->forEach([&](ripple::uint256 const& ringHash, Ring const& ring)
+        {
+            for (auto const& e : ring.entries)
+            {
+                if (e.seq < from)
+                    continue;
+                retained.push_back(e.seq);
+                if (!hookHash || ringHash == *hookHash)
+                    matching.push_back(&e);
+            }
+        });
+    }
+
+    std::sort(matching.begin(), matching.end(),
+        [](Entry const* a, Entry const* b) { return a->seq < b->seq; });
+
+    // stop after the last entry returned when the limit cuts the page short
+    uint64_t end = next;
+    if (matching.size() >= limit)
+    {
+        matching.resize(limit);
+        end = limit ? matching.back()->seq + 1 : from;
+    }
+
+    page.entries.reserve(matching.size());
+    for (auto const e : matching)
+        page.entries.push_back(*e);
+
+    page.missed = (end - from) - static_cast<uint64_t>(
+        std::count_if(retained.begin(), retained.end(), [end](uint64_t seq) { return seq < end; }));
+    page.marker = end;
+    return page;
+}
+
+std::string
+HookTraceLog::format(Entry const& e)
+{
+    using namespace hook_float;
+
+    ripple::Slice const message = e.message();
+    ripple::Slice const data = e.data();
+    std::string out(reinterpret_cast<char const*>(message.data()), message.size());
+
+    switch (e.kind)
+    {
+        case Kind::number:
+            if (!out.empty())
+                out += ' ';
+            out += std::to_string(e.number);
+            break;
+
+        case Kind::floating:
+        {
+            if (e.number == 0)
+            {
+                out += " Float 0*10^(0) <ZERO>";
+                break;
+            }
+
+            uint64_t man = get_mantissa(e.number);
+            int32_t exp = get_exponent(e.number);
+            if (man < minMantissa || man > maxMantissa || exp < minExponent || exp > maxExponent)
+            {
+                out += " Float <INVALID>";
+                break;
+            }
+
+            out += " Float ";
+            if (is_negative(e.number))
+                out += '-';
+            out += std::to_string(man) + "*10^(" + std::to_string(exp) + ")";
+            break;
+        }
+
+        default:
+            if (!out.empty())
+                out += ": ";
+
+            if (e.kind == Kind::hex)
+                out += ripple::strHex(data);
+            else if (e.kind == Kind::utf16)
+                for (std::size_t i = 0; i < data.size(); i += 2)
+                    out += static_cast<char>(data[i]);
+            else
+                out.append(reinterpret_cast<char const*>(data.data()), data.size());
+            break;
+    }
+
+    return out;
+}
+
+Json::Value
+HookTraceLog::getJson(
+    uint64_t marker,
+    std::size_t limit,
+    std::optional<ripple::uint256> const& hookHash) const
+{
+    using namespace ripple;
+
+    Page const page = read(marker, limit, hookHash);
+
+    Json::Value ret(Json::objectValue);
+    ret[jss::capacity] = static_cast<Json::UInt>(capacity());
+    ret[jss::marker] = std::to_string(page.marker);
+    ret[jss::dropped] = std::to_string(page.missed);
+
+    Json::Value& traces = (ret[jss::traces] = Json::arrayValue);
+    for (auto const& e : page.entries)
+    {
+        Json::Value& jv = traces.append(Json::objectValue);
+        jv[jss::seq] = std::to_string(e.seq);
+        jv[jss::time] = to_string(
+            std::chrono::time_point_cast<std::chrono::microseconds>(e.time));
+        jv[jss::hook_hash] = to_string(e.hookHash);
+        jv[jss::otxn_id] = to_string(e.otxnId);
+        jv[jss::account] = toBase58(e.account);
+        jv[jss::message] = format(e);
+    }
+
+    return ret;
+}
+
+}
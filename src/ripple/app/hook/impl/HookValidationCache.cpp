@@ -0,0 +1,60 @@
+#include <ripple/app/hook/HookValidationCache.h>
+
+namespace hook
+{
+
+uint32_t
+maxHookValidationCacheSize(void)
+{
+    return 1024U;
+}
+
+HookValidationCache::HookValidationCache(std::size_t capacity)
+    : verdicts_(capacity)
+{
+}
+
+HookValidationCache&
+HookValidationCache::instance()
+{
+    static HookValidationCache cache { maxHookValidationCacheSize() };
+    return cache;
+}
+
+std::optional<HookValidationCache::Verdict>
+HookValidationCache::find(ripple::uint256 const& codeHash, uint64_t rulesVersion)
+{
+    std::lock_guard lock(mutex_);
+    if (auto const verdict = verdicts_.find(Key { codeHash, rulesVersion }))
+        return *verdict;
+    return std::nullopt;
+}
+
+void
+HookValidationCache::insert(
+    ripple::uint256 const& codeHash, uint64_t rulesVersion, Verdict const& verdict)
+{
+    // another thread may have validated the same code meanwhile, the verdict is the same
+    std::lock_guard lock(mutex_);
+    verdicts_.insert(Key { codeHash, rulesVersion }, verdict);
+}
+
+std::size_t
+HookValidationCache::size() const
+{
+    std::lock_guard lock(mutex_);
+    return verdicts_.size();
+}
+
+HookValidationCache::Counts
+HookValidationCache::getCounts() const
+{
+    return Counts {
+        .hits = verdicts_.hits(),
+        .misses = verdicts_.misses(),
+        .evictions = verdicts_.evictions(),
+        .size = size()
+    };
+}
+
+}
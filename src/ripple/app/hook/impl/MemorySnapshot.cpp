@@ -0,0 +1,453 @@
+#include <ripple/app/hook/MemorySnapshot.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/Log.h>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Mapping the image over an instance's memory relies on how WasmEdge 0.11.2 allocates linear
+// memory on Linux: a private anonymous reservation of its own which it unmaps as a whole when the
+// instance is deleted. That is not part of its API, so the mapping is only built against that
+// version and only used when the library loaded at runtime is the same one.
+#if defined(__linux__) && defined(MFD_CLOEXEC) && \
+    (defined(__x86_64__) || defined(__aarch64__)) && \
+    WASMEDGE_VERSION_MAJOR == 0 && WASMEDGE_VERSION_MINOR == 11 && WASMEDGE_VERSION_PATCH == 2
+#define HOOK_SNAPSHOT_MMAP 1
+#endif
+
+namespace hook
+{
+
+namespace
+{
+
+#ifdef HOOK_SNAPSHOT_MMAP
+bool
+mappingSupported()
+{
+    static bool const supported = std::strcmp(WasmEdge_VersionGet(), WASMEDGE_VERSION) == 0;
+    return supported;
+}
+#endif
+
+constexpr uint32_t wasmPageSize = 65536;
+
+// granularity at which the image is split into chunks, and the smallest page size mapped over
+constexpr uint32_t chunkSize = 4096;
+
+// memories larger than this are not snapshotted, taking the image would scan all of it
+constexpr uint32_t maxSnapshotPages = 256;
+
+// read an unsigned leb128 of at most 32 bits, false if it is malformed or runs past end
+bool
+readULeb(uint8_t const* data, size_t end, size_t& offset, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (offset >= end)
+            return false;
+        uint8_t const b = data[offset++];
+        value |= static_cast<uint32_t>(b & 0x7FU) << shift;
+        if (!(b & 0x80U))
+            return true;
+    }
+    return false;
+}
+
+// skip a signed leb128 of at most 32 bits
+bool
+skipSLeb(uint8_t const* data, size_t end, size_t& offset)
+{
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (offset >= end)
+            return false;
+        if (!(data[offset++] & 0x80U))
+            return true;
+    }
+    return false;
+}
+
+// check the active data segments of a data section, false if any is passive or not understood
+bool
+activeSegments(uint8_t const* data, size_t offset, size_t end, uint32_t& count)
+{
+    if (!readULeb(data, end, offset, count))
+        return false;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t flags = 0;
+        if (!readULeb(data, end, offset, flags))
+            return false;
+
+        // 0 = active in memory 0, 2 = active with an explicit memory index, 1 = passive
+        if (flags == 2)
+        {
+            uint32_t memory = 0;
+            if (!readULeb(data, end, offset, memory) || memory != 0)
+                return false;
+        }
+        else if (flags != 0)
+            return false;
+
+        // the offset is a constant expression: i32.const n or global.get g, then end
+        if (offset >= end)
+            return false;
+        uint8_t const op = data[offset++];
+        uint32_t index = 0;
+        if (op == 0x41U)
+        {
+            if (!skipSLeb(data, end, offset))
+                return false;
+        }
+        else if (op != 0x23U || !readULeb(data, end, offset, index))
+            return false;
+
+        if (offset >= end || data[offset++] != 0x0BU)
+            return false;
+
+        uint32_t bytes = 0;
+        if (!readULeb(data, end, offset, bytes) || end - offset < bytes)
+            return false;
+        offset += bytes;
+    }
+
+    return offset == end;
+}
+
+}
+
+uint32_t
+maxHookMemorySnapshotCacheSize(void)
+{
+    return 256U;
+}
+
+MemorySnapshot::MemorySnapshot(
+    ModuleCache::Module module,
+    std::string memoryName,
+    uint32_t pages,
+    std::vector<Chunk> chunks,
+    uint64_t instructions)
+    : module_(std::move(module))
+    , memoryName_(std::move(memoryName))
+    , pages_(pages)
+    , chunks_(std::move(chunks))
+    , instructions_(instructions)
+{
+#ifdef HOOK_SNAPSHOT_MMAP
+    // the memfd is sized to the whole memory, pages never written stay holes and read as zero
+    uint32_t const bytes = pages_ * wasmPageSize;
+    if (!mappingSupported() || bytes == 0 || bytes % sysconf(_SC_PAGESIZE))
+        return;
+
+    fd_ = memfd_create("hook_snapshot", MFD_CLOEXEC);
+    if (fd_ < 0)
+        return;
+
+    bool ok = ftruncate(fd_, bytes) == 0;
+    for (auto it = chunks_.begin(); ok && it != chunks_.end(); ++it)
+    {
+        std::size_t done = 0;
+        while (ok && done < it->bytes.size())
+        {
+            ssize_t const n = pwrite(
+                fd_, it->bytes.data() + done, it->bytes.size() - done, it->offset + done);
+            ok = n > 0;
+            done += ok ? n : 0;
+        }
+    }
+
+    if (!ok)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+MemorySnapshot::~MemorySnapshot()
+{
+#ifdef HOOK_SNAPSHOT_MMAP
+    if (fd_ >= 0)
+        close(fd_);
+#endif
+}
+
+bool
+MemorySnapshot::apply(WasmEdge_ModuleInstanceContext* instance) const
+{
+    WasmEdge_MemoryInstanceContext* memoryCtx = WasmEdge_ModuleInstanceFindMemory(
+        instance, WasmEdge_StringWrap(memoryName_.data(), memoryName_.size()));
+
+    if (!memoryCtx || WasmEdge_MemoryInstanceGetPageSize(memoryCtx) != pages_)
+        return false;
+
+    uint32_t const bytes = pages_ * wasmPageSize;
+    if (bytes == 0)
+        return true;
+
+    uint8_t* base = WasmEdge_MemoryInstanceGetPointer(memoryCtx, 0, bytes);
+    if (!base)
+        return false;
+
+#ifdef HOOK_SNAPSHOT_MMAP
+    if (fd_ >= 0 && reinterpret_cast<uintptr_t>(base) % sysconf(_SC_PAGESIZE) == 0)
+    {
+        // replaces the instance's zero pages in place, WasmEdge releases the mapping along with
+        // the rest of its memory reservation when the instance is deleted. A failed MAP_FIXED may
+        // already have unmapped the original pages, so the instance is unusable then and is not
+        // copied into instead.
+        return mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd_, 0) == base;
+    }
+#endif
+
+    for (auto const& chunk : chunks_)
+        std::memcpy(base + chunk.offset, chunk.bytes.data(), chunk.bytes.size());
+
+    return true;
+}
+
+std::optional<std::vector<uint8_t>>
+MemorySnapshot::stripData(const void* wasm, size_t len)
+{
+    uint8_t const* data = reinterpret_cast<uint8_t const*>(wasm);
+    uint8_t const header[] = { 0x00U, 0x61U, 0x73U, 0x6DU, 0x01U, 0x00U, 0x00U, 0x00U };
+    if (len < sizeof(header) || std::memcmp(data, header, sizeof(header)) != 0)
+        return {};
+
+    size_t dataStart = 0;
+    size_t dataEnd = 0;
+    uint32_t segments = 0;
+
+    size_t offset = sizeof(header);
+    while (offset < len)
+    {
+        size_t const start = offset;
+        uint8_t const id = data[offset++];
+
+        uint32_t size = 0;
+        if (!readULeb(data, len, offset, size) || len - offset < size)
+            return {};
+
+        // start function, data count
+        if (id == 8 || id == 12)
+            return {};
+
+        if (id == 11)
+        {
+            if (dataEnd || !activeSegments(data, offset, offset + size, segments))
+                return {};
+            dataStart = start;
+            dataEnd = offset + size;
+        }
+
+        offset += size;
+    }
+
+    if (segments == 0)
+        return {};
+
+    std::vector<uint8_t> stripped;
+    stripped.reserve(len - (dataEnd - dataStart));
+    stripped.insert(stripped.end(), data, data + dataStart);
+    stripped.insert(stripped.end(), data + dataEnd, data + len);
+    return stripped;
+}
+
+std::shared_ptr<MemorySnapshot const>
+MemorySnapshot::take(
+    ModuleCache::Module const& hook,
+    const void* wasm,
+    size_t len,
+    WasmEdge_ConfigureContext* confCtx,
+    WasmEdge_StoreContext* storeCtx,
+    beast::Journal const& j)
+{
+    auto stripped = stripData(wasm, len);
+    if (!stripped)
+        return {};
+
+    ModuleCache::Module module = ModuleCache::load(stripped->data(), stripped->size(), j);
+    if (!module)
+        return {};
+
+    // instantiate a module on its own statistics, returning the instructions counted doing so and
+    // handing its exported memory to inspect, nullopt if anything about it is unexpected
+    auto const instantiate =
+        [&](WasmEdge_ASTModuleContext const* ast, auto&& inspect) -> std::optional<uint64_t>
+    {
+        WasmEdge_StatisticsContext* statsCtx = WasmEdge_StatisticsCreate();
+        WasmEdge_ExecutorContext* execCtx = WasmEdge_ExecutorCreate(confCtx, statsCtx);
+        WasmEdge_ModuleInstanceContext* instance = NULL;
+
+        std::optional<uint64_t> ret;
+        WasmEdge_Result res = WasmEdge_ExecutorInstantiate(execCtx, &instance, storeCtx, ast);
+        if (!WasmEdge_ResultOK(res))
+        {
+            JLOG(j.debug())
+                << "HookInfo: MemorySnapshot instantiation failed " << WasmEdge_ResultGetMessage(res);
+            instance = NULL;
+        }
+        else if (WasmEdge_ModuleInstanceListMemoryLength(instance) > 0)
+        {
+            WasmEdge_String name;
+            WasmEdge_ModuleInstanceListMemory(instance, &name, 1);
+            if (WasmEdge_MemoryInstanceContext* memoryCtx =
+                    WasmEdge_ModuleInstanceFindMemory(instance, name);
+                memoryCtx && inspect(std::string(name.Buf, name.Length), memoryCtx))
+                ret = WasmEdge_StatisticsGetInstrCount(statsCtx);
+        }
+
+        if (instance)
+            WasmEdge_ModuleInstanceDelete(instance);
+        WasmEdge_ExecutorDelete(execCtx);
+        WasmEdge_StatisticsDelete(statsCtx);
+        return ret;
+    };
+
+    std::string memoryName;
+    uint32_t pages = 0;
+    std::vector<Chunk> chunks;
+
+    auto const hookInstructions = instantiate(hook.get(),
+        [&](std::string name, WasmEdge_MemoryInstanceContext* memoryCtx)
+        {
+            memoryName = std::move(name);
+            pages = WasmEdge_MemoryInstanceGetPageSize(memoryCtx);
+
+            if (pages > maxSnapshotPages)
+                return false;
+
+            uint32_t const bytes = pages * wasmPageSize;
+
+            uint8_t const* base = WasmEdge_MemoryInstanceGetPointer(memoryCtx, 0, bytes);
+            if (!base && bytes)
+                return false;
+
+            for (uint32_t at = 0; at < bytes; at += chunkSize)
+            {
+                uint8_t const* from = base + at;
+                if (std::all_of(from, from + chunkSize, [](uint8_t b) { return b == 0; }))
+                    continue;
+
+                // adjacent non-zero pages are kept as one chunk
+                if (!chunks.empty() && chunks.back().offset + chunks.back().bytes.size() == at)
+                    chunks.back().bytes.insert(chunks.back().bytes.end(), from, from + chunkSize);
+                else
+                    chunks.push_back(Chunk { at, std::vector<uint8_t>(from, from + chunkSize) });
+            }
+            return true;
+        });
+
+    if (!hookInstructions)
+        return {};
+
+    auto const strippedInstructions = instantiate(module.get(),
+        [&](std::string const& name, WasmEdge_MemoryInstanceContext* memoryCtx)
+        {
+            return name == memoryName && WasmEdge_MemoryInstanceGetPageSize(memoryCtx) == pages;
+        });
+
+    if (!strippedInstructions || *strippedInstructions > *hookInstructions)
+        return {};
+
+    return std::make_shared<MemorySnapshot const>(
+        std::move(module),
+        std::move(memoryName),
+        pages,
+        std::move(chunks),
+        *hookInstructions - *strippedInstructions);
+}
+
+MemorySnapshotCache::MemorySnapshotCache(std::size_t capacity)
+    : snapshots_(capacity)
+{
+}
+
+MemorySnapshotCache&
+MemorySnapshotCache::instance()
+{
+    static MemorySnapshotCache cache { maxHookMemorySnapshotCacheSize() };
+    return cache;
+}
+
+void
+MemorySnapshotCache::setup(ripple::Section const& section, beast::Journal const& j)
+{
+    bool snapshots = false;
+    ripple::get_if_exists(section, "memory_snapshots", snapshots);
+    if (!snapshots)
+        return;
+
+    JLOG(j.info()) << "Hook memory snapshots enabled";
+    enable(true);
+}
+
+bool
+MemorySnapshotCache::enabled() const
+{
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+void
+MemorySnapshotCache::enable(bool on)
+{
+    enabled_ = on;
+}
+
+MemorySnapshotCache::Snapshot
+MemorySnapshotCache::fetch(
+    ripple::uint256 const& hookHash,
+    ModuleCache::Module const& hook,
+    const void* wasm,
+    size_t len,
+    WasmEdge_ConfigureContext* confCtx,
+    WasmEdge_StoreContext* storeCtx,
+    beast::Journal const& j)
+{
+    if (!enabled())
+        return {};
+
+    {
+        std::lock_guard lock(mutex_);
+        if (auto const cached = snapshots_.find(hookHash))
+            return *cached;
+    }
+
+    // taken outside the lock, two threads missing on the same hash at the same time will both
+    // take it and the second insert is discarded
+    Snapshot snapshot = MemorySnapshot::take(hook, wasm, len, confCtx, storeCtx, j);
+    if (!snapshot)
+        ++rejected_;
+
+    std::lock_guard lock(mutex_);
+    return snapshots_.insert(hookHash, std::move(snapshot)).first;
+}
+
+std::size_t
+MemorySnapshotCache::size() const
+{
+    std::lock_guard lock(mutex_);
+    return snapshots_.size();
+}
+
+MemorySnapshotCache::Counts
+MemorySnapshotCache::getCounts() const
+{
+    return Counts {
+        .hits = snapshots_.hits(),
+        .misses = snapshots_.misses(),
+        .rejected = rejected_.load(),
+        .evictions = snapshots_.evictions(),
+        .size = size(),
+    };
+}
+
+}
@@ -0,0 +1,519 @@
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/Log.h>
+#include <ripple/basics/strHex.h>
+#include <ripple/core/JobQueue.h>
+#include <ripple/ledger/ReadView.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/digest.h>
+#include <fstream>
+#include <iterator>
+
+namespace hook
+{
+
+uint32_t
+maxHookModuleCacheSize(void)
+{
+    return 1024U;
+}
+
+ModuleCache::ModuleCache(std::size_t capacity)
+    : modules_(capacity)
+{
+}
+
+ModuleCache&
+ModuleCache::instance()
+{
+    static ModuleCache cache { maxHookModuleCacheSize() };
+    return cache;
+}
+
+ModuleCache::Module
+ModuleCache::load(const void* wasm, size_t len, beast::Journal const& j)
+{
+    WasmEdge_ConfigureContext* confCtx = WasmEdge_ConfigureCreate();
+    WasmEdge_LoaderContext* loadCtx = WasmEdge_LoaderCreate(confCtx);
+    WasmEdge_ValidatorContext* validCtx = WasmEdge_ValidatorCreate(confCtx);
+
+    WasmEdge_ASTModuleContext* astCtx = NULL;
+
+    WasmEdge_Result res =
+        WasmEdge_LoaderParseFromBuffer(
+            loadCtx, &astCtx, reinterpret_cast<const uint8_t*>(wasm), (uint32_t)len);
+
+    if (!WasmEdge_ResultOK(res))
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache parse failed " << WasmEdge_ResultGetMessage(res);
+        astCtx = NULL;
+    }
+    else
+    {
+        res = WasmEdge_ValidatorValidate(validCtx, astCtx);
+        if (!WasmEdge_ResultOK(res))
+        {
+            JLOG(j.warn())
+                << "HookError: ModuleCache validate failed " << WasmEdge_ResultGetMessage(res);
+            WasmEdge_ASTModuleDelete(astCtx);
+            astCtx = NULL;
+        }
+    }
+
+    WasmEdge_ValidatorDelete(validCtx);
+    WasmEdge_LoaderDelete(loadCtx);
+    WasmEdge_ConfigureDelete(confCtx);
+
+    if (!astCtx)
+        return {};
+
+    return Module(astCtx, [](WasmEdge_ASTModuleContext const* ptr)
+    {
+        WasmEdge_ASTModuleDelete(const_cast<WasmEdge_ASTModuleContext*>(ptr));
+    });
+}
+
+namespace
+{
+
+// the digest of an artifact is kept next to it
+boost::filesystem::path
+digestFile(boost::filesystem::path const& file)
+{
+    return file.string() + ".digest";
+}
+
+std::optional<std::vector<uint8_t>>
+readFile(boost::filesystem::path const& file)
+{
+    std::ifstream ifs(file.string(), std::ios::binary);
+    if (!ifs)
+        return std::nullopt;
+
+    std::vector<uint8_t> data {
+        std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>() };
+    if (ifs.bad())
+        return std::nullopt;
+
+    return data;
+}
+
+bool
+writeFile(boost::filesystem::path const& file, void const* data, std::size_t size)
+{
+    std::ofstream ofs(file.string(), std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(data), size);
+    return static_cast<bool>(ofs);
+}
+
+}
+
+ripple::uint256
+ModuleCache::nativeDigest(ripple::uint256 const& hookHash, std::vector<uint8_t> const& artifact)
+{
+    return ripple::sha512Half(hookHash, ripple::Slice(artifact.data(), artifact.size()));
+}
+
+ModuleCache::Module
+ModuleCache::loadNative(
+    boost::filesystem::path const& file,
+    ripple::uint256 const& hookHash,
+    beast::Journal const& j)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(file, ec))
+        return {};
+
+    // loading a shared library runs code from it, so it is checked to be the one compiled from
+    // this hook first. this catches truncated, corrupted and misplaced artifacts, it is no defence
+    // against someone able to write to aot_path
+    {
+        auto const artifact = readFile(file);
+        auto const digest = readFile(digestFile(file));
+        if (!artifact || !digest || digest->size() != ripple::uint256::size() ||
+            ripple::uint256::fromVoid(digest->data()) != nativeDigest(hookHash, *artifact))
+        {
+            JLOG(j.warn())
+                << "HookError: ModuleCache native artifact " << file.string()
+                << " does not match its digest, discarding it";
+            boost::filesystem::remove(file, ec);
+            boost::filesystem::remove(digestFile(file), ec);
+            return {};
+        }
+    }
+
+    WasmEdge_ConfigureContext* confCtx = WasmEdge_ConfigureCreate();
+    WasmEdge_LoaderContext* loadCtx = WasmEdge_LoaderCreate(confCtx);
+    WasmEdge_ValidatorContext* validCtx = WasmEdge_ValidatorCreate(confCtx);
+
+    WasmEdge_ASTModuleContext* astCtx = NULL;
+
+    // the loader recognises a native shared library and binds the compiled code to the module
+    WasmEdge_Result res = WasmEdge_LoaderParseFromFile(loadCtx, &astCtx, file.string().c_str());
+
+    if (!WasmEdge_ResultOK(res))
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache native load failed " << file.string() << " "
+            << WasmEdge_ResultGetMessage(res);
+        astCtx = NULL;
+    }
+    else if (res = WasmEdge_ValidatorValidate(validCtx, astCtx); !WasmEdge_ResultOK(res))
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache native validate failed " << file.string() << " "
+            << WasmEdge_ResultGetMessage(res);
+        WasmEdge_ASTModuleDelete(astCtx);
+        astCtx = NULL;
+    }
+
+    WasmEdge_ValidatorDelete(validCtx);
+    WasmEdge_LoaderDelete(loadCtx);
+    WasmEdge_ConfigureDelete(confCtx);
+
+    if (!astCtx)
+    {
+        // an unusable artifact would fail on every start, remove it so the next compile can
+        // replace it
+        boost::filesystem::remove(file, ec);
+        boost::filesystem::remove(digestFile(file), ec);
+        return {};
+    }
+
+    return Module(astCtx, [](WasmEdge_ASTModuleContext const* ptr)
+    {
+        WasmEdge_ASTModuleDelete(const_cast<WasmEdge_ASTModuleContext*>(ptr));
+    });
+}
+
+bool
+ModuleCache::compile(
+    std::vector<uint8_t> const& wasm,
+    ripple::uint256 const& hookHash,
+    boost::filesystem::path const& file,
+    beast::Journal const& j)
+{
+    boost::system::error_code ec;
+    boost::filesystem::path const in  = file.string() + ".wasm.tmp";
+    boost::filesystem::path const out = file.string() + ".tmp";
+
+    if (!writeFile(in, wasm.data(), wasm.size()))
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache could not write " << in.string();
+        boost::filesystem::remove(in, ec);
+        return false;
+    }
+
+    WasmEdge_ConfigureContext* confCtx = WasmEdge_ConfigureCreate();
+    WasmEdge_ConfigureCompilerSetOptimizationLevel(confCtx, WasmEdge_CompilerOptimizationLevel_O2);
+    WasmEdge_ConfigureCompilerSetOutputFormat(confCtx, WasmEdge_CompilerOutputFormat_Native);
+
+    // the compiled code must count exactly what the interpreter counts, otherwise the
+    // instruction count (and fee) of a hook would depend on which tier happened to run it
+    WasmEdge_ConfigureCompilerSetInstructionCounting(confCtx, true);
+    WasmEdge_ConfigureCompilerSetCostMeasuring(confCtx, true);
+
+    WasmEdge_CompilerContext* compilerCtx = WasmEdge_CompilerCreate(confCtx);
+
+    // a WasmEdge built without the compiler has none to create
+    WasmEdge_Result res = compilerCtx
+        ? WasmEdge_CompilerCompile(compilerCtx, in.string().c_str(), out.string().c_str())
+        : WasmEdge_Result_Fail;
+
+    if (compilerCtx)
+        WasmEdge_CompilerDelete(compilerCtx);
+    WasmEdge_ConfigureDelete(confCtx);
+
+    boost::filesystem::remove(in, ec);
+
+    if (!WasmEdge_ResultOK(res))
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache native compile failed " << WasmEdge_ResultGetMessage(res);
+        boost::filesystem::remove(out, ec);
+        return false;
+    }
+
+    // the digest is in place before the artifact, an artifact without a matching one is discarded
+    auto const artifact = readFile(out);
+    if (!artifact)
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache could not read " << out.string();
+        boost::filesystem::remove(out, ec);
+        return false;
+    }
+
+    auto const digest = nativeDigest(hookHash, *artifact);
+    boost::filesystem::path const digestOut = digestFile(out);
+    bool written = writeFile(digestOut, digest.data(), digest.size());
+    if (written)
+    {
+        boost::filesystem::rename(digestOut, digestFile(file), ec);
+        written = !ec;
+    }
+
+    if (!written)
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache could not write the digest of " << file.string();
+        boost::filesystem::remove(digestOut, ec);
+        boost::filesystem::remove(out, ec);
+        return false;
+    }
+
+    // rename so a crash mid-compile never leaves a partial artifact under the final name
+    boost::filesystem::rename(out, file, ec);
+    if (ec)
+    {
+        JLOG(j.warn())
+            << "HookError: ModuleCache could not move artifact into place " << ec.message();
+        boost::filesystem::remove(out, ec);
+        return false;
+    }
+
+    return true;
+}
+
+boost::filesystem::path
+ModuleCache::nativeFile(ripple::uint256 const& hookHash) const
+{
+    // the runtime version is part of the name, artifacts from another WasmEdge are never loaded
+    return nativePath_ /
+        (ripple::strHex(hookHash) + "-" + WasmEdge_VersionGet() + ".so");
+}
+
+void
+ModuleCache::setupNative(
+    ripple::Section const& section,
+    std::string const& databasePath,
+    beast::Journal const& j)
+{
+    bool aot = false;
+    ripple::get_if_exists(section, "aot", aot);
+    if (!aot)
+    {
+        std::lock_guard lock(mutex_);
+        nativePath_.clear();
+        nativeEnabled_ = false;
+        pending_.clear();
+        modules_.forEach([](ripple::uint256 const&, Modules& modules)
+        {
+            modules.native.reset();
+        });
+        native_ = 0;
+        return;
+    }
+
+    boost::filesystem::path path =
+        ripple::get<std::string>(section, "aot_path", databasePath + "/hook_aot");
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(path, ec);
+    if (ec)
+    {
+        JLOG(j.warn())
+            << "Hook native compilation disabled, cannot create " << path.string()
+            << ": " << ec.message();
+        return;
+    }
+
+    JLOG(j.info()) << "Hook native compilation enabled, artifacts in " << path.string();
+
+    std::lock_guard lock(mutex_);
+    nativePath_ = path;
+    nativeEnabled_ = true;
+    modules_.forEach([this](ripple::uint256 const& hookHash, Modules const& modules)
+    {
+        if (!modules.native)
+            pending_.emplace(hookHash);
+    });
+}
+
+bool
+ModuleCache::nativeEnabled() const
+{
+    return nativeEnabled_.load(std::memory_order_relaxed);
+}
+
+ModuleCache::Modules
+ModuleCache::fetch(
+    ripple::uint256 const& hookHash,
+    const void* wasm,
+    size_t len,
+    beast::Journal const& j)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (auto const cached = modules_.find(hookHash))
+            return *cached;
+    }
+
+    // loading happens outside the lock, two threads missing on the same hash at the same time
+    // will both load it and the second insert is discarded
+    Modules modules { load(wasm, len, j), {} };
+    if (!modules.interpreted)
+    {
+        ++failures_;
+        return {};
+    }
+
+    std::lock_guard lock(mutex_);
+    auto const [cached, inserted] = modules_.insert(hookHash, modules,
+        [this](ripple::uint256 const& evicted, Modules const& evictedModules)
+        {
+            if (evictedModules.native)
+                --native_;
+            pending_.erase(evicted);
+        });
+
+    // native code, compiled now or by an earlier run, is attached by the next compile job
+    if (inserted && !nativePath_.empty() && !rejected_.count(hookHash))
+        pending_.emplace(hookHash);
+
+    return cached;
+}
+
+void
+ModuleCache::compilePending(
+    std::shared_ptr<ripple::ReadView const> const& ledger,
+    ripple::JobQueue& jobQueue,
+    beast::Journal const& j)
+{
+    if (!nativeEnabled())
+        return;
+
+    std::set<ripple::uint256> hookHashes;
+    {
+        std::lock_guard lock(mutex_);
+        if (nativePath_.empty() || jobQueued_ || pending_.empty())
+            return;
+
+        hookHashes.swap(pending_);
+        jobQueued_ = true;
+    }
+
+    bool const queued = jobQueue.addJob(
+        ripple::jtHOOK_COMPILE,
+        "hookCompile",
+        [this, ledger, hookHashes, j]()
+        {
+            buildNative(ledger, hookHashes, j);
+        });
+
+    if (!queued)
+    {
+        std::lock_guard lock(mutex_);
+        pending_.insert(hookHashes.begin(), hookHashes.end());
+        jobQueued_ = false;
+    }
+}
+
+void
+ModuleCache::buildNative(
+    std::shared_ptr<ripple::ReadView const> const& ledger,
+    std::set<ripple::uint256> const& hookHashes,
+    beast::Journal const& j)
+{
+    for (auto const& hookHash : hookHashes)
+    {
+        boost::filesystem::path file;
+        bool wanted = false;
+        {
+            std::lock_guard lock(mutex_);
+            if (auto const modules = modules_.peek(hookHash))
+                wanted = !modules->native && !rejected_.count(hookHash);
+            if (!nativePath_.empty())
+                file = nativeFile(hookHash);
+        }
+
+        // evicted, demoted or the tier was disabled meanwhile
+        if (!wanted || file.empty())
+            continue;
+
+        auto const def = ledger->read(ripple::keylet::hookDefinition(hookHash));
+        if (!def)
+        {
+            // executed on an open ledger only so far
+            std::lock_guard lock(mutex_);
+            if (modules_.peek(hookHash))
+                pending_.emplace(hookHash);
+            continue;
+        }
+
+        // an artifact compiled by an earlier run of this server is used as it is
+        Module native = loadNative(file, hookHash, j);
+        if (!native)
+        {
+            auto const& code = def->getFieldVL(ripple::sfCreateCode);
+            if (compile(code, hookHash, file, j))
+                native = loadNative(file, hookHash, j);
+        }
+
+        std::lock_guard lock(mutex_);
+        if (!native)
+        {
+            ++compileFailures_;
+            continue;
+        }
+
+        if (auto const modules = modules_.peek(hookHash); modules && !modules->native &&
+            !rejected_.count(hookHash) && !nativePath_.empty())
+        {
+            modules->native = native;
+            ++native_;
+        }
+
+        JLOG(j.debug())
+            << "HookInfo: ModuleCache compiled " << hookHash << " to native code";
+    }
+
+    std::lock_guard lock(mutex_);
+    jobQueued_ = false;
+}
+
+void
+ModuleCache::demoteNative(ripple::uint256 const& hookHash)
+{
+    std::lock_guard lock(mutex_);
+    rejected_.emplace(hookHash);
+    if (auto const modules = modules_.peek(hookHash); modules && modules->native)
+    {
+        modules->native.reset();
+        --native_;
+    }
+
+    pending_.erase(hookHash);
+
+    if (!nativePath_.empty())
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove(nativeFile(hookHash), ec);
+        boost::filesystem::remove(digestFile(nativeFile(hookHash)), ec);
+    }
+}
+
+std::size_t
+ModuleCache::size() const
+{
+    std::lock_guard lock(mutex_);
+    return modules_.size();
+}
+
+ModuleCache::Counts
+ModuleCache::getCounts() const
+{
+    return Counts {
+        .hits = modules_.hits(),
+        .misses = modules_.misses(),
+        .evictions = modules_.evictions(),
+        .failures = failures_.load(),
+        .size = size(),
+        .native = native_.load(),
+        .compileFailures = compileFailures_.load()
+    };
+}
+
+}
@@ -0,0 +1,168 @@
+#include <ripple/app/hook/WeakChainScheduler.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/Log.h>
+#include <algorithm>
+
+namespace hook
+{
+
+bool
+WeakChainScheduler::Batch::work()
+{
+    std::size_t const i = next.fetch_add(1);
+    if (i >= size)
+        return false;
+
+    try
+    {
+        task(i);
+    }
+    catch (...)
+    {
+        failed = true;
+    }
+
+    if (done.fetch_add(1) + 1 == size)
+    {
+        std::lock_guard lock(mutex);
+        finished.notify_all();
+    }
+    return true;
+}
+
+WeakChainScheduler::~WeakChainScheduler()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_)
+        t.join();
+}
+
+WeakChainScheduler&
+WeakChainScheduler::instance()
+{
+    static WeakChainScheduler scheduler;
+    return scheduler;
+}
+
+void
+WeakChainScheduler::setup(ripple::Section const& section, beast::Journal const& j)
+{
+    std::size_t threads = 0;
+    ripple::get_if_exists(section, "parallel_weak_chains", threads);
+    if (threads == 0)
+    {
+        enabled_ = false;
+        return;
+    }
+
+    JLOG(j.info()) << "Weak hook chains run on " << threads << " worker threads";
+    start(threads);
+}
+
+void
+WeakChainScheduler::start(std::size_t n)
+{
+    std::lock_guard lock(mutex_);
+    if (n == 0 || stop_)
+        return;
+
+    if (threads_.empty())
+    {
+        threads_.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+            threads_.emplace_back(&WeakChainScheduler::worker, this);
+    }
+    enabled_ = true;
+}
+
+bool
+WeakChainScheduler::enabled() const
+{
+    return enabled_.load();
+}
+
+void
+WeakChainScheduler::worker()
+{
+    for (;;)
+    {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_)
+                return;
+            batch = queue_.front();
+        }
+
+        if (!batch->work())
+        {
+            // every task is taken, stop offering the batch to other workers
+            std::lock_guard lock(mutex_);
+            if (!queue_.empty() && queue_.front() == batch)
+                queue_.pop_front();
+        }
+    }
+}
+
+bool
+WeakChainScheduler::run(std::size_t n, std::function<void(std::size_t)> task)
+{
+    if (n == 0)
+        return true;
+
+    auto batch = std::make_shared<Batch>();
+    batch->task = std::move(task);
+    batch->size = n;
+
+    ++batches_;
+
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back(batch);
+    }
+    wake_.notify_all();
+
+    while (batch->work())
+        ;
+
+    {
+        std::lock_guard lock(mutex_);
+        auto const it = std::find(queue_.begin(), queue_.end(), batch);
+        if (it != queue_.end())
+            queue_.erase(it);
+    }
+
+    {
+        std::unique_lock lock(batch->mutex);
+        batch->finished.wait(lock, [&] { return batch->done.load() == n; });
+    }
+
+    // workers may still hold the batch but never call the task again, anything it captured
+    // by reference can go out of scope
+    return !batch->failed;
+}
+
+void
+WeakChainScheduler::noteFallback()
+{
+    ++fallbacks_;
+}
+
+uint64_t
+WeakChainScheduler::batches() const
+{
+    return batches_.load(std::memory_order_relaxed);
+}
+
+uint64_t
+WeakChainScheduler::fallbacks() const
+{
+    return fallbacks_.load(std::memory_order_relaxed);
+}
+
+}
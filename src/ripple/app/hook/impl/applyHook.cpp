@@ -1,4 +1,6 @@
 #include <ripple/app/hook/applyHook.h>
+#include <ripple/app/hook/HookTrace.h>
+#include <ripple/app/hook/XFL.h>
 #include <ripple/basics/Log.h>
 #include <ripple/basics/Slice.h>
 #include <ripple/app/misc/Transaction.h>
@@ -16,7 +18,6 @@
 #include <utility>
 #include <wasmedge/wasmedge.h>
 #include <ripple/protocol/tokens.h>
-#include <boost/multiprecision/cpp_dec_float.hpp>
 
 using namespace ripple;
 
@@ -293,234 +294,22 @@ namespace hook
 
 }
 
-namespace hook_float
+using namespace hook_api;
+using namespace hook_float;
+// the slot's current object serialized, which is computed once rather than on every slot or slot_size call
+inline
+Blob const&
+slot_serialized(hook::SlotEntry& slot)
 {
-
-    // power of 10 LUT for fast integer math
-    static int64_t power_of_ten[19] =
-    {
-        1LL,
-        10LL,
-        100LL,
-        1000LL,
-        10000LL,
-        100000LL,
-        1000000LL,
-        10000000LL,
-        100000000LL,
-        1000000000LL,
-        10000000000LL,
-        100000000000LL,
-        1000000000000LL,
-        10000000000000LL,
-        100000000000000LL,
-        1000000000000000LL,  // 15
-        10000000000000000LL,
-        100000000000000000LL,
-        1000000000000000000LL,
-    };
-
-    using namespace hook_api;
-    static int64_t const minMantissa = 1000000000000000ull;
-    static int64_t const maxMantissa = 9999999999999999ull;
-    static int32_t const minExponent = -96;
-    static int32_t const maxExponent = 80;
-    inline int32_t get_exponent(int64_t float1)
-    {
-        if (float1 < 0)
-            return INVALID_FLOAT;
-        if (float1 == 0)
-            return 0;
-        if (float1 < 0) return INVALID_FLOAT;
-        uint64_t float_in = (uint64_t)float1;
-        float_in >>= 54U;
-        float_in &= 0xFFU;
-        return ((int32_t)float_in) - 97;
-    }
-
-    inline int64_t get_mantissa(int64_t float1)
-    {
-        if (float1 < 0)
-            return INVALID_FLOAT;
-        if (float1 == 0)
-            return 0;
-        if (float1 < 0) return INVALID_FLOAT;
-        float1 -= ((((uint64_t)float1) >> 54U) << 54U);
-        return float1;
-    }
-
-    inline bool is_negative(int64_t float1)
-    {
-        return ((float1 >> 62U) & 1ULL) == 0;
-    }
-
-    inline int64_t invert_sign(int64_t float1)
-    {
-        int64_t r = (int64_t)(((uint64_t)float1) ^ (1ULL<<62U));
-        return r;
-    }
-
-    inline int64_t set_sign(int64_t float1, bool set_negative)
-    {
-        bool neg = is_negative(float1);
-        if ((neg && set_negative) || (!neg && !set_negative))
-            return float1;
-
-        return invert_sign(float1);
-    }
-
-    inline int64_t set_mantissa(int64_t float1, uint64_t mantissa)
-    {
-        if (mantissa > maxMantissa)
-            return MANTISSA_OVERSIZED;
-        if (mantissa < minMantissa)
-            return MANTISSA_UNDERSIZED;
-        return float1 - get_mantissa(float1) + mantissa;
-    }
-
-    inline int64_t set_exponent(int64_t float1, int32_t exponent)
+    if (!slot.serialized)
     {
-        if (exponent > maxExponent)
-            return EXPONENT_OVERSIZED;
-        if (exponent < minExponent)
-            return EXPONENT_UNDERSIZED;
-
-        uint64_t exp = (exponent + 97);
-        exp <<= 54U;
-        float1 &= ~(0xFFLL<<54);
-        float1 += (int64_t)exp;
-        return float1;
-    }
-
-    inline int64_t make_float(ripple::IOUAmount& amt)
-    {
-        int64_t man_out = amt.mantissa();
-        int64_t float_out = 0;
-        bool neg = man_out < 0;
-        if (neg)
-            man_out *= -1;
-
-        float_out = set_sign(float_out, neg);
-        float_out = set_mantissa(float_out, (uint64_t)man_out);
-        float_out = set_exponent(float_out, amt.exponent());
-        return float_out;
-    }
-
-    inline int64_t make_float(uint64_t mantissa, int32_t exponent, bool neg)
-    {
-        if (mantissa == 0)
-            return 0;
-        if (mantissa > maxMantissa)
-            return MANTISSA_OVERSIZED;
-        if (mantissa < minMantissa)
-            return MANTISSA_UNDERSIZED;
-        if (exponent > maxExponent)
-            return EXPONENT_OVERSIZED;
-        if (exponent < minExponent)
-            return EXPONENT_UNDERSIZED;
-        int64_t out =  0;
-        out = set_mantissa(out, mantissa);
-        out = set_exponent(out, exponent);
-        out = set_sign(out, neg);
-        return out;
-    }
-
-    /**
-     * This function normalizes the mantissa and exponent passed, if it can.
-     * It returns the XFL and mutates the supplied manitssa and exponent.
-     * If a negative mantissa is provided then the returned XFL has the negative flag set.
-     * If there is an overflow error return XFL_OVERFLOW. On underflow returns canonical 0
-     */
-    template <typename T>
-    inline int64_t normalize_xfl(T& man, int32_t& exp, bool neg = false)
-    {
-
-        constexpr bool sman = std::is_same<T, int64_t>::value;
-        static_assert(sman || std::is_same<T, uint64_t>());
-
-        if constexpr(sman)
-        {
-            if (man < 0)
-            {
-                man *= -1LL;
-                neg = true;
-            }
-        }
-
-        // mantissa order
-        int32_t mo = log10(man);
-        int32_t adjust = 15 - mo;
-
-        if (adjust > 0)
-        {
-            man *= power_of_ten[adjust];
-            exp -= adjust;
-        }
-        else if (adjust < 0)
-        {
-            man /= power_of_ten[-adjust];
-            exp -= adjust;
-        }
-
-        if (man == 0)
-        {
-            exp = 0;
-            return 0;
-        }
-
-        // even after adjustment the mantissa can be outside the range by one place
-        // improving the math above would probably alleviate the need for these branches
-        if (man < minMantissa)
-        {
-            if (man == minMantissa - 1LL)
-                man += 1LL;
-            else
-            {
-                man *= 10LL;
-                exp--;
-            }
-        }
-
-        if (man > maxMantissa)
-        {
-            if (man == maxMantissa + 1LL)
-                man -= 1LL;
-            else
-            {
-                man /= 10LL;
-                exp++;
-            }
-        }
-
-        if (exp < minExponent)
-        {
-            man = 0;
-            exp = 0;
-            return 0;
-        }
-        
-        if (man == 0)
-        {
-            exp = 0;
-            return 0;
-        }
-
-        if (exp > maxExponent)
-            return XFL_OVERFLOW;
-
-        int64_t ret = make_float((uint64_t)man, exp, neg);
-        if constexpr(sman)
-        {
-            if (neg)
-                man *= -1LL;
-        }
-
-        return ret;
-    
+        Serializer s;
+        slot.entry->add(s);
+        slot.serialized = s.getData();
     }
-    
+    return *slot.serialized;
 }
-using namespace hook_float;
+
 inline
 int32_t
 no_free_slots(hook::HookContext& hookCtx)
@@ -652,6 +441,13 @@ uint32_t hook::maxHookStateDataSize(void) {
     return 256U;
 }
 
+// total number of ledger state entries one state map may read ahead, this bounds the ledger reads
+// a single state_prefetch call (or the automatic prefetch) can cause
+uint32_t hook::maxHookStatePrefetchCount(void)
+{
+    return 256U;
+}
+
 uint32_t hook::maxHookWasmSize(void)
 {
     return 0xFFFFU;
@@ -681,6 +477,32 @@ int64_t hook::computeExecutionFee(uint64_t instructionCount)
     return fee;
 }
 
+std::vector<uint64_t> const*
+hook::executionCostTable(ripple::Rules const& rules)
+{
+    if (!rules.enabled(featureHookFuel))
+        return nullptr;
+
+    // WasmEdge reads every entry of a table it is given and charges nothing for entries missing
+    // from a short one, so all 65536 are filled
+    static std::vector<uint64_t> const table = []()
+    {
+        std::vector<uint64_t> table(0x10000U, 1);
+        for (uint32_t opcode = 0; opcode < 0x100U; ++opcode)
+            table[opcode] = hook_api::instruction_fuel(opcode);
+
+        // a prefixed instruction's own opcode is added to its prefix, vector opcodes run past 0xFF
+        for (uint32_t opcode = 0; opcode < 0x100U; ++opcode)
+            table[0xFC00U + opcode] = hook_api::instruction_fuel(0xFCU);
+        for (uint32_t opcode = 0; opcode < 0x200U; ++opcode)
+            table[0xFD00U + opcode] = hook_api::instruction_fuel(0xFDU);
+
+        return table;
+    }();
+
+    return &table;
+}
+
 int64_t hook::computeCreationFee(uint64_t byteCount)
 {
     int64_t fee = ((int64_t)byteCount) * 500ULL;
@@ -960,7 +782,7 @@ hook::setHookState(
 hook::HookResult
 hook::apply(
     ripple::uint256 const& hookSetTxnID, /* this is the txid of the sethook, used for caching (one day) */
-    ripple::uint256 const& hookHash,     /* hash of the actual hook byte code, used for metadata */
+    ripple::uint256 const& hookHash,     /* hash of the actual hook byte code, used for metadata and module caching */
     ripple::uint256 const& hookNamespace,
     ripple::Blob const& wasm,
     std::map<
@@ -981,12 +803,17 @@ hook::apply(
     bool isStrong,
     uint32_t wasmParam,
     uint8_t hookChainPosition,
+    std::optional<uint64_t> fuel,
     std::shared_ptr<STObject const> const& provisionalMeta)
 {
+    // the hook phase of the transaction normally has one open already, this covers callers which
+    // don't, e.g. parallel weak chains on other threads. It must outlive hookCtx.
+    HookArena::Scope arenaScope;
 
     HookContext hookCtx =
     {
         .applyCtx = applyCtx,
+        .j = applyCtx.app.journal("View"),
         // we will return this context object (RVO / move constructed)
         .result = {
             .hookSetTxnID = hookSetTxnID,
@@ -1023,11 +850,23 @@ hook::apply(
     };
 
 
-    auto const& j = applyCtx.app.journal("View");
+    auto const& j = hookCtx.j;
 
     HookExecutor executor { hookCtx } ;
 
-    executor.executeWasm(wasm.data(), (size_t)wasm.size(), isCallback, wasmParam, j);
+    auto const start = std::chrono::steady_clock::now();
+
+    // with HookFuel a hook is metered against the fuel its definition was priced for. definitions
+    // set before it have none, their fee only covers the unweighted count, so only the guards bound them
+    if (!applyCtx.view().rules().enabled(featureHookFuel))
+        fuel.reset();
+
+    executor.executeWasm(hookHash, wasm.data(), (size_t)wasm.size(), isCallback, wasmParam, fuel, j);
+
+    HookStats::instance().record(
+        hookCtx.result,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
 
     JLOG(j.trace()) <<
         "HookInfo[" << HC_ACC() << "]: " <<
@@ -1047,6 +886,11 @@ DEFINE_HOOK_FUNCTION(
     HOOK_SETUP(); // populates memory_ctx, memory, memory_length, applyCtx on current stack
     if (NOT_IN_BOUNDS(read_ptr, read_len, memory_length))
         return OUT_OF_BOUNDS;
+
+    if (auto& traceLog = hook::HookTraceLog::instance(); traceLog.enabled())
+        traceLog.append(
+            hookCtx.result.hookHash, applyCtx.tx.getTransactionID(), hookCtx.result.account,
+            hook::HookTraceLog::Kind::number, Slice(memory + read_ptr, read_len), Slice(), number);
     
     if (!j.trace())
         return 0;
@@ -1081,6 +925,14 @@ DEFINE_HOOK_FUNCTION(
         NOT_IN_BOUNDS(dread_ptr, dread_len, memory_length))
         return OUT_OF_BOUNDS;
 
+    if (auto& traceLog = hook::HookTraceLog::instance(); traceLog.enabled())
+        traceLog.append(
+            hookCtx.result.hookHash, applyCtx.tx.getTransactionID(), hookCtx.result.account,
+            as_hex ? hook::HookTraceLog::Kind::hex :
+            is_UTF16LE(memory + dread_ptr, dread_len) ? hook::HookTraceLog::Kind::utf16 :
+                hook::HookTraceLog::Kind::text,
+            Slice(memory + mread_ptr, mread_len), Slice(memory + dread_ptr, dread_len), 0);
+
     if (!j.trace())
         return 0;
 
@@ -1174,31 +1026,84 @@ make_state_key(
 
 // check the state cache
 inline
-std::optional<std::reference_wrapper<std::pair<bool, ripple::Blob> const>>
+hook::HookStateMap::Entry const*
 lookup_state_cache(
         hook::HookContext& hookCtx,
         ripple::AccountID const& acc,
         ripple::uint256 const& ns,
         ripple::uint256 const& key)
+{
+    return hookCtx.result.stateMap.find(acc, ns, key);
+}
+
+
+// misses in one namespace after which the rest of it is read ahead, if it fits one directory page
+static constexpr uint32_t statePrefetchAfterMisses = 4;
+
+// read the hook state of a namespace into the prefetch table of the state map in one walk of its
+// directory, returns the number of entries read. Every namespace is walked at most once per state
+// map. The view's hook state only changes in finalizeHookState, so the values stay valid for the
+// life of the map.
+inline
+int64_t
+prefetch_state(
+        hook::HookContext& hookCtx,
+        ripple::AccountID const& acc,
+        ripple::uint256 const& ns,
+        bool singlePageOnly)
 {
     auto& stateMap = hookCtx.result.stateMap;
-    if (stateMap.find(acc) == stateMap.end())
-        return std::nullopt;
+    auto& status = stateMap.prefetchStatus(acc, ns);
+    if (status.attempted)
+        return 0;
 
-    auto& stateMapAcc = stateMap[acc].second;
-    if (stateMapAcc.find(ns) == stateMapAcc.end())
-        return std::nullopt;
+    auto& view = hookCtx.applyCtx.view();
+    auto const dirKeylet = ripple::keylet::hookStateDir(acc, ns);
 
-    auto& stateMapNs = stateMapAcc[ns];
+    auto page = view.read(dirKeylet);
+    if (page && singlePageOnly && page->getFieldU64(sfIndexNext) != 0)
+        return 0;
 
-    auto const& ret = stateMapNs.find(key);
+    status.attempted = true;
 
-    if (ret == stateMapNs.end())
-        return std::nullopt;
-    
-    return std::cref(ret->second);
-}
+    // no directory means no state at all in this namespace
+    if (!page)
+    {
+        status.complete = true;
+        return 0;
+    }
+
+    int64_t count = 0;
+    for (;;)
+    {
+        for (auto const& index : page->getFieldV256(sfIndexes))
+        {
+            if (stateMap.prefetchedSize() >= hook::maxHookStatePrefetchCount())
+                return count;
+
+            auto const sle = view.read(ripple::Keylet { ltHOOK_STATE, index });
+            if (!sle)
+                return count;
+
+            auto const& data = sle->getFieldVL(sfHookStateData);
+            stateMap.insertPrefetched(
+                acc, ns, sle->getFieldH256(sfHookStateKey),
+                ripple::Slice(data.data(), data.size()));
+            ++count;
+        }
+
+        auto const next = page->getFieldU64(sfIndexNext);
+        if (next == 0)
+            break;
+
+        page = view.read(ripple::keylet::page(dirKeylet, next));
+        if (!page)
+            return count;
+    }
 
+    status.complete = true;
+    return count;
+}
 
 // update the state cache
 inline
@@ -1208,7 +1113,7 @@ set_state_cache(
         ripple::AccountID const& acc,
         ripple::uint256 const& ns,
         ripple::uint256 const& key,
-        ripple::Blob& data,
+        ripple::Slice const& data,
         bool modified)
 {
     auto& stateMap = hookCtx.result.stateMap;
@@ -1216,7 +1121,8 @@ set_state_cache(
     if (modified && stateMap.modified_entry_count > max_state_modifications)
         return TOO_MANY_STATE_MODIFICATIONS;
 
-    if (stateMap.find(acc) == stateMap.end())
+    int64_t* availableForReserves = stateMap.findAccount(acc);
+    if (!availableForReserves)
     {
 
         // if this is the first time this account has been interacted with
@@ -1229,7 +1135,7 @@ set_state_cache(
 
         STAmount bal = accSLE->getFieldAmount(sfBalance);
 
-        int64_t availableForReserves =
+        int64_t available =
             bal.xrp().drops() - fees.accountReserve(accSLE->getFieldU32(sfOwnerCount)).drops();
 
         int64_t increment = fees.increment.drops();
@@ -1237,86 +1143,65 @@ set_state_cache(
         if (increment <= 0)
             increment = 1;
 
-        availableForReserves /= increment;
+        available /= increment;
 
-        if (availableForReserves < 1 && modified)
+        if (available < 1 && modified)
             return RESERVE_INSUFFICIENT;
 
         stateMap.modified_entry_count++;
-        
-        stateMap[acc] =
-        {
-            availableForReserves - 1,
-            {
-                {
-                    ns,
-                    {
-                        {
-                            key,
-                            {
-                               modified,
-                               data
-                            }
-                        }
-                    }
-                }
-            }
-        };
+
+        stateMap.insertAccount(acc, available - 1);
+        stateMap.insertNamespace(acc, ns);
+        stateMap.insert(acc, ns, key, modified, data);
         return 1;
     }
 
-    auto& stateMapAcc = stateMap[acc].second;
-    auto& availableForReserves = stateMap[acc].first;
-    bool const canReserveNew = 
-        availableForReserves > 0;
+    bool const canReserveNew =
+        *availableForReserves > 0;
 
-    if (stateMapAcc.find(ns) == stateMapAcc.end())
+    if (!stateMap.hasNamespace(acc, ns))
     {
         if (modified)
-        {   
+        {
             if (!canReserveNew)
                 return RESERVE_INSUFFICIENT;
 
-            availableForReserves--;
+            (*availableForReserves)--;
             stateMap.modified_entry_count++;
         }
 
-        stateMapAcc[ns] =
-        {
-            { key,
-                       { modified, data }
-            }
-        };
+        stateMap.insertNamespace(acc, ns);
+        stateMap.insert(acc, ns, key, modified, data);
 
         return 1;
     }
 
-    auto& stateMapNs = stateMapAcc[ns];
-    if (stateMapNs.find(key) == stateMapNs.end())
+    auto* entry = stateMap.find(acc, ns, key);
+    if (!entry)
     {
         if (modified)
-        {   
+        {
             if (!canReserveNew)
                 return RESERVE_INSUFFICIENT;
-            availableForReserves--;
+            (*availableForReserves)--;
             stateMap.modified_entry_count++;
         }
 
-        stateMapNs[key] = { modified, data };
+        stateMap.insert(acc, ns, key, modified, data);
         hookCtx.result.changedStateCount++;
         return 1;
     }
 
     if (modified)
     {
-        if (!stateMapNs[key].first)
+        if (!entry->modified)
             hookCtx.result.changedStateCount++;
 
         stateMap.modified_entry_count++;
-        stateMapNs[key].first = true;
+        entry->modified = true;
     }
 
-    stateMapNs[key].second = data;
+    entry->assign(data);
     return 1;
 }
 
@@ -1402,7 +1287,7 @@ DEFINE_HOOK_FUNCTION(
     auto const key =
         make_state_key( std::string_view { (const char*)(memory + kread_ptr), (size_t)kread_len } );
 
-    ripple::Blob data {memory + read_ptr,  memory + read_ptr + read_len};
+    ripple::Slice data {memory + read_ptr, read_len};
 
     // local modifications are always allowed
     if (aread_len == 0 || acc == hookCtx.result.account)
@@ -1419,7 +1304,7 @@ DEFINE_HOOK_FUNCTION(
 
     // first check if we've already modified this state
     auto cacheEntry = lookup_state_cache(hookCtx, acc, ns, *key);
-    if (cacheEntry && cacheEntry->get().first)
+    if (cacheEntry && cacheEntry->modified)
     {
         // if a cache entry already exists and it has already been modified don't check grants again
         if (int64_t ret = set_state_cache(hookCtx, acc, ns, *key, data, true); ret < 0)
@@ -1519,46 +1404,40 @@ finalizeHookState(
     uint16_t changeCount = 0;
 
     // write all changes to state, if in "apply" mode
-    for (const auto& accEntry : stateMap)
+    // entries are written in account, namespace, key order
+    for (auto const& [entryKey, entry] : stateMap.ordered())
     {
-        const auto& acc = accEntry.first;
-        for (const auto& nsEntry : accEntry.second.second)
+        if (!entry->modified)
+            continue;
+
+        auto const& acc = entryKey->account;
+        auto const& ns = entryKey->ns;
+        auto const& key = entryKey->key;
+
+        changeCount++;
+        if (changeCount >= 0xFFFFU)      // RH TODO: limit the max number of state changes?
         {
-            const auto& ns = nsEntry.first;
-            for (const auto& cacheEntry : nsEntry.second)
-            {
-                bool is_modified = cacheEntry.second.first;
-                const auto& key = cacheEntry.first;
-                const auto& blob = cacheEntry.second.second;
-                if (is_modified)
-                {
-                    changeCount++;
-                    if (changeCount >= 0xFFFFU)      // RH TODO: limit the max number of state changes?
-                    {
-                        // overflow
-                        JLOG(j.warn()) 
-                            << "HooKError[TX:" << txnID << "]: SetHooKState failed: Too many state changes";
-                        return tecHOOK_REJECTED;
-                    }
+            // overflow
+            JLOG(j.warn())
+                << "HooKError[TX:" << txnID << "]: SetHooKState failed: Too many state changes";
+            return tecHOOK_REJECTED;
+        }
 
-                    // this entry isn't just cached, it was actually modified
-                    auto slice = Slice(blob.data(), blob.size());
+        // this entry isn't just cached, it was actually modified
+        auto slice = entry->data();
 
-                    TER result = 
-                        setHookState(applyCtx, acc, ns, key, slice);
+        TER result =
+            setHookState(applyCtx, acc, ns, key, slice);
 
-                    if (result != tesSUCCESS)
-                    {
-                        JLOG(j.warn())
-                            << "HookError[TX:" << txnID << "]: SetHookState failed: " << result
-                            << " Key: " << key 
-                            << " Value: " << slice;
-                        return result;
-                    }
-                    // ^ should not fail... checks were done before map insert
-                }
-            }
+        if (result != tesSUCCESS)
+        {
+            JLOG(j.warn())
+                << "HookError[TX:" << txnID << "]: SetHookState failed: " << result
+                << " Key: " << key
+                << " Value: " << slice;
+            return result;
         }
+        // ^ should not fail... checks were done before map insert
     }
     return tesSUCCESS;
 }
@@ -1631,6 +1510,7 @@ removeEmissionEntry(ripple::ApplyContext& applyCtx)
     }
 
     applyCtx.view().erase(sle);
+    applyCtx.app.getTxQ().emittedTxns().removed(tx.getTransactionID());
     return tesSUCCESS;
 }
 
@@ -1657,21 +1537,13 @@ finalizeHookResult(
     if (doEmit)
     {
         DBG_PRINTF("emitted txn count: %d\n", hookResult.emittedTxn.size());
-        for (; hookResult.emittedTxn.size() > 0; hookResult.emittedTxn.pop())
+        for (auto const& [id, ptr] : hookResult.emittedTxn)
         {
-            auto& tpTrans = hookResult.emittedTxn.front();
-            auto& id = tpTrans->getID();
             JLOG(j.trace())
                 << "HookEmit[" << HR_ACC() << "]: " << id;
 
             applyCtx.app.getHashRouter().setFlags(id, SF_EMITTED); 
 
-            std::shared_ptr<const ripple::STTx> ptr = tpTrans->getSTransaction();
-
-            ripple::Serializer s;
-            ptr->add(s);
-            SerialIter sit(s.slice());
-
             auto emittedId = keylet::emittedTxn(id);
             auto sleEmitted = applyCtx.view().peek(emittedId);
 
@@ -1679,9 +1551,14 @@ finalizeHookResult(
             {
                 ++emission_count;
                 sleEmitted = std::make_shared<SLE>(emittedId);
-                sleEmitted->emplace_back(
-                    ripple::STObject(sit, sfEmittedTxn)
-                );
+
+                // the fields of the parsed txn are copied in rather than serialized and parsed
+                // again, fields are sorted when the entry is serialized so the bytes are the same
+                ripple::STObject emitted {sfEmittedTxn};
+                for (auto const& field : *ptr)
+                    if (field.getSType() != STI_NOTPRESENT)
+                        emitted.emplace_back(field);
+                sleEmitted->emplace_back(std::move(emitted));
                 auto page = applyCtx.view().dirInsert(
                     keylet::emittedDir(),
                     emittedId,
@@ -1694,6 +1571,7 @@ finalizeHookResult(
                 {
                     (*sleEmitted)[sfOwnerNode] = *page;
                     applyCtx.view().insert(sleEmitted);
+                    applyCtx.app.getTxQ().emittedTxns().emitted(ptr);
                 }
                 else
                 {
@@ -1703,6 +1581,7 @@ finalizeHookResult(
                 }
             }
         }
+        hookResult.emittedTxn.clear();
     }
 
     // add a metadata entry for this hook execution result
@@ -1816,32 +1695,49 @@ DEFINE_HOOK_FUNCTION(
         return INVALID_ARGUMENT;
 
     // first check if the requested state was previously cached this session
-    auto cacheEntryLookup = lookup_state_cache(hookCtx, acc, ns, *key);
-    if (cacheEntryLookup)
+    auto cacheEntry = lookup_state_cache(hookCtx, acc, ns, *key);
+    if (cacheEntry)
     {
-        auto const& cacheEntry = cacheEntryLookup->get();
+        auto const cached = cacheEntry->data();
         if (write_ptr == 0)
-            return data_as_int64(cacheEntry.second.data(), cacheEntry.second.size());
+            return data_as_int64(cached.data(), cached.size());
 
-        if (cacheEntry.second.size() > write_len)
+        if (cached.size() > write_len)
             return TOO_SMALL;
 
         WRITE_WASM_MEMORY_AND_RETURN(
             write_ptr, write_len,
-            cacheEntry.second.data(), cacheEntry.second.size(),
+            cached.data(), cached.size(),
             memory, memory_length);
     }
 
-    auto hsSLE =
-        view.peek(keylet::hookState(acc, *key, ns));
+    // then the ledger values read ahead, repeated misses in a small namespace read all of it
+    auto& stateMap = hookCtx.result.stateMap;
+    auto& prefetchStatus = stateMap.prefetchStatus(acc, ns);
+    if (!prefetchStatus.attempted && ++prefetchStatus.misses == statePrefetchAfterMisses)
+        prefetch_state(hookCtx, acc, ns, true);
 
-    if (!hsSLE)
+    Blob b;
+    if (auto const prefetched = stateMap.findPrefetched(acc, ns, *key))
+    {
+        auto const data = prefetched->data();
+        b.assign(data.begin(), data.end());
+    }
+    else if (prefetchStatus.complete)
         return DOESNT_EXIST;
+    else
+    {
+        auto hsSLE =
+            view.peek(keylet::hookState(acc, *key, ns));
 
-    Blob b = hsSLE->getFieldVL(sfHookStateData);
+        if (!hsSLE)
+            return DOESNT_EXIST;
+
+        b = hsSLE->getFieldVL(sfHookStateData);
+    }
 
     // it exists add it to cache and return it
-    if (set_state_cache(hookCtx, acc, ns, *key, b, false) < 0)
+    if (set_state_cache(hookCtx, acc, ns, *key, ripple::Slice(b.data(), b.size()), false) < 0)
         return INTERNAL_ERROR; // should never happen
 
     if (write_ptr == 0)
@@ -1857,6 +1753,42 @@ DEFINE_HOOK_FUNCTION(
 }
 
 
+/* Read the state of a namespace (of this or a foreign account) ahead of use so that subsequent
+ * state and state_foreign calls on it are served from memory. Returns the number of entries read,
+ * 0 if the namespace was already read ahead or the prefetch limit has been reached.
+ * feeding aread_ptr = 0 and aread_len = 0 will prefetch local state
+ * feeding nread_len = 0 will cause hook's native namespace to be used */
+DEFINE_HOOK_FUNCTION(
+    int64_t,
+    state_prefetch,
+    uint32_t nread_ptr, uint32_t nread_len,         // namespace
+    uint32_t aread_ptr, uint32_t aread_len )        // account
+{
+    HOOK_SETUP(); // populates memory_ctx, memory, memory_length, applyCtx, hookCtx on current stack
+
+    if (nread_len != 0 && nread_len != 32)
+        return INVALID_ARGUMENT;
+
+    if (aread_len != 0 && aread_len != 20)
+        return INVALID_ARGUMENT;
+
+    if ((nread_len && NOT_IN_BOUNDS(nread_ptr, nread_len, memory_length)) ||
+        (aread_len && NOT_IN_BOUNDS(aread_ptr, aread_len, memory_length)))
+        return OUT_OF_BOUNDS;
+
+    uint256 ns =
+        nread_len == 0
+            ? hookCtx.result.hookNamespace
+            : ripple::base_uint<256>::fromVoid(memory + nread_ptr);
+
+    ripple::AccountID acc =
+        aread_len == 20
+            ? AccountID::fromVoid(memory + aread_ptr)
+            : hookCtx.result.account;
+
+    return prefetch_state(hookCtx, acc, ns, false);
+}
+
 // Cause the originating transaction to go through, save state changes and emit emitted tx, exit hook
 DEFINE_HOOK_FUNCTION(
     int64_t,
@@ -1937,12 +1869,14 @@ DEFINE_HOOK_FUNCTION(
         slot_into = get_free_slot(hookCtx);
 
 
-    auto const& st_tx =
-        std::make_shared<ripple::STObject>(
-            hookCtx.emitFailure
-                ? *(hookCtx.emitFailure)
-                : const_cast<ripple::STTx&>(applyCtx.tx).downcast<ripple::STObject>()
-        );
+    // both the originating txn and the emit failure outlive the hook execution and so every slot,
+    // the slot refers to the object rather than holding a copy of it
+    std::shared_ptr<const ripple::STObject> st_tx {
+        std::shared_ptr<void>{},
+        hookCtx.emitFailure
+            ? &*(hookCtx.emitFailure)
+            : static_cast<ripple::STObject const*>(&applyCtx.tx)
+    };
 
     auto const& txID =
         hookCtx.emitFailure
@@ -2148,20 +2082,19 @@ DEFINE_HOOK_FUNCTION(
     if (hookCtx.slot[slot_no].entry == 0)
         return INTERNAL_ERROR;
 
-    Serializer s;
-    hookCtx.slot[slot_no].entry->add(s);
+    Blob const& s = slot_serialized(hookCtx.slot[slot_no]);
 
     if (write_ptr == 0)
-        return data_as_int64(s.getDataPtr(), s.getDataLength());
+        return data_as_int64(s.data(), s.size());
 
     bool is_account = hookCtx.slot[slot_no].entry->getSType() == STI_ACCOUNT; //RH TODO improve this hack
 
-    if (s.getDataLength() - (is_account ? 1 : 0) > write_len)
+    if (s.size() - (is_account ? 1 : 0) > write_len)
         return TOO_SMALL;
 
     WRITE_WASM_MEMORY_AND_RETURN(
         write_ptr, write_len,
-        (unsigned char*)(s.getDataPtr()) + (is_account ? 1 : 0), s.getDataLength() - (is_account ? 1 : 0),
+        s.data() + (is_account ? 1 : 0), s.size() - (is_account ? 1 : 0),
         memory, memory_length);
 
 }
@@ -2277,10 +2210,7 @@ DEFINE_HOOK_FUNCTION(
     if (hookCtx.slot.find(slot_no) == hookCtx.slot.end())
         return DOESNT_EXIST;
 
-    //RH TODO: this is a very expensive way of computing size, cache it
-    Serializer s;
-    hookCtx.slot[slot_no].entry->add(s);
-    return s.getDataLength();
+    return slot_serialized(hookCtx.slot[slot_no]).size();
 }
 
 DEFINE_HOOK_FUNCTION(
@@ -2318,9 +2248,10 @@ DEFINE_HOOK_FUNCTION(
         if (new_slot != parent_slot)
         {
             copied = true;
-            hookCtx.slot[new_slot] = hookCtx.slot[parent_slot];
+            hookCtx.slot[new_slot] = hook::SlotEntry { .storage = hookCtx.slot[parent_slot].storage };
         }
         hookCtx.slot[new_slot].entry = &(parent_obj[array_id]);
+        hookCtx.slot[new_slot].serialized.reset();
         return new_slot;
     }
     catch (const std::bad_cast& e)
@@ -2372,10 +2303,11 @@ DEFINE_HOOK_FUNCTION(
         if (new_slot != parent_slot)
         {
             copied = true;
-            hookCtx.slot[new_slot] = hookCtx.slot[parent_slot];
+            hookCtx.slot[new_slot] = hook::SlotEntry { .storage = hookCtx.slot[parent_slot].storage };
         }
 
         hookCtx.slot[new_slot].entry = &(parent_obj.getField(fieldCode));
+        hookCtx.slot[new_slot].serialized.reset();
         return new_slot;
     }
     catch (const std::bad_cast& e)
@@ -2827,6 +2759,29 @@ DEFINE_HOOK_FUNCTION(
 }
 
 
+// the base fee of a transaction if it were emitted into the open ledger, negative if it cannot be
+// calculated. used by etxn_fee_base and by emit, which has already parsed the transaction
+inline
+int64_t
+emitted_fee_base(
+        ripple::ApplyContext& applyCtx,
+        ripple::STTx const& stx)
+{
+    try
+    {
+        FeeUnit64 fee =
+            Transactor::calculateBaseFee(
+                *(applyCtx.app.openLedger().current()),
+                stx);
+
+        return fee.fee();
+    }
+    catch (std::exception& e)
+    {
+        return hook_api::INVALID_TXN;
+    }
+}
+
 /* Emit a transaction from this hook. Transaction must be in STObject form, fully formed and valid.
  * XRPLD does not modify transactions it only checks them for validity. */
 DEFINE_HOOK_FUNCTION(
@@ -2845,19 +2800,16 @@ DEFINE_HOOK_FUNCTION(
     if (write_len < 32)
         return TOO_SMALL;
 
-    auto& app = hookCtx.applyCtx.app;
-
     if (hookCtx.expected_etxn_count < 0)
         return PREREQUISITE_NOT_MET;
 
     if (hookCtx.result.emittedTxn.size() >= hookCtx.expected_etxn_count)
         return TOO_MANY_EMITTED_TXN;
 
-    ripple::Blob blob{memory + read_ptr, memory + read_ptr + read_len};
-
     std::shared_ptr<STTx const> stpTrans;
     try
     {
+        // parsed straight out of wasm memory, this is the only copy made until the txn is committed
         stpTrans = std::make_shared<STTx const>(SerialIter { memory + read_ptr, read_len });
     }
     catch (std::exception& e)
@@ -3057,7 +3009,7 @@ DEFINE_HOOK_FUNCTION(
     }
 
     // rule 7 check the emitted txn pays the appropriate fee
-    int64_t minfee = etxn_fee_base(hookCtx, frameCtx, read_ptr, read_len);
+    int64_t minfee = emitted_fee_base(applyCtx, *stpTrans);
 
     if (minfee < 0)
     {
@@ -3081,15 +3033,6 @@ DEFINE_HOOK_FUNCTION(
         return EMISSION_FAILURE;
     }
 
-    std::string reason;
-    auto tpTrans = std::make_shared<Transaction>(stpTrans, reason, app);
-    if (tpTrans->getStatus() != NEW)
-    {
-        JLOG(j.trace())
-            << "HookEmit[" << HC_ACC() << "]: tpTrans->getStatus() != NEW";
-        return EMISSION_FAILURE;
-    }
-
     // preflight the transaction
     auto preflightResult = 
         ripple::preflight(applyCtx.app, applyCtx.view().rules(), *stpTrans, ripple::ApplyFlags::tapPREFLIGHT_EMIT, j);
@@ -3101,10 +3044,10 @@ DEFINE_HOOK_FUNCTION(
         return EMISSION_FAILURE;
     }
 
-    hookCtx.result.emittedTxn.push(tpTrans);
-
+    // nothing more is built until finalizeHookResult, most emissions are rolled back with their hook
     auto const& txID =
-        tpTrans->getID();
+        hookCtx.result.emittedTxn.emplace_back(
+            hook::EmittedTxn{stpTrans->getTransactionID(), stpTrans}).id;
 
     if (txID.size() > write_len)
         return TOO_SMALL;
@@ -3380,148 +3323,6 @@ DEFINE_HOOK_FUNCTION(
 }
 
 
-// RH NOTE this is a light-weight stobject parsing function for drilling into a provided serialzied object
-// however it could probably be replaced by an existing class or routine or set of routines in XRPLD
-// Returns object length including header bytes (and footer bytes in the event of array or object)
-// negative indicates error
-// -1 = unexpected end of bytes
-// -2 = unknown type (detected early)
-// -3 = unknown type (end of function)
-// -4 = excessive stobject nesting
-// -5 = excessively large array or object
-inline int32_t get_stobject_length (
-    unsigned char* start,   // in - begin iterator
-    unsigned char* maxptr,  // in - end iterator
-    int& type,              // out - populated by serialized type code
-    int& field,             // out - populated by serialized field code
-    int& payload_start,     // out - the start of actual payload data for this type
-    int& payload_length,    // out - the length of actual payload data for this type
-    int recursion_depth = 0)   // used internally
-{
-    if (recursion_depth > 10)
-        return -4;
-
-    unsigned char* end = maxptr;
-    unsigned char* upto = start;
-    int high = *upto >> 4;
-    int low = *upto & 0xF;
-
-    upto++; if (upto >= end) return -1;
-    if (high > 0 && low > 0)
-    {
-        // common type common field
-        type = high;
-        field = low;
-    } else if (high > 0) {
-        // common type, uncommon field
-        type = high;
-        field = *upto++;
-    } else if (low > 0) {
-        // common field, uncommon type
-        field = low;
-        type = *upto++;
-    } else {
-        // uncommon type and field
-        type = *upto++;
-        if (upto >= end) return -1;
-        field = *upto++;
-    }
-
-    DBG_PRINTF("%d get_st_object found field %d type %d\n", recursion_depth, field, type);
-
-    if (upto >= end) return -1;
-
-    // RH TODO: link this to rippled's internal STObject constants
-    // E.g.:
-    /*
-    int field_code = (safe_cast<int>(type) << 16) | field;
-    auto const& fieldObj = ripple::SField::getField;
-    */
-
-    if (type < 1 || type > 19 || ( type >= 9 && type <= 13))
-        return -2;
-
-    bool is_vl = (type == 8 /*ACCID*/ || type == 7 || type == 18 || type == 19);
-
-
-    int length = -1;
-    if (is_vl)
-    {
-        length = *upto++;
-        if (upto >= end)
-            return -1;
-
-        if (length < 193)
-        {
-            // do nothing
-        } else if (length > 192 && length < 241)
-        {
-            length -= 193;
-            length *= 256;
-            length += *upto++ + 193; if (upto > end) return -1;
-        } else {
-            int b2 = *upto++; if (upto >= end) return -1;
-            length -= 241;
-            length *= 65536;
-            length += 12481 + (b2 * 256) + *upto++; if (upto >= end) return -1;
-        }
-    } else if ((type >= 1 && type <= 5) || type == 16 || type == 17 )
-    {
-        length =    (type ==  1 ?  2 :
-                    (type ==  2 ?  4 :
-                    (type ==  3 ?  8 :
-                    (type ==  4 ? 16 :
-                    (type ==  5 ? 32 :
-                    (type == 16 ?  1 :
-                    (type == 17 ? 20 : -1 )))))));
-
-    } else if (type == 6) /* AMOUNT */
-    {
-        length =  (*upto >> 6 == 1) ? 8 : 48;
-        if (upto >= end) return -1;
-    }
-
-    if (length > -1)
-    {
-        payload_start = upto - start;
-        payload_length = length;
-        DBG_PRINTF("%d get_stobject_length field: %d Type: %d VL: %s Len: %d Payload_Start: %d Payload_Len: %d\n",
-            recursion_depth, field, type, (is_vl ? "yes": "no"), length, payload_start, payload_length);
-        return length + (upto - start);
-    }
-
-    if (type == 15 || type == 14) /* Object / Array */
-    {
-       payload_start = upto - start;
-
-       for(int i = 0; i < 1024; ++i)
-       {
-            int subfield = -1, subtype = -1, payload_start_ = -1, payload_length_ = -1;
-            int32_t sublength = get_stobject_length(
-                    upto, end, subtype, subfield, payload_start_, payload_length_, recursion_depth + 1);
-            DBG_PRINTF("%d get_stobject_length i %d %d-%d, upto %d sublength %d\n", recursion_depth, i,
-                    subtype, subfield, upto - start, sublength);
-            if (sublength < 0)
-                return -1;
-            upto += sublength;
-            if (upto >= end)
-                return -1;
-
-            if ((*upto == 0xE1U && type == 0xEU) ||
-                (*upto == 0xF1U && type == 0xFU))
-            {
-                payload_length = upto - start - payload_start;
-                upto++;
-                return (upto - start);
-            }
-       }
-       return -5;
-    }
-
-    return -3;
-
-}
-
 // Given an serialized object in memory locate and return the offset and length of the payload of a subfield of that
 // object. Arrays are returned fully formed. If successful returns offset and length joined as int64_t.
 // Use SUB_OFFSET and SUB_LENGTH to extract.
@@ -3539,8 +3340,6 @@ DEFINE_HOOK_FUNCTION(
         return TOO_SMALL;
 
     unsigned char* start = (unsigned char*)(memory + read_ptr);
-    unsigned char* upto = start;
-    unsigned char* end = start + read_len;
 
     DBG_PRINTF("sto_subfield called, looking for field %u type %u\n", field_id & 0xFFFF, (field_id >> 16));
     for (int j = -5; j < 5; ++j)
@@ -3550,31 +3349,27 @@ DEFINE_HOOK_FUNCTION(
 //    if ((*upto & 0xF0) == 0xE0)
 //        upto++;
 
-    for (int i = 0; i < 1024 && upto < end; ++i)
+    hook::STOScan const& scan = hookCtx.stoIndex.scan(memory, read_ptr, read_len);
+    for (hook::STOField const& f : scan.fields)
     {
-        int type = -1, field = -1, payload_start = -1, payload_length = -1;
-        int32_t length = get_stobject_length(upto, end, type, field, payload_start, payload_length, 0);
-        if (length < 0)
-            return PARSE_ERROR;
-        if ((type << 16) + field == field_id)
+        if ((f.type << 16) + f.field == field_id)
         {
             DBG_PRINTF("sto_subfield returned for field %u type %u\n", field_id & 0xFFFF, (field_id >> 16));
-            for (int j = -5; j < 5; ++j)
-                DBG_PRINTF(( j == 0 ? " [%02X] " : "  %02X  "), *(upto + j));
-            DBG_PRINTF("\n");
-            
-            if (type == 0xF)    // we return arrays fully formed
-                return (((int64_t)(upto - start)) << 32) /* start of the object */
-                    + (uint32_t)(length);
+
+            if (f.type == 0xF)    // we return arrays fully formed
+                return (((int64_t)(f.offset)) << 32) /* start of the object */
+                    + (uint32_t)(f.length);
 
             // return pointers to all other objects as payloads
-            return (((int64_t)(upto - start + payload_start)) << 32U) /* start of the object */
-                + (uint32_t)(payload_length);
+            return (((int64_t)(f.offset + f.payload_start)) << 32U) /* start of the object */
+                + (uint32_t)(f.payload_length);
         }
-        upto += length;
     }
-    
-    if (upto != end)
+
+    if (scan.error)
+        return PARSE_ERROR;
+
+    if (scan.upto != read_len)
         return PARSE_ERROR;
 
     return DOESNT_EXIST;
@@ -3594,13 +3389,12 @@ DEFINE_HOOK_FUNCTION(
     if (read_len < 2)
         return TOO_SMALL;
 
-    unsigned char* start = (unsigned char*)(memory + read_ptr);
-    unsigned char* upto = start;
-    unsigned char* end = start + read_len;
+    uint32_t upto = read_ptr;
+    uint32_t end = read_ptr + read_len;
 
     // unwrap the array if it is wrapped,
     // by removing a byte from the start and end
-    if ((*upto & 0xF0U) == 0xF0U)
+    if ((memory[upto] & 0xF0U) == 0xF0U)
     {
         upto++;
         end--;
@@ -3609,34 +3403,21 @@ DEFINE_HOOK_FUNCTION(
     if (upto >= end)
         return PARSE_ERROR;
 
-    /*
     DBG_PRINTF("sto_subarray called, looking for index %u\n", index_id);
-    for (int j = -5; j < 5; ++j)
-        printf(( j == 0 ? " >%02X< " : "  %02X  "), *(start + j));
-    DBG_PRINTF("\n");
-    */
-    for (int i = 0; i < 1024 && upto < end; ++i)
-    {
-        int type = -1, field = -1, payload_start = -1, payload_length = -1;
-        int32_t length = get_stobject_length(upto, end, type, field, payload_start, payload_length, 0);
-        if (length < 0)
-            return PARSE_ERROR;
-        
-        if (i == index_id)
-        {
-            DBG_PRINTF("sto_subarray returned for index %u\n", index_id);
-            for (int j = -5; j < 5; ++j)
-                DBG_PRINTF(( j == 0 ? " [%02X] " : "  %02X  "), *(upto + j + length));
-            DBG_PRINTF("\n");
 
-            return 
-                (((int64_t)(upto - start)) << 32U) /* start of the object */
-                +   (int64_t)(length);
-        }
-        upto += length;
+    hook::STOScan const& scan = hookCtx.stoIndex.scan(memory, upto, end - upto);
+    if (index_id < scan.fields.size())
+    {
+        hook::STOField const& f = scan.fields[index_id];
+        return
+            (((int64_t)(upto - read_ptr + f.offset)) << 32U) /* start of the object */
+            +   (int64_t)(f.length);
     }
 
-    if (upto != end)
+    if (scan.error)
+        return PARSE_ERROR;
+
+    if (scan.upto != end - upto)
         return PARSE_ERROR;
 
     return DOESNT_EXIST;
@@ -3819,7 +3600,6 @@ DEFINE_HOOK_FUNCTION(
     // we must inject the field at the canonical location....
     // so find that location
     unsigned char* start = (unsigned char*)(memory + sread_ptr);
-    unsigned char* upto = start;
     unsigned char* end = start + sread_len;
     unsigned char* inject_start = end;
     unsigned char* inject_end = end;
@@ -3830,34 +3610,36 @@ DEFINE_HOOK_FUNCTION(
     DBG_PRINTF("\n");
 
 
-    for (int i = 0; i < 1024 && upto < end; ++i)
+    hook::STOScan const& scan = hookCtx.stoIndex.scan(memory, sread_ptr, sread_len);
+    bool found = false;
+    for (hook::STOField const& f : scan.fields)
     {
-        int type = -1, field = -1, payload_start = -1, payload_length = -1;
-        int32_t length = get_stobject_length(upto, end, type, field, payload_start, payload_length, 0);
-        if (length < 0)
-            return PARSE_ERROR;
-        if ((type << 16) + field == field_id)
+        if ((f.type << 16) + f.field == field_id)
         {
-            inject_start = upto;
-            inject_end = upto + length;
+            inject_start = start + f.offset;
+            inject_end = start + f.offset + f.length;
+            found = true;
             break;
         }
-        else if ((type << 16) + field > field_id)
+        else if ((f.type << 16) + f.field > field_id)
         {
-            inject_start = upto;
-            inject_end = upto;
+            inject_start = start + f.offset;
+            inject_end = start + f.offset;
+            found = true;
             break;
         }
-        upto += length;
     }
 
+    if (!found && scan.error)
+        return PARSE_ERROR;
+
     // if the scan loop ends past the end of the source object
     // then the source object is invalid/corrupt, so we must
     // return an error
-    if (upto > end)
+    if (!found && scan.upto > sread_len)
         return PARSE_ERROR;
 
-    // upto is injection point
+    // inject_start is the injection point
     int64_t bytes_written = 0;
 
     // part 1
@@ -3933,21 +3715,11 @@ DEFINE_HOOK_FUNCTION(
     if (read_len < 2)
         return TOO_SMALL;
 
-    unsigned char* start = (unsigned char*)(memory + read_ptr);
-    unsigned char* upto = start;
-    unsigned char* end = start + read_len;
-
-
-    for (int i = 0; i < 1024 && upto < end; ++i)
-    {
-        int type = -1, field = -1, payload_start = -1, payload_length = -1;
-        int32_t length = get_stobject_length(upto, end, type, field, payload_start, payload_length, 0);
-        if (length < 0)
-            return 0;
-        upto += length;
-    }
+    hook::STOScan const& scan = hookCtx.stoIndex.scan(memory, read_ptr, read_len);
+    if (scan.error)
+        return 0;
 
-    return upto == end ? 1 : 0;
+    return scan.upto == read_len ? 1 : 0;
 }
 
 
@@ -4018,15 +3790,7 @@ DEFINE_HOOK_FUNCTION(
 
         SerialIter sitTrans(tx);
 
-        std::unique_ptr<STTx const> stpTrans;
-        stpTrans = std::make_unique<STTx const>(std::ref(sitTrans));
-
-        FeeUnit64 fee =
-            Transactor::calculateBaseFee(
-                *(applyCtx.app.openLedger().current()),
-                *stpTrans);
-
-        return fee.fee();
+        return emitted_fee_base(applyCtx, STTx{sitTrans});
     }
     catch (std::exception& e)
     {
@@ -4147,17 +3911,8 @@ DEFINE_HOOK_FUNCTION(
 
 #define RETURN_IF_INVALID_FLOAT(float1)\
 {\
-    if (float1 < 0) return hook_api::INVALID_FLOAT;\
-    if (float1 != 0)\
-    {\
-        uint64_t mantissa = get_mantissa(float1);\
-        int32_t exponent = get_exponent(float1);\
-        if (mantissa < minMantissa ||\
-            mantissa > maxMantissa ||\
-            exponent > maxExponent ||\
-            exponent < minExponent)\
-            return INVALID_FLOAT;\
-    }\
+    if (!hook_float::is_valid(float1))\
+        return INVALID_FLOAT;\
 }
 
 
@@ -4171,6 +3926,11 @@ DEFINE_HOOK_FUNCTION(
     if (NOT_IN_BOUNDS(read_ptr, read_len, memory_length))
         return OUT_OF_BOUNDS;
 
+    if (auto& traceLog = hook::HookTraceLog::instance(); traceLog.enabled())
+        traceLog.append(
+            hookCtx.result.hookHash, applyCtx.tx.getTransactionID(), hookCtx.result.account,
+            hook::HookTraceLog::Kind::floating, Slice(memory + read_ptr, read_len), Slice(), float1);
+
     if (!j.trace())
         return 0;
 
@@ -4240,29 +4000,6 @@ inline int64_t mulratio_internal
     }
 }
 
-inline int64_t float_multiply_internal_parts(
-        uint64_t man1,
-        int32_t exp1,
-        bool neg1,
-        uint64_t man2,
-        int32_t exp2,
-        bool neg2)
-{
-    using namespace boost::multiprecision;
-    cpp_int mult = cpp_int(man1) * cpp_int(man2);
-    mult /= power_of_ten[15];
-    uint64_t man_out = static_cast<uint64_t>(mult);
-    int32_t exp_out = exp1 + exp2 + 15;
-    bool neg_out = (neg1 && !neg2) || (!neg1 && neg2);
-    int64_t ret = normalize_xfl(man_out, exp_out, neg_out);
-
-    if (ret == EXPONENT_UNDERSIZED)
-        return 0;
-    if (ret == EXPONENT_OVERSIZED)
-        return XFL_OVERFLOW;
-    return ret;
-}
-
 DEFINE_HOOK_FUNCTION(
     int64_t,
     float_int,
@@ -4272,31 +4009,7 @@ DEFINE_HOOK_FUNCTION(
 {
     RETURN_IF_INVALID_FLOAT(float1);
     if (float1 == 0) return 0;
-    uint64_t man1 = get_mantissa(float1);
-    int32_t exp1 = get_exponent(float1);
-    bool neg1 = is_negative(float1);
-
-    if (decimal_places > 15)
-        return INVALID_ARGUMENT;
-
-    if (neg1)
-    {
-        if (!absolute)
-            return CANT_RETURN_NEGATIVE;
-    }
-
-    int32_t shift = -(exp1 + decimal_places);
-
-    if (shift > 15)
-        return 0;
-
-    if (shift < 0)
-        return TOO_BIG;
-    
-    if (shift > 0)
-        man1 /= power_of_ten[shift];
-    
-    return man1;
+    return hook_float::to_int(float1, decimal_places, absolute);
 }
 
 
@@ -4308,17 +4021,7 @@ DEFINE_HOOK_FUNCTION(
     RETURN_IF_INVALID_FLOAT(float1);
     RETURN_IF_INVALID_FLOAT(float2);
 
-    if (float1 == 0 || float2 == 0) return 0;
-
-    uint64_t man1 = get_mantissa(float1);
-    int32_t exp1 = get_exponent(float1);
-    bool neg1 = is_negative(float1);
-    uint64_t man2 = get_mantissa(float2);
-    int32_t exp2 = get_exponent(float2);
-    bool neg2 = is_negative(float2);
-
-
-    return float_multiply_internal_parts(man1, exp1, neg1, man2, exp2, neg2);
+    return hook_float::multiply(float1, float2);
 }
 
 
@@ -4376,34 +4079,21 @@ DEFINE_HOOK_FUNCTION(
     if (mode & (~0b111UL))
         return INVALID_ARGUMENT;
 
-    try
-    {
-        int64_t man1 = (int64_t)(get_mantissa(float1)) * (is_negative(float1) ? -1LL : 1LL);
-        int32_t exp1 = get_exponent(float1);
-        ripple::IOUAmount amt1 {man1, exp1};
-        int64_t man2 = (int64_t)(get_mantissa(float2)) * (is_negative(float2) ? -1LL : 1LL);
-        int32_t exp2 = get_exponent(float2);
-        ripple::IOUAmount amt2 {man2, exp2};
-
-        if (not_equal && amt1 != amt2)
-            return 1;
+    int const c = hook_float::compare(float1, float2);
 
-        if (equal_flag && amt1 == amt2)
-            return 1;
+    if (not_equal && c != 0)
+        return 1;
 
-        if (greater_flag && amt1 > amt2)
-            return 1;
+    if (equal_flag && c == 0)
+        return 1;
 
-        if (less_flag && amt1 < amt2)
-            return 1;
+    if (greater_flag && c > 0)
+        return 1;
 
-        return 0;
-    }
-    catch (std::overflow_error& e)
-    {
-        return XFL_OVERFLOW;
-    }
+    if (less_flag && c < 0)
+        return 1;
 
+    return 0;
 }
 
 DEFINE_HOOK_FUNCTION(
@@ -4414,32 +4104,7 @@ DEFINE_HOOK_FUNCTION(
     RETURN_IF_INVALID_FLOAT(float1);
     RETURN_IF_INVALID_FLOAT(float2);
 
-    if (float1 == 0) return float2;
-    if (float2 == 0) return float1;
-
-    int64_t man1 = (int64_t)(get_mantissa(float1)) * (is_negative(float1) ? -1LL : 1LL);
-    int32_t exp1 = get_exponent(float1);
-    int64_t man2 = (int64_t)(get_mantissa(float2)) * (is_negative(float2) ? -1LL : 1LL);
-    int32_t exp2 = get_exponent(float2);
-
-    try
-    {
-        ripple::IOUAmount amt1 {man1, exp1};
-        ripple::IOUAmount amt2 {man2, exp2};
-        amt1 += amt2;
-        int64_t result = make_float(amt1);
-        if (result == EXPONENT_UNDERSIZED)
-        {
-            // this is an underflow e.g. as a result of subtracting an xfl from itself
-            // and thus not an error, just return canonical 0
-            return 0;
-        }
-        return result;
-    }
-    catch (std::overflow_error& e)
-    {
-        return XFL_OVERFLOW;
-    }
+    return hook_float::sum(float1, float2);
 }
 
 DEFINE_HOOK_FUNCTION(
@@ -4725,84 +4390,12 @@ DEFINE_HOOK_FUNCTION(
     );
 }
 
-const int64_t float_one_internal = make_float(1000000000000000ull, -15, false);
-
-inline
-int64_t
-float_divide_internal(int64_t float1, int64_t float2)
-{
-    RETURN_IF_INVALID_FLOAT(float1);
-    RETURN_IF_INVALID_FLOAT(float2);
-    if (float2 == 0)
-        return DIVISION_BY_ZERO;
-    if (float1 == 0)
-        return 0;
-
-    // special case: division by 1
-    // RH TODO: add more special cases (division by power of 10)
-    if (float2 == float_one_internal)
-        return float1;
-
-    uint64_t man1 = get_mantissa(float1);
-    int32_t exp1 = get_exponent(float1);
-    bool neg1 = is_negative(float1);
-    uint64_t man2 = get_mantissa(float2);
-    int32_t exp2 = get_exponent(float2);
-    bool neg2 = is_negative(float2);
-
-    int64_t tmp1 = normalize_xfl(man1, exp1);
-    int64_t tmp2 = normalize_xfl(man2, exp2);
-    
-    if (tmp1 < 0 || tmp2 < 0)
-        return INVALID_FLOAT;
-
-    if (tmp1 == 0)
-        return 0;
-
-    while (man2 > man1)
-    {
-        man2 /= 10;
-        exp2++;
-    }
-
-    if (man2 == 0)
-        return DIVISION_BY_ZERO;
-
-    while (man2 < man1)
-    {
-        if (man2*10 > man1)
-            break;
-        man2 *= 10;
-        exp2--;
-    }
-
-    uint64_t man3 = 0;
-    int32_t exp3 = exp1 - exp2;
-
-    while (man2 > 0)
-    {
-        int i = 0;
-        for (; man1 > man2; man1 -= man2, ++i);
-
-        man3 *= 10;
-        man3 += i;
-        man2 /= 10;
-        if (man2 == 0)
-            break;
-        exp3--;
-    }
-
-    bool neg3 = !((neg1 && neg2) || (!neg1 && !neg2));
-
-    return normalize_xfl(man3, exp3, neg3);
-}
-
 DEFINE_HOOK_FUNCTION(
     int64_t,
     float_divide,
     int64_t float1, int64_t float2 )
 {
-    return float_divide_internal(float1, float2);
+    return hook_float::divide(float1, float2);
 }
 
 
@@ -4822,7 +4415,7 @@ DEFINE_HOOK_FUNCTION(
         return DIVISION_BY_ZERO;
     if (float1 == float_one_internal)
         return float_one_internal;
-    return float_divide_internal(float_one_internal, float1);
+    return hook_float::divide(float_one_internal, float1);
 }
 
 DEFINE_HOOK_FUNCTION(
@@ -4848,53 +4441,6 @@ DEFINE_HOOK_FUNCTION(
 }
 
 
-inline int64_t double_to_xfl(double x)
-{
-    if ((x) == 0)
-        return 0;
-    bool neg = x < 0;
-    double absresult = neg ? -x : x;
-
-    // first compute the base 10 order of the float
-    int32_t exp_out = (int32_t) log10(absresult);
-
-    // next adjust it into the valid mantissa range (this means dividing by its order and multiplying by 10**15)
-    absresult *= pow(10, -exp_out + 15);
-
-    // after adjustment the value may still fall below the minMantissa
-    int64_t result = (int64_t)absresult;
-    if (result < minMantissa)
-    {
-        if (result == minMantissa - 1LL)
-            result += 1LL;
-        else
-        {
-            result *= 10LL;
-            exp_out--;
-        }
-    }
-
-    // likewise the value can fall above the maxMantissa
-    if (result > maxMantissa)
-    {
-        if (result == maxMantissa + 1LL)
-            result -= 1LL;
-        else
-        {
-            result /= 10LL;
-            exp_out++;
-        }
-    }
-
-    exp_out -= 15;
-    int64_t ret = make_float(result, exp_out, neg);
-    
-    if (ret == EXPONENT_UNDERSIZED)
-        return 0;
-    
-    return ret;
-}
-
 DEFINE_HOOK_FUNCTION(
     int64_t,
     float_log,
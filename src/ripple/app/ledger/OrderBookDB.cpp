@@ -234,7 +234,7 @@ void
 OrderBookDB::processTxn(
     std::shared_ptr<ReadView const> const& ledger,
     const AcceptedLedgerTx& alTx,
-    Json::Value const& jvObj)
+    InfoSub::Message const& message)
 {
     std::lock_guard sl(mLock);
 
@@ -261,7 +261,7 @@ OrderBookDB::processTxn(
                             {data->getFieldAmount(sfTakerGets).issue(),
                              data->getFieldAmount(sfTakerPays).issue()});
                         if (listeners)
-                            listeners->publish(jvObj, havePublished);
+                            listeners->publish(message, havePublished);
                     }
                 };
 
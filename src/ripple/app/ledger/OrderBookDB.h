@@ -63,7 +63,7 @@ public:
     processTxn(
         std::shared_ptr<ReadView const> const& ledger,
         const AcceptedLedgerTx& alTx,
-        Json::Value const& jvObj);
+        InfoSub::Message const& message);
 
 private:
     Application& app_;
@@ -18,6 +18,10 @@
 //==============================================================================
 
 #include <ripple/app/consensus/RCLValidations.h>
+#include <ripple/app/hook/HookTrace.h>
+#include <ripple/app/hook/MemorySnapshot.h>
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/app/hook/WeakChainScheduler.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/InboundTransactions.h>
 #include <ripple/app/ledger/LedgerCleaner.h>
@@ -1283,6 +1287,23 @@ ApplicationImp::setup(boost::program_options::variables_map const& cmdline)
         return false;
     }
 
+    hook::ModuleCache::instance().setupNative(
+        config().section(SECTION_HOOKS),
+        config().legacy("database_path"),
+        logs_->journal("Hooks"));
+
+    hook::MemorySnapshotCache::instance().setup(
+        config().section(SECTION_HOOKS),
+        logs_->journal("Hooks"));
+
+    hook::HookTraceLog::instance().setup(
+        config().section(SECTION_HOOKS),
+        logs_->journal("Hooks"));
+
+    hook::WeakChainScheduler::instance().setup(
+        config().section(SECTION_HOOKS),
+        logs_->journal("Hooks"));
+
     if (!config().reporting())
     {
         {
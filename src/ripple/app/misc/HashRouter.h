@@ -46,6 +46,9 @@ namespace ripple {
 
 #define SF_EMITTED 0x4000
 
+// Relayed to us by a peer although it carries sfEmitDetails
+#define SF_EMITDETAILS 0x8000
+
 /** Routing table for objects identified by hash.
 
     This table keeps track of which hashes have been received by which peers.
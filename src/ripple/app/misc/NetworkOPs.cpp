@@ -2026,12 +2026,14 @@ NetworkOPsImp::pubManifest(Manifest const& mo)
             jvObj[jss::domain] = mo.domain;
         jvObj[jss::manifest] = strHex(mo.serialized);
 
+        InfoSub::Message const message(jvObj);
+
         for (auto i = mStreamMaps[sManifests].begin();
              i != mStreamMaps[sManifests].end();)
         {
             if (auto p = i->second.lock())
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++i;
             }
             else
@@ -2129,6 +2131,8 @@ NetworkOPsImp::pubServer()
 
         mLastFeeSummary = f;
 
+        InfoSub::Message const message(jvObj);
+
         for (auto i = mStreamMaps[sServer].begin();
              i != mStreamMaps[sServer].end();)
         {
@@ -2139,7 +2143,7 @@ NetworkOPsImp::pubServer()
             //             sending of JSON data.
             if (p)
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++i;
             }
             else
@@ -2162,11 +2166,13 @@ NetworkOPsImp::pubConsensus(ConsensusPhase phase)
         jvObj[jss::type] = "consensusPhase";
         jvObj[jss::consensus] = to_string(phase);
 
+        InfoSub::Message const message(jvObj);
+
         for (auto i = streamMap.begin(); i != streamMap.end();)
         {
             if (auto p = i->second.lock())
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++i;
             }
             else
@@ -2239,12 +2245,14 @@ NetworkOPsImp::pubValidation(std::shared_ptr<STValidation> const& val)
         if (auto const reserveInc = (*val)[~sfReserveIncrement])
             jvObj[jss::reserve_inc] = *reserveInc;
 
+        InfoSub::Message const message(jvObj);
+
         for (auto i = mStreamMaps[sValidations].begin();
              i != mStreamMaps[sValidations].end();)
         {
             if (auto p = i->second.lock())
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++i;
             }
             else
@@ -2266,6 +2274,8 @@ NetworkOPsImp::pubPeerStatus(std::function<Json::Value(void)> const& func)
 
         jvObj[jss::type] = "peerStatusChange";
 
+        InfoSub::Message const message(jvObj);
+
         for (auto i = mStreamMaps[sPeerStatus].begin();
              i != mStreamMaps[sPeerStatus].end();)
         {
@@ -2273,7 +2283,7 @@ NetworkOPsImp::pubPeerStatus(std::function<Json::Value(void)> const& func)
 
             if (p)
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++i;
             }
             else
@@ -2736,6 +2746,8 @@ NetworkOPsImp::pubProposedTransaction(
     {
         std::lock_guard sl(mSubLock);
 
+        InfoSub::Message const message(jvObj);
+
         auto it = mStreamMaps[sRTTransactions].begin();
         while (it != mStreamMaps[sRTTransactions].end())
         {
@@ -2743,7 +2755,7 @@ NetworkOPsImp::pubProposedTransaction(
 
             if (p)
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++it;
             }
             else
@@ -2767,6 +2779,8 @@ NetworkOPsImp::forwardProposedTransaction(Json::Value const& jvObj)
     {
         std::lock_guard sl(mSubLock);
 
+        InfoSub::Message const message(jvObj);
+
         auto it = mStreamMaps[sRTTransactions].begin();
         while (it != mStreamMaps[sRTTransactions].end())
         {
@@ -2774,7 +2788,7 @@ NetworkOPsImp::forwardProposedTransaction(Json::Value const& jvObj)
 
             if (p)
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++it;
             }
             else
@@ -2792,12 +2806,14 @@ NetworkOPsImp::forwardValidation(Json::Value const& jvObj)
 {
     std::lock_guard sl(mSubLock);
 
+    InfoSub::Message const message(jvObj);
+
     for (auto i = mStreamMaps[sValidations].begin();
          i != mStreamMaps[sValidations].end();)
     {
         if (auto p = i->second.lock())
         {
-            p->send(jvObj, true);
+            p->send(message, true);
             ++i;
         }
         else
@@ -2812,12 +2828,14 @@ NetworkOPsImp::forwardManifest(Json::Value const& jvObj)
 {
     std::lock_guard sl(mSubLock);
 
+    InfoSub::Message const message(jvObj);
+
     for (auto i = mStreamMaps[sManifests].begin();
          i != mStreamMaps[sManifests].end();)
     {
         if (auto p = i->second.lock())
         {
-            p->send(jvObj, true);
+            p->send(message, true);
             ++i;
         }
         else
@@ -2908,8 +2926,10 @@ NetworkOPsImp::forwardProposedAccountTransaction(Json::Value const& jvObj)
 
     if (!notify.empty())
     {
+        InfoSub::Message const message(jvObj);
+
         for (InfoSub::ref isrListener : notify)
-            isrListener->send(jvObj, true);
+            isrListener->send(message, true);
     }
 }
 
@@ -2962,13 +2982,15 @@ NetworkOPsImp::pubLedger(std::shared_ptr<ReadView const> const& lpAccepted)
                     app_.getLedgerMaster().getCompleteLedgers();
             }
 
+            InfoSub::Message const message(jvObj);
+
             auto it = mStreamMaps[sLedger].begin();
             while (it != mStreamMaps[sLedger].end())
             {
                 InfoSub::pointer p = it->second.lock();
                 if (p)
                 {
-                    p->send(jvObj, true);
+                    p->send(message, true);
                     ++it;
                 }
                 else
@@ -2980,13 +3002,15 @@ NetworkOPsImp::pubLedger(std::shared_ptr<ReadView const> const& lpAccepted)
         {
             Json::Value jvObj = ripple::RPC::computeBookChanges(lpAccepted);
 
+            InfoSub::Message const message(jvObj);
+
             auto it = mStreamMaps[sBookChanges].begin();
             while (it != mStreamMaps[sBookChanges].end())
             {
                 InfoSub::pointer p = it->second.lock();
                 if (p)
                 {
-                    p->send(jvObj, true);
+                    p->send(message, true);
                     ++it;
                 }
                 else
@@ -3140,6 +3164,9 @@ NetworkOPsImp::pubValidatedTransaction(
         RPC::insertDeliveredAmount(jvObj[jss::meta], *ledger, stTxn, meta);
     }
 
+    // serialized once for the transaction streams and the order books
+    InfoSub::Message const message(jvObj);
+
     {
         std::lock_guard sl(mSubLock);
 
@@ -3150,7 +3177,7 @@ NetworkOPsImp::pubValidatedTransaction(
 
             if (p)
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++it;
             }
             else
@@ -3165,7 +3192,7 @@ NetworkOPsImp::pubValidatedTransaction(
 
             if (p)
             {
-                p->send(jvObj, true);
+                p->send(message, true);
                 ++it;
             }
             else
@@ -3174,7 +3201,7 @@ NetworkOPsImp::pubValidatedTransaction(
     }
 
     if (transaction.getResult() == tesSUCCESS)
-        app_.getOrderBookDB().processTxn(ledger, transaction, jvObj);
+        app_.getOrderBookDB().processTxn(ledger, transaction, message);
 
     pubAccountTransaction(ledger, transaction);
 }
@@ -3287,8 +3314,10 @@ NetworkOPsImp::pubAccountTransaction(
             RPC::insertDeliveredAmount(jvObj[jss::meta], *ledger, stTxn, meta);
         }
 
+        InfoSub::Message const message(jvObj);
+
         for (InfoSub::ref isrListener : notify)
-            isrListener->send(jvObj, true);
+            isrListener->send(message, true);
 
         assert(!jvObj.isMember(jss::account_history_tx_stream));
         for (auto& info : accountHistoryNotify)
@@ -3353,8 +3382,10 @@ NetworkOPsImp::pubProposedAccountTransaction(
     {
         Json::Value jvObj = transJson(*tx, result, false, ledger);
 
+        InfoSub::Message const message(jvObj);
+
         for (InfoSub::ref isrListener : notify)
-            isrListener->send(jvObj, true);
+            isrListener->send(message, true);
 
         assert(!jvObj.isMember(jss::account_history_tx_stream));
         for (auto& info : accountHistoryNotify)
@@ -20,6 +20,7 @@
 #ifndef RIPPLE_TXQ_H_INCLUDED
 #define RIPPLE_TXQ_H_INCLUDED
 
+#include <ripple/app/hook/EmittedTxnIndex.h>
 #include <ripple/app/tx/applySteps.h>
 #include <ripple/ledger/ApplyView.h>
 #include <ripple/ledger/OpenView.h>
@@ -361,6 +362,16 @@ public:
     Json::Value
     doRPC(Application& app, std::optional<FeeUnit64> hookFeeUnits = std::nullopt) const;
 
+    /** The emitted transactions waiting in the emitted directory,
+        which `accept` injects into the open ledger when they are due.
+        Transactors keep it current as they add and remove entries.
+    */
+    hook::EmittedTxnIndex&
+    emittedTxns()
+    {
+        return emittedTxns_;
+    }
+
 private:
     // Implementation for nextQueuableSeq().  The passed lock must be held.
     SeqProxy
@@ -788,6 +799,12 @@ private:
     */
     std::optional<size_t> maxSize_;
 
+    /** Emitted transactions parsed out of the emitted directory.
+        @note Has its own lock, it is updated while transactions
+        are applied, which is not always under mutex_
+    */
+    hook::EmittedTxnIndex emittedTxns_;
+
 #if !NDEBUG
     /**
         parentHash_ checks that no unexpected ledger transitions
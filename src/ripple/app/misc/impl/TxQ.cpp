@@ -1426,132 +1426,55 @@ TxQ::accept(Application& app, OpenView& view)
 
     // Inject emitted transactions if any
     if (view.rules().enabled(featureHooks))
-    do { 
-        Keylet const emittedDirKeylet { keylet::emittedDir() };
-        if (dirIsEmpty(view, emittedDirKeylet))
-            break;
-
-        std::shared_ptr<SLE const> sleDirNode{};
-        unsigned int uDirEntry{0};
-        uint256 dirEntry{beast::zero};
+    {
+        auto const seq = view.info().seq;
+        auto const due = emittedTxns_.update(view, j_);
 
-        if (!cdirFirst(
-                view,
-                emittedDirKeylet.key,
-                sleDirNode,
-                uDirEntry,
-                dirEntry))
-            break;
+        for (auto const& txnHash : due.pending)
+            app.getHashRouter().setFlags(txnHash, SF_EMITTED);
 
-        do
+        for (auto const& stpTrans : due.expired)
         {
-            Keylet const itemKeylet{ltCHILD, dirEntry};
-            auto sleItem = view.read(itemKeylet);
-            if (!sleItem)
-            {
-                // Directory node has an invalid index.  Bail out.
-                JLOG(j_.fatal())
-                    << "EmittedTxn processing: directory node in ledger " << view.seq()
-                    << " has index to object that is missing: "
-                    << to_string(dirEntry);
-                break;
-            }
+            auto const txnHash = stpTrans->getTransactionID();
 
-            LedgerEntryType const nodeType{
-                safe_cast<LedgerEntryType>((*sleItem)[sfLedgerEntryType])};
+            JLOG(j_.trace())
+                << "Hook: Emission failure, adding cleanup pseudotxn to ledger " << seq;
 
-            if (nodeType != ltEMITTED_TXN)
-            {
-                JLOG(j_.fatal())
-                    << "EmittedTxn processing: emitted directory contained non ltEMITTED_TXN type";
-                break;
-            }
+            auto const& emitDetails =
+                const_cast<ripple::STTx&>(*stpTrans).getField(sfEmitDetails).downcast<STObject>();
 
-            JLOG(j_.info()) << "Processing emitted txn: " << *sleItem;
+            STTx efTx (
+                ttEMIT_FAILURE,
+                [seq, txnHash, emitDetails](auto& obj) {
+                    obj[sfLedgerSequence] = seq;
+                    obj[sfTransactionHash] = txnHash;
+                    obj.emplace_back(emitDetails);
+                });
 
-            auto const& emitted =
-                const_cast<ripple::STLedgerEntry&>(*sleItem).getField(sfEmittedTxn).downcast<STObject>();
+            uint256 txID = efTx.getTransactionID();
 
             auto s = std::make_shared<ripple::Serializer>();
-            emitted.add(*s);
-            SerialIter sitTrans(s->slice()); // do we need slice?
-            try
-            {
-                auto const& stpTrans = std::make_shared<STTx const>(std::ref(sitTrans));
-
-                if (!stpTrans->isFieldPresent(sfEmitDetails) ||
-                        !stpTrans->isFieldPresent(sfFirstLedgerSequence) ||
-                        !stpTrans->isFieldPresent(sfLastLedgerSequence))
-                {
-                    JLOG(j_.warn())
-                        << "Hook: Emission failure: "
-                        << "sfEmitDetails or sfFirst/LastLedgerSeq missing.";
-                    continue;
-                }
-                
-                auto seq = view.info().seq;
-                auto txnHash = stpTrans->getTransactionID();
-
-                app.getHashRouter().setFlags(txnHash, SF_EMITTED);
-
-                if (stpTrans->getFieldU32(sfLastLedgerSequence) < seq)
-                {
-                    JLOG(j_.trace())
-                        << "Hook: Emission failure, adding cleanup pseudotxn to ledger " << seq;
-
-                    auto const& emitDetails =
-                        const_cast<ripple::STTx&>(*stpTrans).getField(sfEmitDetails).downcast<STObject>();
-
-                    STTx efTx (
-                        ttEMIT_FAILURE,
-                        [seq, txnHash, emitDetails](auto& obj) {
-                            obj[sfLedgerSequence] = seq;
-                            obj[sfTransactionHash] = txnHash;
-                            obj.emplace_back(emitDetails);
-                            /*std::unique_ptr<STBase> ed = 
-                                std::make_unique<STBase>(emitDetails);
-                            ed->setFName(sfEmitDetails);
-                            obj.set(std::move(ed));*/
-
-                        });
-
-                    uint256 txID = efTx.getTransactionID();
-
-                    auto s = std::make_shared<ripple::Serializer>();
-                    efTx.add(*s);
-                    app.getHashRouter().setFlags(txID, SF_PRIVATE2);
-                    app.getHashRouter().setFlags(txID, SF_EMITTED);
-                    view.rawTxInsert(txID, std::move(s), nullptr);
-                    ledgerChanged = true;
-
-                    continue;
-                }
-
-                auto fls = stpTrans->getFieldU32(sfFirstLedgerSequence);
-                if (fls > view.info().seq)
-                {
-                    JLOG(j_.info()) <<
-                        "Holding TX " << stpTrans->getTransactionID() << " for future ledger.";
-                    continue;
-                }
-
-                // execution to here means we are adding the tx to the local set
-                if (fls >= view.info().seq)
-                {
-                    app.getHashRouter().setFlags(txnHash, SF_PRIVATE2);
-                    view.rawTxInsert(stpTrans->getTransactionID(), std::move(s), nullptr);
-                    ledgerChanged = true;
-                }
+            efTx.add(*s);
+            app.getHashRouter().setFlags(txID, SF_PRIVATE2);
+            app.getHashRouter().setFlags(txID, SF_EMITTED);
+            view.rawTxInsert(txID, std::move(s), nullptr);
+            ledgerChanged = true;
+        }
 
-            }
-            catch (std::exception& e)
-            {
-                JLOG(j_.fatal()) << "EmittedTxn Processing: Failure: " << e.what() << "\n";
-            }
+        // execution to here means we are adding the tx to the local set
+        for (auto const& stpTrans : due.ready)
+        {
+            auto const txnHash = stpTrans->getTransactionID();
 
-        } while (cdirNext(view, emittedDirKeylet.key, sleDirNode, uDirEntry, dirEntry));
+            JLOG(j_.info()) << "Processing emitted txn: " << txnHash;
 
-    } while(0);
+            auto s = std::make_shared<ripple::Serializer>();
+            stpTrans->add(*s);
+            app.getHashRouter().setFlags(txnHash, SF_PRIVATE2);
+            view.rawTxInsert(txnHash, std::move(s), nullptr);
+            ledgerChanged = true;
+        }
+    }
 
     for (auto candidateIter = byFee_.begin(); candidateIter != byFee_.end();)
     {
@@ -21,6 +21,7 @@
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/AmendmentTable.h>
 #include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/app/misc/TxQ.h>
 #include <ripple/app/tx/impl/Change.h>
 #include <ripple/basics/Log.h>
 #include <ripple/ledger/Sandbox.h>
@@ -366,6 +367,7 @@ Change::applyEmitFailure()
         }
 
         view().erase(sle);
+        ctx_.app.getTxQ().emittedTxns().removed(txnID);
     } while (0);
     return tesSUCCESS;
 }
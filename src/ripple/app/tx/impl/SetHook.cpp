@@ -37,6 +37,8 @@
 #include <utility>
 #include <ripple/app/hook/Enum.h>
 #include <ripple/app/hook/Guard.h>
+#include <ripple/app/hook/HookChainCache.h>
+#include <ripple/app/hook/HookValidationCache.h>
 #include <ripple/app/hook/applyHook.h>
 #include <ripple/app/ledger/LedgerMaster.h>
 #include <ripple/app/ledger/OpenLedger.h>
@@ -232,6 +234,105 @@ SetHook::inferOperation(STObject const& hookSetObj)
             : hsoUPDATE;
 }
 
+uint64_t
+SetHook::rulesVersion(Rules const& rules)
+{
+    uint64_t version = 0;
+    if (rules.enabled(featureHookStatePrefetch))
+        version |= 0x01U;
+    if (rules.enabled(featureHookFuel))
+        version |= 0x02U;
+    return version;
+}
+
+// Validate the guards of the byte code and try to load it into the wasm runtime. The verdict only
+// depends on the code and the rules version, callers cache it under both (see HookValidationCache).
+hook::HookValidationCache::Verdict
+SetHook::validateHookCode(SetHookCtx& ctx, Blob const& hook)
+{
+    hook::HookValidationCache::Verdict verdict;
+
+    // RH NOTE: validateGuards has a generic non-rippled specific interface so it can be
+    // used in other projects (i.e. tooling). As such the calling here is a bit convoluted.
+
+    std::optional<std::reference_wrapper<std::basic_ostream<char>>> logger;
+    std::ostringstream loggerStream;
+    std::string hsacc {""};
+    if (ctx.j.trace())
+    {
+        logger = loggerStream;
+        std::stringstream ss;
+        ss << HS_ACC();
+        hsacc = ss.str();
+    }
+
+    std::optional<std::pair<uint64_t, uint64_t>> result =
+        validateGuards(
+            makeSlice(hook),    // wasm to verify
+            logger,
+            hsacc,
+            ctx.rulesVersion
+        );
+
+    if (ctx.j.trace())
+    {
+        // clunky but to get the stream to accept the output correctly we will
+        // split on new line and feed each line one by one into the trace stream
+        // beast::Journal should be updated to inherit from basic_ostream<char>
+        // then this wouldn't be necessary.
+
+        // is this a needless copy or does the compiler do copy elision here?
+        std::string s = loggerStream.str();
+
+        char* data = s.data();
+        size_t len = s.size();
+
+        char* last = data;
+        size_t i = 0;
+        for (; i < len; ++i)
+        {
+            if (data[i] == '\n')
+            {
+                data[i] = '\0';
+                ctx.j.trace() << last;
+                last = data + i;
+            }
+        }
+
+        if (last < data + i)
+            ctx.j.trace() << last;
+    }
+
+    if (!result)
+    {
+        verdict.reason = "guard validation failed";
+        return verdict;
+    }
+
+    JLOG(ctx.j.trace())
+        << "HookSet(" << hook::log::WASM_SMOKE_TEST << ")[" << HS_ACC()
+        << "]: Trying to wasm instantiate proposed hook "
+        << "size = " <<  hook.size();
+
+
+    std::optional<std::string> result2 =
+        hook::HookExecutor::validateWasm(hook.data(), (size_t)hook.size());
+
+    if (result2)
+    {
+        JLOG(ctx.j.trace())
+            << "HookSet(" << hook::log::WASM_TEST_FAILURE << ")[" << HS_ACC()
+            << "Tried to set a hook with invalid code. VM error: "
+            << *result2;
+        verdict.reason = "VM error: " + *result2;
+        return verdict;
+    }
+
+    verdict.valid = true;
+    std::tie(verdict.maxInstrCountHook, verdict.maxInstrCountCbak) = *result;
+    return verdict;
+}
+
 // This is a context-free validation, it does not take into account the current state of the ledger
 // returns  < valid, instruction count >
 // may throw overflow_error
@@ -435,78 +536,30 @@ SetHook::validateHookSetEntry(SetHookCtx& ctx, STObject const& hookSetObj)
 
                 Blob hook = hookSetObj.getFieldVL(sfCreateCode);
 
-                // RH NOTE: validateGuards has a generic non-rippled specific interface so it can be
-                // used in other projects (i.e. tooling). As such the calling here is a bit convoluted.
+                uint256 const hookHash = ripple::sha512Half_s(ripple::Slice(hook.data(), hook.size()));
 
-                std::optional<std::reference_wrapper<std::basic_ostream<char>>> logger;
-                std::ostringstream loggerStream;
-                std::string hsacc {""};
-                if (ctx.j.trace())
+                auto& cache = hook::HookValidationCache::instance();
+                auto verdict = cache.find(hookHash, ctx.rulesVersion);
+                if (!verdict)
                 {
-                    logger = loggerStream;
-                    std::stringstream ss;
-                    ss << HS_ACC();
-                    hsacc = ss.str();
+                    // the verdict depends on nothing but the code and the amendments, never on a
+                    // ledger, so preflight gives the same result on every node (apply does not get
+                    // here for code which already has a definition on its view, it installs that one)
+                    verdict = validateHookCode(ctx, hook);
+                    cache.insert(hookHash, ctx.rulesVersion, *verdict);
                 }
-
-                auto result =
-                    validateGuards(
-                        hook,   // wasm to verify
-                        logger,
-                        hsacc
-                    );
-
-                if (ctx.j.trace())
+                else
                 {
-                    // clunky but to get the stream to accept the output correctly we will
-                    // split on new line and feed each line one by one into the trace stream
-                    // beast::Journal should be updated to inherit from basic_ostream<char>
-                    // then this wouldn't be necessary.
-
-                    // is this a needless copy or does the compiler do copy elision here?
-                    std::string s = loggerStream.str();
-
-                    char* data = s.data();
-                    size_t len = s.size();
-
-                    char* last = data;
-                    size_t i = 0;
-                    for (; i < len; ++i)
-                    {
-                        if (data[i] == '\n')
-                        {
-                            data[i] = '\0';
-                            ctx.j.trace() << last;
-                            last = data + i;
-                        }
-                    }
-
-                    if (last < data + i)
-                        ctx.j.trace() << last;
+                    JLOG(ctx.j.trace())
+                        << "HookSet(" << hook::log::WASM_SMOKE_TEST << ")[" << HS_ACC()
+                        << "]: Using cached validation of " << hookHash
+                        << (verdict->valid ? "" : ": ") << verdict->reason;
                 }
 
-                if (!result)
+                if (!verdict->valid)
                     return false;
 
-                JLOG(ctx.j.trace())
-                    << "HookSet(" << hook::log::WASM_SMOKE_TEST << ")[" << HS_ACC()
-                    << "]: Trying to wasm instantiate proposed hook "
-                    << "size = " <<  hook.size();
-
-
-                std::optional<std::string> result2 =
-                    hook::HookExecutor::validateWasm(hook.data(), (size_t)hook.size());
-
-                if (result2)
-                {
-                    JLOG(ctx.j.trace())
-                        << "HookSet(" << hook::log::WASM_TEST_FAILURE << ")[" << HS_ACC()
-                        << "Tried to set a hook with invalid code. VM error: "
-                        << *result2;
-                    return false;
-                }
-
-                return *result;
+                return std::make_pair(verdict->maxInstrCountHook, verdict->maxInstrCountCbak);
             }
         }
 
@@ -635,7 +688,8 @@ SetHook::preflight(PreflightContext const& ctx)
     {
        .j = ctx.j,
        .tx = ctx.tx,
-       .app = ctx.app
+       .app = ctx.app,
+       .rulesVersion = rulesVersion(ctx.rules)
     };
 
     bool allBlank = true;
@@ -727,7 +781,11 @@ TER
 SetHook::doApply()
 {
     preCompute();
-    return setHook();
+    TER const result = setHook();
+
+    // whatever the outcome, chains resolved from the hook SLE as it was are not reused
+    hook::HookChainCache::instance().invalidate(account_);
+    return result;
 }
 
 void
@@ -1091,7 +1149,8 @@ SetHook::setHook()
     {
         .j = ctx_.app.journal("View"),
         .tx = ctx_.tx,
-        .app = ctx_.app
+        .app = ctx_.app,
+        .rulesVersion = rulesVersion(view().rules())
     };
 
     const int  blobMax = hook::maxHookWasmSize();
@@ -1504,6 +1563,15 @@ SetHook::setHook()
                     newHookDef->setFieldAmount(sfHookCallbackFee,
                             XRPAmount {hook::computeExecutionFee(maxInstrCountCbak)});
 
+                    // with HookFuel the counts are the fuel the guards bound hook() and cbak() to,
+                    // which is what their executions are metered against
+                    if (ctx.rulesVersion & 0x02U)
+                    {
+                        newHookDef->setFieldU64(sfHookFuel, maxInstrCountHook);
+                        if (maxInstrCountCbak > 0)
+                        newHookDef->setFieldU64(sfHookCallbackFuel, maxInstrCountCbak);
+                    }
+
                     if (flags)
                         newHookDef->setFieldU32(sfFlags, newFlags);
                     else
@@ -1517,6 +1585,7 @@ SetHook::setHook()
                     }
 
                     slesToInsert.emplace(keylet, newHookDef);
+
                     newHook.setFieldH256(sfHookHash, *createHookHash);
                     newHooks.push_back(std::move(newHook));
                     continue;
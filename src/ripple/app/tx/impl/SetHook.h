@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <vector>
 #include <ripple/app/hook/Enum.h>
+#include <ripple/app/hook/HookValidationCache.h>
 #include <ripple/app/hook/applyHook.h>
 
 namespace ripple {
@@ -52,6 +53,7 @@ struct SetHookCtx
     beast::Journal j;
     STTx const& tx;
     Application& app;
+    uint64_t rulesVersion;  // see SetHook::rulesVersion
 };
 
 class SetHook : public Transactor
@@ -95,6 +97,15 @@ public:
     HookSetValidation
     validateHookSetEntry(SetHookCtx& ctx, STObject const& hookSetObj);
 
+    static
+    hook::HookValidationCache::Verdict
+    validateHookCode(SetHookCtx& ctx, Blob const& hook);
+
+    // the amendment gated hook api imports the rules allow, as passed to validateGuards
+    static
+    uint64_t
+    rulesVersion(Rules const& rules);
+
 private:
 
     TER
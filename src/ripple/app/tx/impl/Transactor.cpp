@@ -17,6 +17,9 @@
 */
 //==============================================================================
 
+#include <ripple/app/hook/HookArena.h>
+#include <ripple/app/hook/HookChainCache.h>
+#include <ripple/app/hook/WeakChainScheduler.h>
 #include <ripple/app/hook/applyHook.h>
 #include <ripple/app/main/Application.h>
 #include <ripple/app/misc/HashRouter.h>
@@ -38,6 +41,8 @@
 #include <ripple/ledger/PaymentSandbox.h>
 #include <ripple/ledger/detail/ApplyViewBase.h>
 #include <ripple/app/hook/Enum.h>
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <set>
 
@@ -200,55 +205,11 @@ calculateHookChainFee(
     Keylet const& hookKeylet,
     bool collectCallsOnly)
 {
-
-    std::shared_ptr<SLE const> hookSLE = view.read(hookKeylet);
-    if (!hookSLE)
+    auto const chain = hook::HookChainCache::instance().resolve(view, hookKeylet);
+    if (!chain)
         return FeeUnit64{0};
 
-    FeeUnit64 fee{0};
-
-    auto const& hooks = hookSLE->getFieldArray(sfHooks);
-
-    for (auto const& hook : hooks)
-    {
-        ripple::STObject const* hookObj = dynamic_cast<ripple::STObject const*>(&hook);
-
-        if (!hookObj->isFieldPresent(sfHookHash)) // skip blanks
-            continue;
-        
-        uint256 const& hash = hookObj->getFieldH256(sfHookHash);
-            
-        std::shared_ptr<SLE const> hookDef = view.read(keylet::hookDefinition(hash));
-
-        // this is an edge case that happens when a hook is deleted and executed at the same ledger
-        // the fee calculation for it can no longer occur
-        if (!hookDef)
-        {
-            printf("calculateHookChainFee edge case\n");
-            continue;
-        }
-        
-        // check if the hook can fire
-        uint64_t hookOn = (hookObj->isFieldPresent(sfHookOn)
-                ? hookObj->getFieldU64(sfHookOn)
-                : hookDef->getFieldU64(sfHookOn));
-
-        uint32_t flags = 0;
-        if (hookObj->isFieldPresent(sfFlags))
-            flags = hookObj->getFieldU32(sfFlags);
-        else
-            flags = hookDef->getFieldU32(sfFlags);
-
-        if (hook::canHook(tx.getTxnType(), hookOn) &&
-            (!collectCallsOnly || (flags & hook::hsfCOLLECT)))
-        {
-                fee += FeeUnit64{
-                    (uint32_t)(hookDef->getFieldAmount(sfFee).xrp().drops())
-                };
-        }
-    }
-
-    return fee;
+    return FeeUnit64{chain->fee(tx.getTxnType(), collectCallsOnly)};
 }
 
 FeeUnit64
@@ -909,8 +870,7 @@ removeUnfundedOffers(
 static void
 removeExpiredNFTokenOffers(
     ApplyView& view,
-    std::vector<uint256> const& offers,
-    beast::Journal viewJ)
+    std::vector<uint256> const& offers)
 {
     std::size_t removed = 0;
 
@@ -978,6 +938,24 @@ executeHookChain(
     ripple::AccountID const& account,
     bool strong,
     std::shared_ptr<STObject const> const& provisionalMeta)
+{
+    std::size_t const before = results.size();
+    TER const ter =
+        executeHookChain(ctx_, hookSLE, stateMap, results, account, strong, provisionalMeta);
+    executedHookCount_ += results.size() - before;
+    return ter;
+}
+
+TER
+Transactor::
+executeHookChain(
+    ApplyContext& applyCtx,
+    std::shared_ptr<ripple::STLedgerEntry const> const& hookSLE,
+    hook::HookStateMap& stateMap,
+    std::vector<hook::HookResult>& results,
+    ripple::AccountID const& account,
+    bool strong,
+    std::shared_ptr<STObject const> const& provisionalMeta)
 {
     std::set<uint256> hookSkips;
     std::map<
@@ -987,20 +965,11 @@ executeHookChain(
             std::vector<uint8_t>
         >> hookParamOverrides {};
 
-    auto const& hooks = hookSLE->getFieldArray(sfHooks);
-    uint8_t hook_no = 0;
+    auto const chain = hook::HookChainCache::instance().resolve(applyCtx.view(), hookSLE);
 
-    for (auto const& hook : hooks)
+    for (hook::ResolvedHook const& hook : chain->hooks())
     {
-        hook_no++;
-
-        ripple::STObject const* hookObj = dynamic_cast<ripple::STObject const*>(&hook);
-
-        if (!hookObj->isFieldPresent(sfHookHash)) // skip blanks
-            continue;
-
-        // lookup hook definition
-        uint256 const& hookHash = hookObj->getFieldH256(sfHookHash);
+        uint256 const& hookHash = hook.hookHash;
 
         if (hookSkips.find(hookHash) != hookSkips.end())
         {
@@ -1009,8 +978,7 @@ executeHookChain(
             continue;
         }
 
-        auto const& hookDef = ctx_.view().peek(keylet::hookDefinition(hookHash));
-        if (!hookDef)
+        if (!hook.definition)
         {
             JLOG(j_.warn())
                 << "HookError[]: Failure: hook def missing (send)";
@@ -1018,15 +986,10 @@ executeHookChain(
         }
 
         // check if the hook can fire
-        uint64_t hookOn = (hookObj->isFieldPresent(sfHookOn)
-                ? hookObj->getFieldU64(sfHookOn)
-                : hookDef->getFieldU64(sfHookOn));
-
-        if (!hook::canHook(ctx_.tx.getTxnType(), hookOn))
+        if (!hook::canHook(applyCtx.tx.getTxnType(), hook.hookOn))
             continue;    // skip if it can't
 
-        uint32_t flags = (hookObj->isFieldPresent(sfFlags) ?
-                hookObj->getFieldU32(sfFlags) : hookDef->getFieldU32(sfFlags));
+        uint32_t flags = hook.flags;
 
         JLOG(j_.trace())
             << "HookChainExecution: " << hookHash
@@ -1036,43 +999,35 @@ executeHookChain(
         if (!strong && !(flags & hsfCOLLECT))
             continue;
 
-        // fetch the namespace either from the hook object of, if absent, the hook def
-        uint256 const& ns = 
-            (hookObj->isFieldPresent(sfHookNamespace)
-                 ?  hookObj->getFieldH256(sfHookNamespace)
-                 :  hookDef->getFieldH256(sfHookNamespace));
-
-        // gather parameters
-        std::map<std::vector<uint8_t>, std::vector<uint8_t>> parameters;
-        if (hook::gatherHookParameters(hookDef, hookObj, parameters, j_))
+        // parameters were gathered when the chain was resolved
+        if (!hook.parametersValid)
         {
+            JLOG(j_.fatal())
+                << "HookError[]: Failure: hook def missing parameters (send)";
             JLOG(j_.warn())
                 << "HookError[]: Failure: gatherHookParameters failed)";
             return tecINTERNAL;
         }
 
-        bool hasCallback = hookDef->isFieldPresent(sfHookCallbackFee);
-
         results.push_back(
             hook::apply(
-                hookDef->getFieldH256(sfHookSetTxnID),
+                hook.hookSetTxnID,
                 hookHash,
-                ns,
-                hookDef->getFieldVL(sfCreateCode),
-                parameters,
+                hook.hookNamespace,
+                hook.definition->getFieldVL(sfCreateCode),
+                hook.parameters,
                 hookParamOverrides,
                 stateMap,
-                ctx_,
+                applyCtx,
                 account,
-                hasCallback,
+                hook.hasCallback,
                 false,
                 strong,
                 (strong ? 0 : 1UL),             // 0 = strong, 1 = weak
-                hook_no - 1,
+                hook.hookNo - 1,
+                hook.fuel,
                 provisionalMeta));
 
-        executedHookCount_++;
-
         hook::HookResult& hookResult = results.back();
 
         if (hookResult.exitType != hook_api::ExitType::ACCEPT)
@@ -1207,6 +1162,7 @@ Transactor::doHookCallback(std::shared_ptr<STObject const> const& provisionalMet
                     safe_cast<TxType>(ctx_.tx.getFieldU16(sfTransactionType)) == ttEMIT_FAILURE 
                         ? 1UL : 0UL, 
                     hook_no - 1,
+                    hookDef->at(~sfHookCallbackFuel),
                     provisionalMeta);
 
             
@@ -1278,6 +1234,10 @@ doTSH(
     std::vector<hook::HookResult>& results,
     std::shared_ptr<STObject const> const& provisionalMeta)
 {
+    if (!strong && hook::WeakChainScheduler::instance().enabled() &&
+        doTSHParallel(stateMap, results, provisionalMeta))
+        return tesSUCCESS;
+
     auto& view = ctx_.view();
 
     std::vector<std::pair<AccountID, bool>> tsh = 
@@ -1399,6 +1359,170 @@ doTSH(
     return tesSUCCESS;
 }
 
+bool
+Transactor::
+doTSHParallel(
+    hook::HookStateMap& stateMap,
+    std::vector<hook::HookResult>& results,
+    std::shared_ptr<STObject const> const& provisionalMeta)
+{
+    auto& scheduler = hook::WeakChainScheduler::instance();
+    auto const& view = ctx_.view();
+
+    struct Chain
+    {
+        AccountID account;
+        std::shared_ptr<SLE const> hookSLE;
+        XRPAmount feeDrops;
+    };
+
+    // the same selection as the weak pass of doTSH, without deducting anything yet
+    std::vector<Chain> chains;
+    {
+        std::vector<std::pair<AccountID, bool>> tsh =
+            hook::getTransactionalStakeHolders(ctx_.tx, view);
+        for (auto& weakTsh : additionalWeakTSH_)
+            tsh.emplace_back(weakTsh, false);
+
+        std::set<AccountID> alreadyProcessed;
+        for (auto& [tshAccountID, canRollback] : tsh)
+        {
+            if (tshAccountID == account_ || !alreadyProcessed.emplace(tshAccountID).second)
+                continue;
+
+            if (canRollback)
+                continue;
+
+            auto klTshHook = keylet::hook(tshAccountID);
+            auto tshHook = view.read(klTshHook);
+            if (!(tshHook && tshHook->isFieldPresent(sfHooks)))
+                continue;
+
+            auto tshAcc = view.read(keylet::account(tshAccountID));
+            if (!tshAcc)
+                continue;
+
+            FeeUnit64 tshFee = calculateHookChainFee(view, ctx_.tx, klTshHook, true);
+            if (tshFee == 0)
+                continue;
+
+            XRPAmount tshFeeDrops = view.fees().toDrops(tshFee);
+            if (!(tshAcc->getFieldU32(sfFlags) & lsfTshCollect))
+                continue;
+
+            auto const reserve = view.fees().accountReserve(tshAcc->getFieldU32(sfOwnerCount));
+            if (tshFeeDrops + reserve > tshAcc->getFieldAmount(sfBalance))
+                continue;
+
+            chains.push_back({tshAccountID, tshHook, tshFeeDrops});
+        }
+    }
+
+    if (chains.size() < 2)
+        return false;
+
+    // Each chain runs against its own context layered over ctx_, in which the fees of the chains
+    // up to and including it have been deducted, which is the ledger it would have seen in
+    // sequence since weak executions only write the ledger in finalizeHookState and
+    // finalizeHookResult.
+    //
+    // The workers share ctx_.view() only as the read-only base of their own OpenView, and reading
+    // it from several threads is safe:
+    //  - nothing writes ctx_ while the batch runs, this thread only takes tasks of the batch and
+    //    waits in scheduler.run before it touches ctx_ again;
+    //  - reads through ApplyViewImpl, OpenView and their state tables are const and keep no
+    //    cache, every write a chain makes lands in the ApplyStateTable of its own chainCtx;
+    //  - below them the ledger's SHAMap is immutable, nodes fetched from the node store are
+    //    canonicalized under the TaggedCache lock and inner node children under their atomic
+    //    lock, as for any ledger read by RPC and consensus threads at the same time;
+    //  - the hook API imports are per thread, each execution creates its own WasmEdge VM and the
+    //    module cache they share is locked.
+    std::vector<std::unique_ptr<hook::HookStateMap>> maps;
+    std::vector<std::vector<hook::HookResult>> chainResults(chains.size());
+    for (std::size_t i = 0; i < chains.size(); ++i)
+        maps.push_back(std::make_unique<hook::HookStateMap>());
+
+    bool const ran = scheduler.run(chains.size(), [&](std::size_t i)
+    {
+        OpenView base(&view);
+        ApplyContext chainCtx(
+            ctx_.app, base, ctx_.tx, ctx_.preclaimResult, ctx_.baseFee, ctx_.flags(), ctx_.journal);
+
+        for (std::size_t k = 0; k <= i; ++k)
+        {
+            auto acc = chainCtx.view().peek(keylet::account(chains[k].account));
+            acc->setFieldAmount(sfBalance, acc->getFieldAmount(sfBalance) - chains[k].feeDrops);
+            chainCtx.view().update(acc);
+        }
+
+        executeHookChain(
+            chainCtx,
+            chains[i].hookSLE,
+            *maps[i],
+            chainResults[i],
+            chains[i].account,
+            false,
+            provisionalMeta);
+    });
+
+    // chains are independent when no two of them, nor any of them and the state already in
+    // stateMap, looked at the same account's state or reserve
+    bool independent = ran;
+    uint32_t modifications = stateMap.modified_entry_count;
+    std::vector<AccountID> seen = stateMap.touchedAccounts();
+    for (std::size_t i = 0; independent && i < chains.size(); ++i)
+    {
+        auto const touched = maps[i]->touchedAccounts();
+        std::vector<AccountID> both;
+        std::set_intersection(
+            seen.begin(), seen.end(), touched.begin(), touched.end(), std::back_inserter(both));
+        if (!both.empty())
+            independent = false;
+
+        std::vector<AccountID> all;
+        std::merge(
+            seen.begin(), seen.end(), touched.begin(), touched.end(), std::back_inserter(all));
+        seen = std::move(all);
+
+        modifications += maps[i]->modified_entry_count;
+    }
+
+    // in sequence the chains share one modification limit
+    if (modifications > hook_api::max_state_modifications)
+        independent = false;
+
+    if (!independent)
+    {
+        JLOG(j_.trace())
+            << "HookInfo[" << account_ << "]: weak hook chains were not independent, "
+            << "running them in sequence.";
+        scheduler.noteFallback();
+        return false;
+    }
+
+    for (std::size_t i = 0; i < chains.size(); ++i)
+    {
+        auto tshAcc = ctx_.view().peek(keylet::account(chains[i].account));
+        STAmount priorBalance = tshAcc->getFieldAmount(sfBalance);
+        STAmount finalBalance = priorBalance - chains[i].feeDrops;
+        assert(finalBalance >= beast::zero);
+        assert(finalBalance < priorBalance);
+
+        tshAcc->setFieldAmount(sfBalance, finalBalance);
+        ctx_.view().update(tshAcc);
+        ctx_.destroyXRP(chains[i].feeDrops);
+
+        stateMap.merge(*maps[i]);
+        executedHookCount_ += chainResults[i].size();
+        for (auto& result : chainResults[i])
+            results.push_back(std::move(result));
+
+        speculativeStateMaps_.push_back(std::move(maps[i]));
+    }
+
+    return true;
+}
+
 void
 Transactor::doAgainAsWeak(
     AccountID const& hookAccountID,
@@ -1483,6 +1607,7 @@ Transactor::doAgainAsWeak(
                     false,
                     2UL,                                            // param 2 = aaw
                     hook_no - 1,
+                    hookDef->at(~sfHookFuel),
                     provisionalMeta);
 
 
@@ -1553,6 +1678,9 @@ Transactor::operator()()
     // Weak TSH and callback are executed post-application.
     if (hooksEnabled && (result == tesSUCCESS || result == tecHOOK_REJECTED))
     {
+        // the scratch containers of every hook executed below come from this thread's arena
+        hook::HookArena::Scope arenaScope;
+
         // this state map will be shared across all hooks in this execution chain
         // and any associated chains which are executed during this transaction also
         // this map can get large so 
@@ -1697,8 +1825,7 @@ Transactor::operator()()
                 view(), removedOffers, ctx_.app.journal("View"));
 
         if (result == tecEXPIRED)
-            removeExpiredNFTokenOffers(
-                view(), expiredNFTokenOffers, ctx_.app.journal("View"));
+            removeExpiredNFTokenOffers(view(), expiredNFTokenOffers);
 
         applied = isTecClaim(result);
     }
@@ -1744,6 +1871,8 @@ Transactor::operator()()
         std::shared_ptr<STObject const>
             proMeta = std::make_shared<STObject const>(std::move(meta.getAsObject()));
 
+        hook::HookArena::Scope arenaScope;
+
         // perform callback logic if applicable
         if (ctx_.tx.isFieldPresent(sfEmitDetails))
             doHookCallback(proMeta);
@@ -217,6 +217,26 @@ protected:
         bool strong,
         std::shared_ptr<STObject const> const& provisionalMeta);
 
+    // as above but against the given context, which is ctx_ or a speculative context layered
+    // over it, and without counting the executed hooks
+    TER
+    executeHookChain(
+        ApplyContext& applyCtx,
+        std::shared_ptr<ripple::STLedgerEntry const> const& hookSLE,
+        hook::HookStateMap& stateMap,
+        std::vector<hook::HookResult>& results,
+        ripple::AccountID const& account,
+        bool strong,
+        std::shared_ptr<STObject const> const& provisionalMeta);
+
+    // Run the weak TSH hook chains concurrently on the WeakChainScheduler. Returns false, having
+    // changed nothing, when there is nothing to gain or the chains turned out not to be
+    // independent, in which case doTSH runs them in sequence as usual.
+    bool
+    doTSHParallel(
+        hook::HookStateMap& stateMap,
+        std::vector<hook::HookResult>& results,
+        std::shared_ptr<STObject const> const& provisionalMeta);
 
     void
     addWeakTSHFromSandbox(detail::ApplyViewBase const& pv);
@@ -226,6 +246,9 @@ protected:
     std::set<AccountID> additionalWeakTSH_;  // any TSH that needs weak hook execution at the end
                                              // of the transactor, who isn't able to be deduced until after apply
                                              // i.e. pathing participants, crossed offers
+    std::vector<std::unique_ptr<hook::HookStateMap>>
+        speculativeStateMaps_;               // state maps of weak chains run by doTSHParallel, which
+                                             // their results refer to
 
     ///////////////////////////////////////////////////
 
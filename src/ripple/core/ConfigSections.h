@@ -57,6 +57,7 @@ struct ConfigSection
 #define SECTION_FEE_ACCOUNT_RESERVE "fee_account_reserve"
 #define SECTION_FEE_OWNER_RESERVE "fee_owner_reserve"
 #define SECTION_FETCH_DEPTH "fetch_depth"
+#define SECTION_HOOKS "hooks"
 #define SECTION_HISTORICAL_SHARD_PATHS "historical_shard_paths"
 #define SECTION_INSIGHT "insight"
 #define SECTION_IPS "ips"
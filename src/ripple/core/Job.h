@@ -41,6 +41,7 @@ enum JobType {
     // insert a job at a specific priority, simply add it at the right location.
 
     jtPACK,               // Make a fetch pack for a peer
+    jtHOOK_COMPILE,       // Compile a hook to native code
     jtPUBOLDLEDGER,       // An old ledger has been accepted
     jtCLIENT,             // A placeholder for the priority of all jtCLIENT jobs
     jtCLIENT_SUBSCRIBE,   // A websocket subscription by a client
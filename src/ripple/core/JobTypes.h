@@ -70,6 +70,7 @@ private:
         //                                                           avg     peak
         //  JobType               name                    limit    latency  latency
         add(jtPACK,              "makeFetchPack",               1,     0ms,     0ms);
+        add(jtHOOK_COMPILE,      "hookCompile",                 1,     0ms,     0ms);
         add(jtPUBOLDLEDGER,      "publishAcqLedger",            2, 10000ms, 15000ms);
         add(jtVALIDATION_ut,     "untrustedValidation",  maxLimit,  2000ms,  5000ms);
         add(jtMANIFEST,          "manifest",             maxLimit,  2000ms,  5000ms);
@@ -26,7 +26,9 @@
 #include <ripple/protocol/Book.h>
 #include <ripple/protocol/ErrorCodes.h>
 #include <ripple/resource/Consumer.h>
+#include <memory>
 #include <mutex>
+#include <string>
 
 namespace ripple {
 
@@ -61,6 +63,42 @@ public:
 
     using Consumer = Resource::Consumer;
 
+    /** A message published to the subscribers of a stream.
+
+        Publishers wrap the Json::Value they send to every subscriber of a
+        stream in a Message. The first subscriber that needs the message as
+        text serializes it, and every later one shares that text instead of
+        serializing the same value again.
+
+        A Message refers to its Json::Value, which must outlive it and must
+        not change while it is being sent. A Message is sent from one thread.
+    */
+    class Message
+    {
+    public:
+        explicit Message(Json::Value const& jv) : jv_(jv)
+        {
+        }
+
+        Message(Message const&) = delete;
+        Message&
+        operator=(Message const&) = delete;
+
+        Json::Value const&
+        json() const
+        {
+            return jv_;
+        }
+
+        /** The value serialized as JSON text. */
+        std::shared_ptr<std::string const> const&
+        text() const;
+
+    private:
+        Json::Value const& jv_;
+        mutable std::shared_ptr<std::string const> text_;
+    };
+
 public:
     /** Abstracts the source of subscription data.
      */
@@ -201,6 +239,13 @@ public:
     virtual void
     send(Json::Value const& jvObj, bool broadcast) = 0;
 
+    /** Send a message that is published to many subscribers. */
+    void
+    send(Message const& message, bool broadcast)
+    {
+        sendMessage(message, broadcast);
+    }
+
     std::uint64_t
     getSeq();
 
@@ -232,6 +277,12 @@ public:
 protected:
     std::mutex mLock;
 
+    /** Send a published message. Subscribers which send text override this
+        to share the message's text, the default sends its Json::Value.
+    */
+    virtual void
+    sendMessage(Message const& message, bool broadcast);
+
 private:
     Consumer m_consumer;
     Source& m_source;
@@ -17,6 +17,7 @@
 */
 //==============================================================================
 
+#include <ripple/json/json_writer.h>
 #include <ripple/net/InfoSub.h>
 #include <atomic>
 
@@ -82,6 +83,26 @@ InfoSub::onSendEmpty()
 {
 }
 
+std::shared_ptr<std::string const> const&
+InfoSub::Message::text() const
+{
+    if (!text_)
+    {
+        auto text = std::make_shared<std::string>();
+        Json::stream(jv_, [&](void const* data, std::size_t n) {
+            text->append(static_cast<char const*>(data), n);
+        });
+        text_ = std::move(text);
+    }
+    return text_;
+}
+
+void
+InfoSub::sendMessage(Message const& message, bool broadcast)
+{
+    send(message.json(), broadcast);
+}
+
 void
 InfoSub::insertSubAccountInfo(AccountID const& account, bool rt)
 {
@@ -575,6 +575,33 @@ private:
         return jvRequest;
     }
 
+    // hook_stats [<limit>]
+    Json::Value
+    parseHookStats(Json::Value const& jvParams)
+    {
+        Json::Value jvRequest(Json::objectValue);
+
+        if (jvParams.size())
+            jvRequest[jss::limit] = jvParams[0u].asUInt();
+
+        return jvRequest;
+    }
+
+    // hook_trace [<marker> [<limit>]]
+    Json::Value
+    parseHookTrace(Json::Value const& jvParams)
+    {
+        Json::Value jvRequest(Json::objectValue);
+
+        if (jvParams.size() > 0)
+            jvRequest[jss::marker] = jvParams[0u].asString();
+
+        if (jvParams.size() > 1)
+            jvRequest[jss::limit] = jvParams[1u].asUInt();
+
+        return jvRequest;
+    }
+
     // sign_for <account> <secret> <json> offline
     // sign_for <account> <secret> <json>
     Json::Value
@@ -1335,6 +1362,8 @@ public:
             {"fetch_info", &RPCParser::parseFetchInfo, 0, 1},
             {"gateway_balances", &RPCParser::parseGatewayBalances, 1, -1},
             {"get_counts", &RPCParser::parseGetCounts, 0, 1},
+            {"hook_stats", &RPCParser::parseHookStats, 0, 1},
+            {"hook_trace", &RPCParser::parseHookTrace, 0, 2},
             {"json", &RPCParser::parseJson, 2, 2},
             {"json2", &RPCParser::parseJson2, 1, 1},
             {"ledger", &RPCParser::parseLedger, 0, 2},
@@ -141,6 +141,7 @@ OverlayImpl::OverlayImpl(
     , next_id_(1)
     , timer_count_(0)
     , slots_(app.logs(), *this)
+    , txVerifyQueue_(app)
     , m_stats(
           std::bind(&OverlayImpl::collect_metrics, this),
           collector,
@@ -31,6 +31,7 @@
 #include <ripple/overlay/impl/Handshake.h>
 #include <ripple/overlay/impl/TrafficCount.h>
 #include <ripple/overlay/impl/TxMetrics.h>
+#include <ripple/overlay/impl/TxVerifyQueue.h>
 #include <ripple/peerfinder/PeerfinderManager.h>
 #include <ripple/resource/ResourceManager.h>
 #include <ripple/rpc/ServerHandler.h>
@@ -130,6 +131,9 @@ private:
     // Transaction reduce-relay metrics
     metrics::TxMetrics txMetrics_;
 
+    // Transactions relayed by peers waiting to be checked
+    TxVerifyQueue txVerifyQueue_;
+
     // A message with the list of manifests we send to peers
     std::shared_ptr<Message> manifestMessage_;
     // Used to track whether we need to update the cached list of manifests
@@ -350,6 +354,18 @@ public:
     void
     reportTraffic(TrafficCount::category cat, bool isInbound, int bytes);
 
+    TrafficCount const&
+    getTraffic() const
+    {
+        return m_traffic;
+    }
+
+    TxVerifyQueue&
+    txVerifyQueue()
+    {
+        return txVerifyQueue_;
+    }
+
     void
     incJqTransOverflow() override
     {
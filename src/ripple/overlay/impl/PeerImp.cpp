@@ -1540,7 +1540,52 @@ PeerImp::handleTransaction(
         return;
     }
 
-    SerialIter sit(makeSlice(m->rawtransaction()));
+    int flags;
+    constexpr std::chrono::seconds tx_interval = 10s;
+
+    // Returns true if we have seen the transaction recently
+    auto const seen = [&](uint256 const& txID) {
+        if (app_.getHashRouter().shouldProcess(txID, id_, flags, tx_interval))
+            return false;
+
+        if (flags & SF_BAD)
+        {
+            fee_ = Resource::feeInvalidSignature;
+            JLOG(p_journal_.debug()) << "Ignoring known bad tx " << txID;
+        }
+
+        // Charged like the first copy, which was parsed
+        else if (flags & SF_EMITDETAILS)
+        {
+            JLOG(p_journal_.warn()) << "Ignoring Network relayed Tx containing sfEmitDetails (handleTransaction).";
+            fee_ = Resource::feeHighBurdenPeer;
+        }
+
+        // Erase only if the server has seen this tx. If the server has not
+        // seen this tx then the tx could not has been queued for this peer.
+        else if (eraseTxQueue && txReduceRelayEnabled())
+            removeTxQueue(txID);
+
+        return true;
+    };
+
+    auto const raw = makeSlice(m->rawtransaction());
+
+    // The ID of a transaction is the hash of its canonical serialization,
+    // which is what peers relay, so the copies we get from other peers are
+    // recognized without parsing them.
+    uint256 const rawID = sha512Half(HashPrefix::transactionID, raw);
+
+    if (seen(rawID))
+    {
+        overlay_.reportTraffic(
+            TrafficCount::category::transaction_duplicate,
+            true,
+            static_cast<int>(raw.size()));
+        return;
+    }
+
+    SerialIter sit(raw);
 
     try
     {
@@ -1552,27 +1597,20 @@ PeerImp::handleTransaction(
         {
             JLOG(p_journal_.warn()) << "Ignoring Network relayed Tx containing sfEmitDetails (handleTransaction).";
             fee_ =  Resource::feeHighBurdenPeer;
+            app_.getHashRouter().setFlags(rawID, SF_EMITDETAILS);
             return;
         }
 
-        int flags;
-        constexpr std::chrono::seconds tx_interval = 10s;
-
-        if (!app_.getHashRouter().shouldProcess(txID, id_, flags, tx_interval))
+        // Not serialized canonically: it is known by the ID it parses to,
+        // and the peer pays for the entry made under the ID of its blob
+        if (txID != rawID)
         {
-            // we have seen this transaction recently
-            if (flags & SF_BAD)
-            {
-                fee_ = Resource::feeInvalidSignature;
-                JLOG(p_journal_.debug()) << "Ignoring known bad tx " << txID;
-            }
-
-            // Erase only if the server has seen this tx. If the server has not
-            // seen this tx then the tx could not has been queued for this peer.
-            else if (eraseTxQueue && txReduceRelayEnabled())
-                removeTxQueue(txID);
+            JLOG(p_journal_.debug())
+                << "Tx " << txID << " relayed in a non-canonical form";
 
-            return;
+            fee_ = Resource::feeInvalidRequest;
+            if (seen(txID))
+                return;
         }
 
         JLOG(p_journal_.debug()) << "Got tx " << txID;
@@ -1601,30 +1639,26 @@ PeerImp::handleTransaction(
                 << "No new transactions until synchronized";
         }
         else if (
-            app_.getJobQueue().getJobCount(jtTRANSACTION) >
-            app_.config().MAX_TRANSACTIONS)
+            overlay_.txVerifyQueue().size() > app_.config().MAX_TRANSACTIONS)
         {
             overlay_.incJqTransOverflow();
             JLOG(p_journal_.info()) << "Transaction queue is full";
         }
         else
         {
-            app_.getJobQueue().addJob(
-                jtTRANSACTION,
-                "recvTransaction->checkTransaction",
-                [weak = std::weak_ptr<PeerImp>(shared_from_this()),
-                 flags,
-                 checkSignature,
-                 stx]() {
-                    if (auto peer = weak.lock())
-                        peer->checkTransaction(flags, checkSignature, stx);
-                });
+            overlay_.txVerifyQueue().add(
+                shared_from_this(), flags, checkSignature, stx);
         }
     }
     catch (std::exception const&)
     {
         JLOG(p_journal_.warn())
             << "Transaction invalid: " << strHex(m->rawtransaction());
+
+        // The blob was routed under the ID of its bytes before it failed to
+        // parse: mark that ID bad, so every copy costs the peer relaying it
+        app_.getHashRouter().setFlags(rawID, SF_BAD);
+        fee_ = Resource::feeInvalidRequest;
     }
 }
 
@@ -3061,7 +3095,8 @@ void
 PeerImp::checkTransaction(
     int flags,
     bool checkSignature,
-    std::shared_ptr<STTx const> const& stx)
+    std::shared_ptr<STTx const> const& stx,
+    Rules const& rules)
 {
     // VFALCO TODO Rewrite to not use exceptions
     try
@@ -3089,10 +3124,7 @@ PeerImp::checkTransaction(
         {
             // Check the signature before handing off to the job queue.
             if (auto [valid, validReason] = checkValidity(
-                    app_.getHashRouter(),
-                    *stx,
-                    app_.getLedgerMaster().getValidatedRules(),
-                    app_.config());
+                    app_.getHashRouter(), *stx, rules, app_.config());
                 valid != Validity::Valid)
             {
                 if (!validReason.empty())
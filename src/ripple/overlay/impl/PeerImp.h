@@ -182,6 +182,7 @@ private:
     LedgerReplayMsgHandler ledgerReplayMsgHandler_;
 
     friend class OverlayImpl;
+    friend class TxVerifyQueue;
 
     class Metrics
     {
@@ -615,7 +616,8 @@ private:
     checkTransaction(
         int flags,
         bool checkSignature,
-        std::shared_ptr<STTx const> const& stx);
+        std::shared_ptr<STTx const> const& stx,
+        Rules const& rules);
 
     void
     checkPropose(
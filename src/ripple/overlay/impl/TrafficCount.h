@@ -71,6 +71,7 @@ public:
         overlay,    // overlay management
         manifests,  // manifest management
         transaction,
+        transaction_duplicate,  // transactions seen recently, not parsed
         proposal,
         validation,
         validatorlist,
@@ -205,6 +206,7 @@ protected:
         {"overhead_overlay"},   // category::overlay
         {"overhead_manifest"},  // category::manifests
         {"transactions"},       // category::transaction
+        {"transactions_duplicate"},  // category::transaction_duplicate
         {"proposals"},          // category::proposal
         {"validations"},        // category::validation
         {"validator_lists"},    // category::validatorlist
@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/app/ledger/LedgerMaster.h>
+#include <ripple/app/main/Application.h>
+#include <ripple/core/JobQueue.h>
+#include <ripple/overlay/impl/PeerImp.h>
+#include <ripple/overlay/impl/TxVerifyQueue.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+namespace ripple {
+
+TxVerifyQueue::TxVerifyQueue(Application& app, std::size_t batchSize)
+    : app_(app), batchSize_(batchSize)
+{
+    assert(batchSize_ != 0);
+}
+
+void
+TxVerifyQueue::add(
+    std::shared_ptr<PeerImp> const& peer,
+    int flags,
+    bool checkSignature,
+    std::shared_ptr<STTx const> const& stx)
+{
+    std::lock_guard lock(mutex_);
+
+    pending_.push_back({peer, flags, checkSignature, stx});
+
+    // The jobs already waiting take a batch each
+    if (pending_.size() > scheduled_ * batchSize_)
+    {
+        if (app_.getJobQueue().addJob(
+                jtTRANSACTION, "recvTransaction->checkTransaction", [this]() {
+                    check();
+                }))
+        {
+            ++scheduled_;
+        }
+    }
+}
+
+std::size_t
+TxVerifyQueue::size() const
+{
+    std::lock_guard lock(mutex_);
+    return pending_.size();
+}
+
+void
+TxVerifyQueue::check()
+{
+    std::vector<Pending> batch;
+    {
+        std::lock_guard lock(mutex_);
+        assert(scheduled_ != 0);
+        --scheduled_;
+
+        auto const end = pending_.begin() +
+            std::min<std::size_t>(batchSize_, pending_.size());
+        batch.reserve(std::distance(pending_.begin(), end));
+        std::move(pending_.begin(), end, std::back_inserter(batch));
+        pending_.erase(pending_.begin(), end);
+    }
+
+    if (batch.empty())
+        return;
+
+    // The whole batch is checked against the same validated ledger
+    auto const rules = app_.getLedgerMaster().getValidatedRules();
+
+    for (auto const& tx : batch)
+    {
+        if (auto peer = tx.peer.lock())
+            peer->checkTransaction(tx.flags, tx.checkSignature, tx.stx, rules);
+    }
+}
+
+}  // namespace ripple
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#ifndef RIPPLE_OVERLAY_TXVERIFYQUEUE_H_INCLUDED
+#define RIPPLE_OVERLAY_TXVERIFYQUEUE_H_INCLUDED
+
+#include <ripple/protocol/STTx.h>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace ripple {
+
+class Application;
+class PeerImp;
+
+/** Checks the transactions relayed by peers in batches.
+
+    Rather than adding a job for every transaction, the transactions are
+    queued and jtTRANSACTION jobs take them in batches of up to batchSize.
+    A job is only added when the jobs already waiting can not take all the
+    queued transactions, so an idle server checks a transaction as soon as
+    it arrives while a busy one gathers the transactions relayed meanwhile
+    into the next batch. Several batches are checked at once, each on its
+    own job, and every signature is checked on its own exactly as before.
+*/
+class TxVerifyQueue
+{
+public:
+    static constexpr std::size_t defaultBatchSize = 64;
+
+    explicit TxVerifyQueue(
+        Application& app,
+        std::size_t batchSize = defaultBatchSize);
+
+    TxVerifyQueue(TxVerifyQueue const&) = delete;
+    TxVerifyQueue&
+    operator=(TxVerifyQueue const&) = delete;
+
+    /** Queue a transaction relayed by a peer to be checked.
+
+        The result is released to the peer, which charges for a bad
+        transaction and hands a good one to NetworkOPs.
+    */
+    void
+    add(std::shared_ptr<PeerImp> const& peer,
+        int flags,
+        bool checkSignature,
+        std::shared_ptr<STTx const> const& stx);
+
+    /** Returns the number of transactions waiting for a job. */
+    std::size_t
+    size() const;
+
+private:
+    struct Pending
+    {
+        std::weak_ptr<PeerImp> peer;
+        int flags;
+        bool checkSignature;
+        std::shared_ptr<STTx const> stx;
+    };
+
+    // Called from the JobQueue: check the oldest batch
+    void
+    check();
+
+    Application& app_;
+    std::size_t const batchSize_;
+
+    mutable std::mutex mutex_;
+    std::deque<Pending> pending_;
+    // Jobs added which have not started yet
+    std::size_t scheduled_ = 0;
+};
+
+}  // namespace ripple
+
+#endif
@@ -18,6 +18,7 @@
 //==============================================================================
 
 #include <ripple/perflog/impl/PerfLogImp.h>
+#include <ripple/app/hook/HookStats.h>
 
 #include <ripple/basics/BasicConfig.h>
 #include <ripple/beast/core/CurrentThreadName.h>
@@ -304,6 +305,8 @@ PerfLogImp::report()
     else
         app_.getNodeStore().getCountsJson(report[jss::nodestore]);
     report[jss::current_activities] = counters_.currentJson();
+    report[jss::hook_stats] =
+        hook::HookStats::instance().getJson(hookStatsReportSize);
     app_.getOPs().stateAccounting(report);
 
     logFile_ << Json::Compact{std::move(report)} << std::endl;
@@ -122,6 +122,9 @@ class PerfLogImp : public PerfLog
         currentJson() const;
     };
 
+    // hooks which used the most execution time listed in each report
+    static constexpr std::size_t hookStatsReportSize = 20;
+
     Setup const setup_;
     Application& app_;
     beast::Journal const j_;
@@ -423,6 +423,8 @@ extern SF_UINT64 const sfHookOn;
 extern SF_UINT64 const sfHookInstructionCount;
 extern SF_UINT64 const sfHookReturnCode;
 extern SF_UINT64 const sfReferenceCount;
+extern SF_UINT64 const sfHookFuel;
+extern SF_UINT64 const sfHookCallbackFuel;
 
 // 128-bit
 extern SF_UINT128 const sfEmailHash;
@@ -237,6 +237,41 @@ sha512Half_s(Args const&... args)
     return static_cast<typename sha512_half_hasher_s::result_type>(h);
 }
 
+/** Computes the SHA512-Half of several messages of the same size.
+
+    Equivalent to results[i] = sha512Half(Slice(messages[i], size)) for each
+    i < count. Where the CPU allows it the messages are hashed side by side,
+    four at a time with AVX2 and eight with AVX-512, otherwise one by one.
+*/
+void
+sha512HalfBatch(
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results);
+
+/** Returns how many messages sha512HalfBatch hashes side by side. */
+std::size_t
+sha512HalfBatchLanes();
+
+namespace detail {
+
+/** Hashes as sha512HalfBatch does, with the kernel of the given number of
+    lanes: 1 (one by one), 4 (AVX2) or 8 (AVX-512) rather than the one chosen
+    for this CPU, and never one by one for a lone message. Returns false and
+    hashes nothing if the build or the CPU lacks that kernel, a count of 0
+    only asks. Lets tests check every kernel the machine can run.
+*/
+bool
+sha512HalfBatchWith(
+    std::size_t lanes,
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results);
+
+}  // namespace detail
+
 }  // namespace ripple
 
 #endif
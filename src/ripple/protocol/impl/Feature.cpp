@@ -450,6 +450,8 @@ REGISTER_FEATURE(PaychanAndEscrowForTokens,     Supported::yes, DefaultVote::no)
 REGISTER_FIX    (fixNFTokenNegOffer,            Supported::yes, DefaultVote::no);
 REGISTER_FEATURE(NonFungibleTokensV1_1,         Supported::yes, DefaultVote::no);
 REGISTER_FIX    (fixTrustLinesToSelf,           Supported::yes, DefaultVote::no);
+REGISTER_FEATURE(HookFuel,                      Supported::yes, DefaultVote::no);
+REGISTER_FEATURE(HookStatePrefetch,             Supported::yes, DefaultVote::no);
 
 // The following amendments have been active for at least two years. Their
 // pre-amendment code has been removed and the identifiers are deprecated.
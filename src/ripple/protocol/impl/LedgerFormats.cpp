@@ -206,7 +206,9 @@ LedgerFormats::LedgerFormats()
             {sfHookSetTxnID, soeREQUIRED},
             {sfReferenceCount, soeREQUIRED},
             {sfFee, soeREQUIRED},
-            {sfHookCallbackFee, soeOPTIONAL}
+            {sfHookCallbackFee, soeOPTIONAL},
+            {sfHookFuel, soeOPTIONAL},
+            {sfHookCallbackFuel, soeOPTIONAL}
         },
         commonFields);
 
@@ -173,6 +173,8 @@ CONSTRUCT_TYPED_SFIELD(sfHookOn,                "HookOn",               UINT64,
 CONSTRUCT_TYPED_SFIELD(sfHookInstructionCount,  "HookInstructionCount", UINT64,    17);
 CONSTRUCT_TYPED_SFIELD(sfHookReturnCode,        "HookReturnCode",       UINT64,    18);
 CONSTRUCT_TYPED_SFIELD(sfReferenceCount,        "ReferenceCount",       UINT64,    19);
+CONSTRUCT_TYPED_SFIELD(sfHookFuel,              "HookFuel",             UINT64,    20);
+CONSTRUCT_TYPED_SFIELD(sfHookCallbackFuel,      "HookCallbackFuel",     UINT64,    21);
 
 // 128-bit
 CONSTRUCT_TYPED_SFIELD(sfEmailHash,             "EmailHash",            UINT128,    1);
@@ -0,0 +1,439 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2014 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/basics/Slice.h>
+#include <ripple/protocol/digest.h>
+#include <boost/endian/conversion.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RIPPLE_SHA512_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace ripple {
+
+namespace {
+
+// SHA-512, FIPS 180-4 section 4.2.3
+constexpr std::uint64_t K[80] = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f,
+    0xe9b5dba58189dbbc, 0x3956c25bf348b538, 0x59f111f1b605d019,
+    0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242,
+    0x12835b0145706fbe, 0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2,
+    0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3,
+    0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65, 0x2de92c6f592b0275,
+    0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5,
+    0x983e5152ee66dfab, 0xa831c66d2db43210, 0xb00327c898fb213f,
+    0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc,
+    0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed, 0x53380d139d95b3df,
+    0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6,
+    0x92722c851482353b, 0xa2bfe8a14cf10364, 0xa81a664bbc423001,
+    0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8,
+    0x19a4c116b8d2d0c8, 0x1e376c085141ab53, 0x2748774cdf8eeb99,
+    0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb,
+    0x5b9cca4f7763e373, 0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc,
+    0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915,
+    0xc67178f2e372532b, 0xca273eceea26619c, 0xd186b8c721c0c207,
+    0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba,
+    0x0a637dc5a2c898a6, 0x113f9804bef90dae, 0x1b710b35131c471b,
+    0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a,
+    0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
+
+constexpr std::uint64_t H0[8] = {
+    0x6a09e667f3bcc908,
+    0xbb67ae8584caa73b,
+    0x3c6ef372fe94f82b,
+    0xa54ff53a5f1d36f1,
+    0x510e527fade682d1,
+    0x9b05688c2b3e6c1f,
+    0x1f83d9abfb41bd6b,
+    0x5be0cd19137e2179};
+
+constexpr std::size_t blockSize = 128;
+
+/*  The blocks of one padded message. The blocks which lie entirely inside
+    the message are read from it in place, the remaining one or two (the end
+    of the message, the 0x80 byte and the 128 bit length) are built in tail.
+*/
+class PaddedMessage
+{
+    std::uint8_t const* message_ = nullptr;
+    std::size_t inPlace_ = 0;
+    std::array<std::uint8_t, 2 * blockSize> tail_;
+
+public:
+    static std::size_t
+    blocks(std::size_t size)
+    {
+        return (size + 17 + blockSize - 1) / blockSize;
+    }
+
+    void
+    reset(std::uint8_t const* message, std::size_t size)
+    {
+        message_ = message;
+        inPlace_ = size / blockSize;
+
+        std::size_t const rest = size - inPlace_ * blockSize;
+        std::size_t const tailBlocks = blocks(size) - inPlace_;
+        std::size_t const tailSize = tailBlocks * blockSize;
+
+        tail_.fill(0);
+        if (rest > 0)
+            std::memcpy(tail_.data(), message + inPlace_ * blockSize, rest);
+        tail_[rest] = 0x80;
+
+        // the length in bits, big endian, in the last 16 bytes (of which the
+        // first 8 stay zero for any message which fits in memory)
+        std::uint64_t const bits = static_cast<std::uint64_t>(size) * 8;
+        for (int i = 0; i < 8; ++i)
+            tail_[tailSize - 1 - i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+
+    std::uint8_t const*
+    block(std::size_t i) const
+    {
+        if (i < inPlace_)
+            return message_ + i * blockSize;
+        return tail_.data() + (i - inPlace_) * blockSize;
+    }
+};
+
+inline std::uint64_t
+loadBigEndian(std::uint8_t const* p)
+{
+    std::uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return boost::endian::big_to_native(w);
+}
+
+inline void
+storeHalf(std::uint64_t const (&h)[4], uint256& result)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        std::uint64_t const w = boost::endian::native_to_big(h[i]);
+        std::memcpy(result.data() + 8 * i, &w, sizeof(w));
+    }
+}
+
+void
+hashOneByOne(
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results)
+{
+    for (std::size_t i = 0; i < count; ++i)
+        results[i] = sha512Half(Slice(messages[i], size));
+}
+
+#ifdef RIPPLE_SHA512_BATCH_X86
+
+// One SHA-512 round on vectors of words, a..h rotate by renaming.
+#define RIPPLE_SHA512_ROUND(a, b, c, d, e, f, g, h, t)                     \
+    {                                                                      \
+        auto const t1 = ADD(                                               \
+            ADD(ADD(h, SIGMA1(e)), ADD(CH(e, f, g), SET1(K[(t)]))),        \
+            w[(t) & 15]);                                                  \
+        auto const t2 = ADD(SIGMA0(a), MAJ(a, b, c));                      \
+        d = ADD(d, t1);                                                    \
+        h = ADD(t1, t2);                                                   \
+    }
+
+#define RIPPLE_SHA512_SCHEDULE(t)                                          \
+    w[(t) & 15] = ADD(                                                     \
+        ADD(w[(t) & 15], sigma1(w[((t) - 2) & 15])),                       \
+        ADD(w[((t) - 7) & 15], sigma0(w[((t) - 15) & 15])))
+
+#define RIPPLE_SHA512_ROUNDS                                               \
+    for (int t = 0; t < 80; t += 8)                                        \
+    {                                                                      \
+        if (t >= 16)                                                       \
+        {                                                                  \
+            for (int i = 0; i < 8; ++i)                                    \
+                RIPPLE_SHA512_SCHEDULE(t + i);                             \
+        }                                                                  \
+        RIPPLE_SHA512_ROUND(a, b, c, d, e, f, g, h, t + 0);                \
+        RIPPLE_SHA512_ROUND(h, a, b, c, d, e, f, g, t + 1);                \
+        RIPPLE_SHA512_ROUND(g, h, a, b, c, d, e, f, t + 2);                \
+        RIPPLE_SHA512_ROUND(f, g, h, a, b, c, d, e, t + 3);                \
+        RIPPLE_SHA512_ROUND(e, f, g, h, a, b, c, d, t + 4);                \
+        RIPPLE_SHA512_ROUND(d, e, f, g, h, a, b, c, t + 5);                \
+        RIPPLE_SHA512_ROUND(c, d, e, f, g, h, a, b, t + 6);                \
+        RIPPLE_SHA512_ROUND(b, c, d, e, f, g, h, a, t + 7);                \
+    }
+
+/*  Hash up to Lanes messages side by side, lane i holding message i. Unused
+    lanes repeat the first message and their results are dropped.
+*/
+#define RIPPLE_SHA512_LANES(Lanes, V, LOAD)                                \
+    PaddedMessage padded[Lanes];                                           \
+    for (std::size_t i = 0; i < Lanes; ++i)                                \
+        padded[i].reset(messages[i < count ? i : 0], size);                \
+                                                                           \
+    V state[8];                                                            \
+    for (int i = 0; i < 8; ++i)                                            \
+        state[i] = SET1(H0[i]);                                            \
+                                                                           \
+    std::size_t const blocks = PaddedMessage::blocks(size);                \
+    for (std::size_t n = 0; n < blocks; ++n)                               \
+    {                                                                      \
+        std::uint8_t const* p[Lanes];                                      \
+        for (std::size_t i = 0; i < Lanes; ++i)                            \
+            p[i] = padded[i].block(n);                                     \
+                                                                           \
+        V w[16];                                                           \
+        for (int i = 0; i < 16; ++i)                                       \
+            w[i] = LOAD(p, 8 * i);                                         \
+                                                                           \
+        V a = state[0], b = state[1], c = state[2], d = state[3];          \
+        V e = state[4], f = state[5], g = state[6], h = state[7];          \
+        RIPPLE_SHA512_ROUNDS                                               \
+        state[0] = ADD(state[0], a);                                       \
+        state[1] = ADD(state[1], b);                                       \
+        state[2] = ADD(state[2], c);                                       \
+        state[3] = ADD(state[3], d);                                       \
+        state[4] = ADD(state[4], e);                                       \
+        state[5] = ADD(state[5], f);                                       \
+        state[6] = ADD(state[6], g);                                       \
+        state[7] = ADD(state[7], h);                                       \
+    }                                                                      \
+                                                                           \
+    alignas(sizeof(V)) std::uint64_t words[4][Lanes];                      \
+    for (int i = 0; i < 4; ++i)                                            \
+        std::memcpy(words[i], &state[i], sizeof(V));                       \
+    for (std::size_t i = 0; i < count && i < Lanes; ++i)                   \
+    {                                                                      \
+        std::uint64_t const half[4] = {                                    \
+            words[0][i], words[1][i], words[2][i], words[3][i]};           \
+        storeHalf(half, results[i]);                                       \
+    }
+
+//------------------------------------------------------------------------------
+
+// AVX2: four lanes of 64 bit words, rotations are built from shifts
+#define SET1(x) _mm256_set1_epi64x(static_cast<long long>(x))
+#define ADD(x, y) _mm256_add_epi64(x, y)
+#define XOR(x, y) _mm256_xor_si256(x, y)
+#define ROR(x, n) \
+    _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - (n)))
+#define SIGMA0(x) XOR(XOR(ROR(x, 28), ROR(x, 34)), ROR(x, 39))
+#define SIGMA1(x) XOR(XOR(ROR(x, 14), ROR(x, 18)), ROR(x, 41))
+#define sigma0(x) XOR(XOR(ROR(x, 1), ROR(x, 8)), _mm256_srli_epi64(x, 7))
+#define sigma1(x) XOR(XOR(ROR(x, 19), ROR(x, 61)), _mm256_srli_epi64(x, 6))
+#define CH(x, y, z) XOR(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+#define MAJ(x, y, z) \
+    _mm256_or_si256( \
+        _mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+#define LOAD4(p, o)                                    \
+    _mm256_set_epi64x(                                 \
+        static_cast<long long>(loadBigEndian(p[3] + o)), \
+        static_cast<long long>(loadBigEndian(p[2] + o)), \
+        static_cast<long long>(loadBigEndian(p[1] + o)), \
+        static_cast<long long>(loadBigEndian(p[0] + o)))
+
+__attribute__((target("avx2"))) void
+hash4(
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results)
+{
+    RIPPLE_SHA512_LANES(4, __m256i, LOAD4)
+}
+
+#undef SET1
+#undef ADD
+#undef XOR
+#undef ROR
+#undef SIGMA0
+#undef SIGMA1
+#undef sigma0
+#undef sigma1
+#undef CH
+#undef MAJ
+
+//------------------------------------------------------------------------------
+
+// AVX-512: eight lanes, with native rotations and three input logic
+#define SET1(x) _mm512_set1_epi64(static_cast<long long>(x))
+#define ADD(x, y) _mm512_add_epi64(x, y)
+#define XOR3(x, y, z) _mm512_ternarylogic_epi64(x, y, z, 0x96)
+#define SIGMA0(x) \
+    XOR3(_mm512_ror_epi64(x, 28), _mm512_ror_epi64(x, 34), _mm512_ror_epi64(x, 39))
+#define SIGMA1(x) \
+    XOR3(_mm512_ror_epi64(x, 14), _mm512_ror_epi64(x, 18), _mm512_ror_epi64(x, 41))
+#define sigma0(x) \
+    XOR3(_mm512_ror_epi64(x, 1), _mm512_ror_epi64(x, 8), _mm512_srli_epi64(x, 7))
+#define sigma1(x) \
+    XOR3(_mm512_ror_epi64(x, 19), _mm512_ror_epi64(x, 61), _mm512_srli_epi64(x, 6))
+#define CH(x, y, z) _mm512_ternarylogic_epi64(x, y, z, 0xca)
+#define MAJ(x, y, z) _mm512_ternarylogic_epi64(x, y, z, 0xe8)
+#define LOAD8(p, o)                                    \
+    _mm512_set_epi64(                                  \
+        static_cast<long long>(loadBigEndian(p[7] + o)), \
+        static_cast<long long>(loadBigEndian(p[6] + o)), \
+        static_cast<long long>(loadBigEndian(p[5] + o)), \
+        static_cast<long long>(loadBigEndian(p[4] + o)), \
+        static_cast<long long>(loadBigEndian(p[3] + o)), \
+        static_cast<long long>(loadBigEndian(p[2] + o)), \
+        static_cast<long long>(loadBigEndian(p[1] + o)), \
+        static_cast<long long>(loadBigEndian(p[0] + o)))
+
+__attribute__((target("avx512f"))) void
+hash8(
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results)
+{
+    RIPPLE_SHA512_LANES(8, __m512i, LOAD8)
+}
+
+#undef SET1
+#undef ADD
+#undef XOR3
+#undef SIGMA0
+#undef SIGMA1
+#undef sigma0
+#undef sigma1
+#undef CH
+#undef MAJ
+#undef LOAD4
+#undef LOAD8
+#undef RIPPLE_SHA512_LANES
+#undef RIPPLE_SHA512_ROUNDS
+#undef RIPPLE_SHA512_SCHEDULE
+#undef RIPPLE_SHA512_ROUND
+
+#endif
+
+using LanesFn = void (*)(
+    std::uint8_t const* const*,
+    std::size_t,
+    std::size_t,
+    uint256*);
+
+struct Kernel
+{
+    std::size_t lanes;
+    LanesFn hash;
+};
+
+// the kernel with this many lanes, if the build and the CPU have it
+std::optional<Kernel>
+kernelWith(std::size_t lanes)
+{
+    if (lanes == 1)
+        return Kernel{1, &hashOneByOne};
+#ifdef RIPPLE_SHA512_BATCH_X86
+    __builtin_cpu_init();
+    if (lanes == 8 && __builtin_cpu_supports("avx512f"))
+        return Kernel{8, &hash8};
+    if (lanes == 4 && __builtin_cpu_supports("avx2"))
+        return Kernel{4, &hash4};
+#endif
+    return std::nullopt;
+}
+
+Kernel
+selectKernel()
+{
+    for (std::size_t lanes : {8, 4})
+    {
+        if (auto const k = kernelWith(lanes))
+            return *k;
+    }
+    return {1, &hashOneByOne};
+}
+
+Kernel const&
+kernel()
+{
+    static Kernel const k = selectKernel();
+    return k;
+}
+
+void
+hashLanes(
+    Kernel const& k,
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results)
+{
+    for (std::size_t i = 0; i < count; i += k.lanes)
+        k.hash(messages + i, size, std::min(k.lanes, count - i), results + i);
+}
+
+}  // namespace
+
+std::size_t
+sha512HalfBatchLanes()
+{
+    return kernel().lanes;
+}
+
+void
+sha512HalfBatch(
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results)
+{
+    auto const& k = kernel();
+
+    // a lone message gains nothing from the lanes
+    if (k.lanes == 1 || count == 1)
+        return hashOneByOne(messages, size, count, results);
+
+    hashLanes(k, messages, size, count, results);
+}
+
+namespace detail {
+
+bool
+sha512HalfBatchWith(
+    std::size_t lanes,
+    std::uint8_t const* const* messages,
+    std::size_t size,
+    std::size_t count,
+    uint256* results)
+{
+    auto const k = kernelWith(lanes);
+    if (!k)
+        return false;
+
+    hashLanes(*k, messages, size, count, results);
+    return true;
+}
+
+}  // namespace detail
+
+}  // namespace ripple
@@ -154,6 +154,7 @@ JSS(acquiring);              // out: LedgerRequest
 JSS(address);                // out: PeerImp
 JSS(affected);               // out: AcceptedLedgerTx
 JSS(age);                    // out: NetworkOPs, Peers
+JSS(allocations);            // out: GetCounts
 JSS(alternatives);           // out: PathRequest, RipplePathFind
 JSS(amendment_blocked);      // out: NetworkOPs
 JSS(amendments);             // in: AccountObjects, out: NetworkOPs
@@ -174,6 +175,7 @@ JSS(balances);               // out: GatewayBalances
 JSS(base);                   // out: LogLevel
 JSS(base_fee);               // out: NetworkOPs
 JSS(base_fee_xrp);           // out: NetworkOPs
+JSS(batches);                // out: GetCounts
 JSS(bids);                   // out: Subscribe
 JSS(binary);                 // in: AccountTX, LedgerEntry,
                              //     AccountTxOld, Tx LedgerData
@@ -186,8 +188,10 @@ JSS(both_sides);             // in: Subscribe, Unsubscribe
 JSS(broadcast);              // out: SubmitTransaction
 JSS(build_path);             // in: TransactionSign
 JSS(build_version);          // out: NetworkOPs
+JSS(bytes);                  // out: GetCounts
 JSS(cancel_after);           // out: AccountChannels
 JSS(can_delete);             // out: CanDelete
+JSS(capacity);               // out: HookTrace
 JSS(changes);                // out: BookChanges
 JSS(channel_id);             // out: AccountChannels
 JSS(channels);               // out: AccountChannels
@@ -208,6 +212,7 @@ JSS(closed_ledger);          // out: NetworkOPs
 JSS(cluster);                // out: PeerImp
 JSS(code);                   // out: errors
 JSS(command);                // in: RPCHandler
+JSS(compile_failures);       // out: GetCounts
 JSS(complete);               // out: NetworkOPs, InboundLedger
 JSS(complete_ledgers);       // out: NetworkOPs, PeerImp
 JSS(complete_shards);        // out: OverlayImpl, PeerImp
@@ -255,6 +260,7 @@ JSS(dir_root);                // out: DirectoryEntryIterator
 JSS(directory);               // in: LedgerEntry
 JSS(domain);                  // out: ValidatorInfo, Manifest
 JSS(drops);                   // out: TxQ
+JSS(dropped);                 // out: HookTrace
 JSS(duration_us);             // out: NetworkOPs
 JSS(effective);               // out: ValidatorList
                               // in: UNL
@@ -263,6 +269,7 @@ JSS(engine_result);           // out: NetworkOPs, TransactionSign, Submit
 JSS(engine_result_code);      // out: NetworkOPs, TransactionSign, Submit
 JSS(engine_result_message);   // out: NetworkOPs, TransactionSign, Submit
 JSS(ephemeral_key);           // out: ValidatorInfo
+JSS(emits);                   // out: HookStats
                               // in/out: Manifest
 JSS(error);                   // out: error
 JSS(errored);
@@ -270,6 +277,9 @@ JSS(error_code);            // out: error
 JSS(error_exception);       // out: Submit
 JSS(error_message);         // out: error
 JSS(escrow);                // in: LedgerEntry
+JSS(evicted);               // out: HookStats
+JSS(evictions);             // out: GetCounts
+JSS(executions);            // out: HookStats
 JSS(expand);                // in: handler/Ledger
 JSS(expected_date);         // out: any (warnings)
 JSS(expected_date_UTC);     // out: any (warnings)
@@ -278,6 +288,8 @@ JSS(expiration);            // out: AccountOffers, AccountChannels,
                             //      ValidatorList
 JSS(fail_hard);             // in: Sign, Submit
 JSS(failed);                // out: InboundLedger
+JSS(failures);              // out: GetCounts
+JSS(fallbacks);             // out: GetCounts
 JSS(feature);               // in: Feature
 JSS(features);              // out: Feature
 JSS(fee);                   // out: NetworkOPs, Peers
@@ -309,12 +321,23 @@ JSS(hashes);                // in: AccountObjects
 JSS(have_header);           // out: InboundLedger
 JSS(have_state);            // out: InboundLedger
 JSS(have_transactions);     // out: InboundLedger
+JSS(heap_blocks);           // out: GetCounts
 JSS(high);                  // out: BookChanges
 JSS(highest_sequence);      // out: AccountInfo
 JSS(highest_ticket);        // out: AccountInfo
 JSS(historical_perminute);  // historical_perminute.
+JSS(hits);                  // out: GetCounts
+JSS(hook_arena);            // out: GetCounts
+JSS(hook_chain_cache);      // out: GetCounts
 JSS(hook_hash);             // in: LedgerEntry
+JSS(hook_memory_snapshots); // out: GetCounts
+JSS(hook_module_cache);     // out: GetCounts
+JSS(hook_stats);            // out: PerfLog
+JSS(hook_validation_cache); // out: GetCounts
+JSS(hook_weak_chains);      // out: GetCounts
+JSS(hooks);                 // out: HookStats
 JSS(hostid);                // out: NetworkOPs
+JSS(host_calls);            // out: HookStats
 JSS(hotwallet);             // in: GatewayBalances
 JSS(id);                    // websocket.
 JSS(ident);                 // in: AccountCurrencies, AccountInfo,
@@ -327,7 +350,9 @@ JSS(index);                 // in: LedgerEntry, DownloadShard
                             //      LedgerEntry, TxHistory, LedgerData
 JSS(info);                  // out: ServerInfo, ConsensusInfo, FetchInfo
 JSS(initial_sync_duration_us);
+JSS(instructions);         // out: HookStats
 JSS(internal_command);     // in: Internal
+JSS(invalidations);         // out: GetCounts
 JSS(invalid_API_version);  // out: Many, when a request has an invalid
                            //      version
 JSS(io_latency_ms);        // out: NetworkOPs
@@ -413,6 +438,7 @@ JSS(max_ledger);                  // in/out: LedgerCleaner
 JSS(max_queue_size);              // out: TxQ
 JSS(max_spend_drops);             // out: AccountInfo
 JSS(max_spend_drops_total);       // out: AccountInfo
+JSS(max_us);                      // out: HookStats
 JSS(median_fee);                  // out: TxQ
 JSS(median_level);                // out: TxQ
 JSS(message);                     // error.
@@ -431,10 +457,12 @@ JSS(min_count);                  // in: GetCounts
 JSS(min_ledger);                 // in: LedgerCleaner
 JSS(minimum_fee);                // out: TxQ
 JSS(minimum_level);              // out: TxQ
+JSS(misses);                     // out: GetCounts
 JSS(missingCommand);             // error
 JSS(name);                       // out: AmendmentTableImpl, PeerImp
 JSS(namespace_entries);          // out: AccountNamespace
 JSS(namespace_id);               // in/out: AccountNamespace
+JSS(native);                     // out: GetCounts
 JSS(needed_state_hashes);        // out: InboundLedger
 JSS(needed_transaction_hashes);  // out: InboundLedger
 JSS(network_id);                 // out: NetworkOPs
@@ -471,8 +499,11 @@ JSS(open);                       // out: handlers/Ledger
 JSS(open_ledger_cost);           // out: SubmitTransaction
 JSS(open_ledger_fee);            // out: TxQ
 JSS(open_ledger_level);          // out: TxQ
+JSS(otxn_id);                    // out: HookTrace
 JSS(owner);                      // in: LedgerEntry, out: NetworkOPs
 JSS(owner_funds);                // in/out: Ledger, NetworkOPs, AcceptedLedgerTx
+JSS(p50_us);                      // out: HookStats
+JSS(p99_us);                      // out: HookStats
 JSS(page_index);
 JSS(params);                      // RPC
 JSS(parent_close_time);           // out: LedgerToJson
@@ -491,6 +522,7 @@ JSS(peers);                       // out: InboundLedger, handlers/Peers, Overlay
 JSS(peer_disconnects);            // Severed peer connection counter.
 JSS(peer_disconnects_resources);  // Severed peer connections because of
                                   // excess resource consumption.
+JSS(phases);                      // out: GetCounts
 JSS(port);                        // in: Connect
 JSS(previous);                    // out: Reservations
 JSS(previous_ledger);             // out: LedgerPropose
@@ -522,6 +554,7 @@ JSS(reference_level);       // out: TxQ
 JSS(refresh_interval);      // in: UNL
 JSS(refresh_interval_min);  // out: ValidatorSites
 JSS(regular_seed);          // in/out: LedgerEntry
+JSS(rejected);              // out: GetCounts
 JSS(remaining);             // out: ValidatorList
 JSS(remote);                // out: Logic.h
 JSS(request);               // RPC
@@ -570,6 +603,7 @@ JSS(signing_keys);              // out: ValidatorList
 JSS(signing_time);              // out: NetworkOPs
 JSS(signer_list);               // in: AccountObjects
 JSS(signer_lists);              // in/out: AccountInfo
+JSS(size);                      // out: GetCounts
 JSS(snapshot);                  // in: Subscribe
 JSS(source_account);            // in: PathRequest, RipplePathFind
 JSS(source_amount);             // in: PathRequest, RipplePathFind
@@ -581,6 +615,8 @@ JSS(started);
 JSS(state);                 // out: Logic.h, ServerState, LedgerData
 JSS(state_accounting);      // out: NetworkOPs
 JSS(state_now);             // in: Subscribe
+JSS(state_reads);           // out: HookStats
+JSS(state_writes);          // out: HookStats
 JSS(status);                // error
 JSS(stop);                  // in: LedgerCleaner
 JSS(stop_history_tx_only);  // in: Unsubscribe, stop history tx stream
@@ -604,6 +640,7 @@ JSS(ticket_count);          // out: AccountInfo
 JSS(ticket_seq);            // in: LedgerEntry
 JSS(time);
 JSS(timeouts);                // out: InboundLedger
+JSS(traces);                  // out: HookTrace
 JSS(track);                   // out: PeerImp
 JSS(traffic);                 // out: Overlay
 JSS(total);                   // out: counters
@@ -611,6 +648,7 @@ JSS(totalCoins);              // out: LedgerToJson
 JSS(total_bytes_recv);        // out: Peers
 JSS(total_bytes_sent);        // out: Peers
 JSS(total_coins);             // out: LedgerToJson
+JSS(total_us);                // out: HookStats
 JSS(transTreeHash);           // out: ledger/Ledger.cpp
 JSS(transaction);             // in: Tx
                               // out: NetworkOPs, AcceptedLedgerTx,
@@ -683,6 +721,7 @@ JSS(volume_b);                // out: BookChanges
 JSS(vote);                    // in: Feature
 JSS(warning);                 // rpc:
 JSS(warnings);                // out: server_info, server_state
+JSS(wasm_errors);             // out: HookStats
 JSS(workers);
 JSS(write_load);   // out: GetCounts
 JSS(NegativeUNL);  // out: ValidatorList; ledger type
@@ -17,6 +17,12 @@
 */
 //==============================================================================
 
+#include <ripple/app/hook/HookArena.h>
+#include <ripple/app/hook/HookChainCache.h>
+#include <ripple/app/hook/HookValidationCache.h>
+#include <ripple/app/hook/MemorySnapshot.h>
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/app/hook/WeakChainScheduler.h>
 #include <ripple/app/ledger/AcceptedLedger.h>
 #include <ripple/app/ledger/InboundLedgers.h>
 #include <ripple/app/ledger/LedgerMaster.h>
@@ -119,6 +125,70 @@ getCountsJson(Application& app, int minObjectCount)
     ret[jss::treenode_track_size] =
         app.getNodeFamily().getTreeNodeCache(0)->getTrackSize();
 
+    {
+        auto const counts = hook::ModuleCache::instance().getCounts();
+        Json::Value& jv = (ret[jss::hook_module_cache] = Json::objectValue);
+
+        jv[jss::hits] = std::to_string(counts.hits);
+        jv[jss::misses] = std::to_string(counts.misses);
+        jv[jss::evictions] = std::to_string(counts.evictions);
+        jv[jss::failures] = std::to_string(counts.failures);
+        jv[jss::size] = Json::UInt(counts.size);
+        jv[jss::native] = Json::UInt(counts.native);
+        jv[jss::compile_failures] = std::to_string(counts.compileFailures);
+    }
+
+    if (auto& snapshots = hook::MemorySnapshotCache::instance(); snapshots.enabled())
+    {
+        auto const counts = snapshots.getCounts();
+        Json::Value& jv = (ret[jss::hook_memory_snapshots] = Json::objectValue);
+
+        jv[jss::hits] = std::to_string(counts.hits);
+        jv[jss::misses] = std::to_string(counts.misses);
+        jv[jss::rejected] = std::to_string(counts.rejected);
+        jv[jss::evictions] = std::to_string(counts.evictions);
+        jv[jss::size] = Json::UInt(counts.size);
+    }
+
+    {
+        auto const counts = hook::HookChainCache::instance().getCounts();
+        Json::Value& jv = (ret[jss::hook_chain_cache] = Json::objectValue);
+
+        jv[jss::hits] = std::to_string(counts.hits);
+        jv[jss::misses] = std::to_string(counts.misses);
+        jv[jss::evictions] = std::to_string(counts.evictions);
+        jv[jss::invalidations] = std::to_string(counts.invalidations);
+        jv[jss::size] = Json::UInt(counts.size);
+    }
+
+    {
+        auto const counts = hook::HookValidationCache::instance().getCounts();
+        Json::Value& jv = (ret[jss::hook_validation_cache] = Json::objectValue);
+
+        jv[jss::hits] = std::to_string(counts.hits);
+        jv[jss::misses] = std::to_string(counts.misses);
+        jv[jss::evictions] = std::to_string(counts.evictions);
+        jv[jss::size] = Json::UInt(counts.size);
+    }
+
+    {
+        auto const counts = hook::HookArena::getCounts();
+        Json::Value& jv = (ret[jss::hook_arena] = Json::objectValue);
+
+        jv[jss::phases] = std::to_string(counts.phases);
+        jv[jss::allocations] = std::to_string(counts.allocations);
+        jv[jss::heap_blocks] = std::to_string(counts.heapBlocks);
+        jv[jss::bytes] = std::to_string(counts.bytes);
+    }
+
+    if (auto& scheduler = hook::WeakChainScheduler::instance(); scheduler.enabled())
+    {
+        Json::Value& jv = (ret[jss::hook_weak_chains] = Json::objectValue);
+
+        jv[jss::batches] = std::to_string(scheduler.batches());
+        jv[jss::fallbacks] = std::to_string(scheduler.fallbacks());
+    }
+
     std::string uptime;
     auto s = UptimeClock::now();
     using namespace std::chrono_literals;
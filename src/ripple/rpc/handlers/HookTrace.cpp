@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2014 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/app/hook/HookTrace.h>
+#include <ripple/beast/core/LexicalCast.h>
+#include <ripple/json/json_value.h>
+#include <ripple/net/RPCErr.h>
+#include <ripple/protocol/ErrorCodes.h>
+#include <ripple/protocol/jss.h>
+#include <ripple/rpc/Context.h>
+
+namespace ripple {
+
+// {
+//   marker: <string>     // optional, continue where the previous call stopped
+//   limit: <number>      // optional, defaults to 200
+//   hook_hash: <string>  // optional, only the traces of this hook
+// }
+Json::Value
+doHookTrace(RPC::JsonContext& context)
+{
+    auto const& traceLog = hook::HookTraceLog::instance();
+    if (!traceLog.enabled())
+        return rpcError(rpcNOT_ENABLED);
+
+    uint64_t marker = 0;
+    std::size_t limit = 200;
+    std::optional<uint256> hookHash;
+
+    if (context.params.isMember(jss::marker))
+    {
+        auto const& jvMarker = context.params[jss::marker];
+        if (jvMarker.isUInt() || (jvMarker.isInt() && jvMarker.asInt() >= 0))
+            marker = jvMarker.asUInt();
+        else if (
+            !jvMarker.isString() ||
+            !beast::lexicalCastChecked(marker, jvMarker.asString()))
+            return RPC::invalid_field_error(jss::marker);
+    }
+
+    if (context.params.isMember(jss::limit))
+    {
+        auto const& jvLimit = context.params[jss::limit];
+        if (!(jvLimit.isUInt() || (jvLimit.isInt() && jvLimit.asInt() >= 0)))
+            return RPC::expected_field_error(jss::limit, "unsigned integer");
+        limit = jvLimit.asUInt();
+    }
+
+    if (context.params.isMember(jss::hook_hash))
+    {
+        auto const& jvHash = context.params[jss::hook_hash];
+        if (!jvHash.isString() ||
+            !hookHash.emplace().parseHex(jvHash.asString()))
+            return RPC::invalid_field_error(jss::hook_hash);
+    }
+
+    return traceLog.getJson(marker, limit, hookHash);
+}
+
+}  // namespace ripple
@@ -81,6 +81,16 @@ public:
         auto m = std::make_shared<StreambufWSMsg<decltype(sb)>>(std::move(sb));
         sp->send(m);
     }
+
+protected:
+    void
+    sendMessage(Message const& message, bool) override
+    {
+        auto sp = ws_.lock();
+        if (!sp)
+            return;
+        sp->send(std::make_shared<SharedWSMsg>(message.text()));
+    }
 };
 
 }  // namespace ripple
@@ -33,6 +33,7 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -104,6 +105,37 @@ public:
     }
 };
 
+/** A message whose bytes are shared with other messages.
+
+    Every session needs its own WSMsg to track how much of the message it has
+    written, but the text of a message sent to many sessions only needs to
+    exist once.
+*/
+class SharedWSMsg : public WSMsg
+{
+    std::shared_ptr<std::string const> text_;
+    std::size_t pos_ = 0;
+    std::size_t n_ = 0;
+
+public:
+    explicit SharedWSMsg(std::shared_ptr<std::string const> text)
+        : text_(std::move(text))
+    {
+    }
+
+    std::pair<boost::tribool, std::vector<boost::asio::const_buffer>>
+    prepare(std::size_t bytes, std::function<void(void)>) override
+    {
+        pos_ += n_;
+        auto const remaining = text_->size() - pos_;
+        if (remaining == 0)
+            return {true, {}};
+        n_ = std::min(bytes, remaining);
+        boost::tribool const done = n_ == remaining;
+        return {done, {boost::asio::const_buffer(text_->data() + pos_, n_)}};
+    }
+};
+
 struct WSSession
 {
     std::shared_ptr<void> appDefined;
@@ -336,10 +336,20 @@ public:
     int
     unshare();
 
-    /** Flush modified nodes to the nodestore and convert them to shared. */
+    /** Flush modified nodes to the nodestore and convert them to shared.
+
+        The subtrees below the root's branches are flushed on a pool of
+        threads shared by all maps, the root itself last.
+    */
     int
     flushDirty(NodeObjectType t);
 
+    /** Set the number of threads flushDirty may use, the calling thread
+        included. One per core by default.
+    */
+    static void
+    setFlushThreads(std::size_t threads);
+
     void
     walkMap(std::vector<SHAMapMissingNode>& missingNodes, int maxMissing) const;
     bool
@@ -414,6 +424,16 @@ private:
     std::shared_ptr<SHAMapTreeNode>
     writeNode(NodeObjectType t, std::shared_ptr<SHAMapTreeNode> node) const;
 
+    /** flush the modified nodes below node, which must be ours to modify,
+        and node itself. Returns the node to hook to the parent in its place.
+    */
+    std::shared_ptr<SHAMapInnerNode>
+    flushSubTree(
+        std::shared_ptr<SHAMapInnerNode> node,
+        bool doWrite,
+        NodeObjectType t,
+        int& flushed) const;
+
     // returns the first item at or below this node
     SHAMapLeafNode*
     firstBelow(
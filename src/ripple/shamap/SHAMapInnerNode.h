@@ -175,6 +175,14 @@ public:
     void
     updateHashDeep();
 
+    /** Recalculate the hash of all children and these nodes.
+
+        Equivalent to calling updateHashDeep on each node, but the nodes are
+        hashed side by side using sha512HalfBatch.
+    */
+    static void
+    updateHashesDeep(SHAMapInnerNode* const* nodes, std::size_t count);
+
     void
     serializeForWire(Serializer&) const override;
 
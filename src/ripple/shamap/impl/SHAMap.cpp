@@ -18,15 +18,102 @@
 //==============================================================================
 
 #include <ripple/basics/contract.h>
+#include <ripple/core/impl/Workers.h>
 #include <ripple/shamap/SHAMap.h>
 #include <ripple/shamap/SHAMapAccountStateLeafNode.h>
 #include <ripple/shamap/SHAMapNodeID.h>
 #include <ripple/shamap/SHAMapSyncFilter.h>
 #include <ripple/shamap/SHAMapTxLeafNode.h>
 #include <ripple/shamap/SHAMapTxPlusMetaLeafNode.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 namespace ripple {
 
+namespace {
+
+// The threads flushing the subtrees below the roots of maps, kept for the
+// life of the process rather than started by every flush.
+class FlushPool : private Workers::Callback
+{
+public:
+    static FlushPool&
+    instance()
+    {
+        static FlushPool pool;
+        return pool;
+    }
+
+    // The threads a flush may use, the calling thread included
+    std::size_t
+    threads() const
+    {
+        return threads_;
+    }
+
+    void
+    setThreads(std::size_t threads)
+    {
+        std::lock_guard lock(mutex_);
+        threads_ = std::max<std::size_t>(threads, 1);
+
+        // The pool only grows, a flush may be using its threads
+        int const helpers = static_cast<int>(threads_ - 1);
+        if (helpers > workers_.getNumberOfThreads())
+            workers_.setNumberOfThreads(helpers);
+    }
+
+    void
+    post(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        workers_.addTask();
+    }
+
+private:
+    FlushPool() : workers_(*this, nullptr, "SHAMapFlush", 0)
+    {
+        setThreads(std::thread::hardware_concurrency());
+    }
+
+    void
+    processTask(int) override
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard lock(mutex_);
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+
+    std::mutex mutex_;
+    std::deque<std::function<void()>> tasks_;
+    std::atomic<std::size_t> threads_ = 1;
+    // Last, so its threads are stopped before the tasks go
+    Workers workers_;
+};
+
+}  // namespace
+
+void
+SHAMap::setFlushThreads(std::size_t threads)
+{
+    FlushPool::instance().setThreads(threads);
+}
+
 [[nodiscard]] std::shared_ptr<SHAMapLeafNode>
 makeTypedLeaf(
     SHAMapNodeType type,
@@ -1016,101 +1103,257 @@ SHAMap::walkSubTree(bool doWrite, NodeObjectType t)
         return 1;
     }
 
-    // Stack of {parent,index,child} pointers representing
-    // inner nodes we are in the process of flushing
-    using StackEntry = std::pair<std::shared_ptr<SHAMapInnerNode>, int>;
-    std::stack<StackEntry, std::vector<StackEntry>> stack;
-
     node = preFlushNode(std::move(node));
 
-    int pos = 0;
+    // The dirty children of the root: leaves are flushed here, the subtrees
+    // below the inner ones are flushed independently of each other, on
+    // several threads when writing to the nodestore.
+    std::array<std::shared_ptr<SHAMapInnerNode>, branchFactor> subtrees;
+    std::vector<int> branches;
 
-    // We can't flush an inner node until we flush its children
-    while (1)
+    for (int branch = 0; branch < branchFactor; ++branch)
     {
-        while (pos < branchFactor)
+        if (node->isEmptyBranch(branch))
+            continue;
+
+        auto child = node->getChild(branch);
+
+        if (!child || (child->cowid() == 0))
+            continue;
+
+        child = preFlushNode(std::move(child));
+
+        if (child->isInner())
         {
-            if (node->isEmptyBranch(pos))
-            {
-                ++pos;
-            }
-            else
-            {
-                // No need to do I/O. If the node isn't linked,
-                // it can't need to be flushed
-                int branch = pos;
-                auto child = node->getChild(pos++);
+            subtrees[branch] =
+                std::static_pointer_cast<SHAMapInnerNode>(std::move(child));
+            branches.push_back(branch);
+        }
+        else
+        {
+            ++flushed;
 
-                if (child && (child->cowid() != 0))
-                {
-                    // This is a node that needs to be flushed
+            assert(node->cowid() == cowid_);
+            child->updateHash();
+            child->unshare();
 
-                    child = preFlushNode(std::move(child));
+            if (doWrite)
+                child = writeNode(t, std::move(child));
 
-                    if (child->isInner())
-                    {
-                        // save our place and work on this node
-
-                        stack.emplace(std::move(node), branch);
-                        // The semantics of this changes when we move to c++-20
-                        // Right now no move will occur; With c++-20 child will
-                        // be moved from.
-                        node = std::static_pointer_cast<SHAMapInnerNode>(
-                            std::move(child));
-                        pos = 0;
-                    }
-                    else
-                    {
-                        // flush this leaf
-                        ++flushed;
+            node->shareChild(branch, child);
+        }
+    }
 
-                        assert(node->cowid() == cowid_);
-                        child->updateHash();
-                        child->unshare();
+    auto& pool = FlushPool::instance();
 
-                        if (doWrite)
-                            child = writeNode(t, std::move(child));
+    std::size_t workers = 1;
+    if (doWrite)
+        workers = std::min(branches.size(), pool.threads());
 
-                        node->shareChild(branch, child);
-                    }
-                }
-            }
+    // Shared with the pool, whose threads may get to a flush after it took
+    // every subtree and returned: they only touch the subtrees they take.
+    struct Flush
+    {
+        explicit Flush(std::size_t n) : count(n)
+        {
         }
 
-        // update the hash of this inner node
-        node->updateHashDeep();
+        std::size_t const count;
+        std::atomic<std::size_t> next = 0;
+        std::atomic<int> flushed = 0;
 
-        // This inner node can now be shared
-        node->unshare();
+        std::mutex mutex;
+        std::condition_variable cond;
+        int active = 0;
+        std::exception_ptr error;
+    };
 
-        if (doWrite)
-            node = std::static_pointer_cast<SHAMapInnerNode>(
-                writeNode(t, std::move(node)));
+    auto const flush = std::make_shared<Flush>(branches.size());
+
+    auto work = [this, flush, &subtrees, &branches, doWrite, t]() {
+        {
+            std::lock_guard lock(flush->mutex);
+            ++flush->active;
+        }
 
-        ++flushed;
+        int count = 0;
+        try
+        {
+            for (auto i = flush->next++; i < flush->count; i = flush->next++)
+            {
+                auto& subtree = subtrees[branches[i]];
+                subtree = flushSubTree(std::move(subtree), doWrite, t, count);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard lock(flush->mutex);
+            if (!flush->error)
+                flush->error = std::current_exception();
+        }
+        flush->flushed += count;
 
-        if (stack.empty())
-            break;
+        std::lock_guard lock(flush->mutex);
+        if (--flush->active == 0)
+            flush->cond.notify_all();
+    };
 
-        auto parent = std::move(stack.top().first);
-        pos = stack.top().second;
-        stack.pop();
+    if (workers > 1)
+    {
+        JLOG(journal_.debug()) << "flushing " << branches.size()
+                               << " subtrees on " << workers << " threads";
 
-        // Hook this inner node to its parent
-        assert(parent->cowid() == cowid_);
-        parent->shareChild(pos, node);
+        for (std::size_t i = 1; i < workers; ++i)
+            pool.post(work);
+    }
 
-        // Continue with parent's next child, if any
-        node = std::move(parent);
-        ++pos;
+    // Every subtree is taken once this returns, wait for those still
+    // being flushed by the pool
+    work();
+    {
+        std::unique_lock lock(flush->mutex);
+        flush->cond.wait(lock, [&flush] { return flush->active == 0; });
     }
 
-    // Last inner node is the new root_
+    if (flush->error)
+        std::rethrow_exception(flush->error);
+
+    flushed += flush->flushed;
+
+    // Hook the flushed subtrees to the root, which is finished last
+    for (auto const branch : branches)
+        node->shareChild(branch, subtrees[branch]);
+
+    node->updateHashDeep();
+    node->unshare();
+
+    if (doWrite)
+        node = std::static_pointer_cast<SHAMapInnerNode>(
+            writeNode(t, std::move(node)));
+
+    ++flushed;
+
     root_ = std::move(node);
 
     return flushed;
 }
 
+std::shared_ptr<SHAMapInnerNode>
+SHAMap::flushSubTree(
+    std::shared_ptr<SHAMapInnerNode> node,
+    bool doWrite,
+    NodeObjectType t,
+    int& flushed) const
+{
+    // The inner nodes to flush, in breadth first order so those at the same
+    // depth are adjacent, each with the index of its parent and its branch
+    // in the parent. The node flushed has no parent here.
+    struct Dirty
+    {
+        std::shared_ptr<SHAMapInnerNode> node;
+        std::size_t parent;
+        int branch;
+        int depth;
+    };
+    static constexpr std::size_t noParent =
+        std::numeric_limits<std::size_t>::max();
+
+    std::vector<Dirty> dirty;
+    dirty.push_back({std::move(node), noParent, 0, 0});
+
+    // Flush the leaves as they are found, they were hashed when modified.
+    for (std::size_t i = 0; i < dirty.size(); ++i)
+    {
+        for (int branch = 0; branch < branchFactor; ++branch)
+        {
+            // don't hold a reference into dirty, it may reallocate
+            auto parent = dirty[i].node.get();
+
+            if (parent->isEmptyBranch(branch))
+                continue;
+
+            // No need to do I/O. If the node isn't linked,
+            // it can't need to be flushed
+            auto child = parent->getChild(branch);
+
+            if (!child || (child->cowid() == 0))
+                continue;
+
+            // This is a node that needs to be flushed
+            child = preFlushNode(std::move(child));
+
+            if (child->isInner())
+            {
+                dirty.push_back(
+                    {std::static_pointer_cast<SHAMapInnerNode>(
+                         std::move(child)),
+                     i,
+                     branch,
+                     dirty[i].depth + 1});
+            }
+            else
+            {
+                // flush this leaf
+                ++flushed;
+
+                assert(parent->cowid() == cowid_);
+                child->updateHash();
+                child->unshare();
+
+                if (doWrite)
+                    child = writeNode(t, std::move(child));
+
+                parent->shareChild(branch, child);
+            }
+        }
+    }
+
+    // We can't flush an inner node until we flush its children, so work up
+    // from the deepest level, hashing all the inner nodes of a level at once.
+    std::vector<SHAMapInnerNode*> level;
+    for (auto end = dirty.size(); end > 0;)
+    {
+        auto begin = end;
+        while (begin > 0 && dirty[begin - 1].depth == dirty[end - 1].depth)
+            --begin;
+
+        level.clear();
+        for (auto i = begin; i < end; ++i)
+            level.push_back(dirty[i].node.get());
+
+        // update the hashes of these inner nodes
+        SHAMapInnerNode::updateHashesDeep(level.data(), level.size());
+
+        for (auto i = begin; i < end; ++i)
+        {
+            auto& entry = dirty[i];
+
+            // This inner node can now be shared
+            entry.node->unshare();
+
+            if (doWrite)
+                entry.node = std::static_pointer_cast<SHAMapInnerNode>(
+                    writeNode(t, std::move(entry.node)));
+
+            ++flushed;
+
+            // Hook this inner node to its parent
+            if (entry.parent != noParent)
+            {
+                auto const& parent = dirty[entry.parent].node;
+                assert(parent->cowid() == cowid_);
+                parent->shareChild(entry.branch, entry.node);
+                entry.node.reset();
+            }
+        }
+
+        end = begin;
+    }
+
+    // The top of the flushed inner nodes takes the place of node
+    return std::move(dirty.front().node);
+}
+
 void
 SHAMap::dump(bool hash) const
 {
@@ -30,8 +30,10 @@
 #include <ripple/shamap/impl/TaggedPointer.ipp>
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <utility>
+#include <vector>
 
 namespace ripple {
 
@@ -222,6 +224,59 @@ SHAMapInnerNode::updateHashDeep()
     updateHash();
 }
 
+void
+SHAMapInnerNode::updateHashesDeep(SHAMapInnerNode* const* nodes, std::size_t count)
+{
+    // The prefix and the 16 child hashes updateHash feeds the hasher
+    static constexpr std::size_t messageSize =
+        sizeof(std::uint32_t) + branchFactor * uint256::size();
+
+    std::vector<std::uint8_t> buffer(count * messageSize);
+    std::vector<std::uint8_t const*> messages;
+    std::vector<SHAMapInnerNode*> hashed;
+    messages.reserve(count);
+    hashed.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto node = nodes[i];
+
+        SHAMapHash* hashes;
+        std::shared_ptr<SHAMapTreeNode>* children;
+        std::tie(std::ignore, hashes, children) =
+            node->hashesAndChildren_.getHashesAndChildren();
+        node->iterNonEmptyChildIndexes([&](auto branchNum, auto indexNum) {
+            if (children[indexNum] != nullptr)
+                hashes[indexNum] = children[indexNum]->getHash();
+        });
+
+        if (node->isBranch_ == 0)
+        {
+            node->hash_ = SHAMapHash{};
+            continue;
+        }
+
+        auto out = buffer.data() + hashed.size() * messageSize;
+        messages.push_back(out);
+        hashed.push_back(node);
+
+        std::uint32_t const prefix = boost::endian::native_to_big(
+            static_cast<std::uint32_t>(HashPrefix::innerNode));
+        std::memcpy(out, &prefix, sizeof(prefix));
+        out += sizeof(prefix);
+        node->iterChildren([&](SHAMapHash const& hh) {
+            std::memcpy(out, hh.as_uint256().data(), uint256::size());
+            out += uint256::size();
+        });
+    }
+
+    std::vector<uint256> results(hashed.size());
+    sha512HalfBatch(messages.data(), messageSize, hashed.size(), results.data());
+
+    for (std::size_t i = 0; i < hashed.size(); ++i)
+        hashed[i]->hash_ = SHAMapHash{results[i]};
+}
+
 void
 SHAMapInnerNode::serializeForWire(Serializer& s) const
 {
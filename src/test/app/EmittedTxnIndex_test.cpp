@@ -0,0 +1,183 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/EmittedTxnIndex.h>
+#include <ripple/ledger/Sandbox.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/LedgerFormats.h>
+#include <test/jtx.h>
+
+namespace ripple {
+namespace test {
+
+class EmittedTxnIndex_test : public beast::unit_test::suite
+{
+    std::shared_ptr<STTx const>
+    emitted(
+        jtx::Account const& account,
+        std::uint32_t firstSeq,
+        std::uint32_t lastSeq,
+        std::uint64_t nonce)
+    {
+        return std::make_shared<STTx const>(ttACCOUNT_SET, [&](STObject& obj) {
+            obj.setAccountID(sfAccount, account.id());
+            obj.setFieldU32(sfSequence, 0);
+            obj.setFieldAmount(sfFee, STAmount{10});
+            obj.setFieldVL(sfSigningPubKey, Slice{});
+            obj.setFieldU32(sfFirstLedgerSequence, firstSeq);
+            obj.setFieldU32(sfLastLedgerSequence, lastSeq);
+
+            STObject details(sfEmitDetails);
+            details.setFieldU32(sfEmitGeneration, 1);
+            details.setFieldU64(sfEmitBurden, 1);
+            details.setFieldH256(sfEmitParentTxnID, uint256{nonce});
+            details.setFieldH256(sfEmitNonce, uint256{nonce});
+            details.setFieldH256(sfEmitHookHash, uint256{});
+            obj.emplace_back(std::move(details));
+        });
+    }
+
+    // add the entry finalizeHookResult would add for tx
+    void
+    insert(ApplyView& view, STTx const& tx)
+    {
+        auto const key = keylet::emittedTxn(tx.getTransactionID());
+        auto sle = std::make_shared<SLE>(key);
+
+        Serializer s;
+        tx.add(s);
+        SerialIter sit(s.slice());
+        sle->emplace_back(STObject(sit, sfEmittedTxn));
+
+        auto const page = view.dirInsert(keylet::emittedDir(), key, [](SLE::ref dir) {
+            (*dir)[sfFlags] = lsfEmittedDir;
+        });
+        BEAST_EXPECT(page);
+        (*sle)[sfOwnerNode] = *page;
+        view.insert(sle);
+    }
+
+    void
+    erase(ApplyView& view, STTx const& tx)
+    {
+        auto const sle = view.peek(keylet::emittedTxn(tx.getTransactionID()));
+        BEAST_EXPECT(view.dirRemove(
+            keylet::emittedDir(), sle->getFieldU64(sfOwnerNode), sle->key(), false));
+        view.erase(sle);
+    }
+
+    static bool
+    holds(
+        std::vector<std::shared_ptr<STTx const>> const& txs,
+        std::shared_ptr<STTx const> const& tx)
+    {
+        return std::any_of(txs.begin(), txs.end(), [&](auto const& t) {
+            return t->getTransactionID() == tx->getTransactionID();
+        });
+    }
+
+    void
+    testDue()
+    {
+        testcase("due transactions");
+
+        using namespace jtx;
+        Env env{*this};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        Sandbox sb(env.closed().get(), tapNONE);
+        auto const seq = sb.seq();
+        auto const ready = emitted(alice, seq, seq + 5, 1);
+        auto const held = emitted(alice, seq + 1, seq + 5, 2);
+        auto const expired = emitted(alice, seq - 1, seq - 1, 3);
+        for (auto const& tx : {ready, held, expired})
+            insert(sb, *tx);
+
+        hook::EmittedTxnIndex index;
+        auto const due = index.update(sb, env.journal);
+        BEAST_EXPECT(due.pending.size() == 3);
+        BEAST_EXPECT(due.ready.size() == 1 && holds(due.ready, ready));
+        BEAST_EXPECT(due.expired.size() == 1 && holds(due.expired, expired));
+        BEAST_EXPECT(index.size() == 3);
+
+        // entries are parsed once, later updates hand back the same transaction
+        auto const again = index.update(sb, env.journal);
+        BEAST_EXPECT(again.ready.size() == 1 && again.ready[0] == due.ready[0]);
+
+        // the directory is the authority
+        erase(sb, *held);
+        erase(sb, *expired);
+        auto const after = index.update(sb, env.journal);
+        BEAST_EXPECT(after.pending.size() == 1);
+        BEAST_EXPECT(after.expired.empty());
+        BEAST_EXPECT(index.size() == 1);
+
+        index.removed(ready->getTransactionID());
+        BEAST_EXPECT(index.size() == 0);
+        BEAST_EXPECT(index.update(sb, env.journal).ready.size() == 1);
+        BEAST_EXPECT(index.size() == 1);
+    }
+
+    void
+    testEmitted()
+    {
+        testcase("transactions emitted here");
+
+        using namespace jtx;
+        Env env{*this};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        Sandbox sb(env.closed().get(), tapNONE);
+        auto const seq = sb.seq();
+        auto const mine = emitted(alice, seq, seq + 2, 4);
+        auto const stale = emitted(alice, seq - 1, seq - 1, 5);
+
+        // handed over before their entries reach the directory the index is reading
+        hook::EmittedTxnIndex index;
+        index.emitted(mine);
+        index.emitted(stale);
+        BEAST_EXPECT(index.size() == 2);
+
+        // not yet in the directory so not due, and one can no longer become due
+        auto const due = index.update(sb, env.journal);
+        BEAST_EXPECT(due.pending.empty() && due.ready.empty() && due.expired.empty());
+        BEAST_EXPECT(index.size() == 1);
+
+        // once there, the transaction handed over is used as is
+        insert(sb, *mine);
+        auto const now = index.update(sb, env.journal);
+        BEAST_EXPECT(now.ready.size() == 1 && now.ready[0] == mine);
+    }
+
+public:
+    void
+    run() override
+    {
+        testDue();
+        testEmitted();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(EmittedTxnIndex, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
@@ -0,0 +1,535 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/Guard.h>
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/basics/Blob.h>
+#include <ripple/beast/unit_test.h>
+#include <test/app/Guard_legacy.h>
+#include <test/app/SetHook_wasm.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace ripple {
+namespace test {
+
+namespace {
+
+using Verdict = std::optional<std::pair<uint64_t, uint64_t>>;
+
+Verdict
+verdict(Blob const& code)
+{
+    return validateGuards(makeSlice(code), {}, "");
+}
+
+// the checker validateGuards replaced, which throws where it now rejects
+Verdict
+legacyVerdict(Blob const& code)
+{
+    try
+    {
+        return guard_legacy::validateGuards(code, {}, "");
+    }
+    catch (std::exception const&)
+    {
+        return {};
+    }
+}
+
+void
+appendLeb(Blob& out, uint64_t v)
+{
+    do
+    {
+        uint8_t b = v & 0x7FU;
+        v >>= 7;
+        out.push_back(v ? (b | 0x80U) : b);
+    } while (v);
+}
+
+void
+appendSection(Blob& out, uint8_t id, Blob const& content)
+{
+    out.push_back(id);
+    appendLeb(out, content.size());
+    out.insert(out.end(), content.begin(), content.end());
+}
+
+/**
+ * Builds hooks importing _g (function 0) and accept (function 1) which export hook() and
+ * optionally cbak(). The bodies are exprs without their final end.
+ */
+Blob
+buildHook(Blob const& hookBody, std::optional<Blob> const& cbakBody = {})
+{
+    Blob hook{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+
+    // (i32, i32) -> i32 for _g, (i32, i32, i64) -> i64 for accept, (i32) -> i64 for hook and cbak
+    appendSection(hook, 1, {
+        0x03,
+        0x60, 0x02, 0x7F, 0x7F, 0x01, 0x7F,
+        0x60, 0x03, 0x7F, 0x7F, 0x7E, 0x01, 0x7E,
+        0x60, 0x01, 0x7F, 0x01, 0x7E});
+
+    appendSection(hook, 2, {
+        0x02,
+        0x03, 'e', 'n', 'v', 0x02, '_', 'g', 0x00, 0x00,
+        0x03, 'e', 'n', 'v', 0x06, 'a', 'c', 'c', 'e', 'p', 't', 0x00, 0x01});
+
+    appendSection(hook, 3, cbakBody ? Blob{0x02, 0x02, 0x02} : Blob{0x01, 0x02});
+
+    Blob exports{uint8_t(cbakBody ? 2 : 1), 0x04, 'h', 'o', 'o', 'k', 0x00, 0x02};
+    if (cbakBody)
+        exports.insert(exports.end(), {0x04, 'c', 'b', 'a', 'k', 0x00, 0x03});
+    appendSection(hook, 7, exports);
+
+    Blob code{uint8_t(cbakBody ? 2 : 1)};
+    for (Blob const* body : {&hookBody, cbakBody ? &*cbakBody : nullptr})
+    {
+        if (!body)
+            continue;
+        appendLeb(code, body->size() + 2);
+        code.push_back(0x00);   // no locals
+        code.insert(code.end(), body->begin(), body->end());
+        code.push_back(0x0B);
+    }
+    appendSection(hook, 10, code);
+
+    return hook;
+}
+
+// body followed by the i64.const 0 hook() and cbak() return
+Blob
+returning(Blob body)
+{
+    body.insert(body.end(), {0x42, 0x00});
+    return body;
+}
+
+// a guarded loop around body: _g(id, bound), which returns an i32 that is dropped
+Blob
+loop(uint32_t id, uint32_t bound, Blob const& body)
+{
+    Blob out{0x03, 0x40, 0x41};
+    appendLeb(out, id & 0x3FU);
+    out.push_back(0x41);
+    appendLeb(out, bound);
+    out.insert(out.end(), {0x10, 0x00, 0x1A});
+    out.insert(out.end(), body.begin(), body.end());
+    out.push_back(0x0B);
+    return out;
+}
+
+// a random expr of the instructions hooks are made of, nested at most depth blocks deep
+void
+randomExpr(Blob& out, std::mt19937& rng, int depth, uint32_t bound)
+{
+    std::size_t const count = rng() % 6;
+    for (std::size_t n = 0; n < count; ++n)
+    {
+        switch (rng() % 9)
+        {
+            case 0:     // i32.const, drop
+                out.push_back(0x41);
+                appendLeb(out, rng() % 100000);
+                out.push_back(0x1A);
+                break;
+            case 1:     // block
+            case 2:     // if
+                if (depth <= 0)
+                    break;
+                out.insert(out.end(), {uint8_t(rng() % 2 ? 0x02 : 0x04), 0x40});
+                randomExpr(out, rng, depth - 1, bound);
+                out.push_back(0x0B);
+                break;
+            case 3:     // loop
+            {
+                if (depth <= 0)
+                    break;
+                uint32_t const b = bound * (1 + rng() % 8);
+                Blob body;
+                randomExpr(body, rng, depth - 1, b);
+                Blob const l = loop(rng(), b, body);
+                out.insert(out.end(), l.begin(), l.end());
+                break;
+            }
+            case 4:     // accept(0, 0, 0)
+                out.insert(out.end(), {0x41, 0x00, 0x41, 0x00, 0x42, 0x00, 0x10, 0x01, 0x1A});
+                break;
+            case 5:     // local.get 0, br_if 0
+                out.insert(out.end(), {0x20, 0x00, 0x0D, 0x00});
+                break;
+            case 6:     // f64.const, drop
+                out.push_back(0x44);
+                for (int b = 0; b < 8; ++b)
+                    out.push_back(rng());
+                out.push_back(0x1A);
+                break;
+            case 7:     // i32.load offset, drop
+                out.insert(out.end(), {0x41, 0x00, 0x28, 0x02});
+                appendLeb(out, rng() % 1000);
+                out.push_back(0x1A);
+                break;
+            default:
+                out.push_back(0x01);    // nop
+        }
+    }
+}
+
+Blob
+randomHook(std::mt19937& rng)
+{
+    // mostly within the nesting limit, sometimes past it
+    int const depth = rng() % 4 == 0 ? 20 : 1 + rng() % 5;
+    Blob hookBody;
+    randomExpr(hookBody, rng, depth, 1);
+    if (rng() % 2)
+        return buildHook(returning(hookBody));
+
+    Blob cbakBody;
+    randomExpr(cbakBody, rng, depth, 1);
+    return buildHook(returning(hookBody), returning(cbakBody));
+}
+
+void
+mutate(Blob& code, std::mt19937& rng)
+{
+    static uint8_t const interesting[] = {
+        0x00, 0x01, 0x02, 0x03, 0x0B, 0x10, 0x11, 0x40, 0x41, 0x7F, 0x80, 0xFF};
+
+    if (code.empty())
+        return;
+
+    std::size_t const at = rng() % code.size();
+    switch (rng() % 7)
+    {
+        case 0:
+            code[at] ^= uint8_t(1U << (rng() % 8));
+            break;
+        case 1:
+            code[at] = interesting[rng() % std::size(interesting)];
+            break;
+        case 2:
+            code[at] = rng();
+            break;
+        case 3:
+            code.insert(code.begin() + at, interesting[rng() % std::size(interesting)]);
+            break;
+        case 4:
+            code.erase(code.begin() + at);
+            break;
+        case 5:
+            code.resize(at);
+            break;
+        default:
+        {
+            // repeat a few bytes, sections and instructions are often duplicated whole this way
+            std::size_t const len = std::min<std::size_t>(1 + rng() % 16, code.size() - at);
+            Blob const copy(code.begin() + at, code.begin() + at + len);
+            code.insert(code.begin() + rng() % code.size(), copy.begin(), copy.end());
+        }
+    }
+}
+
+}  // namespace
+
+class Guard_test : public beast::unit_test::suite
+{
+    void
+    expectSameVerdict(Blob const& code, std::string const& what)
+    {
+        auto const expected = legacyVerdict(code);
+        auto const actual = verdict(code);
+        if (expected == actual)
+        {
+            pass();
+            return;
+        }
+
+        fail(what + " " + strHex(code), __FILE__, __LINE__);
+    }
+
+    void
+    testLeb128()
+    {
+        testcase("leb128");
+
+        auto const leb = [](Blob const& buf, int offset) {
+            uint64_t val = 1;
+            bool const ok = parseLeb128(makeSlice(buf), offset, val);
+            return std::make_tuple(ok, val, offset);
+        };
+
+        BEAST_EXPECT(leb({0x05}, 0) == std::make_tuple(true, 5ULL, 1));
+        BEAST_EXPECT(leb({0x00, 0x80, 0x01, 0x00}, 1) == std::make_tuple(true, 128ULL, 3));
+        BEAST_EXPECT(leb({0xE5, 0x8E, 0x26}, 0) == std::make_tuple(true, 624485ULL, 3));
+
+        // nothing to decode, the callers' bounds checks find that
+        BEAST_EXPECT(leb({0x05}, 1) == std::make_tuple(true, 0ULL, 1));
+        BEAST_EXPECT(leb({0x05}, -3) == std::make_tuple(true, 0ULL, -3));
+
+        // truncated
+        BEAST_EXPECT(!std::get<0>(leb({0x80}, 0)));
+        BEAST_EXPECT(!std::get<0>(leb({0x05, 0xFF, 0xFF}, 1)));
+
+        // ten bytes just fit, the eleventh overflows
+        Blob big(9, 0xFF);
+        big.push_back(0x7F);
+        BEAST_EXPECT(leb(big, 0) == std::make_tuple(true, ~0ULL, 10));
+        big.back() = 0xFF;
+        big.push_back(0x01);
+        BEAST_EXPECT(!std::get<0>(leb(big, 0)));
+
+        // the same values and failures as the throwing decoder
+        std::mt19937 rng{128};
+        for (int n = 0; n < 10000; ++n)
+        {
+            Blob buf(1 + rng() % 12);
+            for (auto& b : buf)
+                b = rng() % 3 ? (rng() | 0x80U) : rng();
+
+            int const offset = rng() % (buf.size() + 1);
+            std::optional<std::pair<uint64_t, int>> expected;
+            try
+            {
+                int end = offset;
+                uint64_t const val = guard_legacy::parseLeb128(buf, offset, &end);
+                expected.emplace(val, end);
+            }
+            catch (std::exception const&)
+            {
+            }
+
+            auto const [ok, val, end] = leb(buf, offset);
+            BEAST_EXPECT(ok == bool(expected));
+            if (ok && expected)
+                BEAST_EXPECT(val == expected->first && end == expected->second);
+
+            int signedEnd = offset;
+            bool const signedOk = skipSignedLeb128(makeSlice(buf), signedEnd);
+            try
+            {
+                int end = offset;
+                guard_legacy::parseSignedLeb128(buf, offset, &end);
+                BEAST_EXPECT(signedOk && signedEnd == end);
+            }
+            catch (std::exception const&)
+            {
+                BEAST_EXPECT(!signedOk);
+            }
+        }
+    }
+
+    void
+    testVerdicts()
+    {
+        testcase("verdicts");
+
+        // the loop counts the drop of _g's result, its nop and its end 10 times, the body its loop,
+        // i64.const and end once
+        Blob const guarded = buildHook(returning(loop(1, 10, {0x01})));
+        BEAST_EXPECT(verdict(guarded) == Verdict({33, 0}));
+
+        // a loop nested in another runs the quotient of their bounds times per outer iteration
+        Blob const nested = buildHook(
+            returning(loop(1, 10, loop(2, 100, {0x01}))),
+            returning({}));
+        BEAST_EXPECT(verdict(nested) == Verdict({333, 2}));
+
+        // a loop without a guard
+        BEAST_EXPECT(!verdict(buildHook(returning({0x03, 0x40, 0x01, 0x0B}))));
+
+        // too many iterations
+        BEAST_EXPECT(!verdict(buildHook(returning(loop(1, 0xFFFF, {0x01})))));
+
+        // 16 blocks deep is the most allowed
+        auto const blocks = [](int depth) {
+            Blob body;
+            for (int d = 0; d < depth; ++d)
+                body.insert(body.end(), {0x02, 0x40});
+            body.insert(body.end(), depth, 0x0B);
+            return buildHook(returning(body));
+        };
+        BEAST_EXPECT(verdict(blocks(16)));
+        BEAST_EXPECT(!verdict(blocks(17)));
+
+        // calling a function which is not an import
+        BEAST_EXPECT(!verdict(buildHook(returning({0x41, 0x00, 0x10, 0x02, 0x1A}))));
+
+        for (Blob const& code : {guarded, nested, blocks(16), blocks(17)})
+            expectSameVerdict(code, "built");
+
+        // every prefix of a valid hook
+        for (std::size_t n = 0; n <= nested.size(); ++n)
+            expectSameVerdict(Blob(nested.begin(), nested.begin() + n), "prefix");
+    }
+
+    void
+    testCorpus()
+    {
+        testcase("corpus");
+
+        for (auto const& [source, code] : wasm)
+            expectSameVerdict(code, "corpus");
+    }
+
+    void
+    testMutations()
+    {
+        testcase("mutations");
+
+        std::mt19937 rng{0x6A0D};
+        std::vector<Blob> seeds;
+        for (auto const& [source, code] : wasm)
+            seeds.push_back(code);
+        for (int n = 0; n < 200; ++n)
+            seeds.push_back(randomHook(rng));
+
+        std::size_t valid = 0;
+        for (Blob const& seed : seeds)
+        {
+            valid += bool(verdict(seed));
+            expectSameVerdict(seed, "seed");
+            for (int n = 0; n < 100; ++n)
+            {
+                Blob code = seed;
+                for (std::size_t m = 1 + rng() % 3; m > 0; --m)
+                    mutate(code, rng);
+                expectSameVerdict(code, "mutation");
+            }
+        }
+
+        // most of the built hooks are valid, so the mutations start from where it matters
+        BEAST_EXPECT(valid > seeds.size() / 2);
+    }
+
+public:
+    void
+    run() override
+    {
+        testLeb128();
+        testVerdicts();
+        testCorpus();
+        testMutations();
+    }
+};
+
+/**
+ * Times validateGuards against the checker it replaced, on the SetHook_test corpus and on a
+ * synthetic hook of close to the maximum size.
+ *
+ *   --unittest=GuardBench --unittest-arg=file=<hook.wasm>,iterations=<n>
+ *
+ * file         a wasm file to validate as well
+ * iterations   validations timed per hook (default 1000)
+ */
+class GuardBench_test : public beast::unit_test::suite
+{
+    // a valid hook of nearly maxHookWasmSize bytes, guarded loops of f64.consts
+    static Blob
+    largeHook()
+    {
+        std::size_t const size = hook::maxHookWasmSize() - 256;
+        std::mt19937 rng{7};
+        Blob body;
+        while (body.size() + 512 < size)
+        {
+            Blob inner;
+            for (int n = 0; n < 40; ++n)
+            {
+                inner.push_back(0x44);
+                for (int b = 0; b < 8; ++b)
+                    inner.push_back(rng());
+                inner.push_back(0x1A);
+            }
+            Blob const l = loop(body.size(), 2, inner);
+            body.insert(body.end(), l.begin(), l.end());
+        }
+        return buildHook(returning(body));
+    }
+
+    void
+    bench(std::string const& name, Blob const& code, std::size_t iterations)
+    {
+        using namespace std::chrono;
+
+        auto const time = [&](auto&& validate) {
+            auto const start = steady_clock::now();
+            for (std::size_t n = 0; n < iterations; ++n)
+                validate(code);
+            return duration_cast<nanoseconds>(steady_clock::now() - start) / iterations;
+        };
+
+        auto const legacyTime = time(legacyVerdict);
+        auto const sliceTime = time(verdict);
+
+        log << name << " (" << code.size() << " bytes, "
+            << (verdict(code) ? "valid" : "invalid") << "): legacy "
+            << legacyTime.count() << "ns, slice " << sliceTime.count() << "ns" << std::endl;
+
+        BEAST_EXPECT(legacyVerdict(code) == verdict(code));
+    }
+
+public:
+    void
+    run() override
+    {
+        std::string file;
+        std::size_t iterations = 1000;
+
+        std::string const args = arg();
+        std::size_t pos = 0;
+        while (pos < args.size())
+        {
+            std::size_t const end = std::min(args.find(',', pos), args.size());
+            std::string const kv = args.substr(pos, end - pos);
+            pos = end + 1;
+
+            std::size_t const eq = kv.find('=');
+            if (eq == std::string::npos)
+                continue;
+            if (kv.substr(0, eq) == "file")
+                file = kv.substr(eq + 1);
+            else if (kv.substr(0, eq) == "iterations")
+                iterations = std::max<std::size_t>(1, std::stoul(kv.substr(eq + 1)));
+        }
+
+        if (!file.empty())
+        {
+            std::ifstream in(file, std::ios::binary);
+            if (!BEAST_EXPECT(in))
+                return;
+            bench(file, Blob{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()}, iterations);
+        }
+
+        std::size_t i = 0;
+        for (auto const& [source, code] : wasm)
+            bench("corpus hook " + std::to_string(i++), code, iterations);
+
+        bench("large hook", largeHook(), iterations);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(Guard, app, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(GuardBench, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
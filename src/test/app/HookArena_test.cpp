@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/HookArena.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/beast/unit_test.h>
+#include <boost/container/pmr/global_resource.hpp>
+#include <thread>
+
+namespace ripple {
+namespace test {
+
+class HookArena_test : public beast::unit_test::suite
+{
+    using HookArena = hook::HookArena;
+
+    void
+    testScope()
+    {
+        testcase("scope");
+
+        namespace pmr = boost::container::pmr;
+
+        BEAST_EXPECT(HookArena::resource() == pmr::get_default_resource());
+
+        auto const before = HookArena::getCounts();
+        {
+            HookArena::Scope scope;
+            auto* const arena = HookArena::resource();
+            BEAST_EXPECT(arena != pmr::get_default_resource());
+
+            {
+                // nested scopes share the arena and don't release it
+                HookArena::Scope inner;
+                BEAST_EXPECT(HookArena::resource() == arena);
+            }
+            BEAST_EXPECT(HookArena::resource() == arena);
+
+            hook::ArenaMap<uint256, bool> nonces{arena};
+            hook::ArenaMap<uint32_t, uint32_t> guards{arena};
+            hook::ArenaQueue<uint32_t> slots{
+                hook::ArenaAllocator<uint32_t>{arena}};
+            for (std::uint32_t i = 0; i < 32; ++i)
+            {
+                nonces[uint256{i}] = true;
+                guards[i] = i;
+                slots.push(i);
+            }
+            BEAST_EXPECT(nonces.size() == 32);
+            BEAST_EXPECT(guards.at(31) == 31);
+            BEAST_EXPECT(slots.front() == 0);
+        }
+        BEAST_EXPECT(HookArena::resource() == pmr::get_default_resource());
+
+        auto const after = HookArena::getCounts();
+        BEAST_EXPECT(after.phases == before.phases + 1);
+        BEAST_EXPECT(after.allocations >= before.allocations + 64);
+        BEAST_EXPECT(after.bytes > before.bytes);
+    }
+
+    void
+    testRelease()
+    {
+        testcase("release");
+
+        // a phase which fits the initial buffer never takes from the heap,
+        // however often it runs on the same thread
+        std::thread([this] {
+            auto const before = HookArena::getCounts();
+            for (int phase = 0; phase < 100; ++phase)
+            {
+                HookArena::Scope scope;
+                hook::ArenaMap<uint32_t, uint32_t> guards{
+                    HookArena::resource()};
+                for (std::uint32_t i = 0; i < 64; ++i)
+                    guards[i] = i;
+            }
+            auto const after = HookArena::getCounts();
+            BEAST_EXPECT(after.phases >= before.phases + 100);
+            BEAST_EXPECT(after.allocations >= before.allocations + 6400);
+            BEAST_EXPECT(after.heapBlocks == before.heapBlocks);
+        }).join();
+
+        // one that doesn't takes more blocks and releases them at its end
+        std::thread([this] {
+            auto const before = HookArena::getCounts();
+            for (int phase = 0; phase < 2; ++phase)
+            {
+                HookArena::Scope scope;
+                auto* const arena = HookArena::resource();
+                void* p = arena->allocate(4 * HookArena::initialSize);
+                BEAST_EXPECT(p != nullptr);
+                arena->deallocate(p, 4 * HookArena::initialSize);
+            }
+            auto const after = HookArena::getCounts();
+            BEAST_EXPECT(after.heapBlocks == before.heapBlocks + 2);
+        }).join();
+    }
+
+public:
+    void
+    run() override
+    {
+        testScope();
+        testRelease();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookArena, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
@@ -0,0 +1,243 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/app/tx/impl/ApplyContext.h>
+#include <ripple/ledger/OpenView.h>
+#include <ripple/protocol/digest.h>
+#include <test/app/SetHook_wasm.h>
+#include <test/jtx.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+namespace ripple {
+namespace test {
+
+/**
+ * Executes a hook outside of any transactor, straight through hook::apply on an in-memory ledger,
+ * and reports how long an execution takes and what it did. Without arguments every hook of the
+ * SetHook_test corpus (see build_test_hooks.sh) is run in turn.
+ *
+ *   --unittest=HookBench --unittest-arg=file=<hook.wasm>,iterations=<n>,accounts=<n>,state=<n>
+ *
+ * file         a wasm file to run instead of the corpus
+ * iterations   executions measured per hook, after one which loads the module (default 1000)
+ * accounts     funded accounts, the first has the hook and the others send it payments (default 2)
+ * state        HookState entries put in the hook account's namespace beforehand (default 0)
+ */
+class HookBench_test : public beast::unit_test::suite
+{
+    struct Options
+    {
+        std::string file;
+        std::size_t iterations = 1000;
+        std::size_t accounts = 2;
+        std::size_t state = 0;
+    };
+
+    Options
+    parseArgs()
+    {
+        Options opts;
+        std::string const args = arg();
+        std::size_t pos = 0;
+        while (pos < args.size())
+        {
+            std::size_t const end = std::min(args.find(',', pos), args.size());
+            std::string const kv = args.substr(pos, end - pos);
+            pos = end + 1;
+
+            std::size_t const eq = kv.find('=');
+            if (eq == std::string::npos)
+                continue;
+
+            std::string const key = kv.substr(0, eq);
+            std::string const value = kv.substr(eq + 1);
+            if (key == "file")
+                opts.file = value;
+            else if (key == "iterations")
+                opts.iterations = std::stoul(value);
+            else if (key == "accounts")
+                opts.accounts = std::max<std::size_t>(1, std::stoul(value));
+            else if (key == "state")
+                opts.state = std::stoul(value);
+            else
+                log << "HookBench: ignoring unknown argument " << key << std::endl;
+        }
+        return opts;
+    }
+
+    static char const*
+    exitName(uint8_t exitType)
+    {
+        switch (exitType)
+        {
+            case hook_api::ExitType::WASM_ERROR:
+                return "wasm error";
+            case hook_api::ExitType::ROLLBACK:
+                return "rollback";
+            case hook_api::ExitType::ACCEPT:
+                return "accept";
+            default:
+                return "unset";
+        }
+    }
+
+    void
+    bench(
+        jtx::Env& env,
+        OpenView const& seed,
+        std::vector<jtx::Account> const& accounts,
+        std::string const& name,
+        Blob const& code,
+        Options const& opts)
+    {
+        using namespace std::chrono;
+
+        uint256 const hookHash = sha512Half_s(Slice(code.data(), code.size()));
+
+        // the originating transactions, payments to the hook account from every other account
+        std::vector<std::shared_ptr<STTx const>> txs;
+        for (std::size_t i = 1; i < accounts.size(); ++i)
+            txs.push_back(env.jt(jtx::pay(accounts[i], accounts[0], jtx::XRP(1))).stx);
+        if (txs.empty())
+            txs.push_back(env.jt(jtx::noop(accounts[0])).stx);
+
+        std::map<std::vector<uint8_t>, std::vector<uint8_t>> const params;
+        std::map<uint256, std::map<std::vector<uint8_t>, std::vector<uint8_t>>> const overrides;
+
+        std::vector<nanoseconds> times;
+        times.reserve(opts.iterations);
+        uint64_t instructions = 0;
+        uint64_t hostCalls = 0;
+        uint8_t exitType = hook_api::ExitType::UNSET;
+        std::string exitReason;
+
+        // the first execution loads the module into the module cache and is not measured
+        for (std::size_t i = 0; i <= opts.iterations; ++i)
+        {
+            OpenView view(&seed);
+            ApplyContext applyCtx(
+                env.app(), view, *txs[i % txs.size()], tesSUCCESS, FeeUnit64{0}, tapNONE,
+                env.journal);
+            hook::HookStateMap stateMap;
+
+            auto const start = steady_clock::now();
+            auto const result = hook::apply(
+                uint256{}, hookHash, uint256{}, code, params, overrides, stateMap, applyCtx,
+                accounts[0].id(), false, false, true, 0, 0, std::nullopt, {});
+            auto const elapsed = steady_clock::now() - start;
+
+            if (i == 0)
+            {
+                exitType = result.exitType;
+                exitReason = result.exitReason;
+                continue;
+            }
+
+            times.push_back(duration_cast<nanoseconds>(elapsed));
+            instructions += result.instructionCount;
+            hostCalls += result.hostCallCount;
+        }
+
+        if (times.empty())
+            return;
+
+        std::sort(times.begin(), times.end());
+        auto const n = times.size();
+        nanoseconds total{0};
+        for (auto const& t : times)
+            total += t;
+
+        auto const us = [](nanoseconds t) { return duration<double, std::micro>(t).count(); };
+
+        log << name << " (" << code.size() << " bytes, " << exitName(exitType)
+            << (exitReason.empty() ? "" : ": ") << exitReason << ")\n"
+            << "    " << n << " executions, mean " << us(total / n) << "us, p50 "
+            << us(times[n / 2]) << "us, p99 " << us(times[std::min(n - 1, n * 99 / 100)])
+            << "us, max " << us(times.back()) << "us\n"
+            << "    " << instructions / n << " instructions, " << hostCalls / n
+            << " host calls per execution" << std::endl;
+    }
+
+public:
+    void
+    run() override
+    {
+        using namespace jtx;
+
+        Options const opts = parseArgs();
+
+        Env env{*this, supported_amendments()};
+
+        std::vector<Account> accounts;
+        for (std::size_t i = 0; i < opts.accounts; ++i)
+            accounts.emplace_back("bench" + std::to_string(i));
+
+        // the hook account holds the reserve for all of its state
+        env.fund(XRP(1'000'000'000), accounts[0]);
+        for (std::size_t i = 1; i < accounts.size(); ++i)
+            env.fund(XRP(10'000), accounts[i]);
+        env.close();
+
+        OpenView seed(*env.current());
+        if (opts.state > 0)
+        {
+            auto const stx = env.jt(noop(accounts[0])).stx;
+            ApplyContext applyCtx(
+                env.app(), seed, *stx, tesSUCCESS, FeeUnit64{0}, tapNONE, env.journal);
+
+            std::vector<uint8_t> const data(32, 0xAB);
+            for (std::size_t i = 0; i < opts.state; ++i)
+            {
+                TER const ter = hook::setHookState(
+                    applyCtx, accounts[0].id(), uint256{}, uint256{i}, Slice(data.data(), data.size()));
+                if (!BEAST_EXPECT(isTesSuccess(ter)))
+                    return;
+            }
+            applyCtx.apply(tesSUCCESS);
+        }
+
+        if (!opts.file.empty())
+        {
+            std::ifstream in(opts.file, std::ios::binary);
+            if (!BEAST_EXPECT(in))
+            {
+                log << "HookBench: cannot read " << opts.file << std::endl;
+                return;
+            }
+            Blob const code{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+            bench(env, seed, accounts, opts.file, code, opts);
+        }
+        else
+        {
+            std::size_t i = 0;
+            for (auto const& [source, code] : wasm)
+                bench(env, seed, accounts, "corpus hook " + std::to_string(i++), code, opts);
+        }
+
+        pass();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(HookBench, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
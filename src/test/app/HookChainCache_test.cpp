@@ -0,0 +1,250 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/Enum.h>
+#include <ripple/app/hook/HookChainCache.h>
+#include <ripple/ledger/Sandbox.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/STArray.h>
+#include <test/jtx.h>
+
+namespace ripple {
+namespace test {
+
+class HookChainCache_test : public beast::unit_test::suite
+{
+    using Parameters = std::vector<std::pair<std::string, std::string>>;
+
+    static STArray
+    parameters(Parameters const& params)
+    {
+        STArray array{sfHookParameters, params.size()};
+        for (auto const& [name, value] : params)
+        {
+            STObject param{sfHookParameter};
+            param.setFieldVL(sfHookParameterName, makeSlice(name));
+            param.setFieldVL(sfHookParameterValue, makeSlice(value));
+            array.push_back(std::move(param));
+        }
+        return array;
+    }
+
+    static std::vector<uint8_t>
+    bytes(std::string const& s)
+    {
+        return {s.begin(), s.end()};
+    }
+
+    // add a definition the way SetHook creates one, hookOn and flags are its defaults
+    uint256
+    define(
+        ApplyView& view,
+        std::uint64_t nonce,
+        std::uint64_t hookOn,
+        std::uint32_t flags,
+        std::uint32_t feeDrops,
+        Parameters const& params = {})
+    {
+        uint256 const hash{nonce};
+        auto sle = std::make_shared<SLE>(keylet::hookDefinition(hash));
+        sle->setFieldH256(sfHookHash, hash);
+        sle->setFieldU64(sfHookOn, hookOn);
+        sle->setFieldH256(sfHookNamespace, uint256{nonce + 100});
+        sle->setFieldArray(sfHookParameters, parameters(params));
+        sle->setFieldH256(sfHookSetTxnID, uint256{nonce + 200});
+        sle->setFieldU32(sfFlags, flags);
+        sle->setFieldAmount(sfFee, STAmount{feeDrops});
+        view.insert(sle);
+        return hash;
+    }
+
+    static STObject
+    hook(uint256 const& hash)
+    {
+        STObject obj{sfHook};
+        obj.setFieldH256(sfHookHash, hash);
+        return obj;
+    }
+
+    static STObject
+    blank()
+    {
+        return STObject{sfHook};
+    }
+
+    std::shared_ptr<SLE const>
+    install(ApplyView& view, jtx::Account const& account, std::vector<STObject> const& hooks)
+    {
+        auto const keylet = keylet::hook(account.id());
+
+        STArray array{sfHooks, hooks.size()};
+        for (auto const& obj : hooks)
+            array.push_back(obj);
+
+        // SetHook changes the entry it peeked in place, replace it instead so the versions
+        // handed out stay distinct objects
+        if (auto const old = view.peek(keylet))
+            view.erase(old);
+
+        auto sle = std::make_shared<SLE>(keylet);
+        sle->setFieldArray(sfHooks, array);
+        view.insert(sle);
+
+        return view.read(keylet);
+    }
+
+    void
+    testResolve()
+    {
+        testcase("resolve");
+
+        using namespace jtx;
+        Env env{*this};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        Sandbox sb(env.closed().get(), tapNONE);
+
+        // fires on everything but payments
+        auto const weak = define(sb, 1, 1ULL << ttPAYMENT, 0, 10, {{"a", "1"}, {"b", "2"}});
+        // fires on everything but account sets
+        auto const collect = define(sb, 2, 1ULL << ttACCOUNT_SET, hsfCOLLECT, 20);
+
+        STObject overridden = hook(weak);
+        overridden.setFieldH256(sfHookNamespace, uint256{7});
+        overridden.setFieldArray(sfHookParameters, parameters({{"b", "3"}}));
+
+        // the hook object's hookOn lets the first definition fire on payments as well
+        STObject all = hook(weak);
+        all.setFieldU64(sfHookOn, 0);
+
+        auto const sle =
+            install(sb, alice, {overridden, blank(), hook(collect), hook(uint256{99}), all});
+
+        hook::ResolvedHookChain const chain{sb, sle};
+        auto const& hooks = chain.hooks();
+        BEAST_EXPECT(hooks.size() == 4);
+        if (hooks.size() != 4)
+            return;
+
+        // blanks are skipped but still count as a position
+        BEAST_EXPECT(hooks[0].hookNo == 1);
+        BEAST_EXPECT(hooks[1].hookNo == 3);
+        BEAST_EXPECT(hooks[2].hookNo == 4);
+        BEAST_EXPECT(hooks[3].hookNo == 5);
+
+        BEAST_EXPECT(hooks[0].hookNamespace == uint256{7});
+        BEAST_EXPECT(hooks[0].hookSetTxnID == uint256{201});
+        BEAST_EXPECT(hooks[0].parametersValid);
+        BEAST_EXPECT(hooks[0].parameters.size() == 2);
+        BEAST_EXPECT(hooks[0].parameters.at(bytes("a")) == bytes("1"));
+        BEAST_EXPECT(hooks[0].parameters.at(bytes("b")) == bytes("3"));
+        BEAST_EXPECT(hooks[0].feeDrops == 10);
+        BEAST_EXPECT(!hooks[0].hasCallback);
+
+        BEAST_EXPECT(hooks[1].hookNamespace == uint256{102});
+        BEAST_EXPECT(hooks[1].flags == hsfCOLLECT);
+        BEAST_EXPECT(hooks[1].parameters.empty());
+
+        // the definition is not in the ledger
+        BEAST_EXPECT(hooks[2].hookHash == uint256{99});
+        BEAST_EXPECT(!hooks[2].definition);
+
+        BEAST_EXPECT(hooks[3].hookOn == 0);
+        BEAST_EXPECT(hooks[3].parameters.size() == 2);
+        BEAST_EXPECT(hooks[3].parameters.at(bytes("b")) == bytes("2"));
+
+        BEAST_EXPECT(chain.fee(ttPAYMENT, false) == 30);
+        BEAST_EXPECT(chain.fee(ttPAYMENT, true) == 20);
+        BEAST_EXPECT(chain.fee(ttACCOUNT_SET, false) == 20);
+        BEAST_EXPECT(chain.fee(ttACCOUNT_SET, true) == 0);
+        BEAST_EXPECT(chain.fee(ttOFFER_CREATE, false) == 40);
+        // nothing fires on SetHook unless asked for explicitly
+        BEAST_EXPECT(chain.fee(ttHOOK_SET, false) == 0);
+    }
+
+    void
+    testCache()
+    {
+        testcase("cache");
+
+        using namespace jtx;
+        Env env{*this};
+        Account const alice{"alice"};
+        Account const bob{"bob"};
+        Account const carol{"carol"};
+        env.fund(XRP(10000), alice, bob, carol);
+        env.close();
+
+        Sandbox sb(env.closed().get(), tapNONE);
+        auto const hash = define(sb, 1, 0, 0, 10);
+
+        hook::HookChainCache cache{2};
+        BEAST_EXPECT(!cache.resolve(sb, keylet::hook(alice.id())));
+
+        auto const first = install(sb, alice, {hook(hash)});
+        auto const chain = cache.resolve(sb, keylet::hook(alice.id()));
+        BEAST_EXPECT(chain && chain->hookSLE() == first);
+        BEAST_EXPECT(cache.resolve(sb, first) == chain);
+        BEAST_EXPECT(cache.getCounts().hits == 1);
+        BEAST_EXPECT(cache.getCounts().misses == 1);
+
+        // a changed hook SLE is a new object and is resolved again
+        auto const second = install(sb, alice, {hook(hash), hook(hash)});
+        BEAST_EXPECT(second != first);
+        auto const changed = cache.resolve(sb, second);
+        BEAST_EXPECT(changed != chain);
+        BEAST_EXPECT(changed->fee(ttPAYMENT, false) == 20);
+
+        // the previous version is kept as well, the same content in another object is not a hit
+        BEAST_EXPECT(cache.resolve(sb, first) == chain);
+        auto const copy = std::make_shared<SLE const>(*first);
+        BEAST_EXPECT(cache.resolve(sb, copy) != chain);
+        BEAST_EXPECT(cache.getCounts().misses == 3);
+        BEAST_EXPECT(cache.resolve(sb, second) != changed);
+        BEAST_EXPECT(cache.size() == 1);
+
+        // accounts are evicted least recently used first
+        auto const bobs = cache.resolve(sb, install(sb, bob, {hook(hash)}));
+        cache.resolve(sb, copy);
+        cache.resolve(sb, install(sb, carol, {hook(hash)}));
+        BEAST_EXPECT(cache.size() == 2);
+        BEAST_EXPECT(cache.getCounts().evictions == 1);
+        BEAST_EXPECT(cache.resolve(sb, copy) != nullptr);
+        BEAST_EXPECT(cache.getCounts().evictions == 1);
+
+        cache.invalidate(alice.id());
+        cache.invalidate(alice.id());
+        BEAST_EXPECT(cache.size() == 1);
+        BEAST_EXPECT(cache.getCounts().invalidations == 1);
+    }
+
+public:
+    void
+    run() override
+    {
+        testResolve();
+        testCache();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookChainCache, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
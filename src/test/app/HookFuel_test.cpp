@@ -0,0 +1,319 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/Guard.h>
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/app/tx/impl/ApplyContext.h>
+#include <ripple/ledger/OpenView.h>
+#include <ripple/protocol/Feature.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/digest.h>
+#include <test/app/SetHook_wasm.h>
+#include <test/jtx.h>
+
+namespace ripple {
+namespace test {
+
+class HookFuel_test : public beast::unit_test::suite
+{
+    using Params = std::map<std::vector<uint8_t>, std::vector<uint8_t>>;
+
+    // a module exporting hook(i32) -> i64 with the given body, no imports
+    static Blob
+    module(Blob const& body)
+    {
+        Blob code{
+            0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+            0x01, 0x06, 0x01, 0x60, 0x01, 0x7F, 0x01, 0x7E,
+            0x03, 0x02, 0x01, 0x00,
+            0x07, 0x08, 0x01, 0x04, 'h', 'o', 'o', 'k', 0x00, 0x00,
+            0x0A, static_cast<uint8_t>(body.size() + 2), 0x01,
+            static_cast<uint8_t>(body.size())};
+        code.insert(code.end(), body.begin(), body.end());
+        return code;
+    }
+
+    // a module importing _g and exporting hook(i32) -> i64, which runs a loop ten times under
+    // _g(1, bound) and returns 0. it has no globals or data, so instantiating it runs nothing
+    static Blob
+    guarded(uint8_t bound)
+    {
+        Blob const expr{
+            0x03, 0x40,                 // loop
+            0x41, 0x01,                 //   i32.const 1
+            0x41, bound,                //   i32.const bound
+            0x10, 0x00,                 //   call _g
+            0x1A,                       //   drop
+            0x20, 0x01,                 //   local.get 1
+            0x41, 0x01,                 //   i32.const 1
+            0x6A,                       //   i32.add
+            0x22, 0x01,                 //   local.tee 1
+            0x41, 0x0A,                 //   i32.const 10
+            0x49,                       //   i32.lt_u
+            0x0D, 0x00,                 //   br_if 0
+            0x0B,                       // end
+            0x42, 0x00,                 // i64.const 0
+            0x0B};
+        Blob code{
+            0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+            0x01, 0x0C, 0x02, 0x60, 0x02, 0x7F, 0x7F, 0x01, 0x7F,
+            0x60, 0x01, 0x7F, 0x01, 0x7E,
+            0x02, 0x0A, 0x01, 0x03, 'e', 'n', 'v', 0x02, '_', 'g', 0x00, 0x00,
+            0x03, 0x02, 0x01, 0x01,
+            0x07, 0x08, 0x01, 0x04, 'h', 'o', 'o', 'k', 0x00, 0x01,
+            0x0A, static_cast<uint8_t>(expr.size() + 5), 0x01,
+            static_cast<uint8_t>(expr.size() + 3), 0x01, 0x01, 0x7F};
+        code.insert(code.end(), expr.begin(), expr.end());
+        return code;
+    }
+
+    static hook::HookResult
+    run(jtx::Env& env,
+        jtx::Account const& account,
+        STTx const& stx,
+        Blob const& code,
+        std::optional<uint64_t> fuel)
+    {
+        OpenView view(&*env.current());
+        ApplyContext applyCtx(
+            env.app(), view, stx, tesSUCCESS, FeeUnit64{0}, tapNONE,
+            env.journal);
+        hook::HookStateMap stateMap;
+        Params const params;
+        std::map<uint256, Params> const overrides;
+
+        return hook::apply(
+            uint256{}, sha512Half_s(Slice(code.data(), code.size())),
+            uint256{}, code, params, overrides, stateMap, applyCtx,
+            account.id(), false, false, true, 0, 0, fuel, {});
+    }
+
+    void
+    testFuel(FeatureBitset features)
+    {
+        bool const withFuel = features[featureHookFuel];
+        testcase(withFuel ? "fuel" : "no fuel");
+
+        using namespace jtx;
+        Env env{*this, features};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        auto const stx = env.jt(noop(alice)).stx;
+
+        // loop end, i64.const 0, end: the loop has no guard call, so the guard checker rejects it
+        // and nothing but the fuel bounds it
+        Blob const unguarded =
+            module({0x00, 0x03, 0x40, 0x0B, 0x42, 0x00, 0x0B});
+
+        auto const ample = run(env, alice, *stx, unguarded, 1000);
+        BEAST_EXPECT(ample.exitType != hook_api::ExitType::WASM_ERROR);
+        BEAST_EXPECT(ample.instructionCount > 0);
+        BEAST_EXPECT((ample.fuelBurnt > 0) == withFuel);
+
+        if (withFuel)
+        {
+            // the fuel covers exactly what the execution burns
+            auto const exact = run(env, alice, *stx, unguarded, ample.fuelBurnt);
+            BEAST_EXPECT(exact.exitType != hook_api::ExitType::WASM_ERROR);
+            BEAST_EXPECT(exact.fuelBurnt == ample.fuelBurnt);
+
+            auto const shortOne =
+                run(env, alice, *stx, unguarded, ample.fuelBurnt - 1);
+            BEAST_EXPECT(shortOne.exitType == hook_api::ExitType::WASM_ERROR);
+
+            // loop br 0 end, i64.const 0, end: spins until the fuel runs out
+            // (only run with fuel, nothing else would ever stop it)
+            Blob const spins = module(
+                {0x00, 0x03, 0x40, 0x0C, 0x00, 0x0B, 0x42, 0x00, 0x0B});
+            BEAST_EXPECT(
+                run(env, alice, *stx, spins, 100000).exitType ==
+                hook_api::ExitType::WASM_ERROR);
+        }
+        else
+        {
+            // without HookFuel the fuel is not looked at
+            auto const unpaid = run(env, alice, *stx, unguarded, 0);
+            BEAST_EXPECT(unpaid.exitType != hook_api::ExitType::WASM_ERROR);
+        }
+
+        // i32.const 7, i32.const 2, i32.add or i32.div_u, drop, i64.const 0, end: the same number of
+        // instructions, which burn the fuel of the cost table when metered
+        auto const add = run(
+            env, alice, *stx,
+            module({0x00, 0x41, 0x07, 0x41, 0x02, 0x6A, 0x1A, 0x42, 0x00, 0x0B}),
+            1000);
+        auto const div = run(
+            env, alice, *stx,
+            module({0x00, 0x41, 0x07, 0x41, 0x02, 0x6E, 0x1A, 0x42, 0x00, 0x0B}),
+            1000);
+        BEAST_EXPECT(add.instructionCount == div.instructionCount);
+        if (withFuel)
+            BEAST_EXPECT(
+                div.fuelBurnt - add.fuelBurnt ==
+                hook_api::instruction_fuel(0x6EU) -
+                    hook_api::instruction_fuel(0x6AU));
+    }
+
+    void
+    testGuardedLoop()
+    {
+        testcase("guarded loop");
+
+        using namespace jtx;
+        Env env{*this, supported_amendments()};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        auto const stx = env.jt(noop(alice)).stx;
+
+        // ten iterations run the loop to its bound of 10, the tenth call of _g(1, 9) rolls back
+        for (uint8_t const bound : {10, 9})
+        {
+            Blob const code = guarded(bound);
+            auto const wce = validateGuards(makeSlice(code), {}, "");
+            auto const fuel = validateGuards(makeSlice(code), {}, "", 0x02U);
+            if (!BEAST_EXPECT(wce && fuel))
+                continue;
+
+            // the fuel bound prices the guard calls the worst case count leaves out
+            BEAST_EXPECT(fuel->first > wce->first);
+
+            // run for the fuel SetHook stores, which the loop runs to its bound within
+            auto const result = run(env, alice, *stx, code, fuel->first);
+
+            BEAST_EXPECT(result.exitType == hook_api::ExitType::ROLLBACK);
+            if (bound == 9)
+                BEAST_EXPECT(result.exitCode == hook_api::GUARD_VIOLATION);
+            else
+                BEAST_EXPECT(result.exitCode != hook_api::GUARD_VIOLATION);
+            BEAST_EXPECT(result.instructionCount > wce->first);
+            BEAST_EXPECT(result.fuelBurnt > 0);
+            BEAST_EXPECT(result.fuelBurnt <= fuel->first);
+        }
+    }
+
+    void
+    testDefinition(FeatureBitset features)
+    {
+        bool const withFuel = features[featureHookFuel];
+        testcase(withFuel ? "definition with fuel" : "definition without fuel");
+
+        using namespace jtx;
+        Env env{*this, features};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        Blob const code = guarded(10);
+        env(ripple::test::jtx::hook(alice, {{hso(code)}}, 0),
+            fee(100'000'000));
+        env.close();
+
+        auto const def = env.le(
+            keylet::hookDefinition(sha512Half_s(makeSlice(code))));
+        if (!BEAST_EXPECT(def))
+            return;
+
+        // with HookFuel the definition is priced by, and metered against, its fuel bound
+        auto const priced = validateGuards(
+            makeSlice(code), {}, "", withFuel ? 0x02U : 0x00U);
+        if (!BEAST_EXPECT(priced))
+            return;
+
+        BEAST_EXPECT(
+            def->getFieldAmount(sfFee) ==
+            XRPAmount{hook::computeExecutionFee(priced->first)});
+        BEAST_EXPECT(def->isFieldPresent(sfHookFuel) == withFuel);
+        if (withFuel)
+            BEAST_EXPECT(def->getFieldU64(sfHookFuel) == priced->first);
+        BEAST_EXPECT(!def->isFieldPresent(sfHookCallbackFuel));
+    }
+
+    void
+    testCorpus()
+    {
+        testcase("corpus");
+
+        using namespace jtx;
+        Account const alice{"alice"};
+        Account const bob{"bob"};
+
+        // only hooks passing the guard checker can ever be installed and run, each with the fuel
+        // its guards bound it to
+        std::vector<std::pair<Blob const*, uint64_t>> hooks;
+        for (auto const& [source, code] : wasm)
+        {
+            if (auto const fuel =
+                    validateGuards(makeSlice(code), {}, "", ~0ULL))
+                hooks.emplace_back(&code, fuel->first);
+        }
+        BEAST_EXPECT(!hooks.empty());
+
+        auto const runAll = [&](FeatureBitset features) {
+            Env env{*this, features};
+            env.fund(XRP(10000), alice, bob);
+            env.close();
+
+            auto const stx = env.jt(pay(bob, alice, XRP(1))).stx;
+            std::vector<hook::HookResult> results;
+            for (auto const& [code, fuel] : hooks)
+                results.push_back(run(env, alice, *stx, *code, fuel));
+            return results;
+        };
+
+        auto const unmetered = runAll(supported_amendments() - featureHookFuel);
+        auto const metered = runAll(supported_amendments());
+        if (!BEAST_EXPECT(
+                metered.size() == hooks.size() &&
+                unmetered.size() == hooks.size()))
+            return;
+
+        // a hook which runs within its guards never runs out of fuel, metering changes nothing
+        for (std::size_t i = 0; i < hooks.size(); ++i)
+        {
+            auto const name = to_string(sha512Half_s(makeSlice(*hooks[i].first)));
+            BEAST_EXPECTS(metered[i].exitType == unmetered[i].exitType, name);
+            BEAST_EXPECTS(metered[i].exitCode == unmetered[i].exitCode, name);
+            BEAST_EXPECTS(
+                metered[i].instructionCount == unmetered[i].instructionCount, name);
+            BEAST_EXPECTS(metered[i].fuelBurnt <= hooks[i].second, name);
+        }
+    }
+
+public:
+    void
+    run() override
+    {
+        using namespace jtx;
+        auto const sa = supported_amendments();
+        testFuel(sa);
+        testFuel(sa - featureHookFuel);
+        testGuardedLoop();
+        testDefinition(sa);
+        testDefinition(sa - featureHookFuel);
+        testCorpus();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookFuel, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
@@ -0,0 +1,279 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/Guard.h>
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/app/ledger/OpenLedger.h>
+#include <ripple/app/tx/impl/ApplyContext.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/strHex.h>
+#include <ripple/beast/utility/temp_dir.h>
+#include <ripple/ledger/OpenView.h>
+#include <ripple/protocol/Indexes.h>
+#include <ripple/protocol/digest.h>
+#include <test/app/SetHook_wasm.h>
+#include <test/jtx.h>
+#include <fstream>
+#include <iterator>
+
+namespace ripple {
+namespace test {
+
+/**
+ * Runs the SetHook_test corpus (see build_test_hooks.sh) interpreted and then compiled to native
+ * code by the ModuleCache, and checks both tiers give the same results, including when the fuel
+ * of a hook the guards do not bound runs out.
+ */
+class HookNative_test : public beast::unit_test::suite
+{
+    struct Outcome
+    {
+        uint8_t exitType;
+        int64_t exitCode;
+        uint64_t instructionCount;
+        uint64_t fuelBurnt;
+    };
+
+    // far more than any hook which passes the guard checker can burn
+    static constexpr uint64_t ample = 10'000'000;
+
+    static Section
+    aot(std::string const& path)
+    {
+        Section section{"hooks"};
+        section.set("aot", "1");
+        section.set("aot_path", path);
+        return section;
+    }
+
+    // put hook definitions on the open ledger, where the compile job reads the code from
+    static void
+    define(jtx::Env& env, std::map<uint256, Blob const*> const& hooks)
+    {
+        env.app().openLedger().modify([&](OpenView& view, beast::Journal) {
+            for (auto const& [hookHash, code] : hooks)
+            {
+                auto def = std::make_shared<SLE>(keylet::hookDefinition(hookHash));
+                def->setFieldH256(sfHookHash, hookHash);
+                def->setFieldVL(sfCreateCode, *code);
+                view.rawInsert(def);
+            }
+            return true;
+        });
+    }
+
+    static void
+    compile(jtx::Env& env, hook::ModuleCache& cache)
+    {
+        cache.compilePending(env.current(), env.app().getJobQueue(), env.journal);
+        env.app().getJobQueue().rendezvous();
+    }
+
+    static Outcome
+    run(jtx::Env& env,
+        jtx::Account const& account,
+        STTx const& stx,
+        uint256 const& hookHash,
+        Blob const& code,
+        uint64_t fuel)
+    {
+        OpenView view(&*env.current());
+        ApplyContext applyCtx(
+            env.app(), view, stx, tesSUCCESS, FeeUnit64{0}, tapNONE, env.journal);
+        hook::HookStateMap stateMap;
+        std::map<std::vector<uint8_t>, std::vector<uint8_t>> const params;
+        std::map<uint256, std::map<std::vector<uint8_t>, std::vector<uint8_t>>> const overrides;
+
+        auto const result = hook::apply(
+            uint256{}, hookHash, uint256{}, code, params, overrides, stateMap, applyCtx,
+            account.id(), false, false, true, 0, 0, fuel, {});
+
+        return {
+            static_cast<uint8_t>(result.exitType),
+            result.exitCode,
+            result.instructionCount,
+            result.fuelBurnt};
+    }
+
+    void
+    testCorpus()
+    {
+        testcase("corpus");
+
+        using namespace jtx;
+        Env env{*this, supported_amendments()};
+        Account const alice{"alice"};
+        Account const bob{"bob"};
+        env.fund(XRP(10000), alice, bob);
+        env.close();
+
+        beast::temp_dir dir;
+        auto& cache = hook::ModuleCache::instance();
+        cache.setupNative(aot(dir.path()), "", env.journal);
+        BEAST_EXPECT(cache.nativeEnabled());
+
+        // only hooks passing the guard checker can ever be installed and run
+        std::map<uint256, Blob const*> hooks;
+        for (auto const& [source, code] : wasm)
+            if (validateGuards(makeSlice(code), {}, "", ~0ULL))
+                hooks.emplace(sha512Half_s(makeSlice(code)), &code);
+        BEAST_EXPECT(!hooks.empty());
+
+        // hook(i32) -> i64 running loop end, i64.const 0, end. the loop has no guard call, so
+        // unlike the corpus hooks, which their guard bound always covers, only the fuel bounds it
+        Blob const unguarded{
+            0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+            0x01, 0x06, 0x01, 0x60, 0x01, 0x7F, 0x01, 0x7E,
+            0x03, 0x02, 0x01, 0x00,
+            0x07, 0x08, 0x01, 0x04, 'h', 'o', 'o', 'k', 0x00, 0x00,
+            0x0A, 0x09, 0x01, 0x07, 0x00, 0x03, 0x40, 0x0B, 0x42, 0x00, 0x0B};
+        hooks.emplace(sha512Half_s(makeSlice(unguarded)), &unguarded);
+        define(env, hooks);
+
+        auto const stx = env.jt(pay(bob, alice, XRP(1))).stx;
+
+        // the fuel each hook is run with: ample, exactly what it burns and one short of that
+        auto const runAll = [&](uint256 const& hookHash, Blob const& code, Outcome const* first) {
+            std::vector<Outcome> outcomes{
+                first ? *first : run(env, alice, *stx, hookHash, code, ample)};
+            if (auto const burnt = outcomes[0].fuelBurnt; burnt > 0)
+            {
+                outcomes.push_back(run(env, alice, *stx, hookHash, code, burnt));
+                outcomes.push_back(run(env, alice, *stx, hookHash, code, burnt - 1));
+            }
+            return outcomes;
+        };
+
+        // nothing is compiled before compilePending, the first runs are all interpreted
+        std::map<uint256, std::vector<Outcome>> interpreted;
+        for (auto const& [hookHash, code] : hooks)
+            interpreted.emplace(hookHash, runAll(hookHash, *code, nullptr));
+
+        compile(env, cache);
+
+        for (auto const& [hookHash, code] : hooks)
+        {
+            auto const name = to_string(hookHash);
+            if (!BEAST_EXPECTS(
+                    cache.fetch(hookHash, code->data(), code->size(), env.journal).native,
+                    name + " was not compiled"))
+                continue;
+
+            auto const& expected = interpreted[hookHash];
+            auto const first = run(env, alice, *stx, hookHash, *code, ample);
+            auto const native = runAll(hookHash, *code, &first);
+
+            BEAST_EXPECTS(native.size() == expected.size(), name);
+            for (std::size_t i = 0; i < std::min(native.size(), expected.size()); ++i)
+            {
+                BEAST_EXPECTS(native[i].exitType == expected[i].exitType, name);
+                BEAST_EXPECTS(native[i].exitCode == expected[i].exitCode, name);
+                BEAST_EXPECTS(native[i].instructionCount == expected[i].instructionCount, name);
+                BEAST_EXPECTS(native[i].fuelBurnt == expected[i].fuelBurnt, name);
+            }
+
+            // the native code ran, it was not demoted after failing to instantiate
+            BEAST_EXPECTS(
+                cache.fetch(hookHash, code->data(), code->size(), env.journal).native, name);
+        }
+
+        cache.setupNative(Section{"hooks"}, "", env.journal);
+        BEAST_EXPECT(!cache.nativeEnabled());
+    }
+
+    void
+    testDigest()
+    {
+        testcase("artifact digest");
+
+        using namespace jtx;
+        Env env{*this, supported_amendments()};
+
+        // a module exporting hook(i32) -> i64 which returns 0
+        Blob const code{
+            0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+            0x01, 0x06, 0x01, 0x60, 0x01, 0x7F, 0x01, 0x7E,
+            0x03, 0x02, 0x01, 0x00,
+            0x07, 0x08, 0x01, 0x04, 'h', 'o', 'o', 'k', 0x00, 0x00,
+            0x0A, 0x06, 0x01, 0x04, 0x00, 0x42, 0x00, 0x0B};
+        uint256 const hookHash = sha512Half_s(makeSlice(code));
+        define(env, {{hookHash, &code}});
+
+        beast::temp_dir dir;
+        std::string const file =
+            dir.file(strHex(hookHash) + "-" + WasmEdge_VersionGet() + ".so");
+
+        auto const read = [](std::string const& name) {
+            std::ifstream in(name, std::ios::binary);
+            return Blob{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        };
+
+        // the artifact on disk matches its digest
+        auto const matches = [&]() {
+            Blob const artifact = read(file);
+            Blob const digest = read(file + ".digest");
+            return !artifact.empty() && digest.size() == uint256::size() &&
+                uint256::fromVoid(digest.data()) == sha512Half(hookHash, makeSlice(artifact));
+        };
+
+        // a cache of its own, which has not seen the hook, compiles or loads it from dir
+        auto const native = [&]() {
+            hook::ModuleCache cache{16};
+            cache.setupNative(aot(dir.path()), "", env.journal);
+            BEAST_EXPECT(cache.fetch(hookHash, code.data(), code.size(), env.journal).interpreted);
+            compile(env, cache);
+            return cache.fetch(hookHash, code.data(), code.size(), env.journal).native != nullptr;
+        };
+
+        BEAST_EXPECT(native());
+        BEAST_EXPECT(matches());
+
+        // loading an artifact which is there uses it as it is
+        auto const compiled = read(file);
+        BEAST_EXPECT(native());
+        BEAST_EXPECT(read(file) == compiled);
+
+        // an altered artifact is never loaded, it is compiled again
+        {
+            std::ofstream out(file, std::ios::binary | std::ios::app);
+            out.put(0);
+        }
+        BEAST_EXPECT(!matches());
+        BEAST_EXPECT(native());
+        BEAST_EXPECT(matches());
+
+        // and so is one without a digest
+        boost::filesystem::remove(file + ".digest");
+        BEAST_EXPECT(native());
+        BEAST_EXPECT(matches());
+    }
+
+public:
+    void
+    run() override
+    {
+        testCorpus();
+        testDigest();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookNative, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
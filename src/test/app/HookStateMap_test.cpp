@@ -0,0 +1,384 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/Enum.h>
+#include <ripple/app/hook/HookStateMap.h>
+#include <ripple/basics/Blob.h>
+#include <ripple/beast/unit_test.h>
+#include <chrono>
+#include <map>
+#include <random>
+
+namespace ripple {
+namespace test {
+
+namespace {
+
+// the layout HookStateMap replaced, kept here as the benchmark baseline
+using LegacyStateMap = std::map<
+    AccountID,
+    std::pair<
+        int64_t,
+        std::map<uint256, std::map<uint256, std::pair<bool, Blob>>>>>;
+
+uint256
+stateKey(std::uint64_t i)
+{
+    // hooks pass short keys which make_state_key left pads to 32 bytes
+    uint256 key;
+    for (int b = 0; b < 8; ++b)
+        key.data()[31 - b] = static_cast<std::uint8_t>(i >> (8 * b));
+    return key;
+}
+
+AccountID
+account(std::uint8_t i)
+{
+    AccountID acc;
+    acc.data()[0] = i;
+    return acc;
+}
+
+}  // namespace
+
+class HookStateMap_test : public beast::unit_test::suite
+{
+    void
+    testLookup()
+    {
+        testcase("lookup and update");
+
+        hook::HookStateMap map;
+        auto const acc = account(1);
+        uint256 const ns{7};
+        std::vector<std::uint8_t> value(32, 0xAB);
+
+        BEAST_EXPECT(!map.findAccount(acc));
+        map.insertAccount(acc, 10);
+        BEAST_EXPECT(map.findAccount(acc) && *map.findAccount(acc) == 10);
+        --*map.findAccount(acc);
+        BEAST_EXPECT(*map.findAccount(acc) == 9);
+
+        BEAST_EXPECT(!map.hasNamespace(acc, ns));
+        map.insertNamespace(acc, ns);
+        BEAST_EXPECT(map.hasNamespace(acc, ns));
+        BEAST_EXPECT(!map.hasNamespace(account(2), ns));
+
+        BEAST_EXPECT(!map.find(acc, ns, stateKey(1)));
+        map.insert(acc, ns, stateKey(1), false, Slice(value.data(), value.size()));
+
+        auto* entry = map.find(acc, ns, stateKey(1));
+        BEAST_EXPECT(entry && !entry->modified);
+        BEAST_EXPECT(entry->data() == Slice(value.data(), value.size()));
+
+        // delete is an update to an empty value
+        entry->modified = true;
+        entry->assign(Slice{});
+        BEAST_EXPECT(map.find(acc, ns, stateKey(1))->data().empty());
+        BEAST_EXPECT(map.find(acc, ns, stateKey(1))->modified);
+
+        // values larger than the inline buffer still round trip
+        std::vector<std::uint8_t> big(hook::HookStateMap::inlineDataSize + 1, 0x11);
+        entry->assign(Slice(big.data(), big.size()));
+        BEAST_EXPECT(entry->data() == Slice(big.data(), big.size()));
+        entry->assign(Slice(value.data(), 3));
+        BEAST_EXPECT(entry->data() == Slice(value.data(), 3));
+    }
+
+    void
+    testOrdered()
+    {
+        testcase("ordered view");
+
+        // the ordered view must match the iteration order of the nested maps
+        // it replaced, since that is the order state is written to the ledger
+        hook::HookStateMap map;
+        LegacyStateMap legacy;
+
+        std::mt19937_64 rng{42};
+        std::uniform_int_distribution<int> accDist(0, 4);
+        std::uniform_int_distribution<int> nsDist(0, 3);
+        std::uniform_int_distribution<std::uint64_t> keyDist(0, 300);
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            auto const acc = account(static_cast<std::uint8_t>(accDist(rng)));
+            uint256 const ns{static_cast<std::uint64_t>(nsDist(rng))};
+            auto const key = stateKey(keyDist(rng));
+            std::uint8_t const v = static_cast<std::uint8_t>(i);
+            Blob value(1 + i % 40, v);
+
+            if (!map.find(acc, ns, key))
+                map.insert(acc, ns, key, i % 3 == 0, Slice(value.data(), value.size()));
+            else
+                map.find(acc, ns, key)->assign(Slice(value.data(), value.size()));
+
+            auto& entry = legacy[acc].second[ns][key];
+            if (entry.second.empty())
+                entry.first = i % 3 == 0;
+            entry.second = value;
+        }
+
+        auto const ordered = map.ordered();
+
+        std::size_t count = 0;
+        for (auto const& accEntry : legacy)
+            for (auto const& nsEntry : accEntry.second.second)
+                for (auto const& keyEntry : nsEntry.second)
+                    ++count;
+        BEAST_EXPECT(ordered.size() == count);
+        BEAST_EXPECT(map.size() == count);
+
+        auto it = ordered.begin();
+        for (auto const& accEntry : legacy)
+            for (auto const& nsEntry : accEntry.second.second)
+                for (auto const& keyEntry : nsEntry.second)
+                {
+                    if (!BEAST_EXPECT(it != ordered.end()))
+                        return;
+                    BEAST_EXPECT(it->first->account == accEntry.first);
+                    BEAST_EXPECT(it->first->ns == nsEntry.first);
+                    BEAST_EXPECT(it->first->key == keyEntry.first);
+                    BEAST_EXPECT(it->second->modified == keyEntry.second.first);
+                    BEAST_EXPECT(
+                        it->second->data() ==
+                        Slice(
+                            keyEntry.second.second.data(),
+                            keyEntry.second.second.size()));
+                    ++it;
+                }
+    }
+
+    void
+    testStability()
+    {
+        testcase("references survive growth");
+
+        hook::HookStateMap map;
+        auto const acc = account(3);
+        uint256 const ns{1};
+        std::uint8_t const byte = 0x5A;
+
+        auto& first = map.insert(acc, ns, stateKey(0), true, Slice(&byte, 1));
+        for (std::uint64_t i = 1; i <= hook_api::max_state_modifications; ++i)
+            map.insert(acc, ns, stateKey(i), true, Slice(&byte, 1));
+
+        BEAST_EXPECT(&first == map.find(acc, ns, stateKey(0)));
+        BEAST_EXPECT(first.data() == Slice(&byte, 1));
+        BEAST_EXPECT(map.size() == hook_api::max_state_modifications + 1);
+    }
+
+    void
+    testPrefetch()
+    {
+        testcase("prefetched values");
+
+        // values read ahead must stay out of the entries, otherwise prefetching would
+        // change what finalizeHookState writes and how reserves are counted
+        hook::HookStateMap map;
+        auto const acc = account(4);
+        uint256 const ns{2};
+        std::uint8_t const byte = 0x33;
+
+        auto& status = map.prefetchStatus(acc, ns);
+        BEAST_EXPECT(!status.attempted && !status.complete && status.misses == 0);
+        status.attempted = true;
+        BEAST_EXPECT(map.prefetchStatus(acc, ns).attempted);
+        BEAST_EXPECT(!map.prefetchStatus(acc, uint256{3}).attempted);
+
+        map.insertPrefetched(acc, ns, stateKey(1), Slice(&byte, 1));
+        map.insertPrefetched(acc, ns, stateKey(1), Slice{});
+        BEAST_EXPECT(map.prefetchedSize() == 1);
+        BEAST_EXPECT(
+            map.findPrefetched(acc, ns, stateKey(1))->data() == Slice(&byte, 1));
+        BEAST_EXPECT(!map.findPrefetched(acc, ns, stateKey(2)));
+
+        BEAST_EXPECT(!map.find(acc, ns, stateKey(1)));
+        BEAST_EXPECT(!map.hasNamespace(acc, ns));
+        BEAST_EXPECT(map.size() == 0);
+        BEAST_EXPECT(map.ordered().empty());
+        BEAST_EXPECT(map.modified_entry_count == 0);
+    }
+
+    void
+    testMerge()
+    {
+        testcase("merge");
+
+        hook::HookStateMap map;
+        hook::HookStateMap chain;
+        uint256 const ns{5};
+        std::uint8_t const byte = 0x44;
+
+        map.insertAccount(account(1), 3);
+        map.insertNamespace(account(1), ns);
+        map.insert(account(1), ns, stateKey(1), true, Slice(&byte, 1));
+        map.modified_entry_count = 1;
+
+        // a read which missed still marks the account as touched
+        chain.prefetchStatus(account(7), ns).misses = 1;
+        chain.insertAccount(account(2), 5);
+        chain.insertNamespace(account(2), ns);
+        chain.insert(account(2), ns, stateKey(2), true, Slice(&byte, 1));
+        chain.insert(account(2), ns, stateKey(3), false, Slice{});
+        chain.insertPrefetched(account(2), ns, stateKey(4), Slice(&byte, 1));
+        chain.modified_entry_count = 1;
+
+        BEAST_EXPECT(map.touchedAccounts() == std::vector<AccountID>{account(1)});
+        BEAST_EXPECT(
+            chain.touchedAccounts() == (std::vector<AccountID>{account(2), account(7)}));
+
+        map.merge(chain);
+        BEAST_EXPECT(map.size() == 3);
+        BEAST_EXPECT(map.modified_entry_count == 2);
+        BEAST_EXPECT(*map.findAccount(account(1)) == 3);
+        BEAST_EXPECT(*map.findAccount(account(2)) == 5);
+        BEAST_EXPECT(map.hasNamespace(account(2), ns));
+        BEAST_EXPECT(map.find(account(2), ns, stateKey(2))->modified);
+        BEAST_EXPECT(map.find(account(2), ns, stateKey(2))->data() == Slice(&byte, 1));
+        BEAST_EXPECT(!map.find(account(2), ns, stateKey(3))->modified);
+        BEAST_EXPECT(!map.findPrefetched(account(2), ns, stateKey(4)));
+        BEAST_EXPECT(
+            map.touchedAccounts() == (std::vector<AccountID>{account(1), account(2)}));
+    }
+
+public:
+    void
+    run() override
+    {
+        testLookup();
+        testOrdered();
+        testStability();
+        testPrefetch();
+        testMerge();
+    }
+};
+
+/**
+ * Time the access pattern of a state heavy hook: max_state_modifications
+ * state_set calls (lookup, insert or overwrite a 256 byte value) followed by
+ * the ordered walk finalizeHookState performs, once against the legacy nested
+ * map layout and once against HookStateMap.
+ */
+class HookStateMapBench_test : public beast::unit_test::suite
+{
+    static constexpr int rounds = 50;
+
+    template <class F>
+    std::chrono::nanoseconds
+    time(F&& f)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+            f();
+        return (std::chrono::steady_clock::now() - start) / rounds;
+    }
+
+public:
+    void
+    run() override
+    {
+        using namespace std::chrono;
+
+        auto const acc = account(9);
+        uint256 const ns{0xBEEF};
+        std::size_t const sets = hook_api::max_state_modifications;
+        Blob const value(hook::HookStateMap::inlineDataSize, 0x42);
+
+        std::size_t sink = 0;
+
+        auto const legacyTime = time([&] {
+            LegacyStateMap map;
+            for (std::size_t i = 0; i < sets; ++i)
+            {
+                // mirrors the find then operator[] pattern of set_state_cache
+                auto const key = stateKey(i % (sets / 2));
+                Blob data{value};
+                if (map.find(acc) == map.end())
+                {
+                    map[acc] = {0, {{ns, {{key, {true, data}}}}}};
+                    continue;
+                }
+                auto& accMap = map[acc].second;
+                if (accMap.find(ns) == accMap.end())
+                {
+                    accMap[ns] = {{key, {true, data}}};
+                    continue;
+                }
+                auto& nsMap = accMap[ns];
+                if (nsMap.find(key) == nsMap.end())
+                {
+                    nsMap[key] = {true, data};
+                    continue;
+                }
+                nsMap[key].first = true;
+                nsMap[key].second = data;
+            }
+            for (auto const& accEntry : map)
+                for (auto const& nsEntry : accEntry.second.second)
+                    for (auto const& keyEntry : nsEntry.second)
+                        sink += keyEntry.second.second.size();
+        });
+
+        auto const flatTime = time([&] {
+            hook::HookStateMap map;
+            Slice const data{value.data(), value.size()};
+            for (std::size_t i = 0; i < sets; ++i)
+            {
+                auto const key = stateKey(i % (sets / 2));
+                if (!map.findAccount(acc))
+                {
+                    map.insertAccount(acc, 0);
+                    map.insertNamespace(acc, ns);
+                    map.insert(acc, ns, key, true, data);
+                    continue;
+                }
+                if (!map.hasNamespace(acc, ns))
+                {
+                    map.insertNamespace(acc, ns);
+                    map.insert(acc, ns, key, true, data);
+                    continue;
+                }
+                if (auto* entry = map.find(acc, ns, key))
+                {
+                    entry->modified = true;
+                    entry->assign(data);
+                    continue;
+                }
+                map.insert(acc, ns, key, true, data);
+            }
+            for (auto const& [k, entry] : map.ordered())
+                sink += entry->data().size();
+        });
+
+        log << sets << " state_set + finalize, mean of " << rounds
+            << " rounds: legacy "
+            << duration_cast<microseconds>(legacyTime).count()
+            << "us, flat "
+            << duration_cast<microseconds>(flatTime).count() << "us"
+            << std::endl;
+
+        BEAST_EXPECT(sink > 0);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookStateMap, app, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(HookStateMapBench, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
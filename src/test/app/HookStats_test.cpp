@@ -0,0 +1,249 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/HookStats.h>
+#include <ripple/app/hook/applyHook.h>
+#include <ripple/app/tx/impl/ApplyContext.h>
+#include <ripple/ledger/OpenView.h>
+#include <ripple/protocol/digest.h>
+#include <ripple/protocol/jss.h>
+#include <test/jtx.h>
+#include <set>
+#include <thread>
+
+namespace ripple {
+namespace test {
+
+class HookStats_test : public beast::unit_test::suite
+{
+    using Params = std::map<std::vector<uint8_t>, std::vector<uint8_t>>;
+
+    static hook::HookResult
+    result(hook::HookStateMap& stateMap, Params const& params, uint256 const& hookHash)
+    {
+        AccountID const account{};
+        return hook::HookResult{
+            .hookHash = hookHash,
+            .accountKeylet = keylet::account(account),
+            .ownerDirKeylet = keylet::ownerDir(account),
+            .hookKeylet = keylet::hook(account),
+            .stateMap = stateMap,
+            .hookParams = params};
+    }
+
+    void
+    testRecord()
+    {
+        testcase("record");
+
+        using namespace std::chrono;
+        using namespace hook_api;
+
+        hook::HookStateMap stateMap;
+        Params const params;
+        hook::HookStats stats{2};
+
+        // a: three executions reading and writing state
+        auto a = result(stateMap, params, uint256{1});
+        a.exitType = ExitType::ACCEPT;
+        a.instructionCount = 100;
+        a.hostCalls[WasmFunctionIdstate] = 2;
+        a.hostCalls[WasmFunctionIdstate_foreign] = 1;
+        a.hostCalls[WasmFunctionIdstate_set] = 1;
+        a.hostCalls[WasmFunctionIdaccept] = 1;
+        stats.record(a, microseconds{10});
+        stats.record(a, microseconds{20});
+        stats.record(a, microseconds{1000});
+
+        // b: one long execution which failed
+        auto b = result(stateMap, params, uint256{2});
+        b.exitType = ExitType::WASM_ERROR;
+        stats.record(b, microseconds{5000});
+
+        BEAST_EXPECT(stats.evicted() == 0);
+
+        auto const top = stats.top(10);
+        BEAST_EXPECT(top.size() == 2);
+        if (top.size() != 2)
+            return;
+
+        BEAST_EXPECT(top[0].hookHash == uint256{2});
+        BEAST_EXPECT(top[0].executions == 1);
+        BEAST_EXPECT(top[0].wasmErrors == 1);
+        BEAST_EXPECT(top[0].p50Micros == 5000);
+        BEAST_EXPECT(top[0].hostCalls.empty());
+
+        BEAST_EXPECT(top[1].hookHash == uint256{1});
+        BEAST_EXPECT(top[1].executions == 3);
+        BEAST_EXPECT(top[1].wasmErrors == 0);
+        BEAST_EXPECT(top[1].totalMicros == 1030);
+        BEAST_EXPECT(top[1].maxMicros == 1000);
+        // 20us falls in the [16, 31] bucket
+        BEAST_EXPECT(top[1].p50Micros == 31);
+        BEAST_EXPECT(top[1].p99Micros == 1000);
+        BEAST_EXPECT(top[1].instructions == 300);
+        BEAST_EXPECT(top[1].stateReads == 9);
+        BEAST_EXPECT(top[1].stateWrites == 3);
+        BEAST_EXPECT(top[1].hostCalls.size() == 4);
+        BEAST_EXPECT(top[1].hostCalls.front().first == "state");
+        BEAST_EXPECT(top[1].hostCalls.front().second == 6);
+
+        auto const limited = stats.top(1);
+        BEAST_EXPECT(limited.size() == 1 && limited[0].hookHash == uint256{2});
+
+        auto const jv = stats.getJson(1);
+        BEAST_EXPECT(jv[jss::evicted].asString() == "0");
+        BEAST_EXPECT(jv[jss::hooks].size() == 1);
+        BEAST_EXPECT(jv[jss::hooks][0u][jss::hook_hash].asString() == to_string(uint256{2}));
+        BEAST_EXPECT(jv[jss::hooks][0u][jss::wasm_errors].asString() == "1");
+    }
+
+    void
+    testEviction()
+    {
+        testcase("eviction");
+
+        using namespace std::chrono;
+
+        hook::HookStateMap stateMap;
+        Params const params;
+        hook::HookStats stats{2};
+
+        auto const hashes = [&stats]() {
+            std::set<uint256> hashes;
+            for (auto const& s : stats.top(10))
+                hashes.insert(s.hookHash);
+            return hashes;
+        };
+
+        // fill the shard, executing 1 again so 2 is the least recently executed
+        stats.record(result(stateMap, params, uint256{1}), microseconds{100});
+        stats.record(result(stateMap, params, uint256{2}), microseconds{100});
+        stats.record(result(stateMap, params, uint256{1}), microseconds{100});
+        BEAST_EXPECT(stats.evicted() == 0);
+
+        // a new hook is still profiled, in 2's place
+        stats.record(result(stateMap, params, uint256{3}), microseconds{1});
+        BEAST_EXPECT(stats.evicted() == 1);
+        BEAST_EXPECT((hashes() == std::set<uint256>{uint256{1}, uint256{3}}));
+
+        // and 2 starts afresh once it executes again, in 1's place
+        stats.record(result(stateMap, params, uint256{2}), microseconds{1});
+        BEAST_EXPECT(stats.evicted() == 2);
+        BEAST_EXPECT((hashes() == std::set<uint256>{uint256{2}, uint256{3}}));
+
+        auto const top = stats.top(10);
+        for (auto const& s : top)
+        {
+            BEAST_EXPECT(s.executions == 1);
+            BEAST_EXPECT(s.totalMicros == 1);
+        }
+
+        BEAST_EXPECT(stats.getJson(10)[jss::evicted].asString() == "2");
+    }
+
+    void
+    testThreads()
+    {
+        testcase("threads");
+
+        hook::HookStats stats{16};
+        std::size_t constexpr threads = 4;
+        std::size_t constexpr executions = 1000;
+
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+            workers.emplace_back([&stats, t]() {
+                hook::HookStateMap stateMap;
+                Params const params;
+                auto r = result(stateMap, params, uint256{1});
+                r.instructionCount = t + 1;
+                for (std::size_t i = 0; i < executions; ++i)
+                    stats.record(r, std::chrono::microseconds{1});
+            });
+        for (auto& w : workers)
+            w.join();
+
+        auto const top = stats.top(10);
+        BEAST_EXPECT(top.size() == 1);
+        if (top.empty())
+            return;
+        BEAST_EXPECT(top[0].executions == threads * executions);
+        BEAST_EXPECT(top[0].totalMicros == threads * executions);
+        BEAST_EXPECT(top[0].instructions == executions * (1 + 2 + 3 + 4));
+    }
+
+    void
+    testApply()
+    {
+        testcase("apply");
+
+        using namespace jtx;
+        Env env{*this, supported_amendments()};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        // not webassembly, unique to this test so nothing else has run it
+        Blob const code(128, 0x44);
+        uint256 const hookHash = sha512Half_s(Slice(code.data(), code.size()));
+
+        OpenView view(&*env.current());
+        auto const stx = env.jt(noop(alice)).stx;
+        ApplyContext applyCtx(
+            env.app(), view, *stx, tesSUCCESS, FeeUnit64{0}, tapNONE, env.journal);
+        hook::HookStateMap stateMap;
+        Params const params;
+        std::map<uint256, Params> const overrides;
+
+        auto const r = hook::apply(
+            uint256{}, hookHash, uint256{}, code, params, overrides, stateMap, applyCtx,
+            alice.id(), false, false, true, 0, 0, std::nullopt, {});
+        BEAST_EXPECT(r.exitType == hook_api::ExitType::WASM_ERROR);
+
+        auto const jv = env.rpc("hook_stats", std::to_string(hook::maxHookStatsSize()));
+        auto const& hooks = jv[jss::result][jss::hooks];
+        BEAST_EXPECT(hooks.isArray());
+
+        bool found = false;
+        for (auto const& h : hooks)
+        {
+            if (h[jss::hook_hash].asString() != to_string(hookHash))
+                continue;
+            found = true;
+            BEAST_EXPECT(h[jss::executions].asString() == "1");
+            BEAST_EXPECT(h[jss::wasm_errors].asString() == "1");
+        }
+        BEAST_EXPECT(found);
+    }
+
+public:
+    void
+    run() override
+    {
+        testRecord();
+        testEviction();
+        testThreads();
+        testApply();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookStats, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
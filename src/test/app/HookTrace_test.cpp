@@ -0,0 +1,326 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/HookTrace.h>
+#include <ripple/app/hook/XFL.h>
+#include <ripple/protocol/jss.h>
+#include <test/jtx.h>
+#include <string_view>
+
+namespace ripple {
+namespace test {
+
+class HookTrace_test : public beast::unit_test::suite
+{
+    using Kind = hook::HookTraceLog::Kind;
+
+    static Slice
+    slice(std::string_view s)
+    {
+        return Slice(s.data(), s.size());
+    }
+
+    static uint256
+    hash(std::uint8_t n)
+    {
+        uint256 h;
+        h.data()[0] = n;
+        return h;
+    }
+
+    static void
+    trace(hook::HookTraceLog& log, uint256 const& hookHash, int64_t number)
+    {
+        log.append(
+            hookHash,
+            uint256{},
+            AccountID{},
+            Kind::number,
+            slice("n"),
+            Slice(),
+            number);
+    }
+
+    void
+    testRing()
+    {
+        testcase("ring");
+
+        hook::HookTraceLog log;
+        BEAST_EXPECT(!log.enabled());
+
+        // nothing is kept while the rings have no capacity
+        trace(log, hash(1), 0);
+        BEAST_EXPECT(log.read(0, 100, std::nullopt).entries.empty());
+
+        log.resize(4);
+        BEAST_EXPECT(log.enabled());
+        BEAST_EXPECT(log.capacity() == 4);
+
+        for (int64_t i = 1; i <= 6; ++i)
+            trace(log, hash(1), i);
+
+        // 1 and 2 were overwritten
+        auto page = log.read(0, 100, std::nullopt);
+        BEAST_EXPECT(page.missed == 2);
+        BEAST_EXPECT(page.marker == 7);
+        BEAST_EXPECT(page.entries.size() == 4);
+        for (std::size_t i = 0; i < page.entries.size(); ++i)
+        {
+            BEAST_EXPECT(page.entries[i].seq == i + 3);
+            BEAST_EXPECT(page.entries[i].number == static_cast<int64_t>(i + 3));
+        }
+
+        // continue from a marker, a bit at a time
+        page = log.read(4, 1, std::nullopt);
+        BEAST_EXPECT(page.missed == 0);
+        BEAST_EXPECT(page.entries.size() == 1);
+        BEAST_EXPECT(page.entries[0].seq == 4);
+        BEAST_EXPECT(page.marker == 5);
+
+        page = log.read(page.marker, 10, std::nullopt);
+        BEAST_EXPECT(page.entries.size() == 2);
+        BEAST_EXPECT(page.marker == 7);
+
+        // nothing new yet
+        page = log.read(page.marker, 10, std::nullopt);
+        BEAST_EXPECT(page.entries.empty());
+        BEAST_EXPECT(page.marker == 7);
+
+        // only the traces of one hook, the marker moves past the others
+        trace(log, hash(2), 7);
+        trace(log, hash(1), 8);
+        page = log.read(0, 10, hash(2));
+        BEAST_EXPECT(page.entries.size() == 1);
+        BEAST_EXPECT(page.entries[0].number == 7);
+        BEAST_EXPECT(page.marker == 9);
+        BEAST_EXPECT(page.missed == 3);
+
+        page = log.read(7, 10, hash(1));
+        BEAST_EXPECT(page.entries.size() == 1);
+        BEAST_EXPECT(page.entries[0].number == 8);
+        BEAST_EXPECT(page.marker == 9);
+        BEAST_EXPECT(page.missed == 0);
+
+        // resizing drops the entries but not the sequence numbers
+        log.resize(2);
+        BEAST_EXPECT(log.read(0, 10, std::nullopt).entries.empty());
+        trace(log, hash(0), 9);
+        page = log.read(9, 10, std::nullopt);
+        BEAST_EXPECT(page.entries.size() == 1);
+        BEAST_EXPECT(page.entries[0].seq == 9);
+
+        log.resize(0);
+        BEAST_EXPECT(!log.enabled());
+    }
+
+    void
+    testPerHook()
+    {
+        testcase("per hook");
+
+        hook::HookTraceLog log;
+        log.resize(2, 16);
+
+        // a hook tracing in a loop only overwrites its own ring
+        trace(log, hash(1), 1);
+        trace(log, hash(2), 2);
+        for (int64_t i = 3; i <= 102; ++i)
+            trace(log, hash(1), i);
+
+        auto page = log.read(0, 10, hash(2));
+        BEAST_EXPECT(page.entries.size() == 1);
+        BEAST_EXPECT(page.entries[0].number == 2);
+
+        page = log.read(0, 10, std::nullopt);
+        BEAST_EXPECT(page.entries.size() == 3);
+        BEAST_EXPECT(page.missed == 99);
+        BEAST_EXPECT(page.marker == 103);
+        if (page.entries.size() == 3)
+        {
+            BEAST_EXPECT(page.entries[0].number == 2);
+            BEAST_EXPECT(page.entries[1].number == 101);
+            BEAST_EXPECT(page.entries[2].number == 102);
+        }
+
+        // one ring per shard, hashes whose first byte is 1 and 17 share a shard, 3 does not
+        log.resize(2, 1);
+        trace(log, hash(1), 1);
+        trace(log, hash(3), 2);
+        trace(log, hash(1), 3);
+        trace(log, hash(17), 4);
+        BEAST_EXPECT(log.read(0, 10, hash(1)).entries.empty());
+
+        page = log.read(103, 10, std::nullopt);
+        BEAST_EXPECT(page.entries.size() == 2);
+        BEAST_EXPECT(page.missed == 2);
+        if (page.entries.size() == 2)
+        {
+            BEAST_EXPECT(page.entries[0].hookHash == hash(3));
+            BEAST_EXPECT(page.entries[1].hookHash == hash(17));
+        }
+    }
+
+    void
+    testFormat()
+    {
+        testcase("format");
+
+        hook::HookTraceLog log;
+        log.resize(16);
+
+        auto const formatted = [&](Kind kind,
+                                   std::string_view message,
+                                   std::string_view data,
+                                   int64_t number) {
+            log.append(
+                uint256{},
+                uint256{},
+                AccountID{},
+                kind,
+                slice(message),
+                slice(data),
+                number);
+            auto const page = log.read(0, 16, std::nullopt);
+            return hook::HookTraceLog::format(page.entries.back());
+        };
+
+        using namespace std::string_view_literals;
+
+        BEAST_EXPECT(formatted(Kind::number, "count", "", -5) == "count -5");
+        BEAST_EXPECT(formatted(Kind::number, "", "", 42) == "42");
+
+        BEAST_EXPECT(formatted(Kind::text, "msg", "data", 0) == "msg: data");
+        BEAST_EXPECT(formatted(Kind::text, "", "data", 0) == "data");
+        BEAST_EXPECT(
+            formatted(Kind::hex, "h", "\x01\xab", 0) == "h: 01AB");
+        BEAST_EXPECT(
+            formatted(Kind::utf16, "u", "h\0i\0"sv, 0) == "u: hi");
+
+        BEAST_EXPECT(
+            formatted(Kind::floating, "f", "", 0) ==
+            "f Float 0*10^(0) <ZERO>");
+        BEAST_EXPECT(
+            formatted(Kind::floating, "f", "", 1) == "f Float <INVALID>");
+        BEAST_EXPECT(
+            formatted(
+                Kind::floating,
+                "f",
+                "",
+                hook_float::make_float(1500000000000000ull, -15, false)) ==
+            "f Float 1500000000000000*10^(-15)");
+        BEAST_EXPECT(
+            formatted(
+                Kind::floating,
+                "f",
+                "",
+                hook_float::make_float(1500000000000000ull, -15, true)) ==
+            "f Float -1500000000000000*10^(-15)");
+
+        // message and data are cut to the bounds of the trace functions
+        std::string const big(4096, 'x');
+        log.append(
+            uint256{},
+            uint256{},
+            AccountID{},
+            Kind::text,
+            slice(big),
+            slice(big),
+            0);
+        auto const page = log.read(0, 16, std::nullopt);
+        BEAST_EXPECT(
+            page.entries.back().message().size() ==
+            hook::HookTraceLog::maxMessage);
+        BEAST_EXPECT(
+            page.entries.back().data().size() == hook::HookTraceLog::maxData);
+    }
+
+    void
+    testRPC()
+    {
+        testcase("rpc");
+
+        using namespace jtx;
+        Env env{*this};
+
+        auto& log = hook::HookTraceLog::instance();
+
+        // not kept unless configured
+        log.resize(0);
+        auto jv = env.rpc("hook_trace");
+        BEAST_EXPECT(jv[jss::result][jss::error] == "notEnabled");
+
+        log.resize(8);
+        AccountID const account = env.master.id();
+        log.append(
+            hash(1),
+            hash(2),
+            account,
+            Kind::text,
+            slice("msg"),
+            slice("data"),
+            0);
+        log.append(
+            hash(3), hash(2), account, Kind::number, slice("n"), Slice(), 9);
+
+        jv = env.rpc("hook_trace");
+        auto const& traces = jv[jss::result][jss::traces];
+        BEAST_EXPECT(jv[jss::result][jss::capacity] == 8);
+        BEAST_EXPECT(jv[jss::result][jss::dropped] == "0");
+        BEAST_EXPECT(traces.size() == 2);
+        if (traces.size() == 2)
+        {
+            BEAST_EXPECT(traces[0u][jss::seq] == "1");
+            BEAST_EXPECT(traces[0u][jss::hook_hash] == to_string(hash(1)));
+            BEAST_EXPECT(traces[0u][jss::otxn_id] == to_string(hash(2)));
+            BEAST_EXPECT(traces[0u][jss::account] == toBase58(account));
+            BEAST_EXPECT(traces[0u][jss::message] == "msg: data");
+            BEAST_EXPECT(traces[1u][jss::message] == "n 9");
+        }
+
+        // poll from the returned marker
+        jv = env.rpc("hook_trace", jv[jss::result][jss::marker].asString());
+        BEAST_EXPECT(jv[jss::result][jss::traces].size() == 0);
+
+        Json::Value params;
+        params[jss::hook_hash] = to_string(hash(3));
+        jv = env.rpc("json", "hook_trace", to_string(params));
+        BEAST_EXPECT(jv[jss::result][jss::traces].size() == 1);
+
+        params[jss::hook_hash] = "not a hash";
+        jv = env.rpc("json", "hook_trace", to_string(params));
+        BEAST_EXPECT(jv[jss::result][jss::error] == "invalidParams");
+
+        log.resize(0);
+    }
+
+public:
+    void
+    run() override
+    {
+        testRing();
+        testPerHook();
+        testFormat();
+        testRPC();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookTrace, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
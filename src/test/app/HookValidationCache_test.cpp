@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/HookValidationCache.h>
+#include <ripple/app/tx/impl/SetHook.h>
+#include <ripple/protocol/Indexes.h>
+#include <test/jtx.h>
+#include <test/jtx/hook.h>
+
+namespace ripple {
+namespace test {
+
+class HookValidationCache_test : public beast::unit_test::suite
+{
+    static hook::HookValidationCache::Verdict
+    verdict(std::uint64_t wce)
+    {
+        return {.valid = true, .maxInstrCountHook = wce, .maxInstrCountCbak = 0, .reason = {}};
+    }
+
+    void
+    testCache()
+    {
+        testcase("cache");
+
+        hook::HookValidationCache cache{2};
+        BEAST_EXPECT(!cache.find(uint256{1}, 0));
+
+        cache.insert(uint256{1}, 0, verdict(10));
+        cache.insert(uint256{2}, 0, {.valid = false, .reason = "VM error"});
+
+        auto const one = cache.find(uint256{1}, 0);
+        BEAST_EXPECT(one && one->valid && one->maxInstrCountHook == 10);
+        auto const two = cache.find(uint256{2}, 0);
+        BEAST_EXPECT(two && !two->valid && two->reason == "VM error");
+
+        // a verdict never changes, the first one recorded is kept
+        cache.insert(uint256{1}, 0, verdict(20));
+        BEAST_EXPECT(cache.find(uint256{1}, 0)->maxInstrCountHook == 10);
+
+        // least recently used first
+        cache.insert(uint256{3}, 0, verdict(30));
+        BEAST_EXPECT(cache.size() == 2);
+        BEAST_EXPECT(!cache.find(uint256{2}, 0));
+        BEAST_EXPECT(cache.find(uint256{1}, 0));
+
+        auto const counts = cache.getCounts();
+        BEAST_EXPECT(counts.hits == 4);
+        BEAST_EXPECT(counts.misses == 2);
+        BEAST_EXPECT(counts.evictions == 1);
+        BEAST_EXPECT(counts.size == 2);
+
+        // the same code checked under other rules is a separate verdict
+        BEAST_EXPECT(!cache.find(uint256{1}, 1));
+        cache.insert(uint256{1}, 1, verdict(40));
+        BEAST_EXPECT(cache.find(uint256{1}, 1)->maxInstrCountHook == 40);
+    }
+
+    void
+    testSetHook()
+    {
+        testcase("SetHook");
+
+        using namespace jtx;
+        Env env{*this, supported_amendments()};
+        Account const alice{"alice"};
+        env.fund(XRP(10000), alice);
+        env.close();
+
+        // not webassembly at all, unique to this test so the process-wide cache has not seen it
+        std::vector<uint8_t> const code(128, 0x42);
+        uint256 const codeHash = sha512Half_s(Slice(code.data(), code.size()));
+
+        auto const jt = env.jt(jtx::hook(alice, {{hso(code)}}, 0), fee(XRP(1)));
+        STObject const& hookSetObj = jt.stx->getFieldArray(sfHooks)[0];
+
+        auto& cache = hook::HookValidationCache::instance();
+        auto const before = cache.getCounts();
+
+        // rejected by the validation and then by the cached verdict
+        auto const rulesVersion = SetHook::rulesVersion(env.current()->rules());
+        SetHookCtx ctx{
+            .j = env.journal, .tx = *jt.stx, .app = env.app(), .rulesVersion = rulesVersion};
+        for (int i = 0; i < 2; ++i)
+        {
+            auto const valid = SetHook::validateHookSetEntry(ctx, hookSetObj);
+            BEAST_EXPECT(std::holds_alternative<bool>(valid) && !std::get<bool>(valid));
+        }
+
+        auto const after = cache.getCounts();
+        BEAST_EXPECT(after.misses == before.misses + 1);
+        BEAST_EXPECT(after.hits == before.hits + 1);
+        auto const found = cache.find(codeHash, rulesVersion);
+        BEAST_EXPECT(found && !found->valid);
+
+        // code is validated whatever the ledger holds: a definition for it already on the open
+        // ledger does not get invalid code past preflight
+        std::vector<uint8_t> const other(128, 0x43);
+        uint256 const otherHash = sha512Half_s(Slice(other.data(), other.size()));
+
+        env.app().openLedger().modify([&](OpenView& view, beast::Journal) {
+            auto def = std::make_shared<SLE>(keylet::hookDefinition(otherHash));
+            def->setFieldH256(sfHookHash, otherHash);
+            view.rawInsert(def);
+            return true;
+        });
+        BEAST_EXPECT(env.current()->exists(keylet::hookDefinition(otherHash)));
+
+        env(jtx::hook(alice, {{hso(other)}}, 0), fee(XRP(1)), ter(temMALFORMED));
+        auto const otherVerdict = cache.find(otherHash, rulesVersion);
+        BEAST_EXPECT(otherVerdict && !otherVerdict->valid);
+    }
+
+public:
+    void
+    run() override
+    {
+        testCache();
+        testSetHook();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(HookValidationCache, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/LRUMap.h>
+#include <ripple/basics/base_uint.h>
+#include <ripple/beast/unit_test.h>
+#include <string>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+class LRUMap_test : public beast::unit_test::suite
+{
+    using Map = hook::LRUMap<uint256, std::string>;
+
+    void
+    testFind()
+    {
+        testcase("find");
+
+        Map map{2};
+        BEAST_EXPECT(!map.find(uint256{1}));
+        BEAST_EXPECT(map.misses() == 1);
+
+        auto const [value, inserted] = map.insert(uint256{1}, "one");
+        BEAST_EXPECT(inserted && value == "one");
+        BEAST_EXPECT(map.find(uint256{1}) && *map.find(uint256{1}) == "one");
+        BEAST_EXPECT(map.hits() == 2);
+
+        // a value the caller cannot use is a miss
+        BEAST_EXPECT(!map.find(uint256{1}, [](std::string const& v) { return v == "uno"; }));
+        BEAST_EXPECT(map.misses() == 2);
+
+        // peek neither counts nor reorders
+        BEAST_EXPECT(map.peek(uint256{1}) && !map.peek(uint256{2}));
+        BEAST_EXPECT(map.hits() == 2 && map.misses() == 2);
+
+        // a key already there keeps its value
+        auto const [kept, added] = map.insert(uint256{1}, "uno");
+        BEAST_EXPECT(!added && kept == "one");
+        BEAST_EXPECT(map.size() == 1);
+    }
+
+    void
+    testEviction()
+    {
+        testcase("eviction");
+
+        Map map{2};
+        std::vector<uint256> evicted;
+        auto const onEvict = [&evicted](uint256 const& key, std::string&) {
+            evicted.push_back(key);
+        };
+
+        map.insert(uint256{1}, "one", onEvict);
+        map.insert(uint256{2}, "two", onEvict);
+
+        // 1 was used after 2, so 2 makes room for 3
+        map.find(uint256{1});
+        map.insert(uint256{3}, "three", onEvict);
+        BEAST_EXPECT(evicted == std::vector<uint256>{uint256{2}});
+        BEAST_EXPECT(map.size() == 2);
+        BEAST_EXPECT(map.evictions() == 1);
+
+        // adding a key which is already there is a use too, 3 now goes before 1
+        map.insert(uint256{1}, "one", onEvict);
+        map.insert(uint256{4}, "four", onEvict);
+        BEAST_EXPECT(evicted.size() == 2 && evicted.back() == uint256{3});
+        BEAST_EXPECT(map.peek(uint256{1}) && map.peek(uint256{4}));
+
+        // erasing is no eviction and frees a place
+        BEAST_EXPECT(map.erase(uint256{1}));
+        BEAST_EXPECT(!map.erase(uint256{1}));
+        map.insert(uint256{5}, "five", onEvict);
+        BEAST_EXPECT(map.evictions() == 2);
+        BEAST_EXPECT(map.size() == 2);
+
+        std::size_t visited = 0;
+        map.forEach([&visited](uint256 const&, std::string& v) {
+            visited += v.size();
+        });
+        BEAST_EXPECT(visited == 8);
+    }
+
+public:
+    void
+    run() override
+    {
+        testFind();
+        testEviction();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(LRUMap, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
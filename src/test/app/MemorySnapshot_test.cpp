@@ -0,0 +1,271 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/MemorySnapshot.h>
+#include <ripple/beast/unit_test.h>
+#include <cstring>
+#include <string>
+
+namespace ripple {
+namespace test {
+
+class MemorySnapshot_test : public beast::unit_test::suite
+{
+    using Bytes = std::vector<uint8_t>;
+
+    static Bytes
+    section(uint8_t id, Bytes const& content)
+    {
+        Bytes out{id};
+        for (std::size_t v = content.size();;)
+        {
+            uint8_t const b = v & 0x7F;
+            v >>= 7;
+            out.push_back(v ? (b | 0x80) : b);
+            if (!v)
+                break;
+        }
+        out.insert(out.end(), content.begin(), content.end());
+        return out;
+    }
+
+    static Bytes
+    concat(std::initializer_list<Bytes> parts)
+    {
+        Bytes out;
+        for (auto const& p : parts)
+            out.insert(out.end(), p.begin(), p.end());
+        return out;
+    }
+
+    // "hello" at 16 and "world" at 70000 (in the second page)
+    static Bytes
+    dataSection()
+    {
+        return section(
+            11,
+            {0x02,
+             0x00, 0x41, 0x10, 0x0B, 0x05, 'h', 'e', 'l', 'l', 'o',
+             0x00, 0x41, 0xF0, 0xA2, 0x04, 0x0B, 0x05, 'w', 'o', 'r', 'l',
+             'd'});
+    }
+
+    // a data section holding one segment, as given
+    static Bytes
+    segment(Bytes const& content)
+    {
+        Bytes data{0x01};
+        data.insert(data.end(), content.begin(), content.end());
+        return section(11, data);
+    }
+
+    // a module exporting two pages of memory and a function, with the given
+    // sections ahead of the code and the data section after it
+    static Bytes
+    module(Bytes const& beforeCode, Bytes const& data)
+    {
+        return concat(
+            {{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00},
+             section(1, {0x01, 0x60, 0x00, 0x00}),
+             section(3, {0x01, 0x00}),
+             section(5, {0x01, 0x00, 0x02}),
+             section(7, {0x02, 0x06, 'm', 'e', 'm', 'o', 'r', 'y', 0x02, 0x00,
+                         0x04, 'h', 'o', 'o', 'k', 0x00, 0x00}),
+             beforeCode,
+             section(10, {0x01, 0x02, 0x00, 0x0B}),
+             data});
+    }
+
+    static bool
+    strips(Bytes const& wasm, std::size_t len)
+    {
+        return hook::MemorySnapshot::stripData(wasm.data(), len).has_value();
+    }
+
+    static bool
+    strips(Bytes const& wasm)
+    {
+        return strips(wasm, wasm.size());
+    }
+
+    void
+    testStripData()
+    {
+        testcase("strip data");
+
+        Bytes const hook = module({}, dataSection());
+        auto const stripped =
+            hook::MemorySnapshot::stripData(hook.data(), hook.size());
+        BEAST_EXPECT(stripped && *stripped == module({}, {}));
+
+        // nothing to snapshot
+        BEAST_EXPECT(!strips(module({}, {})));
+        BEAST_EXPECT(!strips(module({}, section(11, {0x00}))));
+
+        // start function
+        BEAST_EXPECT(!strips(module(section(8, {0x00}), dataSection())));
+
+        // data count, memory.init and data.drop may refer to the segments
+        BEAST_EXPECT(!strips(module(section(12, {0x02}), dataSection())));
+
+        // passive segment
+        BEAST_EXPECT(!strips(module({}, segment({0x01, 0x02, 'h', 'i'}))));
+
+        // explicit memory index 0 is active, any other is not understood
+        BEAST_EXPECT(strips(module(
+            {}, segment({0x02, 0x00, 0x41, 0x00, 0x0B, 0x02, 'h', 'i'}))));
+        BEAST_EXPECT(!strips(module(
+            {}, segment({0x02, 0x01, 0x41, 0x00, 0x0B, 0x02, 'h', 'i'}))));
+
+        // global.get offset, any other expression is not understood
+        BEAST_EXPECT(strips(
+            module({}, segment({0x00, 0x23, 0x00, 0x0B, 0x02, 'h', 'i'}))));
+        BEAST_EXPECT(!strips(
+            module({}, segment({0x00, 0x42, 0x00, 0x0B, 0x02, 'h', 'i'}))));
+
+        // malformed: bad header, truncated, segment running past its section
+        Bytes bad = hook;
+        bad[0] = 0x01;
+        BEAST_EXPECT(!strips(bad));
+        for (std::size_t len = 0; len < hook.size(); ++len)
+            BEAST_EXPECT(!strips(hook, len));
+        BEAST_EXPECT(!strips(
+            module({}, segment({0x00, 0x41, 0x00, 0x0B, 0x09, 'h', 'i'}))));
+    }
+
+    void
+    testSnapshot()
+    {
+        testcase("snapshot");
+
+        using hook::MemorySnapshot;
+        using hook::ModuleCache;
+
+        std::size_t const memorySize = 2 * 65536;
+        Bytes const hook = module({}, dataSection());
+        auto const j = beast::Journal{beast::Journal::getNullSink()};
+
+        WasmEdge_ConfigureContext* confCtx = WasmEdge_ConfigureCreate();
+        WasmEdge_ConfigureStatisticsSetInstructionCounting(confCtx, true);
+        WasmEdge_StoreContext* storeCtx = WasmEdge_StoreCreate();
+
+        auto const loaded = ModuleCache::load(hook.data(), hook.size(), j);
+        BEAST_EXPECT(loaded);
+
+        auto const snapshot = MemorySnapshot::take(
+            loaded, hook.data(), hook.size(), confCtx, storeCtx, j);
+        BEAST_EXPECT(snapshot && snapshot->module());
+
+        // instantiate a module, optionally from the snapshot, returning its
+        // memory and the instructions counted along the way
+        auto const instantiate = [&](ModuleCache::Module const& ast,
+                                     bool apply) {
+            WasmEdge_StatisticsContext* statsCtx = WasmEdge_StatisticsCreate();
+            WasmEdge_ExecutorContext* execCtx =
+                WasmEdge_ExecutorCreate(confCtx, statsCtx);
+            WasmEdge_ModuleInstanceContext* instance = NULL;
+
+            std::pair<Bytes, uint64_t> ret;
+            if (WasmEdge_ResultOK(WasmEdge_ExecutorInstantiate(
+                    execCtx, &instance, storeCtx, ast.get())))
+            {
+                BEAST_EXPECT(!apply || snapshot->apply(instance));
+                auto* memoryCtx = WasmEdge_ModuleInstanceFindMemory(
+                    instance, WasmEdge_StringWrap("memory", 6));
+                uint8_t const* base =
+                    WasmEdge_MemoryInstanceGetPointer(memoryCtx, 0, memorySize);
+                if (BEAST_EXPECT(base))
+                    ret.first.assign(base, base + memorySize);
+                ret.second = WasmEdge_StatisticsGetInstrCount(statsCtx);
+                WasmEdge_ModuleInstanceDelete(instance);
+            }
+            else
+                fail("instantiation failed");
+
+            WasmEdge_ExecutorDelete(execCtx);
+            WasmEdge_StatisticsDelete(statsCtx);
+            return ret;
+        };
+
+        if (snapshot)
+        {
+            auto const [fresh, freshCount] = instantiate(loaded, false);
+            BEAST_EXPECT(fresh.size() == memorySize);
+            BEAST_EXPECT(std::memcmp(fresh.data() + 16, "hello", 5) == 0);
+            BEAST_EXPECT(std::memcmp(fresh.data() + 70000, "world", 5) == 0);
+
+            // the stripped module starts out zero
+            auto const zero = instantiate(snapshot->module(), false).first;
+            BEAST_EXPECT(zero == Bytes(memorySize, 0));
+
+            // the snapshot puts the segments in place and makes up for the
+            // instructions they would have counted, every time
+            for (int i = 0; i < 3; ++i)
+            {
+                auto const [restored, restoredCount] =
+                    instantiate(snapshot->module(), true);
+                BEAST_EXPECT(restored == fresh);
+                BEAST_EXPECT(
+                    restoredCount + snapshot->instructions() == freshCount);
+            }
+        }
+
+        // the cache remembers both snapshots and hooks which cannot have one
+        hook::MemorySnapshotCache cache{4};
+        auto const fetch = [&](uint256 const& hookHash,
+                               ModuleCache::Module const& ast,
+                               Bytes const& wasm) {
+            return cache.fetch(
+                hookHash, ast, wasm.data(), wasm.size(), confCtx, storeCtx, j);
+        };
+
+        BEAST_EXPECT(!fetch(uint256{1}, loaded, hook));
+        cache.enable(true);
+
+        auto const first = fetch(uint256{1}, loaded, hook);
+        BEAST_EXPECT(first && first == fetch(uint256{1}, loaded, hook));
+
+        Bytes const plain = module({}, {});
+        auto const plainModule =
+            ModuleCache::load(plain.data(), plain.size(), j);
+        BEAST_EXPECT(!fetch(uint256{2}, plainModule, plain));
+        BEAST_EXPECT(!fetch(uint256{2}, plainModule, plain));
+
+        auto const counts = cache.getCounts();
+        BEAST_EXPECT(counts.hits == 2);
+        BEAST_EXPECT(counts.misses == 2);
+        BEAST_EXPECT(counts.rejected == 1);
+        BEAST_EXPECT(counts.size == 2);
+
+        WasmEdge_StoreDelete(storeCtx);
+        WasmEdge_ConfigureDelete(confCtx);
+    }
+
+public:
+    void
+    run() override
+    {
+        testStripData();
+        testSnapshot();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(MemorySnapshot, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
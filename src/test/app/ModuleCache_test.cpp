@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/ModuleCache.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/protocol/digest.h>
+#include <test/unit_test/SuiteJournal.h>
+#include <string>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+class ModuleCache_test : public beast::unit_test::suite
+{
+    using Bytes = std::vector<uint8_t>;
+
+    // an empty module told apart from the others by a custom section named after it
+    static Bytes
+    module(std::string const& name)
+    {
+        Bytes out{0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00};
+        out.push_back(0x00);
+        out.push_back(static_cast<uint8_t>(name.size() + 1));
+        out.push_back(static_cast<uint8_t>(name.size()));
+        out.insert(out.end(), name.begin(), name.end());
+        return out;
+    }
+
+    static uint256
+    hash(Bytes const& wasm)
+    {
+        return sha512Half_s(Slice(wasm.data(), wasm.size()));
+    }
+
+    void
+    testLRU(beast::Journal const& j)
+    {
+        testcase("lru");
+
+        hook::ModuleCache cache{2};
+        Bytes const one = module("one");
+        Bytes const two = module("two");
+        Bytes const three = module("three");
+
+        auto fetch = [&](Bytes const& wasm) {
+            return cache.fetch(hash(wasm), wasm.data(), wasm.size(), j);
+        };
+
+        // a miss loads the module, the same hash then hits and hands out the same module
+        auto const first = fetch(one);
+        BEAST_EXPECT(first.interpreted);
+        BEAST_EXPECT(!first.native);
+        auto const again = fetch(one);
+        BEAST_EXPECT(again.interpreted == first.interpreted);
+
+        auto counts = cache.getCounts();
+        BEAST_EXPECT(counts.misses == 1);
+        BEAST_EXPECT(counts.hits == 1);
+        BEAST_EXPECT(counts.size == 1);
+
+        // at capacity the least recently used entry goes, "one" was used after "two"
+        BEAST_EXPECT(fetch(two).interpreted);
+        BEAST_EXPECT(fetch(one).interpreted);
+        BEAST_EXPECT(fetch(three).interpreted);
+
+        counts = cache.getCounts();
+        BEAST_EXPECT(counts.evictions == 1);
+        BEAST_EXPECT(counts.size == 2);
+        BEAST_EXPECT(cache.size() == 2);
+        BEAST_EXPECT(counts.hits == 2);
+        BEAST_EXPECT(counts.misses == 3);
+
+        BEAST_EXPECT(fetch(one).interpreted);
+        BEAST_EXPECT(cache.getCounts().hits == 3);
+        BEAST_EXPECT(fetch(two).interpreted);
+        counts = cache.getCounts();
+        BEAST_EXPECT(counts.misses == 4);
+        BEAST_EXPECT(counts.evictions == 2);
+        BEAST_EXPECT(counts.failures == 0);
+    }
+
+    void
+    testFailures(beast::Journal const& j)
+    {
+        testcase("failures");
+
+        hook::ModuleCache cache{2};
+
+        // not webassembly, each fetch loads it again and fails again
+        Bytes const junk(64, 0x42);
+        for (int i = 0; i < 2; ++i)
+        {
+            auto const modules = cache.fetch(hash(junk), junk.data(), junk.size(), j);
+            BEAST_EXPECT(!modules.interpreted);
+            BEAST_EXPECT(!modules.native);
+        }
+
+        auto const counts = cache.getCounts();
+        BEAST_EXPECT(counts.failures == 2);
+        BEAST_EXPECT(counts.misses == 2);
+        BEAST_EXPECT(counts.hits == 0);
+        BEAST_EXPECT(counts.size == 0);
+
+        // a failure takes no room from valid modules
+        Bytes const valid = module("valid");
+        BEAST_EXPECT(cache.fetch(hash(valid), valid.data(), valid.size(), j).interpreted);
+        BEAST_EXPECT(cache.size() == 1);
+        BEAST_EXPECT(cache.getCounts().evictions == 0);
+    }
+
+public:
+    void
+    run() override
+    {
+        SuiteJournal journal("ModuleCache_test", *this);
+
+        testLRU(journal);
+        testFailures(journal);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(ModuleCache, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
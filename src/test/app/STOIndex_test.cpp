@@ -0,0 +1,263 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/STOIndex.h>
+#include <ripple/beast/unit_test.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+namespace {
+
+// a serialized payment carrying the given number of memos, as a hook would find it in its memory
+std::vector<std::uint8_t>
+payment(int memos = 2)
+{
+    std::vector<std::uint8_t> b = {
+        0x12, 0x00, 0x00,                                       // TransactionType
+        0x22, 0x80, 0x00, 0x00, 0x00,                           // Flags
+        0x24, 0x00, 0x00, 0x00, 0x01,                           // Sequence
+        0x61, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xE8,   // Amount
+        0x68, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A,   // Fee
+        0x73, 0x21};                                            // SigningPubKey
+    b.insert(b.end(), 33, 0x02);
+    b.insert(b.end(), {0x81, 0x14});                            // Account
+    b.insert(b.end(), 20, 0xAA);
+    b.insert(b.end(), {0x83, 0x14});                            // Destination
+    b.insert(b.end(), 20, 0xBB);
+    b.push_back(0xF9);                                          // Memos
+    for (int i = 0; i < memos; ++i)
+    {
+        b.insert(b.end(), {0xEA, 0x7C, 0x02, 0xAB, static_cast<std::uint8_t>(i)});  // Memo, MemoType
+        b.insert(b.end(), {0x7D, 0x04, 0xDE, 0xAD, 0xBE, 0xEF, 0xE1});           // MemoData
+    }
+    b.push_back(0xF1);
+    return b;
+}
+
+bool
+same(hook::STOScan const& a, hook::STOScan const& b)
+{
+    if (a.error != b.error || a.upto != b.upto || a.fields.size() != b.fields.size())
+        return false;
+    for (std::size_t i = 0; i < a.fields.size(); ++i)
+    {
+        auto const& x = a.fields[i];
+        auto const& y = b.fields[i];
+        if (x.offset != y.offset || x.length != y.length || x.type != y.type ||
+            x.field != y.field || x.payload_start != y.payload_start ||
+            x.payload_length != y.payload_length)
+            return false;
+    }
+    return true;
+}
+
+hook::STOScan
+fresh(std::vector<std::uint8_t> const& memory, std::uint32_t ptr, std::uint32_t len)
+{
+    return hook::STOScan::make(memory.data() + ptr, memory.data() + ptr + len);
+}
+
+}  // namespace
+
+class STOIndex_test : public beast::unit_test::suite
+{
+    void
+    testScan()
+    {
+        testcase("scan");
+
+        auto const tx = payment();
+        auto const scan = fresh(tx, 0, tx.size());
+
+        BEAST_EXPECT(!scan.error);
+        BEAST_EXPECT(scan.upto == static_cast<std::int64_t>(tx.size()));
+        if (!BEAST_EXPECT(scan.fields.size() == 9))
+            return;
+
+        BEAST_EXPECT(scan.fields[0].type == 1 && scan.fields[0].field == 2);
+        BEAST_EXPECT(scan.fields[3].type == 6 && scan.fields[3].payload_length == 8);
+        BEAST_EXPECT(scan.fields[6].type == 8 && scan.fields[6].payload_start == 2);
+
+        // the memos array, unwrapped as sto_subarray does, holds one object per memo
+        auto const& memos = scan.fields[8];
+        BEAST_EXPECT(memos.type == 15 && memos.field == 9);
+        BEAST_EXPECT(memos.offset + memos.length == static_cast<std::int32_t>(tx.size()));
+        auto const elements = fresh(tx, memos.offset + 1, memos.length - 2);
+        BEAST_EXPECT(!elements.error && elements.fields.size() == 2);
+        BEAST_EXPECT(elements.fields[1].type == 14 && elements.fields[1].field == 10);
+
+        // a fixed size field cut short ends the walk past the end, as it did in the sto_ loops
+        auto const truncated = fresh(tx, 0, 10);
+        BEAST_EXPECT(truncated.fields.size() == 3 && truncated.upto == 13);
+        BEAST_EXPECT(!truncated.error);
+
+        std::vector<std::uint8_t> unknown{0x12, 0x00, 0x00, 0x9F, 0x00, 0x00};
+        auto const bad = fresh(unknown, 0, unknown.size());
+        BEAST_EXPECT(bad.error && bad.fields.size() == 1 && bad.upto == 3);
+    }
+
+    void
+    testCache()
+    {
+        testcase("cache");
+
+        std::vector<std::uint8_t> memory(1024, 0);
+        auto const tx = payment();
+        std::uint32_t const ptr = 100;
+        std::copy(tx.begin(), tx.end(), memory.begin() + ptr);
+        std::uint32_t const len = tx.size();
+
+        hook::STOIndex index;
+        BEAST_EXPECT(same(index.scan(memory.data(), ptr, len), fresh(memory, ptr, len)));
+        BEAST_EXPECT(index.size() == 1);
+
+        // ranges inside a scanned buffer are served from its snapshot
+        auto const memos = fresh(memory, ptr, len).fields[8];
+        std::uint32_t const inner = ptr + memos.offset + 1;
+        BEAST_EXPECT(same(
+            index.scan(memory.data(), inner, memos.length - 2),
+            fresh(memory, inner, memos.length - 2)));
+        BEAST_EXPECT(index.size() == 1);
+
+        // a write into the buffer invalidates it
+        memory[ptr + 1] = 0x01;
+        memory[ptr] = 0x9F;
+        BEAST_EXPECT(same(index.scan(memory.data(), ptr, len), fresh(memory, ptr, len)));
+        BEAST_EXPECT(index.scan(memory.data(), ptr, len).error);
+        BEAST_EXPECT(index.size() == 1);
+
+        // at most maxBuffers buffers are kept
+        for (std::uint32_t i = 0; i < hook::STOIndex::maxBuffers * 2; ++i)
+            index.scan(memory.data(), 900 + i, 3);
+        BEAST_EXPECT(index.size() == hook::STOIndex::maxBuffers);
+    }
+
+    void
+    testFuzz()
+    {
+        testcase("cached scans match fresh scans");
+
+        // the hook rewrites bytes between calls and scans arbitrary ranges, every cached
+        // scan must match a scan of the memory as it is now
+        std::mt19937_64 rng{7};
+        std::vector<std::uint8_t> memory(4096, 0);
+        auto const tx = payment(20);
+        for (std::uint32_t at = 0; at + tx.size() < memory.size(); at += 1024)
+            std::copy(tx.begin(), tx.end(), memory.begin() + at);
+
+        hook::STOIndex index;
+        for (int i = 0; i < 200000; ++i)
+        {
+            auto const r = rng();
+            if (r % 8 == 0)
+                memory[rng() % memory.size()] = static_cast<std::uint8_t>(rng());
+
+            std::uint32_t const base = ((r >> 8) % 4) * 1024;
+            std::uint32_t const ptr = base + (r % 3 == 0 ? 0 : (r >> 16) % 64);
+            std::uint32_t const len = 2 + (r >> 24) % (tx.size() + 8);
+
+            if (!same(index.scan(memory.data(), ptr, len), fresh(memory, ptr, len)))
+            {
+                fail(
+                    "scan " + std::to_string(ptr) + ":" + std::to_string(len),
+                    __FILE__,
+                    __LINE__);
+                return;
+            }
+        }
+        pass();
+    }
+
+public:
+    void
+    run() override
+    {
+        testScan();
+        testCache();
+        testFuzz();
+    }
+};
+
+/**
+ * A hook reading every memo of a transaction with sto_subarray and sto_subfield, with and without
+ * the index. Without it every call walks the buffer from the start.
+ */
+class STOIndexBench_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        using namespace std::chrono;
+
+        int const memos = 32;
+        int const rounds = 2000;
+        auto const memory = payment(memos);
+        std::uint32_t const len = memory.size();
+        std::int64_t sink = 0;
+
+        // a scan is only valid until the next one, as in the host functions
+        auto visit = [&](auto&& scan) {
+            auto const array = scan(0, len).fields.back();
+            for (int m = 0; m < memos; ++m)
+            {
+                auto const memo = scan(array.offset + 1, array.length - 2).fields[m];
+                sink += scan(
+                    array.offset + 1 + memo.offset + memo.payload_start,
+                    memo.payload_length).fields.back().payload_length;
+            }
+        };
+
+        auto const start = steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+        {
+            hook::STOScan last;
+            visit([&](std::uint32_t ptr, std::uint32_t l) -> hook::STOScan const& {
+                return last = fresh(memory, ptr, l);
+            });
+        }
+        auto const walked = steady_clock::now() - start;
+
+        auto const start2 = steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+        {
+            hook::STOIndex index;
+            visit([&](std::uint32_t ptr, std::uint32_t l) -> hook::STOScan const& {
+                return index.scan(memory.data(), ptr, l);
+            });
+        }
+        auto const indexed = steady_clock::now() - start2;
+
+        log << memos << " memos read, mean of " << rounds << " executions: walk "
+            << duration_cast<nanoseconds>(walked).count() / rounds << "ns, index "
+            << duration_cast<nanoseconds>(indexed).count() / rounds << "ns"
+            << std::endl;
+
+        BEAST_EXPECT(sink > 0);
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(STOIndex, app, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(STOIndexBench, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
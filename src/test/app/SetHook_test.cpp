@@ -17,7 +17,9 @@
 */
 //==============================================================================
 #include <ripple/app/tx/impl/SetHook.h>
+#include <ripple/app/hook/WeakChainScheduler.h>
 #include <ripple/app/ledger/LedgerMaster.h>
+#include <ripple/core/ConfigSections.h>
 #include <ripple/protocol/TxFlags.h>
 #include <ripple/protocol/jss.h>
 #include <test/app/SetHook_wasm.h>
@@ -80,6 +82,11 @@ private:
         jv[jss::Flags] = hsfOVERRIDE;
     }
 
+    void static collectFlag(Json::Value& jv)
+    {
+        jv[jss::Flags] = hsfCOLLECT;
+    }
+
 public:
 // This is a large fee, large enough that we can set most small test hooks
 // without running into fee issues we only want to test fee code specifically in
@@ -1613,6 +1620,293 @@ public:
             ter(temMALFORMED));
     }
 
+    // Alice's offer crosses offers of three holders, each holder's trust line changes so each is
+    // a weak stake holder with a collect hook that counts in its own state and emits a payment.
+    // Run on the worker pool the chains must leave exactly what they leave in sequence, and with
+    // the "shared" parameter every chain also reads alice's state, so the batch is found not to
+    // be independent and runs again in sequence.
+    void
+    testWeakChains()
+    {
+        testcase("Test parallel weak hook chains");
+        using namespace jtx;
+
+        TestHook hook = wasm[R"[test.hook](
+        #include <stdint.h>
+        extern int32_t _g(uint32_t, uint32_t);
+        extern int64_t accept (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+        extern int64_t rollback (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+        extern int64_t state (uint32_t, uint32_t, uint32_t, uint32_t);
+        extern int64_t state_set (uint32_t, uint32_t, uint32_t, uint32_t);
+        extern int64_t state_foreign (
+            uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+        extern int64_t otxn_field (uint32_t, uint32_t, uint32_t);
+        extern int64_t otxn_param (uint32_t, uint32_t, uint32_t, uint32_t);
+        extern int64_t hook_account (uint32_t, uint32_t);
+        extern int64_t emit (uint32_t, uint32_t, uint32_t, uint32_t);
+        extern int64_t etxn_reserve (uint32_t);
+        extern int64_t etxn_details (uint32_t, uint32_t);
+        extern int64_t etxn_fee_base (uint32_t, uint32_t);
+        extern int64_t ledger_seq (void);
+        #define SBUF(x) (uint32_t)(x), sizeof(x)
+        #define ASSERT(x)\
+            if (!(x))\
+                rollback((uint32_t)#x, sizeof(#x), __LINE__);
+        #define sfAccount ((8U << 16U) + 1U)
+        #define ttPAYMENT 0
+        #define tfCANONICAL 0x80000000UL
+
+        #define ENCODE_UINT32_COMMON(buf_out, i, field)\
+            {\
+                uint32_t ui = i;\
+                buf_out[0] = 0x20U + ((field) & 0x0FU);\
+                buf_out[1] = (ui >> 24) & 0xFFU;\
+                buf_out[2] = (ui >> 16) & 0xFFU;\
+                buf_out[3] = (ui >>  8) & 0xFFU;\
+                buf_out[4] = (ui >>  0) & 0xFFU;\
+                buf_out += 5;\
+            }
+        #define ENCODE_UINT32_UNCOMMON(buf_out, i, field)\
+            {\
+                uint32_t ui = i;\
+                buf_out[0] = 0x20U;\
+                buf_out[1] = field;\
+                buf_out[2] = (ui >> 24) & 0xFFU;\
+                buf_out[3] = (ui >> 16) & 0xFFU;\
+                buf_out[4] = (ui >>  8) & 0xFFU;\
+                buf_out[5] = (ui >>  0) & 0xFFU;\
+                buf_out += 6;\
+            }
+        #define ENCODE_DROPS(buf_out, drops, amount_type)\
+            {\
+                uint64_t udrops = drops;\
+                buf_out[0] = 0x60U + ((amount_type) & 0x0FU);\
+                buf_out[1] = 0b01000000 + ((udrops >> 56) & 0b00111111);\
+                buf_out[2] = (udrops >> 48) & 0xFFU;\
+                buf_out[3] = (udrops >> 40) & 0xFFU;\
+                buf_out[4] = (udrops >> 32) & 0xFFU;\
+                buf_out[5] = (udrops >> 24) & 0xFFU;\
+                buf_out[6] = (udrops >> 16) & 0xFFU;\
+                buf_out[7] = (udrops >>  8) & 0xFFU;\
+                buf_out[8] = (udrops >>  0) & 0xFFU;\
+                buf_out += 9;\
+            }
+        #define ENCODE_ACCOUNT(buf_out, account_id, account_type)\
+            {\
+                buf_out[0] = 0x80U + (account_type);\
+                buf_out[1] = 0x14U;\
+                *(uint64_t*)(buf_out +  2) = *(uint64_t*)(account_id +  0);\
+                *(uint64_t*)(buf_out + 10) = *(uint64_t*)(account_id +  8);\
+                *(uint32_t*)(buf_out + 18) = *(uint32_t*)(account_id + 16);\
+                buf_out += 22;\
+            }
+        #define GUARD(maxiter) _g((1ULL << 31U) + __LINE__, (maxiter)+1)
+
+        #define PAYMENT_SIZE 270U
+        #define PREPARE_PAYMENT(buf_out_master, drops, to_address)\
+            {\
+                uint8_t* buf_out = buf_out_master;\
+                uint8_t acc[20];\
+                uint32_t cls = (uint32_t)ledger_seq();\
+                hook_account(SBUF(acc));\
+                buf_out[0] = 0x12U;\
+                buf_out[1] = (ttPAYMENT >> 8) & 0xFFU;\
+                buf_out[2] = (ttPAYMENT >> 0) & 0xFFU;\
+                buf_out += 3;\
+                ENCODE_UINT32_COMMON(buf_out, tfCANONICAL, 0x2U);\
+                ENCODE_UINT32_COMMON(buf_out, 0, 0x3U);\
+                ENCODE_UINT32_COMMON(buf_out, 0, 0x4U);\
+                ENCODE_UINT32_COMMON(buf_out, 0, 0xEU);\
+                ENCODE_UINT32_UNCOMMON(buf_out, cls + 1, 0x1AU);\
+                ENCODE_UINT32_UNCOMMON(buf_out, cls + 5, 0x1BU);\
+                ENCODE_DROPS(buf_out, drops, 1U);\
+                uint8_t* fee_ptr = buf_out;\
+                ENCODE_DROPS(buf_out, 0, 8U);\
+                buf_out[0] = 0x73U;\
+                buf_out[1] = 0x21U;\
+                *(uint64_t*)(buf_out +  2) = 0;\
+                *(uint64_t*)(buf_out + 10) = 0;\
+                *(uint64_t*)(buf_out + 18) = 0;\
+                *(uint64_t*)(buf_out + 26) = 0;\
+                buf_out[34] = 0;\
+                buf_out += 35;\
+                ENCODE_ACCOUNT(buf_out, acc, 1U);\
+                ENCODE_ACCOUNT(buf_out, to_address, 3U);\
+                etxn_details((uint32_t)buf_out, PAYMENT_SIZE);\
+                int64_t fee = etxn_fee_base((uint32_t)buf_out_master, PAYMENT_SIZE);\
+                ENCODE_DROPS(fee_ptr, fee, 8U);\
+            }
+
+        int64_t hook(uint32_t r)
+        {
+            _g(1,1);
+
+            uint8_t otxn_acc[20];
+            ASSERT(otxn_field(SBUF(otxn_acc), sfAccount) == 20);
+
+            // count the executions in the hook account's own state
+            uint8_t count = 0;
+            state((uint32_t)&count, 1, (uint32_t)"count", 5);
+            ++count;
+            ASSERT(state_set((uint32_t)&count, 1, (uint32_t)"count", 5) == 1);
+
+            // look at the originating account's state as well, which every chain then shares
+            uint8_t shared = 0;
+            if (otxn_param((uint32_t)&shared, 1, (uint32_t)"shared", 6) == 1)
+            {
+                uint8_t ns[32];
+                for (int i = 0; GUARD(32), i < 32; ++i)
+                    ns[i] = 0;
+                uint8_t buf[32];
+                state_foreign(SBUF(buf), (uint32_t)"count", 5, SBUF(ns), SBUF(otxn_acc));
+            }
+
+            ASSERT(etxn_reserve(1) == 1);
+            uint8_t tx[PAYMENT_SIZE];
+            PREPARE_PAYMENT(tx, 1000, otxn_acc);
+            uint8_t hash[32];
+            ASSERT(emit(SBUF(hash), SBUF(tx)) == 32);
+
+            return accept(0,0,count);
+        }
+        )[test.hook]"];
+
+        struct Outcome
+        {
+            std::optional<STArray> executions;
+            std::vector<uint256> emitted;
+            std::vector<Blob> counts;
+            uint64_t batches = 0;
+            uint64_t fallbacks = 0;
+        };
+
+        Account const gw{"gateway"};
+        Account const alice{"alice"};
+        std::vector<Account> const holders{
+            Account{"carol"}, Account{"dave"}, Account{"erin"}};
+        auto const USD = gw["USD"];
+
+        uint256 countKey;
+        std::memcpy(countKey.data() + countKey.size() - 5, "count", 5);
+
+        auto const run = [&](std::size_t threads, bool shared)
+        {
+            Env env{*this, envconfig([threads](std::unique_ptr<Config> cfg)
+            {
+                cfg->section(SECTION_HOOKS).set(
+                    "parallel_weak_chains", std::to_string(threads));
+                return cfg;
+            }), supported_amendments()};
+
+            env.fund(XRP(10000), gw, alice);
+            for (auto const& holder : holders)
+                env.fund(XRP(10000), holder);
+            env.close();
+
+            env.trust(USD(1000), alice);
+            for (auto const& holder : holders)
+                env.trust(USD(1000), holder);
+            env(pay(gw, alice, USD(300)));
+            env.close();
+
+            for (auto const& holder : holders)
+            {
+                env(offer(holder, USD(100), XRP(100)));
+                env(fset(holder, asfTshCollect));
+                env(ripple::test::jtx::hook(holder, {{hso(hook, collectFlag)}}, 0),
+                    M("set weak chain"),
+                    HSFEE);
+            }
+            env.close();
+
+            Json::Value jv = offer(alice, XRP(300), USD(300));
+            if (shared)
+            {
+                Json::Value params{Json::arrayValue};
+                params[0U][jss::HookParameter][jss::HookParameterName] =
+                    strHex(std::string("shared"));
+                params[0U][jss::HookParameter][jss::HookParameterValue] = "01";
+                jv[jss::HookParameters] = params;
+            }
+
+            auto& scheduler = hook::WeakChainScheduler::instance();
+            BEAST_EXPECT(scheduler.enabled() == (threads > 0));
+            auto const batches = scheduler.batches();
+            auto const fallbacks = scheduler.fallbacks();
+
+            env(jv, M("cross the holders' offers"), fee(XRP(1)));
+
+            Outcome outcome;
+            outcome.batches = scheduler.batches() - batches;
+            outcome.fallbacks = scheduler.fallbacks() - fallbacks;
+
+            for (auto const& holder : holders)
+            {
+                auto const hookState =
+                    env.le(keylet::hookState(holder.id(), countKey, uint256{}));
+                outcome.counts.push_back(
+                    hookState ? hookState->getFieldVL(sfHookStateData) : Blob{});
+            }
+
+            auto const meta = env.meta();
+            if (!BEAST_EXPECT(meta && meta->isFieldPresent(sfHookExecutions)))
+                return outcome;
+
+            outcome.executions = meta->getFieldArray(sfHookExecutions);
+            for (auto const& node : meta->getFieldArray(sfAffectedNodes))
+            {
+                if (node.getFName() != sfCreatedNode ||
+                    node.getFieldU16(sfLedgerEntryType) != ltEMITTED_TXN)
+                    continue;
+
+                auto const& nf = const_cast<ripple::STObject&>(node)
+                    .getField(sfNewFields).downcast<STObject>();
+                auto const& et = const_cast<ripple::STObject&>(nf)
+                    .getField(sfEmittedTxn).downcast<STObject>();
+
+                Blob txBlob = et.getSerializer().getData();
+                STTx const tx{Slice{txBlob.data(), txBlob.size()}};
+                outcome.emitted.push_back(tx.getTransactionID());
+            }
+            return outcome;
+        };
+
+        std::vector<AccountID> order;
+        for (auto const& holder : holders)
+            order.push_back(holder.id());
+        std::sort(order.begin(), order.end());
+
+        for (bool const shared : {false, true})
+        {
+            Outcome const sequential = run(0, shared);
+            Outcome const parallel = run(4, shared);
+
+            BEAST_EXPECT(sequential.batches == 0);
+            BEAST_EXPECT(parallel.batches == 1);
+            BEAST_EXPECT(parallel.fallbacks == (shared ? 1 : 0));
+
+            // one accepted execution per holder, in the order the holders are stake holders
+            BEAST_REQUIRE(sequential.executions && parallel.executions);
+            BEAST_REQUIRE(sequential.executions->size() == holders.size());
+            for (std::size_t i = 0; i < holders.size(); ++i)
+            {
+                auto const& execution = (*sequential.executions)[i];
+                BEAST_EXPECT(execution.getAccountID(sfHookAccount) == order[i]);
+                BEAST_EXPECT(execution.getFieldU8(sfHookResult) == 3);
+                BEAST_EXPECT(execution.getFieldU64(sfHookReturnCode) == 1);
+                BEAST_EXPECT(execution.getFieldU16(sfHookStateChangeCount) == 1);
+                BEAST_EXPECT(execution.getFieldU16(sfHookEmitCount) == 1);
+            }
+
+            BEAST_EXPECT(*sequential.executions == *parallel.executions);
+            BEAST_EXPECT(sequential.emitted.size() == holders.size());
+            BEAST_EXPECT(sequential.emitted == parallel.emitted);
+            BEAST_EXPECT(sequential.counts == parallel.counts);
+            for (auto const& count : sequential.counts)
+                BEAST_EXPECT(count == Blob{1});
+        }
+    }
+
     void
     test_accept()
     {
@@ -8061,6 +8355,153 @@ public:
         // RH TODO: check reserve exhaustion
     }
 
+    void
+    test_state_prefetch()
+    {
+        testcase("Test state_prefetch");
+        using namespace jtx;
+
+        auto const bob = Account{"bob"};
+        auto const alice = Account{"alice"};
+
+        TestHook hook = wasm[R"[test.hook](
+            #include <stdint.h>
+            extern int32_t _g       (uint32_t id, uint32_t maxiter);
+            #define GUARD(maxiter) _g((1ULL << 31U) + __LINE__, (maxiter)+1)
+            extern int64_t accept   (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+            extern int64_t rollback (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+            extern int64_t state (
+                uint32_t write_ptr,
+                uint32_t write_len,
+                uint32_t kread_ptr,
+                uint32_t kread_len
+            );
+            extern int64_t state_prefetch (
+                uint32_t nread_ptr,
+                uint32_t nread_len,
+                uint32_t aread_ptr,
+                uint32_t aread_len
+            );
+            #define ASSERT(x)\
+                if (!(x))\
+                    rollback((uint32_t)#x, sizeof(#x), __LINE__);
+
+            #define INVALID_ARGUMENT (-7)
+            #define OUT_OF_BOUNDS (-1)
+            #define DOESNT_EXIST (-5)
+            #define SBUF(x) (uint32_t)(x), sizeof(x)
+
+            uint8_t other_ns[32] = { 0xFFU };
+
+            int64_t hook(uint32_t reserved )
+            {
+                _g(1,1);
+
+                // Test the parameter checks
+                ASSERT(state_prefetch(0, 31, 0, 0) == INVALID_ARGUMENT);
+                ASSERT(state_prefetch(0, 0, 0, 19) == INVALID_ARGUMENT);
+                ASSERT(state_prefetch(1000000, 32, 0, 0) == OUT_OF_BOUNDS);
+                ASSERT(state_prefetch(0, 0, 1000000, 20) == OUT_OF_BOUNDS);
+
+                // the two entries set by the previous hook are read ahead, once
+                ASSERT(state_prefetch(0, 0, 0, 0) == 2);
+                ASSERT(state_prefetch(0, 0, 0, 0) == 0);
+
+                // a namespace without state reads nothing
+                ASSERT(state_prefetch(SBUF(other_ns), 0, 0) == 0);
+
+                // the prefetched entries are served as before
+                uint8_t buf1[32];
+                uint8_t buf2[32];
+                ASSERT(state(SBUF(buf1), SBUF("key")) == sizeof("content"));
+                ASSERT(state(SBUF(buf2), SBUF("key2")) == sizeof("content2"));
+                ASSERT(state(SBUF(buf1), SBUF("key3")) == DOESNT_EXIST);
+
+                for (int i = 0; GUARD(sizeof("content")), i < sizeof("content"); ++i)
+                    ASSERT(buf1[i] == *((uint8_t*)"content" + i));
+
+                for (int i = 0; GUARD(sizeof("content2")), i < sizeof("content2"); ++i)
+                    ASSERT(buf2[i] == *((uint8_t*)"content2" + i));
+
+                return accept(0,0,0);
+            }
+        )[test.hook]"];
+
+        // the api only exists once the amendment is enabled
+        {
+            Env env{*this, supported_amendments() - featureHookStatePrefetch};
+            env.fund(XRP(10000), alice);
+
+            env(ripple::test::jtx::hook(alice, {{hso(hook, overrideFlag)}}, 0),
+                M("set state_prefetch without amendment"),
+                HSFEE,
+                ter(temMALFORMED));
+        }
+
+        Env env{*this, supported_amendments()};
+        env.fund(XRP(10000), alice);
+        env.fund(XRP(10000), bob);
+
+        // set the state the prefetch reads
+        {
+            TestHook hook = wasm[R"[test.hook](
+                #include <stdint.h>
+                extern int32_t _g       (uint32_t id, uint32_t maxiter);
+                extern int64_t accept   (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+                extern int64_t rollback (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+                extern int64_t state_set(uint32_t,uint32_t,uint32_t, uint32_t);
+                #define ASSERT(x)\
+                    if (!(x))\
+                        rollback((uint32_t)#x, sizeof(#x), __LINE__);
+
+                #define SBUF(x) (uint32_t)(x), sizeof(x)
+                int64_t hook(uint32_t reserved )
+                {
+                    _g(1,1);
+                    ASSERT(state_set(SBUF("content"), SBUF("key")) == sizeof("content"));
+                    ASSERT(state_set(SBUF("content2"), SBUF("key2")) == sizeof("content2"));
+                    return accept(0,0,0);
+                }
+            )[test.hook]"];
+
+            env(ripple::test::jtx::hook(alice, {{hso(hook, overrideFlag)}}, 0),
+                M("set state_prefetch 1"),
+                HSFEE);
+            env.close();
+
+            env(pay(bob, alice, XRP(1)), M("test state_prefetch 1"), fee(XRP(1)));
+            env.close();
+        }
+
+        env(ripple::test::jtx::hook(alice, {{hso(hook, overrideFlag)}}, 0),
+            M("set state_prefetch 2"),
+            HSFEE);
+        env.close();
+
+        auto const acc = env.le(keylet::account(alice.id()));
+        BEAST_REQUIRE(acc);
+        auto const ownerCount = acc->getFieldU32(sfOwnerCount);
+        BEAST_EXPECT(acc->getFieldU32(sfHookStateCount) == 2);
+
+        env(pay(bob, alice, XRP(1)), M("test state_prefetch 2"), fee(XRP(1)));
+        env.close();
+
+        // the hook accepted, having changed nothing
+        auto const meta = env.meta();
+        BEAST_REQUIRE(meta);
+        BEAST_REQUIRE(meta->isFieldPresent(sfHookExecutions));
+        auto const hookExecutions = meta->getFieldArray(sfHookExecutions);
+        BEAST_REQUIRE(hookExecutions.size() == 1);
+        BEAST_EXPECT(hookExecutions[0].getFieldU8(sfHookResult) == 3);
+        BEAST_EXPECT(hookExecutions[0].getFieldU16(sfHookStateChangeCount) == 0);
+
+        // reading ahead reserves nothing
+        auto const after = env.le(keylet::account(alice.id()));
+        BEAST_REQUIRE(after);
+        BEAST_EXPECT(after->getFieldU32(sfOwnerCount) == ownerCount);
+        BEAST_EXPECT(after->getFieldU32(sfHookStateCount) == 2);
+    }
+
     void
     test_state_set()
     {
@@ -11155,6 +11596,7 @@ public:
         testNSDelete();
 
         testWasm();
+        testWeakChains();
         test_accept();
         test_rollback();
 
@@ -11225,6 +11667,7 @@ public:
         test_state();               //
         test_state_foreign();       //
         test_state_foreign_set();   // 
+        test_state_prefetch();      //
         test_state_set();           //
 
         test_sto_emplace();         //
@@ -11383,5 +11826,119 @@ private:
     HASH_WASM(accept2);
 };
 BEAST_DEFINE_TESTSUITE(SetHook, tx, ripple);
+
+/**
+ * Measure the host call overhead of individual hook API functions. The bench hook calls the
+ * function selected by the F invoke parameter in a guarded loop, the mean time of an empty
+ * guarded loop (F = 0) is subtracted and the remainder divided by the number of calls.
+ */
+class HookHostCallBench_test : public beast::unit_test::suite
+{
+    // CALLS in the bench hook, kept low enough for the guard's worst case execution limit
+    static constexpr int calls = 400;
+    static constexpr int rounds = 50;
+
+    TestHook bench_wasm = wasm[
+        R"[test.hook](
+        #include <stdint.h>
+        extern int32_t _g             (uint32_t id, uint32_t maxiter);
+        extern int64_t accept         (uint32_t read_ptr, uint32_t read_len, int64_t error_code);
+        extern int64_t otxn_param     (uint32_t write_ptr, uint32_t write_len, uint32_t read_ptr, uint32_t read_len);
+        extern int64_t otxn_type      (void);
+        extern int64_t hook_account   (uint32_t write_ptr, uint32_t write_len);
+        extern int64_t float_one      (void);
+        extern int64_t float_multiply (int64_t float1, int64_t float2);
+        extern int64_t util_sha512h   (uint32_t write_ptr, uint32_t write_len, uint32_t read_ptr, uint32_t read_len);
+        extern int64_t state          (uint32_t write_ptr, uint32_t write_len, uint32_t kread_ptr, uint32_t kread_len);
+        #define SBUF(x) (uint32_t)(x), sizeof(x)
+        #define GUARD(maxiter) _g((1ULL << 31U) + __LINE__, (maxiter)+1)
+        #define CALLS 400
+        #define BENCH(n, call) if (f == n) for (int i = 0; GUARD(CALLS), i < CALLS; ++i) call;
+        int64_t hook(uint32_t reserved )
+        {
+            _g(1,1);
+            uint8_t f = 0;
+            otxn_param(&f, 1, "F", 1);
+            uint8_t buf[32];
+            uint8_t key[32] = {0};
+            int64_t one = float_one();
+            BENCH(0, (void)0)
+            BENCH(1, otxn_type())
+            BENCH(2, hook_account(buf, 20))
+            BENCH(3, float_one())
+            BENCH(4, float_multiply(one, one))
+            BENCH(5, util_sha512h(SBUF(buf), SBUF(buf)))
+            BENCH(6, state(SBUF(buf), SBUF(key)))
+            return accept(0,0,f);
+        }
+    )[test.hook]"];
+
+public:
+    void
+    run() override
+    {
+        using namespace jtx;
+        using namespace std::chrono;
+
+        Env env{*this, supported_amendments()};
+
+        auto const alice = Account{"alice"};
+        env.fund(XRP(100000), alice);
+        env.close();
+
+        env(ripple::test::jtx::hook(alice, {{hso(bench_wasm)}}, 0),
+            M("set host call bench"),
+            HSFEE);
+        env.close();
+
+        auto const time = [&](std::uint8_t f) {
+            Json::Value invoke;
+            invoke[jss::TransactionType] = "Invoke";
+            invoke[jss::Account] = alice.human();
+
+            Json::Value params{Json::arrayValue};
+            params[0U][jss::HookParameter][jss::HookParameterName] =
+                strHex(std::string("F"));
+            params[0U][jss::HookParameter][jss::HookParameterValue] =
+                strHex(std::string(1, static_cast<char>(f)));
+            invoke[jss::HookParameters] = params;
+
+            nanoseconds total{0};
+            for (int r = 0; r < rounds; ++r)
+            {
+                auto const start = steady_clock::now();
+                env(invoke, fee(XRP(1)));
+                total += steady_clock::now() - start;
+
+                auto const meta = env.meta();
+                BEAST_EXPECT(
+                    meta && meta->isFieldPresent(sfHookExecutions) &&
+                    meta->getFieldArray(sfHookExecutions)[0].getFieldU64(
+                        sfHookReturnCode) == f);
+                env.close();
+            }
+            return total / rounds;
+        };
+
+        auto const baseline = time(0);
+
+        for (auto const& [f, name] : std::vector<std::pair<std::uint8_t, char const*>>{
+                 {1, "otxn_type"},
+                 {2, "hook_account"},
+                 {3, "float_one"},
+                 {4, "float_multiply"},
+                 {5, "util_sha512h"},
+                 {6, "state"}})
+        {
+            auto const elapsed = time(f);
+            auto const perCall = elapsed > baseline
+                ? duration_cast<nanoseconds>(elapsed - baseline).count() / calls
+                : 0;
+            log << name << ": " << perCall << "ns per call" << std::endl;
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE_MANUAL(HookHostCallBench, tx, ripple);
 }  // namespace test
 }  // namespace ripple
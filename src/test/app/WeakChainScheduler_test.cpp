@@ -0,0 +1,133 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/WeakChainScheduler.h>
+#include <ripple/basics/BasicConfig.h>
+#include <ripple/basics/contract.h>
+#include <ripple/beast/unit_test.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+class WeakChainScheduler_test : public beast::unit_test::suite
+{
+    // every task runs exactly once and run returns only after all have finished
+    bool
+    covers(hook::WeakChainScheduler& scheduler, std::size_t n)
+    {
+        std::vector<std::atomic<int>> runs(n);
+        bool const ok = scheduler.run(n, [&](std::size_t i) { ++runs[i]; });
+        for (auto const& r : runs)
+            if (r != 1)
+                return false;
+        return ok;
+    }
+
+    void
+    testSequential()
+    {
+        testcase("no workers");
+
+        // without workers the calling thread runs the whole batch
+        hook::WeakChainScheduler scheduler;
+        BEAST_EXPECT(!scheduler.enabled());
+        BEAST_EXPECT(scheduler.run(0, [](std::size_t) {}));
+        BEAST_EXPECT(covers(scheduler, 1));
+        BEAST_EXPECT(covers(scheduler, 50));
+        BEAST_EXPECT(scheduler.batches() == 2);
+    }
+
+    void
+    testWorkers()
+    {
+        testcase("workers");
+
+        hook::WeakChainScheduler scheduler;
+        scheduler.start(4);
+        BEAST_EXPECT(scheduler.enabled());
+
+        for (std::size_t n : {1, 2, 7, 1000})
+            BEAST_EXPECT(covers(scheduler, n));
+
+        // a task which throws fails the batch but the rest of it still runs
+        std::atomic<int> ran{0};
+        BEAST_EXPECT(!scheduler.run(16, [&](std::size_t i) {
+            ++ran;
+            if (i == 3)
+                Throw<std::runtime_error>("chain failed");
+        }));
+        BEAST_EXPECT(ran == 16);
+
+        scheduler.noteFallback();
+        BEAST_EXPECT(scheduler.fallbacks() == 1);
+
+        // an application set up without the option disables the pool it finds running, the
+        // threads stay for the next one that enables it
+        beast::Journal const j{beast::Journal::getNullSink()};
+        scheduler.setup(Section{"hooks"}, j);
+        BEAST_EXPECT(!scheduler.enabled());
+
+        Section section{"hooks"};
+        section.set("parallel_weak_chains", "2");
+        scheduler.setup(section, j);
+        BEAST_EXPECT(scheduler.enabled());
+        BEAST_EXPECT(covers(scheduler, 7));
+    }
+
+    void
+    testConcurrentBatches()
+    {
+        testcase("concurrent batches");
+
+        // transactions of different ledgers may submit batches at the same time
+        hook::WeakChainScheduler scheduler;
+        scheduler.start(2);
+
+        std::atomic<int> failures{0};
+        std::vector<std::thread> callers;
+        for (int t = 0; t < 4; ++t)
+            callers.emplace_back([&] {
+                for (int i = 0; i < 200; ++i)
+                    if (!covers(scheduler, 1 + i % 9))
+                        ++failures;
+            });
+        for (auto& c : callers)
+            c.join();
+
+        BEAST_EXPECT(failures == 0);
+        BEAST_EXPECT(scheduler.batches() == 800);
+    }
+
+public:
+    void
+    run() override
+    {
+        testSequential();
+        testWorkers();
+        testConcurrentBatches();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(WeakChainScheduler, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
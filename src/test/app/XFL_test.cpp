@@ -0,0 +1,512 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/hook/XFL.h>
+#include <ripple/basics/IOUAmount.h>
+#include <ripple/beast/unit_test.h>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace ripple {
+namespace test {
+
+namespace {
+
+// the float_* implementations the XFL kernels replaced, kept as the reference
+// for the differential tests and as the benchmark baseline
+namespace legacy {
+
+using namespace hook_api;
+using namespace hook_float;
+
+template <typename T>
+int64_t
+normalize_xfl(T& man, int32_t& exp, bool neg = false)
+{
+    constexpr bool sman = std::is_same<T, int64_t>::value;
+
+    if constexpr (sman)
+    {
+        if (man < 0)
+        {
+            man *= -1LL;
+            neg = true;
+        }
+    }
+
+    int32_t mo = log10(man);
+    int32_t adjust = 15 - mo;
+
+    if (adjust > 0)
+    {
+        man *= power_of_ten[adjust];
+        exp -= adjust;
+    }
+    else if (adjust < 0)
+    {
+        man /= power_of_ten[-adjust];
+        exp -= adjust;
+    }
+
+    if (man == 0)
+    {
+        exp = 0;
+        return 0;
+    }
+
+    if (man < minMantissa)
+    {
+        if (man == minMantissa - 1LL)
+            man += 1LL;
+        else
+        {
+            man *= 10LL;
+            exp--;
+        }
+    }
+
+    if (man > maxMantissa)
+    {
+        if (man == maxMantissa + 1LL)
+            man -= 1LL;
+        else
+        {
+            man /= 10LL;
+            exp++;
+        }
+    }
+
+    if (exp < minExponent)
+    {
+        man = 0;
+        exp = 0;
+        return 0;
+    }
+
+    if (man == 0)
+    {
+        exp = 0;
+        return 0;
+    }
+
+    if (exp > maxExponent)
+        return XFL_OVERFLOW;
+
+    int64_t ret = make_float((uint64_t)man, exp, neg);
+    if constexpr (sman)
+    {
+        if (neg)
+            man *= -1LL;
+    }
+
+    return ret;
+}
+
+int64_t
+multiply(int64_t float1, int64_t float2)
+{
+    if (float1 == 0 || float2 == 0)
+        return 0;
+
+    uint64_t man1 = get_mantissa(float1);
+    int32_t exp1 = get_exponent(float1);
+    bool neg1 = is_negative(float1);
+    uint64_t man2 = get_mantissa(float2);
+    int32_t exp2 = get_exponent(float2);
+    bool neg2 = is_negative(float2);
+
+    using namespace boost::multiprecision;
+    cpp_int mult = cpp_int(man1) * cpp_int(man2);
+    mult /= power_of_ten[15];
+    uint64_t man_out = static_cast<uint64_t>(mult);
+    int32_t exp_out = exp1 + exp2 + 15;
+    bool neg_out = (neg1 && !neg2) || (!neg1 && neg2);
+    int64_t ret = legacy::normalize_xfl(man_out, exp_out, neg_out);
+
+    if (ret == EXPONENT_UNDERSIZED)
+        return 0;
+    if (ret == EXPONENT_OVERSIZED)
+        return XFL_OVERFLOW;
+    return ret;
+}
+
+int64_t
+divide(int64_t float1, int64_t float2)
+{
+    if (!is_valid(float1) || !is_valid(float2))
+        return INVALID_FLOAT;
+    if (float2 == 0)
+        return DIVISION_BY_ZERO;
+    if (float1 == 0)
+        return 0;
+    if (float2 == float_one_internal)
+        return float1;
+
+    uint64_t man1 = get_mantissa(float1);
+    int32_t exp1 = get_exponent(float1);
+    bool neg1 = is_negative(float1);
+    uint64_t man2 = get_mantissa(float2);
+    int32_t exp2 = get_exponent(float2);
+    bool neg2 = is_negative(float2);
+
+    int64_t tmp1 = legacy::normalize_xfl(man1, exp1);
+    int64_t tmp2 = legacy::normalize_xfl(man2, exp2);
+
+    if (tmp1 < 0 || tmp2 < 0)
+        return INVALID_FLOAT;
+
+    if (tmp1 == 0)
+        return 0;
+
+    while (man2 > man1)
+    {
+        man2 /= 10;
+        exp2++;
+    }
+
+    if (man2 == 0)
+        return DIVISION_BY_ZERO;
+
+    while (man2 < man1)
+    {
+        if (man2 * 10 > man1)
+            break;
+        man2 *= 10;
+        exp2--;
+    }
+
+    uint64_t man3 = 0;
+    int32_t exp3 = exp1 - exp2;
+
+    while (man2 > 0)
+    {
+        int i = 0;
+        for (; man1 > man2; man1 -= man2, ++i)
+            ;
+
+        man3 *= 10;
+        man3 += i;
+        man2 /= 10;
+        if (man2 == 0)
+            break;
+        exp3--;
+    }
+
+    bool neg3 = !((neg1 && neg2) || (!neg1 && !neg2));
+
+    return legacy::normalize_xfl(man3, exp3, neg3);
+}
+
+int64_t
+sum(int64_t float1, int64_t float2)
+{
+    if (float1 == 0)
+        return float2;
+    if (float2 == 0)
+        return float1;
+
+    int64_t man1 =
+        (int64_t)(get_mantissa(float1)) * (is_negative(float1) ? -1LL : 1LL);
+    int32_t exp1 = get_exponent(float1);
+    int64_t man2 =
+        (int64_t)(get_mantissa(float2)) * (is_negative(float2) ? -1LL : 1LL);
+    int32_t exp2 = get_exponent(float2);
+
+    try
+    {
+        IOUAmount amt1{man1, exp1};
+        IOUAmount amt2{man2, exp2};
+        amt1 += amt2;
+        int64_t result = make_float(amt1);
+        if (result == EXPONENT_UNDERSIZED)
+            return 0;
+        return result;
+    }
+    catch (std::overflow_error&)
+    {
+        return XFL_OVERFLOW;
+    }
+}
+
+// float_compare for the three single relation modes
+int
+compare(int64_t float1, int64_t float2)
+{
+    int64_t man1 =
+        (int64_t)(get_mantissa(float1)) * (is_negative(float1) ? -1LL : 1LL);
+    int32_t exp1 = get_exponent(float1);
+    IOUAmount amt1{man1, exp1};
+    int64_t man2 =
+        (int64_t)(get_mantissa(float2)) * (is_negative(float2) ? -1LL : 1LL);
+    int32_t exp2 = get_exponent(float2);
+    IOUAmount amt2{man2, exp2};
+
+    if (amt1 == amt2)
+        return 0;
+    return amt1 < amt2 ? -1 : 1;
+}
+
+}  // namespace legacy
+
+/**
+ * Random valid XFLs, biased towards the values where the arithmetic has edge
+ * cases: extreme mantissas and exponents, powers of ten and equal operands.
+ */
+class XFLGenerator
+{
+    std::mt19937_64 rng_;
+
+public:
+    explicit XFLGenerator(std::uint64_t seed) : rng_(seed)
+    {
+    }
+
+    int64_t
+    operator()()
+    {
+        using namespace hook_float;
+
+        auto pick = [&](std::uint64_t n) { return rng_() % n; };
+
+        uint64_t man;
+        switch (pick(6))
+        {
+            case 0:
+                man = minMantissa + pick(1000);
+                break;
+            case 1:
+                man = maxMantissa - pick(1000);
+                break;
+            case 2:
+                man = minMantissa * (1 + pick(9));
+                break;
+            default:
+                man = minMantissa + pick(maxMantissa - minMantissa + 1);
+        }
+
+        int32_t exp;
+        switch (pick(4))
+        {
+            case 0:
+                exp = minExponent + static_cast<int32_t>(pick(20));
+                break;
+            case 1:
+                exp = maxExponent - static_cast<int32_t>(pick(20));
+                break;
+            case 2:
+                exp = -15 + static_cast<int32_t>(pick(10)) - 5;
+                break;
+            default:
+                exp = minExponent +
+                    static_cast<int32_t>(pick(maxExponent - minExponent + 1));
+        }
+
+        if (pick(50) == 0)
+            return 0;
+
+        return make_float(man, exp, pick(2) == 0);
+    }
+
+    std::uint64_t
+    raw()
+    {
+        return rng_();
+    }
+};
+
+}  // namespace
+
+class XFL_test : public beast::unit_test::suite
+{
+    static constexpr int iterations = 1'000'000;
+
+    void
+    testNormalize()
+    {
+        testcase("normalize");
+
+        using namespace hook_float;
+
+        auto check = [&](uint64_t value, int32_t exponent) {
+            uint64_t man1 = value, man2 = value;
+            int32_t exp1 = exponent, exp2 = exponent;
+            auto const r1 = normalize_xfl(man1, exp1);
+            auto const r2 = legacy::normalize_xfl(man2, exp2);
+            if (r1 != r2 || man1 != man2 || exp1 != exp2)
+            {
+                fail(
+                    "normalize " + std::to_string(value) + "e" +
+                        std::to_string(exponent),
+                    __FILE__,
+                    __LINE__);
+                return false;
+            }
+            return true;
+        };
+
+        // around every power of ten, where double rounding decides the order,
+        // and around the edges of the window in which the kernel defers to libm
+        bool ok = true;
+        uint64_t power = 1;
+        for (int k = 0; k < 20 && ok; ++k, power *= 10)
+        {
+            uint64_t const window = power / 1'000'000'000'000ULL;
+            for (uint64_t const center :
+                 {power, power - window, power + window, power / 11 * 10})
+            {
+                // log10(0) is undefined, the host functions never normalize it
+                if (center == 0)
+                    continue;
+                for (uint64_t d = 0; d < 5000 && ok; ++d)
+                {
+                    if (center > d + 1)
+                        ok = check(center - d, 0);
+                    if (ok && center + d >= center)
+                        ok = check(center + d, 0);
+                }
+            }
+        }
+        BEAST_EXPECT(ok);
+
+        XFLGenerator gen{1};
+        for (int i = 0; i < iterations && ok; ++i)
+        {
+            auto const r = gen.raw();
+            // spread the values over all orders of magnitude
+            uint64_t const value = r >> (r % 64);
+            if (value != 0)
+                ok = check(value, static_cast<int32_t>(r % 200) - 100);
+        }
+        BEAST_EXPECT(ok);
+
+        // signed mantissas take the sign into the result
+        int64_t man = -123456789;
+        int32_t exp = 0;
+        BEAST_EXPECT(normalize_xfl(man, exp) == make_float(1234567890000000ull, -7, true));
+        BEAST_EXPECT(man == -1234567890000000LL && exp == -7);
+    }
+
+    template <class F, class G>
+    void
+    differential(char const* name, F&& kernel, G&& reference)
+    {
+        testcase(name);
+
+        XFLGenerator gen{std::hash<std::string>{}(name)};
+        for (int i = 0; i < iterations; ++i)
+        {
+            int64_t const a = gen();
+            // equal and opposite operands hit the cancellation and unit paths
+            int64_t const b = i % 16 == 0
+                ? a
+                : (i % 16 == 1 && a != 0 ? hook_float::invert_sign(a) : gen());
+
+            auto const r1 = kernel(a, b);
+            auto const r2 = reference(a, b);
+            if (r1 != r2)
+            {
+                fail(
+                    std::string(name) + " " + std::to_string(a) + " " +
+                        std::to_string(b) + ": " + std::to_string(r1) +
+                        " != " + std::to_string(r2),
+                    __FILE__,
+                    __LINE__);
+                return;
+            }
+        }
+        pass();
+    }
+
+public:
+    void
+    run() override
+    {
+        testNormalize();
+        differential("multiply", hook_float::multiply, legacy::multiply);
+        differential("divide", hook_float::divide, legacy::divide);
+        differential("sum", hook_float::sum, legacy::sum);
+        differential("compare", hook_float::compare, legacy::compare);
+    }
+};
+
+/**
+ * Throughput of the XFL kernels against the implementations they replaced,
+ * over the same stream of random operands.
+ */
+class XFLBench_test : public beast::unit_test::suite
+{
+    static constexpr int operations = 1'000'000;
+
+    int64_t sink_ = 0;  // keeps the results live
+
+    template <class F>
+    std::chrono::nanoseconds
+    time(std::vector<int64_t> const& operands, F&& f)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i + 1 < operands.size(); ++i)
+            sink_ += f(operands[i], operands[i + 1]);
+        return std::chrono::steady_clock::now() - start;
+    }
+
+    template <class F, class G>
+    void
+    compare(
+        char const* name,
+        std::vector<int64_t> const& operands,
+        F&& kernel,
+        G&& reference)
+    {
+        using namespace std::chrono;
+        auto const before = time(operands, reference);
+        auto const after = time(operands, kernel);
+        log << name << ": legacy "
+            << duration_cast<nanoseconds>(before).count() / operations
+            << "ns, xfl " << duration_cast<nanoseconds>(after).count() / operations
+            << "ns per operation" << std::endl;
+    }
+
+public:
+    void
+    run() override
+    {
+        XFLGenerator gen{7};
+        std::vector<int64_t> operands;
+        operands.reserve(operations + 1);
+        while (operands.size() < operations + 1)
+            if (auto const f = gen(); f != 0)
+                operands.push_back(f);
+
+        compare("multiply", operands, hook_float::multiply, legacy::multiply);
+        compare("divide", operands, hook_float::divide, legacy::divide);
+        compare("sum", operands, hook_float::sum, legacy::sum);
+        compare("compare", operands, hook_float::compare, legacy::compare);
+
+        log << "checksum " << sink_ << std::endl;
+        pass();
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(XFL, app, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(XFLBench, app, ripple);
+
+}  // namespace test
+}  // namespace ripple
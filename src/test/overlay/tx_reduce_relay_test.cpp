@@ -20,8 +20,13 @@
 #include <ripple/beast/unit_test.h>
 #include <ripple/overlay/impl/OverlayImpl.h>
 #include <ripple/overlay/impl/PeerImp.h>
+#include <ripple/overlay/impl/TxVerifyQueue.h>
 #include <ripple/peerfinder/impl/SlotImp.h>
-#include <test/jtx/Env.h>
+#include <ripple/protocol/HashPrefix.h>
+#include <ripple/protocol/digest.h>
+#include <test/jtx.h>
+#include <algorithm>
+#include <chrono>
 
 namespace ripple {
 
@@ -35,7 +40,7 @@ public:
     using stream_type = boost::beast::ssl_stream<middle_type>;
     using shared_context = std::shared_ptr<boost::asio::ssl::context>;
 
-private:
+protected:
     void
     doTest(const std::string& msg, bool log, std::function<void(bool)> f)
     {
@@ -155,7 +160,7 @@ public:
     {
     }
 
-private:
+protected:
     void
     addPeer(
         jtx::Env& env,
@@ -229,12 +234,175 @@ private:
             PeerTest::queueTx_ == expectQueue);
     }
 
+    void
+    testDuplicate(bool log)
+    {
+        doTest("Duplicate Tx", log, [&](bool log) {
+            jtx::Env env(*this);
+            jtx::Account const alice{"alice"};
+            env.fund(jtx::XRP(1000), alice);
+            env.close();
+
+            std::vector<std::shared_ptr<PeerTest>> peers;
+            std::uint16_t nDisabled = 0;
+            PeerTest::init();
+            lid_ = 0;
+            rid_ = 0;
+            for (int i = 0; i < 3; i++)
+                addPeer(env, peers, nDisabled);
+
+            auto const jt = env.jt(jtx::noop(alice));
+            Serializer s;
+            jt.stx->add(s);
+
+            auto m = std::make_shared<protocol::TMTransaction>();
+            m->set_rawtransaction(s.data(), s.size());
+            m->set_deferred(false);
+            m->set_status(protocol::TransactionStatus::tsNEW);
+
+            auto const& overlay =
+                dynamic_cast<OverlayImpl&>(env.app().overlay());
+            auto const& duplicates = overlay.getTraffic().getCounts().at(
+                TrafficCount::category::transaction_duplicate);
+
+            // every peer relays the transaction, only the first copy is
+            // parsed and routed under the transaction's ID
+            for (auto const& peer : peers)
+                peer->onMessage(m);
+
+            BEAST_EXPECT(duplicates.messagesIn == 2);
+            BEAST_EXPECT(duplicates.bytesIn == 2 * s.size());
+            BEAST_EXPECT(
+                sha512Half(HashPrefix::transactionID, s.slice()) ==
+                jt.stx->getTransactionID());
+        });
+    }
+
+    void
+    testRejected(bool log)
+    {
+        doTest("Rejected Tx", log, [&](bool log) {
+            jtx::Env env(*this);
+            jtx::Account const alice{"alice"};
+            env.fund(jtx::XRP(1000), alice);
+            env.close();
+
+            std::vector<std::shared_ptr<PeerTest>> peers;
+            std::uint16_t nDisabled = 0;
+            PeerTest::init();
+            lid_ = 0;
+            rid_ = 0;
+            for (int i = 0; i < 2; i++)
+                addPeer(env, peers, nDisabled);
+
+            // every peer relays the blob, returns the flags of its entry
+            auto relay = [&](Slice const& blob) {
+                auto m = std::make_shared<protocol::TMTransaction>();
+                m->set_rawtransaction(blob.data(), blob.size());
+                m->set_deferred(false);
+                m->set_status(protocol::TransactionStatus::tsNEW);
+                for (auto const& peer : peers)
+                    peer->onMessage(m);
+                return env.app().getHashRouter().getFlags(
+                    sha512Half(HashPrefix::transactionID, blob));
+            };
+
+            // a blob which does not parse is routed as bad
+            std::string const junk = "transaction";
+            BEAST_EXPECT(relay(makeSlice(junk)) & SF_BAD);
+
+            // a relayed transaction carrying EmitDetails is remembered as
+            // such, so its copies are charged as the first one was
+            auto const emitted = std::make_shared<STTx const>(
+                ttACCOUNT_SET, [&](STObject& obj) {
+                    obj.setAccountID(sfAccount, alice.id());
+                    obj.setFieldU32(sfSequence, 0);
+                    obj.setFieldAmount(sfFee, STAmount{10});
+                    obj.setFieldVL(sfSigningPubKey, Slice{});
+
+                    STObject details(sfEmitDetails);
+                    details.setFieldU32(sfEmitGeneration, 1);
+                    details.setFieldU64(sfEmitBurden, 1);
+                    details.setFieldH256(sfEmitParentTxnID, uint256{1});
+                    details.setFieldH256(sfEmitNonce, uint256{1});
+                    details.setFieldH256(sfEmitHookHash, uint256{});
+                    obj.emplace_back(std::move(details));
+                });
+            Serializer s;
+            emitted->add(s);
+            auto const flags = relay(s.slice());
+            BEAST_EXPECT(flags & SF_EMITDETAILS);
+            BEAST_EXPECT(!(flags & SF_BAD));
+        });
+    }
+
+    void
+    testVerifyQueue(bool log)
+    {
+        doTest("Verify Queue", log, [&](bool log) {
+            using namespace jtx;
+            Env env(*this);
+            std::vector<Account> const accounts{
+                {"alice", KeyType::secp256k1},
+                {"bob", KeyType::ed25519},
+                {"carol", KeyType::secp256k1},
+                {"dave", KeyType::ed25519},
+                {"erin", KeyType::ed25519}};
+            for (auto const& account : accounts)
+                env.fund(XRP(1000), account);
+            env.close();
+
+            std::vector<std::shared_ptr<PeerTest>> peers;
+            std::uint16_t nDisabled = 0;
+            PeerTest::init();
+            lid_ = 0;
+            rid_ = 0;
+            addPeer(env, peers, nDisabled);
+
+            std::vector<std::shared_ptr<STTx const>> txs;
+            for (auto const& account : accounts)
+                txs.push_back(env.jt(noop(account)).stx);
+
+            // erin's signature is broken, which only changes its own result
+            auto const bad = [&] {
+                STTx tx = *txs.back();
+                auto sig = tx.getFieldVL(sfTxnSignature);
+                sig[sig.size() / 2] ^= 0x01;
+                tx.setFieldVL(sfTxnSignature, sig);
+                Serializer s;
+                tx.add(s);
+                SerialIter sit(s.slice());
+                return std::make_shared<STTx const>(sit);
+            }();
+            txs.back() = bad;
+
+            // batches of two, so the transactions take three jobs
+            TxVerifyQueue queue(env.app(), 2);
+            for (auto const& tx : txs)
+                queue.add(peers.front(), 0, true, tx);
+            env.app().getJobQueue().rendezvous();
+            BEAST_EXPECT(queue.size() == 0);
+
+            auto& router = env.app().getHashRouter();
+            for (auto const& tx : txs)
+            {
+                auto const id = tx->getTransactionID();
+                bool const good = tx != bad;
+                BEAST_EXPECT(env.current()->txExists(id) == good);
+                BEAST_EXPECT(((router.getFlags(id) & SF_BAD) == 0) == good);
+            }
+        });
+    }
+
     void
     run() override
     {
         bool log = false;
         std::set<Peer::id_t> skip = {0, 1, 2, 3, 4};
         testConfig(log);
+        testDuplicate(log);
+        testRejected(log);
+        testVerifyQueue(log);
         // relay to all peers, no hash queue
         testRelay("feature disabled", false, 10, 0, 10, 25, 10, 0);
         // relay to nPeers - skip (10-5=5)
@@ -270,6 +438,121 @@ private:
     }
 };
 
+/**
+ * Relays signed transactions, a mix of secp256k1 and Ed25519 ones, from a
+ * peer and times checking and applying them, once with a job for every
+ * transaction and once in batches.
+ *
+ *   --unittest=tx_verify_queue_bench
+ *   --unittest-arg=txs=<n>,ed25519=<pct>,batch=<n>
+ *
+ * txs      transactions relayed, each from its own account (default 2000)
+ * ed25519  percentage of the transactions signed with Ed25519 (default 50)
+ * batch    transactions a job takes at most (default 64)
+ */
+class tx_verify_queue_bench_test : public tx_reduce_relay_test
+{
+    std::chrono::nanoseconds
+    relay(std::size_t txs, std::size_t ed25519, std::size_t batchSize)
+    {
+        using namespace jtx;
+        Env env{*this, envconfig([txs](std::unique_ptr<Config> cfg) {
+                    cfg->section("transaction_queue")
+                        .set(
+                            "minimum_txn_in_ledger_standalone",
+                            std::to_string(txs));
+                    return cfg;
+                })};
+
+        std::vector<Account> accounts;
+        accounts.reserve(txs);
+        for (std::size_t i = 0; i < txs; ++i)
+        {
+            accounts.emplace_back(
+                "bench" + std::to_string(i),
+                (i * ed25519) % 100 < ed25519 ? KeyType::ed25519
+                                               : KeyType::secp256k1);
+            env.fund(XRP(1000), accounts.back());
+        }
+        env.close();
+
+        std::vector<std::shared_ptr<PeerTest>> peers;
+        std::uint16_t nDisabled = 0;
+        PeerTest::init();
+        lid_ = 0;
+        rid_ = 0;
+        addPeer(env, peers, nDisabled);
+
+        std::vector<std::shared_ptr<STTx const>> relayed;
+        relayed.reserve(txs);
+        for (auto const& account : accounts)
+            relayed.push_back(env.jt(jtx::noop(account)).stx);
+
+        TxVerifyQueue queue(env.app(), batchSize);
+        auto const start = std::chrono::steady_clock::now();
+        for (auto const& tx : relayed)
+            queue.add(peers.front(), 0, true, tx);
+        env.app().getJobQueue().rendezvous();
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+
+        BEAST_EXPECT(std::all_of(
+            relayed.begin(), relayed.end(), [&](auto const& tx) {
+                return env.current()->txExists(tx->getTransactionID());
+            }));
+        return elapsed;
+    }
+
+public:
+    void
+    run() override
+    {
+        using namespace std::chrono;
+
+        std::size_t txs = 2000;
+        std::size_t ed25519 = 50;
+        std::size_t batch = TxVerifyQueue::defaultBatchSize;
+        {
+            std::string const args = arg();
+            std::size_t pos = 0;
+            while (pos < args.size())
+            {
+                std::size_t const end =
+                    std::min(args.find(',', pos), args.size());
+                std::string const kv = args.substr(pos, end - pos);
+                pos = end + 1;
+
+                std::size_t const eq = kv.find('=');
+                if (eq == std::string::npos)
+                    continue;
+                if (kv.substr(0, eq) == "txs")
+                    txs = std::stoul(kv.substr(eq + 1));
+                else if (kv.substr(0, eq) == "ed25519")
+                    ed25519 = std::min<std::size_t>(
+                        std::stoul(kv.substr(eq + 1)), 100);
+                else if (kv.substr(0, eq) == "batch")
+                    batch = std::max<std::size_t>(
+                        std::stoul(kv.substr(eq + 1)), 1);
+            }
+        }
+
+        auto const single = relay(txs, ed25519, 1);
+        auto const batched = relay(txs, ed25519, batch);
+
+        auto const perSecond = [txs](auto elapsed) {
+            return txs * 1000 /
+                std::max<std::int64_t>(
+                       duration_cast<milliseconds>(elapsed).count(), 1);
+        };
+        log << txs << " transactions, " << ed25519 << "% Ed25519: "
+            << duration_cast<milliseconds>(single).count()
+            << "ms with a job each (" << perSecond(single) << " tx/s), "
+            << duration_cast<milliseconds>(batched).count()
+            << "ms in batches of " << batch << " (" << perSecond(batched)
+            << " tx/s)" << std::endl;
+    }
+};
+
 BEAST_DEFINE_TESTSUITE(tx_reduce_relay, ripple_data, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(tx_verify_queue_bench, ripple_data, ripple);
 }  // namespace test
 }  // namespace ripple
\ No newline at end of file
@@ -54,6 +54,8 @@ class Hooks_test : public beast::unit_test::suite
             sfEmitBurden,
             sfHookReturnCode,
             sfReferenceCount,
+            sfHookFuel,
+            sfHookCallbackFuel,
             sfEmitParentTxnID,
             sfEmitNonce,
             sfEmitHookHash,
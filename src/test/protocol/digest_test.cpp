@@ -0,0 +1,109 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/basics/Slice.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <optional>
+#include <vector>
+
+namespace ripple {
+
+class digest_test : public beast::unit_test::suite
+{
+    // Hash count random messages of the given size in one batch, with the
+    // kernel of that many lanes or, without lanes, the one chosen for this
+    // CPU, and compare each result with sha512Half of the same message.
+    void
+    check(
+        beast::xor_shift_engine& engine,
+        std::size_t size,
+        std::size_t count,
+        std::optional<std::size_t> lanes)
+    {
+        std::vector<std::uint8_t> buffer(size * count);
+        for (auto& b : buffer)
+            b = static_cast<std::uint8_t>(engine());
+
+        std::vector<std::uint8_t const*> messages;
+        for (std::size_t i = 0; i < count; ++i)
+            messages.push_back(buffer.data() + i * size);
+
+        std::vector<uint256> results(count);
+        if (lanes)
+            detail::sha512HalfBatchWith(
+                *lanes, messages.data(), size, count, results.data());
+        else
+            sha512HalfBatch(messages.data(), size, count, results.data());
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!BEAST_EXPECT(
+                    results[i] == sha512Half(Slice(messages[i], size))))
+            {
+                log << "size " << size << ", count " << count
+                    << ", message " << i << std::endl;
+                return;
+            }
+        }
+    }
+
+    void
+    checkAll(std::optional<std::size_t> lanes)
+    {
+        beast::xor_shift_engine engine(42);
+
+        // around the boundaries of the one and two block paddings, and the
+        // 516 bytes of an inner node
+        for (std::size_t size :
+             {0, 1, 64, 111, 112, 113, 127, 128, 129, 239, 240, 256, 516, 1000})
+        {
+            for (std::size_t count : {0, 1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 33})
+                check(engine, size, count, lanes);
+        }
+    }
+
+public:
+    void
+    run() override
+    {
+        testcase("sha512HalfBatch, " +
+                 std::to_string(sha512HalfBatchLanes()) + " lanes");
+        checkAll(std::nullopt);
+
+        // every kernel this CPU can run, whichever the batch picked
+        for (std::size_t lanes : {1, 4, 8})
+        {
+            if (!detail::sha512HalfBatchWith(lanes, nullptr, 0, 0, nullptr))
+            {
+                log << "no " << lanes << " lane kernel on this machine"
+                    << std::endl;
+                continue;
+            }
+
+            testcase(std::to_string(lanes) + " lane kernel");
+            checkAll(lanes);
+        }
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(digest, protocol, ripple);
+
+}  // namespace ripple
@@ -0,0 +1,267 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+#include <ripple/app/misc/NetworkOPs.h>
+#include <ripple/json/json_writer.h>
+#include <ripple/net/InfoSub.h>
+#include <ripple/protocol/jss.h>
+#include <ripple/server/WSSession.h>
+#include <test/jtx.h>
+#include <boost/beast/core/multi_buffer.hpp>
+#include <chrono>
+
+namespace ripple {
+namespace test {
+
+namespace {
+
+// drain a websocket message the way a session writes it out
+std::string
+drain(WSMsg& m, std::size_t chunk)
+{
+    std::string out;
+    for (;;)
+    {
+        auto const [done, buffers] = m.prepare(chunk, [] {});
+        for (auto const& b : buffers)
+            out.append(static_cast<char const*>(b.data()), b.size());
+        if (done)
+            return out;
+    }
+}
+
+std::string
+streamed(Json::Value const& jv)
+{
+    std::string s;
+    Json::stream(jv, [&](void const* data, std::size_t n) {
+        s.append(static_cast<char const*>(data), n);
+    });
+    return s;
+}
+
+// a subscriber which takes the Json::Value of every message
+class JsonSub : public InfoSub
+{
+public:
+    std::vector<std::string> received;
+
+    explicit JsonSub(Source& source) : InfoSub(source)
+    {
+    }
+
+    void
+    send(Json::Value const& jv, bool) override
+    {
+        received.push_back(streamed(jv));
+    }
+};
+
+// a subscriber which shares the text of published messages, as WSInfoSub
+class TextSub : public JsonSub
+{
+public:
+    std::vector<std::shared_ptr<std::string const>> shared;
+
+    using JsonSub::JsonSub;
+
+protected:
+    void
+    sendMessage(Message const& message, bool) override
+    {
+        shared.push_back(message.text());
+    }
+};
+
+// a validated transaction as pubValidatedTransaction publishes it
+Json::Value
+validatedTransaction(jtx::Env& env)
+{
+    using namespace jtx;
+
+    Account const alice{"alice"};
+    env.fund(XRP(10000), alice);
+    env.close();
+    env(pay(env.master, alice, XRP(100)));
+
+    Json::Value jv(Json::objectValue);
+    jv[jss::type] = "transaction";
+    jv[jss::transaction] = env.tx()->getJson(JsonOptions::none);
+    jv[jss::meta] = env.meta()->getJson(JsonOptions::none);
+    jv[jss::engine_result] = "tesSUCCESS";
+    jv[jss::validated] = true;
+    return jv;
+}
+
+}  // namespace
+
+class InfoSubMessage_test : public beast::unit_test::suite
+{
+    void
+    testSharedWSMsg()
+    {
+        testcase("SharedWSMsg");
+
+        auto const text = std::make_shared<std::string const>(
+            "{\"type\":\"ledgerClosed\",\"ledger_index\":12345}");
+
+        // every session writes the whole text whatever its chunk size
+        for (std::size_t chunk : {1, 7, 16, 4096})
+        {
+            SharedWSMsg m{text};
+            BEAST_EXPECT(drain(m, chunk) == *text);
+        }
+
+        SharedWSMsg empty{std::make_shared<std::string const>()};
+        BEAST_EXPECT(drain(empty, 16).empty());
+    }
+
+    void
+    testMessage()
+    {
+        testcase("Message");
+
+        using namespace jtx;
+        Env env{*this};
+
+        Json::Value const jv = validatedTransaction(env);
+        InfoSub::Message const message(jv);
+        BEAST_EXPECT(&message.json() == &jv);
+
+        // serialized once, on first use, exactly as WSInfoSub::send streams
+        auto const& text = message.text();
+        BEAST_EXPECT(*text == streamed(jv));
+        BEAST_EXPECT(message.text().get() == text.get());
+
+        auto a = std::make_shared<TextSub>(env.app().getOPs());
+        auto b = std::make_shared<TextSub>(env.app().getOPs());
+        auto c = std::make_shared<JsonSub>(env.app().getOPs());
+        for (InfoSub::pointer p :
+             std::vector<InfoSub::pointer>{a, b, c})
+            p->send(message, true);
+
+        // text subscribers share one string, the others still get the value
+        BEAST_EXPECT(a->shared.size() == 1 && a->shared[0] == text);
+        BEAST_EXPECT(b->shared.size() == 1 && b->shared[0] == text);
+        BEAST_EXPECT(a->received.empty());
+        BEAST_EXPECT(c->received.size() == 1 && c->received[0] == *text);
+
+        // sending the value itself is unchanged
+        InfoSub::pointer const p = a;
+        p->send(jv, true);
+        BEAST_EXPECT(a->received.size() == 1);
+    }
+
+public:
+    void
+    run() override
+    {
+        testSharedWSMsg();
+        testMessage();
+    }
+};
+
+/**
+ * Publishes one validated transaction to many websocket subscribers, once by
+ * serializing it per subscriber as WSInfoSub::send does, and once through an
+ * InfoSub::Message whose text the subscribers share.
+ *
+ *   --unittest=InfoSubMessageBench --unittest-arg=subscribers=<n>,ledgers=<n>
+ *
+ * subscribers  websocket sessions the message is sent to (default 1000)
+ * ledgers      times the message is published (default 100)
+ */
+class InfoSubMessageBench_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        using namespace std::chrono;
+
+        std::size_t subscribers = 1000;
+        std::size_t ledgers = 100;
+        {
+            std::string const args = arg();
+            std::size_t pos = 0;
+            while (pos < args.size())
+            {
+                std::size_t const end =
+                    std::min(args.find(',', pos), args.size());
+                std::string const kv = args.substr(pos, end - pos);
+                pos = end + 1;
+
+                std::size_t const eq = kv.find('=');
+                if (eq == std::string::npos)
+                    continue;
+                if (kv.substr(0, eq) == "subscribers")
+                    subscribers = std::stoul(kv.substr(eq + 1));
+                else if (kv.substr(0, eq) == "ledgers")
+                    ledgers = std::stoul(kv.substr(eq + 1));
+            }
+        }
+
+        jtx::Env env{*this};
+        Json::Value const jv = validatedTransaction(env);
+        std::size_t bytes = 0;
+
+        // per subscriber: what every session costs without a shared message
+        auto const start = steady_clock::now();
+        for (std::size_t l = 0; l < ledgers; ++l)
+        {
+            for (std::size_t s = 0; s < subscribers; ++s)
+            {
+                boost::beast::multi_buffer sb;
+                Json::stream(jv, [&](void const* data, std::size_t n) {
+                    sb.commit(boost::asio::buffer_copy(
+                        sb.prepare(n), boost::asio::buffer(data, n)));
+                });
+                StreambufWSMsg<decltype(sb)> m{std::move(sb)};
+                bytes += drain(m, 4096).size();
+            }
+        }
+        auto const perSubscriber = steady_clock::now() - start;
+
+        // shared: serialized once per ledger
+        auto const mid = steady_clock::now();
+        for (std::size_t l = 0; l < ledgers; ++l)
+        {
+            InfoSub::Message const message(jv);
+            for (std::size_t s = 0; s < subscribers; ++s)
+            {
+                SharedWSMsg m{message.text()};
+                bytes -= drain(m, 4096).size();
+            }
+        }
+        auto const shared = steady_clock::now() - mid;
+
+        BEAST_EXPECT(bytes == 0);
+
+        log << subscribers << " subscribers, " << ledgers << " ledgers: "
+            << duration_cast<milliseconds>(perSubscriber).count()
+            << "ms serializing per subscriber, "
+            << duration_cast<milliseconds>(shared).count()
+            << "ms serializing once" << std::endl;
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(InfoSubMessage, rpc, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(InfoSubMessageBench, rpc, ripple);
+
+}  // namespace test
+}  // namespace ripple
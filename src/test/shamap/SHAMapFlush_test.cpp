@@ -0,0 +1,329 @@
+//------------------------------------------------------------------------------
+/*
+    This file is part of rippled: https://github.com/ripple/rippled
+    Copyright (c) 2012-2016 Ripple Labs Inc.
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    THE  SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+    WITH  REGARD  TO  THIS  SOFTWARE  INCLUDING  ALL  IMPLIED  WARRANTIES  OF
+    MERCHANTABILITY  AND  FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+    ANY  SPECIAL ,  DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+    WHATSOEVER  RESULTING  FROM  LOSS  OF USE, DATA OR PROFITS, WHETHER IN AN
+    ACTION  OF  CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+    OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+//==============================================================================
+
+#include <ripple/basics/Slice.h>
+#include <ripple/beast/unit_test.h>
+#include <ripple/beast/xor_shift_engine.h>
+#include <ripple/protocol/digest.h>
+#include <ripple/shamap/SHAMap.h>
+#include <test/shamap/common.h>
+#include <test/unit_test/SuiteJournal.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+namespace tests {
+
+namespace {
+
+uint256
+randomKey(beast::xor_shift_engine& engine)
+{
+    uint256 key;
+    for (auto& b : key)
+        b = static_cast<std::uint8_t>(engine());
+    return key;
+}
+
+void
+addItem(SHAMap& map, uint256 const& key, std::uint8_t fill)
+{
+    Blob const data(40, fill);
+    map.addItem(
+        SHAMapNodeType::tnACCOUNT_STATE, SHAMapItem{key, makeSlice(data)});
+}
+
+}  // namespace
+
+/** Flushing hashes the dirty inner nodes of a level in one batch, and
+    flushing to the nodestore works on the subtrees below the root on a pool
+    of threads.
+*/
+class SHAMapFlush_test : public beast::unit_test::suite
+{
+    // Build a map over many ledgers, unsharing its nodes from snapshots each
+    // time, and check it hashes the same as the map built at once from its
+    // final items.
+    void
+    testUnshare(beast::Journal const& journal)
+    {
+        testcase("batched flush");
+
+        TestNodeFamily f{journal};
+        beast::xor_shift_engine engine(7);
+
+        SHAMap map(SHAMapType::STATE, f);
+        map.setUnbacked();
+
+        std::vector<uint256> keys;
+        for (int i = 0; i < 5000; ++i)
+        {
+            keys.push_back(randomKey(engine));
+            addItem(map, keys.back(), 1);
+        }
+
+        std::vector<SHAMapHash> ledgerHashes;
+        std::vector<std::shared_ptr<SHAMap>> snapshots;
+        for (int ledger = 0; ledger < 10; ++ledger)
+        {
+            ledgerHashes.push_back(map.getHash());
+            snapshots.push_back(map.snapShot(true));
+
+            for (int i = 0; i < 200; ++i)
+            {
+                keys.push_back(randomKey(engine));
+                addItem(map, keys.back(), 1);
+            }
+            for (int i = 0; i < 100; ++i)
+            {
+                auto const n = engine() % keys.size();
+                BEAST_EXPECT(map.delItem(keys[n]));
+                keys[n] = keys.back();
+                keys.pop_back();
+            }
+            map.invariants();
+        }
+
+        SHAMap rebuilt(SHAMapType::STATE, f);
+        rebuilt.setUnbacked();
+        for (auto const& key : keys)
+            addItem(rebuilt, key, 1);
+
+        BEAST_EXPECT(map.getHash() != beast::zero);
+        BEAST_EXPECT(map.getHash() == rebuilt.getHash());
+
+        // flushing the map didn't touch the snapshots
+        for (std::size_t i = 0; i < snapshots.size(); ++i)
+            BEAST_EXPECT(snapshots[i]->getHash() == ledgerHashes[i]);
+    }
+
+    // Flush a backed map to the nodestore and read it back from there.
+    void
+    testFlushDirty(beast::Journal const& journal)
+    {
+        testcase("flush to the nodestore");
+
+        TestNodeFamily f{journal};
+        beast::xor_shift_engine engine(11);
+
+        SHAMap map(SHAMapType::STATE, f);
+        SHAMap unbacked(SHAMapType::STATE, f);
+        unbacked.setUnbacked();
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            auto const key = randomKey(engine);
+            addItem(map, key, 3);
+            addItem(unbacked, key, 3);
+        }
+
+        // the items and every inner node above them
+        BEAST_EXPECT(map.flushDirty(hotACCOUNT_NODE) > 5000);
+        BEAST_EXPECT(map.flushDirty(hotACCOUNT_NODE) == 0);
+
+        auto const hash = map.getHash();
+        BEAST_EXPECT(hash == unbacked.getHash());
+        BEAST_EXPECT(f.db().fetchNodeObject(hash.as_uint256()) != nullptr);
+
+        // forget the cached nodes, so they all come from the nodestore
+        f.reset();
+
+        SHAMap fetched(SHAMapType::STATE, hash.as_uint256(), f);
+        BEAST_EXPECT(fetched.fetchRoot(hash, nullptr));
+
+        std::size_t items = 0;
+        for (auto const& item : fetched)
+        {
+            BEAST_EXPECT(unbacked.hasItem(item.key()));
+            ++items;
+        }
+        BEAST_EXPECT(items == 5000);
+    }
+
+    // Flush the same map on the calling thread alone and on the pool, and
+    // check the two store the same nodes.
+    void
+    testParallel(beast::Journal const& journal)
+    {
+        testcase("parallel flush");
+
+        auto flush = [&](TestNodeFamily& f, std::size_t threads) {
+            beast::xor_shift_engine engine(13);
+
+            auto map = std::make_shared<SHAMap>(SHAMapType::STATE, f);
+            for (int i = 0; i < 5000; ++i)
+                addItem(*map, randomKey(engine), 5);
+
+            SHAMap::setFlushThreads(threads);
+            int const flushed = map->flushDirty(hotACCOUNT_NODE);
+            BEAST_EXPECT(flushed > 5000);
+            BEAST_EXPECT(
+                f.db().getStoreCount() == static_cast<std::uint64_t>(flushed));
+
+            // change a few items, so the next flush is partial
+            for (int i = 0; i < 100; ++i)
+                addItem(*map, randomKey(engine), 6);
+            BEAST_EXPECT(map->flushDirty(hotACCOUNT_NODE) > 100);
+            return map;
+        };
+
+        TestNodeFamily serialFamily{journal};
+        TestNodeFamily parallelFamily{journal};
+
+        auto const serial = flush(serialFamily, 1);
+        auto const parallel = flush(parallelFamily, 4);
+        SHAMap::setFlushThreads(std::thread::hardware_concurrency());
+
+        BEAST_EXPECT(serial->getHash() == parallel->getHash());
+        BEAST_EXPECT(
+            serialFamily.db().getStoreCount() ==
+            parallelFamily.db().getStoreCount());
+
+        // every node of the map was stored by both flushes
+        std::size_t nodes = 0;
+        serial->visitNodes([&](SHAMapTreeNode& node) {
+            auto const hash = node.getHash().as_uint256();
+            BEAST_EXPECT(serialFamily.db().fetchNodeObject(hash) != nullptr);
+            BEAST_EXPECT(
+                parallelFamily.db().fetchNodeObject(hash) != nullptr);
+            ++nodes;
+            return true;
+        });
+        BEAST_EXPECT(nodes > 5100);
+    }
+
+public:
+    void
+    run() override
+    {
+        test::SuiteJournal journal("SHAMapFlush_test", *this);
+
+        testUnshare(journal);
+        testFlushDirty(journal);
+        testParallel(journal);
+    }
+};
+
+/** Times the hashing done when a ledger closes: the dirty nodes of a state
+    map are flushed after each ledger's changes. For comparison, the same
+    number of inner node sized messages is also hashed one by one and in
+    batches.
+
+      --unittest=SHAMapFlushBench --unittest-arg=items=<n>,changes=<n>,ledgers=<n>
+
+    items    entries in the state map (default 100000)
+    changes  entries added to it per ledger (default 2000)
+    ledgers  ledgers closed (default 100)
+*/
+class SHAMapFlushBench_test : public beast::unit_test::suite
+{
+public:
+    void
+    run() override
+    {
+        using namespace std::chrono;
+
+        std::size_t items = 100000;
+        std::size_t changes = 2000;
+        std::size_t ledgers = 100;
+        {
+            std::string const args = arg();
+            std::size_t pos = 0;
+            while (pos < args.size())
+            {
+                std::size_t const end =
+                    std::min(args.find(',', pos), args.size());
+                std::string const kv = args.substr(pos, end - pos);
+                pos = end + 1;
+
+                std::size_t const eq = kv.find('=');
+                if (eq == std::string::npos)
+                    continue;
+                if (kv.substr(0, eq) == "items")
+                    items = std::stoul(kv.substr(eq + 1));
+                else if (kv.substr(0, eq) == "changes")
+                    changes = std::stoul(kv.substr(eq + 1));
+                else if (kv.substr(0, eq) == "ledgers")
+                    ledgers = std::stoul(kv.substr(eq + 1));
+            }
+        }
+
+        test::SuiteJournal journal("SHAMapFlushBench_test", *this);
+        TestNodeFamily f{journal};
+        beast::xor_shift_engine engine(7);
+
+        SHAMap map(SHAMapType::STATE, f);
+        map.setUnbacked();
+        for (std::size_t i = 0; i < items; ++i)
+            addItem(map, randomKey(engine), 1);
+        map.getHash();
+
+        std::size_t flushed = 0;
+        steady_clock::duration flush{};
+        for (std::size_t l = 0; l < ledgers; ++l)
+        {
+            auto const snapshot = map.snapShot(true);
+            for (std::size_t i = 0; i < changes; ++i)
+                addItem(map, randomKey(engine), 2);
+
+            auto const start = steady_clock::now();
+            flushed += map.unshare();
+            flush += steady_clock::now() - start;
+        }
+
+        BEAST_EXPECT(flushed > changes * ledgers);
+
+        // the inner nodes flushed are about all nodes less the leaves added
+        std::size_t const inner =
+            flushed - std::min(flushed, changes * ledgers);
+        std::size_t const size = 4 + 16 * uint256::size();
+        std::size_t const distinct = std::min<std::size_t>(inner, 4096);
+        std::vector<std::uint8_t> buffer(size * distinct);
+        for (auto& b : buffer)
+            b = static_cast<std::uint8_t>(engine());
+
+        std::vector<std::uint8_t const*> messages;
+        for (std::size_t i = 0; i < inner; ++i)
+            messages.push_back(buffer.data() + (i % distinct) * size);
+        std::vector<uint256> results(inner);
+
+        auto const start = steady_clock::now();
+        for (std::size_t i = 0; i < inner; ++i)
+            results[i] = sha512Half(Slice(messages[i], size));
+        auto const mid = steady_clock::now();
+        sha512HalfBatch(messages.data(), size, inner, results.data());
+        auto const end = steady_clock::now();
+
+        log << items << " items, " << changes << " changes per ledger, "
+            << ledgers << " ledgers: "
+            << duration_cast<microseconds>(flush).count() / ledgers
+            << "us flushing per ledger; " << inner << " inner node hashes: "
+            << duration_cast<milliseconds>(mid - start).count()
+            << "ms one by one, "
+            << duration_cast<milliseconds>(end - mid).count() << "ms in "
+            << sha512HalfBatchLanes() << " lanes" << std::endl;
+    }
+};
+
+BEAST_DEFINE_TESTSUITE(SHAMapFlush, shamap, ripple);
+BEAST_DEFINE_TESTSUITE_MANUAL(SHAMapFlushBench, shamap, ripple);
+
+}  // namespace tests
+}  // namespace ripple